@@ -94,7 +94,8 @@ typedef enum _ZZSTATUS {
     ZZ_ALREADY_INIT,
     ZZ_ALREADY_ENABLED,
     ZZ_NEED_INIT,
-    ZZ_NO_BUILD_HOOK
+    ZZ_NO_BUILD_HOOK,
+    ZZ_PARTIAL_HOOK
 } ZZSTATUS;
 
 typedef enum _ZZHOOKTYPE {
@@ -102,9 +103,35 @@ typedef enum _ZZHOOKTYPE {
     HOOK_TYPE_FUNCTION_via_PRE_POST,
     HOOK_TYPE_FUNCTION_via_REPLACE,
     HOOK_TYPE_FUNCTION_via_GOT,
-    HOOK_TYPE_DBI
+    HOOK_TYPE_DBI,
+    HOOK_TYPE_DBI_BLOCK,
+    HOOK_TYPE_DBI_COUNTER,
+    HOOK_TYPE_ONE_SHOT,
+    HOOK_TYPE_FUNCTION_via_CALL_SITE
 }ZZHOOKTYPE;
 
+typedef enum _ZZCOUNTERTYPE {
+    COUNTER_TYPE_HIT = 0,
+    COUNTER_TYPE_COVERAGE
+} ZZCOUNTERTYPE;
+
+typedef enum _ZZPREDICATETYPE {
+    PREDICATE_TYPE_EQ = 0,
+    PREDICATE_TYPE_NE,
+    PREDICATE_TYPE_MASK,
+    PREDICATE_TYPE_RANGE
+} ZZPREDICATETYPE;
+
+// argument register predicate, compiled into the enter trampoline.
+// EQ: reg == value, NE: reg != value, MASK: (reg & mask) == value, RANGE: value <= reg <= upper (unsigned)
+typedef struct _HookPredicate {
+    ZZPREDICATETYPE type;
+    unsigned int reg;
+    unsigned long value;
+    unsigned long mask;
+    unsigned long upper;
+} HookPredicate;
+
 typedef struct _CallStack {
     unsigned long call_id;
     struct _ThreadStack *ts;
@@ -143,6 +170,9 @@ typedef void (*POSTCALL)(RegState *rs, ThreadStack *ts, CallStack *cs, const Hoo
 
 typedef void (*STUBCALL)(RegState *rs, const HookEntryInfo *info);
 
+// name is NULL if the function has no symbol, return false to skip the function
+typedef bool (*MODULEFUNCTIONFILTER)(const char *name, void *address, unsigned long size);
+
 // ------- export API -------
 
 #define STACK_CHECK_KEY(cs, key) (bool)ZzGetCallStackData(cs, key)
@@ -173,26 +203,123 @@ ZZSTATUS ZzBuildHook(void *target_ptr, void *replace_call_ptr, void **origin_ptr
 ZZSTATUS ZzEnableHook(void *target_ptr);
 
 ZZSTATUS ZzHook(void *target_ptr, void *replace_ptr, void **origin_ptr, PRECALL pre_call_ptr, POSTCALL post_call_ptr, bool try_near_jump);
+// hook the same target more than once, each pre/post pair is attached as another listener of the same hook entry
 ZZSTATUS ZzHookPrePost(void *target_ptr, PRECALL pre_call_ptr, POSTCALL post_call_ptr);
+// detach the listener, the hook stay enabled
+ZZSTATUS ZzDetachPrePost(void *target_ptr, PRECALL pre_call_ptr, POSTCALL post_call_ptr);
 ZZSTATUS ZzHookReplace(void *target_ptr, void *replace_ptr, void **origin_ptr);
+// hook a symbol of the module (full path or file name, NULL for every module), resolved through the cached .gnu.hash/.dynsym/.symtab tables on elf
+ZZSTATUS ZzHookByName(const char *module_name, const char *symbol_name, void *replace_ptr, void **origin_ptr,
+                      PRECALL pre_call_ptr, POSTCALL post_call_ptr);
+// pre/post hook every function of the module (full path or file name, elf: .symtab/.dynsym, macho:
+// LC_FUNCTION_STARTS) the filter accepts, switched on with one batched patch. use it with ZzSetLazyTrampolineMode, only
+// the functions that are called get trampolines. the functions the callbacks or HookZz call must be filtered out
+ZZSTATUS ZzHookModule(const char *module_name, PRECALL pre_call_ptr, POSTCALL post_call_ptr,
+                      MODULEFUNCTIONFILTER filter);
+
+// pre/post hook, only the calls that match all the predicates run into pre_call/post_call (only support arm64)
+ZZSTATUS ZzHookPrePostWithPredicate(void *target_ptr, PRECALL pre_call_ptr, POSTCALL post_call_ptr,
+                                    const HookPredicate *predicates, unsigned long predicate_count);
 
 // hook only one instruciton with instruction address
 ZZSTATUS ZzHookOneInstruction(void *insn_address, PRECALL pre_call_ptr, POSTCALL post_call_ptr, bool try_near_jump);
 
-// got hook (only support macho)
+// got hook (macho/elf), replace only hook need no trampoline
 ZZSTATUS ZzHookGOT(const char *name, void *replace_ptr, void **origin_ptr, PRECALL pre_call_ptr, POSTCALL post_call_ptr);
+// got hook, only the imports of the module (full path or file name) (only support elf, macho returns ZZ_FAILED, the
+// ZzHookGOT of macho rebinds the main image only)
+ZZSTATUS ZzHookGOTInModule(const char *module_name, const char *name, void *replace_ptr, void **origin_ptr,
+                           PRECALL pre_call_ptr, POSTCALL post_call_ptr);
+
+// pending hook, installed with the other hooks of the module in one batch once a module matching the pattern (fnmatch
+// on full path or file name) is loaded, pending again after it is unloaded. symbol_name NULL, hook module base + offset
+ZZSTATUS ZzHookPending(const char *module_pattern, const char *symbol_name, unsigned long offset, void *replace_ptr,
+                       void **origin_ptr, PRECALL pre_call_ptr, POSTCALL post_call_ptr);
+// install/reclaim the pending hooks now, dlopen/dlclose are observed already (elf: through the got, macho: dyld)
+ZZSTATUS ZzCheckPendingHooks(void);
 
 // runtime code patch
 ZZSTATUS ZzRuntimeCodePatch(void *address, void *code_data, unsigned long code_length);
 
 ZZSTATUS ZzDynamicBinaryInstrumentation(void *address, STUBCALL stub_call_ptr);
 
+// block dbi, the code of [range_begin, range_end) reached from address runs from a code cache of translated basic
+// blocks, block_call is called at the head of every block with hook_address set to it (only support arm64). the
+// blocks are chained, only the indirect branches look the target up. x17 is used as scratch
+ZZSTATUS ZzDynamicBinaryInstrumentationBlock(void *address, void *range_begin, void *range_end, STUBCALL block_call_ptr);
+
+// counter dbi, the instruction atomically bumps its counter slot (COUNTER_TYPE_COVERAGE: sets it to 1) with an inline
+// sequence, no context save and no callback (only support arm64). x15/x16 are saved on the stack, x17 is used as scratch
+ZZSTATUS ZzDynamicBinaryInstrumentationCounter(void *insn_address, ZZCOUNTERTYPE counter_type);
+unsigned long ZzGetInstrumentationCounter(void *insn_address);
+// write every counter as a `module+offset count` line (`address count` out of any module)
+ZZSTATUS ZzExportCoverage(const char *path);
+
+// one-shot hook, the first hit records the address and takes the hook out again, the later calls run native. the
+// prologue is restored if it is a single instruction (near jump) or in safe patch mode, otherwise the trampoline jumps
+// to the relocated prologue directly
+ZZSTATUS ZzHookOneShot(void *target_ptr);
+// one-shot hook every function of the module the filter accepts, switched on with one batched patch
+ZZSTATUS ZzHookModuleOneShot(const char *module_name, MODULEFUNCTIONFILTER filter);
+// write the one-shot hits as `module+offset` lines (`address` out of any module)
+ZZSTATUS ZzExportOneShotCoverage(const char *path);
+
+// patch the `bl` of the module that call the target (directly or through its plt/stub) instead of the target, callers
+// out of the module run the target as is (arm64 only). a lazily bound stub is matched once it is bound. ZZ_PARTIAL_HOOK
+// if some call sites have no veneer in range, they call the target as is.
+ZZSTATUS ZzHookCallSites(const char *module_name, void *target_ptr, void *replace_ptr, void **origin_ptr,
+                         PRECALL pre_call_ptr, POSTCALL post_call_ptr);
+// restore the call sites, a later ZzHookCallSites of the same module/target patches them again
+ZZSTATUS ZzDisableCallSites(const char *module_name, void *target_ptr);
+
+// hook a function of an elf instrumented ahead of time by tools/StaticBinaryInstrumentation, the prologue is patched in
+// the file and the trampolines are in the segments it appended, only the entry and the callbacks are bound here. no
+// code is generated or allocated per hook (only support arm64 elf)
+ZZSTATUS ZzHookSolidified(void *target_ptr, void *replace_ptr, void **origin_ptr, PRECALL pre_call_ptr,
+                          POSTCALL post_call_ptr);
+// unbind the entry, the function runs its relocated prologue. a later ZzHookSolidified binds the same entry again,
+// or a new one if it passes other callbacks
+ZZSTATUS ZzDisableSolidified(void *target_ptr);
+
 // enable debug info
 void HookZzDebugInfoEnable(void);
 
 // disable hook
 ZZSTATUS ZzDisableHook(void *target_ptr);
 
+// hook group, all hooks of the group are switched on/off with one batched code patch
+ZZSTATUS ZzAddHookToGroup(const char *group_name, void *target_ptr);
+ZZSTATUS ZzEnableHookGroup(const char *group_name);
+ZZSTATUS ZzDisableHookGroup(const char *group_name);
+
+// stop the other threads while patching and move the ones inside a patched prologue (only support linux)
+void ZzSetSafePatchMode(bool enable);
+
+// lazy trampoline, the hooks built from now on patch the prologue to a shared stub only, the trampolines are built on
+// the first call (only support arm64, elsewhere they are built eagerly). the target must not be called by HookZz itself
+// (i.e. malloc, mprotect)
+void ZzSetLazyTrampolineMode(bool enable);
+
+// shared dispatcher, the pre/post hooks built from now on (no predicates) jump to one dispatcher that looks the entry up
+// by target address, only the relocated prologue is allocated per hook (only support arm64). it is tried before lazy
+void ZzSetSharedDispatcherMode(bool enable);
+
+// the trampolines built from now on go to 2MB rwx arenas, huge page backed and cache line aligned (only support linux)
+void ZzSetHugePageArenaMode(bool enable);
+
+// move the trampolines of the pre/post hooks called at least min_hit_count times into one contiguous hot region,
+// hottest first (only support arm64). ZZ_DONE if no hook is hot enough
+ZZSTATUS ZzRelocateHotTrampolines(unsigned long min_hit_count);
+
+// map a hook plan written offline by tools/HookPlan, the hooks of the functions of its module (matched by build id)
+// take the redirect from the plan instead of analysing the prologue (only support arm64)
+ZZSTATUS ZzLoadHookPlan(const char *path);
+
+// map the trampoline cache at path, an invoke trampoline of it is copied and fixed up instead of relocated. the ones
+// built since are added by ZzSaveTrampolineCache, which creates the file if there is none (only support arm64)
+ZZSTATUS ZzEnableTrampolineCache(const char *path);
+ZZSTATUS ZzSaveTrampolineCache();
+
 // ------- export API end -------
 
 #if defined(__arm64__) || defined(__aarch64__)
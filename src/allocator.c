@@ -81,6 +81,36 @@ ZzMemoryPage *ZzNewNearMemoryPage(zz_addr_t address, zz_size_t redirect_range_si
     return page;
 }
 
+static ZzMemoryPage *ZzNewArenaMemoryPageAt(zz_ptr_t arena_ptr) {
+    ZzMemoryPage *page = NULL;
+
+    page            = (ZzMemoryPage *)zz_malloc_with_zero(sizeof(ZzMemoryPage));
+    page->base      = arena_ptr;
+    page->curr_pos  = arena_ptr;
+    page->size      = ZZ_HUGE_PAGE_ARENA_SIZE;
+    page->used_size = 0;
+    page->isArena   = TRUE;
+    return page;
+}
+
+// address is a hint, 0 for anywhere
+static ZzMemoryPage *ZzNewArenaMemoryPage(zz_addr_t address) {
+    zz_ptr_t arena_ptr = ZzMemoryAllocateHugePageArena(address, ZZ_HUGE_PAGE_ARENA_SIZE);
+
+    if (!arena_ptr)
+        return NULL;
+    return ZzNewArenaMemoryPageAt(arena_ptr);
+}
+
+// whole within redirect_range_size of the address, mapped in a free gap there or not at all
+static ZzMemoryPage *ZzNewNearArenaMemoryPage(zz_addr_t address, zz_size_t redirect_range_size) {
+    zz_ptr_t arena_ptr = ZzMemoryAllocateNearHugePageArena(address, redirect_range_size, ZZ_HUGE_PAGE_ARENA_SIZE);
+
+    if (!arena_ptr)
+        return NULL;
+    return ZzNewArenaMemoryPageAt(arena_ptr);
+}
+
 ZzMemoryPage *ZzNewNearCodeCave(zz_addr_t address, zz_size_t redirect_range_size, zz_size_t code_slice_size) {
     zz_size_t page_size = ZzMemoryGetPageSzie();
     zz_ptr_t cave_ptr   = NULL;
@@ -116,10 +146,24 @@ ZZSTATUS ZzAddMemoryPage(ZzAllocator *allocator, ZzMemoryPage *page) {
     return ZZ_SUCCESS;
 }
 
+// the arena and hot slices start on a cache line, the others on an instruction.
+static void ZzAlignMemoryPage(ZzMemoryPage *page) {
+    zz_size_t align = (page->isArena || page->isHot) ? ZZ_CACHE_LINE_SIZE : 4;
+    zz_size_t t;
+
+    if ((zz_addr_t)page->curr_pos % align) {
+        t = align - (zz_addr_t)page->curr_pos % align;
+        if (page->used_size + t > page->size)
+            t = page->size - page->used_size;
+        page->used_size += t;
+        page->curr_pos += t;
+    }
+}
+
 //  1. try allocate from the history pages
 //  2. try allocate a new page
 //  3. add it to the page manager
-ZzCodeSlice *ZzNewCodeSlice(ZzAllocator *allocator, zz_size_t code_slice_size) {
+static ZzCodeSlice *ZzNewCodeSliceFromPages(ZzAllocator *allocator, zz_size_t code_slice_size) {
     ZzCodeSlice *code_slice = NULL;
     ZzMemoryPage *page      = NULL;
     int i;
@@ -130,12 +174,11 @@ ZzCodeSlice *ZzNewCodeSlice(ZzAllocator *allocator, zz_size_t code_slice_size) {
         // 2. can't be codecave
         // 3. the rest memory of this page is enough for code_slice_size
         // 4. the page address is near
+        // 5. the hot pages are kept for the hot trampolines
+        if (page->isHot != allocator->allocate_hot)
+            continue;
 
-        if ((zz_addr_t)page->curr_pos % 4) {
-            int t = 4 - (zz_addr_t)page->curr_pos % 4;
-            page->used_size += t;
-            page->curr_pos += t;
-        }
+        ZzAlignMemoryPage(page);
 
         if (page->base && !page->isCodeCave && (page->size - page->used_size) > code_slice_size) {
             code_slice       = (ZzCodeSlice *)zz_malloc_with_zero(sizeof(ZzCodeSlice));
@@ -148,14 +191,17 @@ ZzCodeSlice *ZzNewCodeSlice(ZzAllocator *allocator, zz_size_t code_slice_size) {
         }
     }
 
-    page = ZzNewMemoryPage();
+    page = NULL;
+    if (allocator->huge_page_arena || allocator->allocate_hot)
+        page = ZzNewArenaMemoryPage(0);
+    if (!page)
+        page = ZzNewMemoryPage();
+    if (!page)
+        return NULL;
+    page->isHot = allocator->allocate_hot;
     ZzAddMemoryPage(allocator, page);
 
-    if ((zz_addr_t)page->curr_pos % 4) {
-        int t = 4 - (zz_addr_t)page->curr_pos % 4;
-        page->used_size += t;
-        page->curr_pos += t;
-    }
+    ZzAlignMemoryPage(page);
 
     code_slice       = (ZzCodeSlice *)zz_malloc_with_zero(sizeof(ZzCodeSlice));
     code_slice->data = page->curr_pos;
@@ -170,8 +216,10 @@ ZzCodeSlice *ZzNewCodeSlice(ZzAllocator *allocator, zz_size_t code_slice_size) {
 //  1. try allocate from the history pages
 //  2. try allocate a new near page
 //  3. add it to the page manager
-ZzCodeSlice *ZzNewNearCodeSlice(ZzAllocator *allocator, zz_addr_t address, zz_size_t redirect_range_size,
-                                zz_size_t code_slice_size) {
+//  4. a code cave, if allowed
+static ZzCodeSlice *ZzNewNearCodeSliceFromPages(ZzAllocator *allocator, zz_addr_t address,
+                                                zz_size_t redirect_range_size, zz_size_t code_slice_size,
+                                                bool allow_code_cave) {
     ZzCodeSlice *code_slice = NULL;
     ZzMemoryPage *page      = NULL;
     int i;
@@ -181,7 +229,7 @@ ZzCodeSlice *ZzNewNearCodeSlice(ZzAllocator *allocator, zz_addr_t address, zz_si
         // 2. can't be codecave
         // 3. the rest memory of this page is enough for code_slice_size
         // 4. the page address is near
-        if (page->base && !page->isCodeCave) {
+        if (page->base && !page->isCodeCave && !page->isHot) {
             int flag             = 0;
             zz_addr_t split_addr = 0;
 
@@ -256,11 +304,17 @@ ZzCodeSlice *ZzNewNearCodeSlice(ZzAllocator *allocator, zz_addr_t address, zz_si
 #endif
     page = NULL;
 
-    if (!page) {
-        page = ZzNewNearCodeCave(address, redirect_range_size, code_slice_size);
-        if (!page)
-            return NULL;
+    // an arena in a free gap in range of the target, none is mapped out of range
+    if (allocator->huge_page_arena) {
+        page = ZzNewNearArenaMemoryPage(address, redirect_range_size);
+        if (page) {
+            ZzAddMemoryPage(allocator, page);
+            ZzAlignMemoryPage(page);
+        }
     }
+
+    if (!page && allow_code_cave)
+        page = ZzNewNearCodeCave(address, redirect_range_size, code_slice_size);
     if (!page)
         return NULL;
 
@@ -274,3 +328,180 @@ ZzCodeSlice *ZzNewNearCodeSlice(ZzAllocator *allocator, zz_addr_t address, zz_si
 
     return code_slice;
 }
+
+static ZzCodeSlice *ZzReuseCodeSlice(ZzAllocator *allocator, zz_addr_t address, zz_size_t redirect_range_size,
+                                     zz_size_t code_slice_size, bool allow_code_cave) {
+    ZzCodeSlice *code_slice;
+    zz_addr_t data;
+    zz_size_t i;
+
+    for (i = 0; i < allocator->code_slice_count; i++) {
+        code_slice = allocator->code_slices[i];
+        data       = (zz_addr_t)code_slice->data;
+        if (code_slice->is_used || code_slice->size < code_slice_size)
+            continue;
+        if (code_slice->isCodeCave && !allow_code_cave)
+            continue;
+        if (address && (data + code_slice->size > address + redirect_range_size ||
+                        data + redirect_range_size < address))
+            continue;
+        code_slice->is_used = TRUE;
+        return code_slice;
+    }
+    return NULL;
+}
+
+static ZzCodeSlice *ZzRecordCodeSlice(ZzAllocator *allocator, ZzCodeSlice *code_slice) {
+    ZzCodeSlice *record;
+
+    if (allocator->code_slice_count >= allocator->code_slice_capacity) {
+        zz_size_t capacity = allocator->code_slice_capacity ? allocator->code_slice_capacity * 2 : 16;
+        ZzCodeSlice **code_slices =
+            (ZzCodeSlice **)realloc(allocator->code_slices, sizeof(ZzCodeSlice *) * capacity);
+        if (!code_slices)
+            return code_slice;
+        allocator->code_slices         = code_slices;
+        allocator->code_slice_capacity = capacity;
+    }
+    record = (ZzCodeSlice *)zz_malloc_with_zero(sizeof(ZzCodeSlice));
+    if (!record)
+        return code_slice;
+    *record         = *code_slice;
+    record->is_used = TRUE;
+    allocator->code_slices[allocator->code_slice_count++] = record;
+    return code_slice;
+}
+
+// the caller owns (and frees) the returned slice, the allocator keeps its own record.
+static ZzCodeSlice *ZzCopyCodeSlice(ZzCodeSlice *record, zz_size_t code_slice_size) {
+    ZzCodeSlice *code_slice = (ZzCodeSlice *)zz_malloc_with_zero(sizeof(ZzCodeSlice));
+    code_slice->data        = record->data;
+    code_slice->size        = code_slice_size;
+    code_slice->is_used     = TRUE;
+    code_slice->isCodeCave  = record->isCodeCave;
+    return code_slice;
+}
+
+ZzCodeSlice *ZzNewCodeSlice(ZzAllocator *allocator, zz_size_t code_slice_size) {
+    ZzCodeSlice *code_slice = NULL;
+
+    // a freed slice is scattered, the hot ones are packed one after the other
+    if (!allocator->allocate_hot)
+        code_slice = ZzReuseCodeSlice(allocator, 0, 0, code_slice_size, TRUE);
+    if (code_slice)
+        return ZzCopyCodeSlice(code_slice, code_slice_size);
+
+    code_slice = ZzNewCodeSliceFromPages(allocator, code_slice_size);
+    if (!code_slice)
+        return NULL;
+    return ZzRecordCodeSlice(allocator, code_slice);
+}
+
+static ZzCodeSlice *ZzNewNearCodeSliceWithCave(ZzAllocator *allocator, zz_addr_t address,
+                                               zz_size_t redirect_range_size, zz_size_t code_slice_size,
+                                               bool allow_code_cave) {
+    ZzCodeSlice *code_slice =
+        ZzReuseCodeSlice(allocator, address, redirect_range_size, code_slice_size, allow_code_cave);
+    if (code_slice)
+        return ZzCopyCodeSlice(code_slice, code_slice_size);
+
+    code_slice =
+        ZzNewNearCodeSliceFromPages(allocator, address, redirect_range_size, code_slice_size, allow_code_cave);
+    if (!code_slice)
+        return NULL;
+    return ZzRecordCodeSlice(allocator, code_slice);
+}
+
+ZzCodeSlice *ZzNewNearCodeSlice(ZzAllocator *allocator, zz_addr_t address, zz_size_t redirect_range_size,
+                                zz_size_t code_slice_size) {
+    return ZzNewNearCodeSliceWithCave(allocator, address, redirect_range_size, code_slice_size, TRUE);
+}
+
+ZzCodeSlice *ZzNewNearOwnedCodeSlice(ZzAllocator *allocator, zz_addr_t address, zz_size_t redirect_range_size,
+                                     zz_size_t code_slice_size) {
+    return ZzNewNearCodeSliceWithCave(allocator, address, redirect_range_size, code_slice_size, FALSE);
+}
+
+void ZzShrinkCodeSlice(ZzAllocator *allocator, ZzCodeSlice *code_slice, zz_size_t size) {
+    zz_addr_t end = (zz_addr_t)code_slice->data + code_slice->size;
+    zz_size_t rest, i;
+    ZzMemoryPage *page;
+
+    if (size >= code_slice->size)
+        return;
+    rest = code_slice->size - size;
+
+    // only the last slice of a page, a reused one keeps its size
+    for (i = 0; i < allocator->size; i++) {
+        page = allocator->memory_pages[i];
+        if ((zz_addr_t)page->curr_pos == end && (zz_addr_t)code_slice->data >= (zz_addr_t)page->base)
+            break;
+    }
+    if (i == allocator->size)
+        return;
+    page->curr_pos -= rest;
+    page->used_size -= rest;
+
+    for (i = allocator->code_slice_count; i > 0; i--) {
+        if (allocator->code_slices[i - 1]->data == code_slice->data) {
+            allocator->code_slices[i - 1]->size = size;
+            break;
+        }
+    }
+    code_slice->size = size;
+}
+
+ZZSTATUS ZzFreeCodeSlice(ZzAllocator *allocator, zz_ptr_t data) {
+    zz_size_t i;
+
+    for (i = 0; i < allocator->code_slice_count; i++) {
+        if (allocator->code_slices[i]->data == data && allocator->code_slices[i]->is_used) {
+            allocator->code_slices[i]->is_used = FALSE;
+            return ZZ_SUCCESS;
+        }
+    }
+    return ZZ_FAILED;
+}
+
+static ZzMemoryPage *ZzFindArenaMemoryPage(ZzAllocator *allocator, zz_addr_t address) {
+    ZzMemoryPage *page;
+    zz_size_t i;
+
+    for (i = 0; i < allocator->size; i++) {
+        page = allocator->memory_pages[i];
+        if (page->isArena && address >= (zz_addr_t)page->base && address < (zz_addr_t)page->base + page->size)
+            return page;
+    }
+    return NULL;
+}
+
+bool ZzAllocatorPatchCode(ZzAllocator *allocator, zz_addr_t address, zz_ptr_t codedata, zz_size_t codedata_size) {
+    zz_addr_t word_addr;
+
+    if (!ZzFindArenaMemoryPage(allocator, address)) {
+        if (ZzMemoryPatchCodeAtomic(address, codedata, codedata_size))
+            return TRUE;
+        return ZzMemoryPatchCode(address, codedata, codedata_size);
+    }
+
+    // a running thread sees the old or the new word, i.e. the literal of a `ldr x17, #8; br x17`
+    if (ZzMemoryIsAtomicPatchable(address, codedata_size) && (address & 3) + codedata_size <= 4) {
+        uint32_t word;
+        word_addr = address & ~(zz_addr_t)3;
+        word      = __atomic_load_n((uint32_t *)word_addr, __ATOMIC_RELAXED);
+        memcpy((char *)&word + (address - word_addr), codedata, codedata_size);
+        __atomic_store_n((uint32_t *)word_addr, word, __ATOMIC_RELEASE);
+#if defined(__x86_64__) || defined(__aarch64__)
+    } else if (ZzMemoryIsAtomicPatchable(address, codedata_size)) {
+        uint64_t word;
+        word_addr = address & ~(zz_addr_t)7;
+        word      = __atomic_load_n((uint64_t *)word_addr, __ATOMIC_RELAXED);
+        memcpy((char *)&word + (address - word_addr), codedata, codedata_size);
+        __atomic_store_n((uint64_t *)word_addr, word, __ATOMIC_RELEASE);
+#endif
+    } else {
+        memcpy((zz_ptr_t)address, codedata, codedata_size);
+    }
+    ZzMemoryClearCache(address, codedata_size);
+    return TRUE;
+}
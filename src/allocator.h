@@ -23,19 +23,47 @@ typedef struct _ZzMemoryPage {
     zz_size_t size;
     zz_size_t used_size;
     bool isCodeCave;
+    bool isArena;
+    bool isHot;
 } ZzMemoryPage;
 
+#define ZZ_HUGE_PAGE_ARENA_SIZE (2 * 1024 * 1024)
+#define ZZ_CACHE_LINE_SIZE 64
+
 typedef struct _allocator {
     ZzMemoryPage **memory_pages;
     zz_size_t size;
     zz_size_t capacity;
+
+    // every handed out slice, a freed one is reused by the next allocation it fits.
+    ZzCodeSlice **code_slices;
+    zz_size_t code_slice_count;
+    zz_size_t code_slice_capacity;
+
+    // new pages are 2MB rwx arenas (one iTLB entry with a huge page), the slices start on a cache line.
+    bool huge_page_arena;
+    // set while the hot trampolines are rebuilt, the slices come from the hot pages only.
+    bool allocate_hot;
 } ZzAllocator;
 
 ZzCodeSlice *ZzNewNearCodeSlice(ZzAllocator *allocator, zz_addr_t address, zz_size_t redirect_range_size,
                                 zz_size_t codeslice_size);
 
+// the same from a page HookZz mapped only, never a code cave in another module
+ZzCodeSlice *ZzNewNearOwnedCodeSlice(ZzAllocator *allocator, zz_addr_t address, zz_size_t redirect_range_size,
+                                     zz_size_t codeslice_size);
+
 ZzCodeSlice *ZzNewCodeSlice(ZzAllocator *allocator, zz_size_t codeslice_size);
 
 ZzAllocator *ZzNewAllocator();
 
+// write code into a slice, an arena is rwx and written in place (a mprotect of part of it splits the huge page).
+bool ZzAllocatorPatchCode(ZzAllocator *allocator, zz_addr_t address, zz_ptr_t codedata, zz_size_t codedata_size);
+
+// give back the tail of a slice just allocated, the next slice starts right after the code.
+void ZzShrinkCodeSlice(ZzAllocator *allocator, ZzCodeSlice *code_slice, zz_size_t size);
+
+// give back the slice starting at data (i.e. the trampolines of an unloaded module)
+ZZSTATUS ZzFreeCodeSlice(ZzAllocator *allocator, zz_ptr_t data);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,92 @@
+#include "arena.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define ZZ_ARENA_ALIGN(size) (((size) + 7) & ~(zz_size_t)7)
+
+#define ZZ_ARENA_CHUNK_DATA(chunk) ((char *)(chunk) + ZZ_ARENA_ALIGN(sizeof(ZzArenaChunk)))
+
+static ZzArenaChunk *ZzNewArenaChunk(ZzArena *arena, zz_size_t size) {
+    zz_size_t chunk_size = arena->chunk ? arena->chunk->size * 2 : ZZ_ARENA_CHUNK_SIZE;
+    while (chunk_size < size)
+        chunk_size *= 2;
+
+    ZzArenaChunk *chunk = (ZzArenaChunk *)malloc(ZZ_ARENA_ALIGN(sizeof(ZzArenaChunk)) + chunk_size);
+    if (!chunk)
+        return NULL;
+    chunk->next  = arena->chunk;
+    chunk->size  = chunk_size;
+    chunk->used  = 0;
+    arena->chunk = chunk;
+    return chunk;
+}
+
+zz_ptr_t ZzArenaAlloc(ZzArena *arena, zz_size_t size) {
+    ZzArenaChunk *chunk = arena->chunk;
+    zz_ptr_t result;
+
+    size = ZZ_ARENA_ALIGN(size);
+    if (!chunk || chunk->size - chunk->used < size) {
+        chunk = ZzNewArenaChunk(arena, size);
+        if (!chunk) {
+            ZZ_ERROR_LOG("arena allocate %ld bytes failed", (long)size);
+            return NULL;
+        }
+    }
+
+    result = ZZ_ARENA_CHUNK_DATA(chunk) + chunk->used;
+    chunk->used += size;
+    memset(result, 0, size);
+    arena->last = result;
+    return result;
+}
+
+zz_ptr_t ZzArenaGrow(ZzArena *arena, zz_ptr_t ptr, zz_size_t old_size, zz_size_t new_size) {
+    ZzArenaChunk *chunk = arena->chunk;
+    zz_ptr_t result;
+
+    if (!ptr)
+        return ZzArenaAlloc(arena, new_size);
+
+    old_size = ZZ_ARENA_ALIGN(old_size);
+    new_size = ZZ_ARENA_ALIGN(new_size);
+    if (new_size <= old_size)
+        return ptr;
+
+    if (ptr == arena->last && chunk->size - chunk->used >= new_size - old_size) {
+        memset((char *)ptr + old_size, 0, new_size - old_size);
+        chunk->used += new_size - old_size;
+        return ptr;
+    }
+
+    result = ZzArenaAlloc(arena, new_size);
+    if (result)
+        memcpy(result, ptr, old_size);
+    return result;
+}
+
+void ZzArenaReset(ZzArena *arena) {
+    ZzArenaChunk *chunk = arena->chunk;
+    ZzArenaChunk *next;
+
+    if (!chunk)
+        return;
+
+    // the newest chunk is the largest one, drop the others
+    next = chunk->next;
+    while (next) {
+        ZzArenaChunk *tmp = next->next;
+        free(next);
+        next = tmp;
+    }
+    chunk->next = NULL;
+    chunk->used = 0;
+    arena->last = NULL;
+}
+
+void ZzArenaFree(ZzArena *arena) {
+    ZzArenaReset(arena);
+    if (arena->chunk)
+        free(arena->chunk);
+    arena->chunk = NULL;
+}
@@ -0,0 +1,34 @@
+#ifndef arena_h
+#define arena_h
+
+#include "hookzz.h"
+#include "kitzz.h"
+
+#include "CommonKit/log/log_kit.h"
+
+// bump arena for the per-build records of the reader/writer/relocator.
+// reset keeps the largest chunk, so a build only hits the heap once it outgrows the previous ones.
+
+#define ZZ_ARENA_CHUNK_SIZE 4096
+
+typedef struct _ZzArenaChunk {
+    struct _ZzArenaChunk *next;
+    zz_size_t size;
+    zz_size_t used;
+} ZzArenaChunk;
+
+typedef struct _ZzArena {
+    ZzArenaChunk *chunk;
+    zz_ptr_t last;
+} ZzArena;
+
+zz_ptr_t ZzArenaAlloc(ZzArena *arena, zz_size_t size);
+
+// grow the last allocation in place when possible, otherwise copy it.
+zz_ptr_t ZzArenaGrow(ZzArena *arena, zz_ptr_t ptr, zz_size_t old_size, zz_size_t new_size);
+
+void ZzArenaReset(ZzArena *arena);
+
+void ZzArenaFree(ZzArena *arena);
+
+#endif
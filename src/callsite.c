@@ -0,0 +1,206 @@
+/**
+ *    Copyright 2017 jmpews
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "callsite.h"
+#include "memory.h"
+#include "tools.h"
+#include "trampoline.h"
+
+static ZzCallSiteHookSet g_call_site_hook_set;
+
+static pthread_mutex_t g_call_site_hook_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static ZzCallSiteHook *ZzFindCallSiteHook(const char *module_name, zz_ptr_t target_ptr) {
+    zz_size_t i;
+    for (i = 0; i < g_call_site_hook_set.size; i++) {
+        ZzCallSiteHook *hook = g_call_site_hook_set.hooks[i];
+        if (hook->target_ptr == target_ptr && !strcmp(hook->module_name, module_name))
+            return hook;
+    }
+    return NULL;
+}
+
+static ZZSTATUS ZzAddCallSiteHook(ZzCallSiteHook *hook) {
+    ZzCallSiteHookSet *set = &g_call_site_hook_set;
+
+    if (set->size >= set->capacity) {
+        zz_size_t capacity     = set->capacity ? set->capacity * 2 : 4;
+        ZzCallSiteHook **hooks = (ZzCallSiteHook **)realloc(set->hooks, sizeof(ZzCallSiteHook *) * capacity);
+        if (!hooks)
+            return ZZ_FAILED;
+        set->hooks    = hooks;
+        set->capacity = capacity;
+    }
+    set->hooks[set->size++] = hook;
+    return ZZ_SUCCESS;
+}
+
+static void ZzFreeCallSiteHook(ZzCallSiteHook *hook) {
+    if (hook->entry) {
+        ZzFreeHookFunctionEntry(hook->entry);
+        free(hook->entry);
+    }
+    free(hook->module_name);
+    free(hook->sites);
+    free(hook);
+}
+
+ZzCallSite *ZzAddCallSite(ZzCallSiteHook *hook) {
+    if (hook->size >= hook->capacity) {
+        zz_size_t capacity = hook->capacity ? hook->capacity * 2 : 16;
+        ZzCallSite *sites  = (ZzCallSite *)realloc(hook->sites, sizeof(ZzCallSite) * capacity);
+        if (!sites)
+            return NULL;
+        hook->sites    = sites;
+        hook->capacity = capacity;
+    }
+    memset(&hook->sites[hook->size], 0, sizeof(ZzCallSite));
+    return &hook->sites[hook->size++];
+}
+
+// every site is a single `bl`, a caller runs the old or the new one. the sites patched before a failure are restored.
+static ZZSTATUS ZzCommitCallSites(ZzCallSiteHook *hook, bool enable) {
+    ZzCallSite *site;
+    zz_size_t i;
+
+    if (hook->isEnabled == enable)
+        return enable ? ZZ_ALREADY_ENABLED : ZZ_DONE;
+
+    ZzMaterializeLock();
+    for (i = 0; i < hook->size; i++) {
+        site = &hook->sites[i];
+        if (!ZzMemoryPatchCodeAtomic(site->address, enable ? site->redirect_insn : site->origin_insn, site->size))
+            break;
+    }
+    if (i < hook->size) {
+        ZZ_ERROR_LOG("patch the call site %p failed!", (void *)hook->sites[i].address);
+        while (i--) {
+            site = &hook->sites[i];
+            ZzMemoryPatchCodeAtomic(site->address, enable ? site->origin_insn : site->redirect_insn, site->size);
+        }
+        ZzMaterializeUnlock();
+        return ZZ_FAILED;
+    }
+    ZzMaterializeUnlock();
+
+    hook->isEnabled = enable;
+    if (!enable)
+        return ZZ_DONE;
+    return hook->missed_count ? ZZ_PARTIAL_HOOK : ZZ_DONE_ENABLE;
+}
+
+static ZZSTATUS ZzHookCallSitesLocked(const char *module_name, zz_ptr_t target_ptr, zz_ptr_t replace_ptr,
+                                      zz_ptr_t *origin_ptr, PRECALL pre_call_ptr, POSTCALL post_call_ptr) {
+    ZzModuleFunction *functions;
+    ZzHookFunctionEntry *entry;
+    ZzCallSiteHook *hook;
+    zz_size_t count;
+    ZZSTATUS status;
+
+    // disabled before, the sites are known already
+    hook = ZzFindCallSiteHook(module_name, target_ptr);
+    if (hook) {
+        if (hook->isEnabled)
+            return ZZ_ALREADY_HOOK;
+        return ZzCommitCallSites(hook, TRUE);
+    }
+
+    count = ZzGetModuleFunctions(module_name, &functions);
+    if (!count) {
+        ZZ_ERROR_LOG("can't find the functions of %s!", module_name);
+        return ZZ_FAILED;
+    }
+
+    hook              = (ZzCallSiteHook *)zz_malloc_with_zero(sizeof(ZzCallSiteHook));
+    entry             = (ZzHookFunctionEntry *)zz_malloc_with_zero(sizeof(ZzHookFunctionEntry));
+    hook->module_name = strdup(module_name);
+    hook->target_ptr  = target_ptr;
+    hook->entry       = entry;
+    if (!hook->module_name || !entry) {
+        ZzFreeCallSiteHook(hook);
+        free(functions);
+        return ZZ_FAILED;
+    }
+
+    // the callee is left as is, the entry goes on to the target itself unless replaced
+    ZzInitializeHookFunctionEntry(entry, HOOK_TYPE_FUNCTION_via_CALL_SITE, target_ptr,
+                                  replace_ptr ? replace_ptr : target_ptr, pre_call_ptr, post_call_ptr, FALSE);
+    if (!entry->interceptor) {
+        ZzFreeCallSiteHook(hook);
+        free(functions);
+        return ZZ_FAILED;
+    }
+
+    ZzMaterializeLock();
+    status = ZZ_SUCCESS;
+    if (pre_call_ptr || post_call_ptr) {
+        status            = ZzBuildTrampoline(entry->interceptor->backend, entry);
+        hook->destination = entry->on_enter_trampoline;
+    } else {
+        hook->destination = replace_ptr;
+    }
+    if (status != ZZ_FAILED && hook->destination)
+        ZzBuildCallSiteRedirects(entry->interceptor->backend, hook, functions, count);
+    ZzMaterializeUnlock();
+    free(functions);
+
+    if (status == ZZ_FAILED || !hook->destination || !hook->size) {
+        ZZ_ERROR_LOG("no call site of %p in %s!", target_ptr, module_name);
+        ZzFreeCallSiteHook(hook);
+        return ZZ_FAILED;
+    }
+    HookZzDebugInfoLog("%s: %lu call sites of %p", module_name, (unsigned long)hook->size, target_ptr);
+    if (hook->missed_count)
+        ZZ_ERROR_LOG("%s: %lu call sites of %p have no veneer in range, they call it as is", module_name,
+                     (unsigned long)hook->missed_count, target_ptr);
+
+    if (ZzAddCallSiteHook(hook) == ZZ_FAILED) {
+        ZzFreeCallSiteHook(hook);
+        return ZZ_FAILED;
+    }
+    if (origin_ptr)
+        *origin_ptr = target_ptr;
+    return ZzCommitCallSites(hook, TRUE);
+}
+
+ZZSTATUS ZzHookCallSites(const char *module_name, zz_ptr_t target_ptr, zz_ptr_t replace_ptr, zz_ptr_t *origin_ptr,
+                         PRECALL pre_call_ptr, POSTCALL post_call_ptr) {
+    ZZSTATUS status;
+
+    if (!module_name || !target_ptr || (!replace_ptr && !pre_call_ptr && !post_call_ptr))
+        return ZZ_FAILED;
+
+    pthread_mutex_lock(&g_call_site_hook_lock);
+    status = ZzHookCallSitesLocked(module_name, target_ptr, replace_ptr, origin_ptr, pre_call_ptr, post_call_ptr);
+    pthread_mutex_unlock(&g_call_site_hook_lock);
+    return status;
+}
+
+ZZSTATUS ZzDisableCallSites(const char *module_name, zz_ptr_t target_ptr) {
+    ZzCallSiteHook *hook;
+    ZZSTATUS status = ZZ_NO_BUILD_HOOK;
+
+    pthread_mutex_lock(&g_call_site_hook_lock);
+    hook = ZzFindCallSiteHook(module_name, target_ptr);
+    if (hook)
+        status = ZzCommitCallSites(hook, FALSE);
+    pthread_mutex_unlock(&g_call_site_hook_lock);
+    return status;
+}
@@ -0,0 +1,60 @@
+/**
+ *    Copyright 2017 jmpews
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#ifndef callsite_h
+#define callsite_h
+
+#include "hookzz.h"
+#include "kitzz.h"
+
+#include "CommonKit/log/log_kit.h"
+#include "memory.h"
+
+#include "interceptor.h"
+
+#define ZZ_MAX_CALL_SITE_INSN_SIZE 8
+
+typedef struct _ZzCallSite {
+    zz_addr_t address;
+    zz_size_t size;
+    char origin_insn[ZZ_MAX_CALL_SITE_INSN_SIZE];
+    char redirect_insn[ZZ_MAX_CALL_SITE_INSN_SIZE];
+} ZzCallSite;
+
+// the call sites of one module to one target. the entry is not in the hook function entry set, the target itself is
+// not hooked and may be hooked on its own.
+typedef struct _ZzCallSiteHook {
+    char *module_name;
+    zz_ptr_t target_ptr;
+    zz_ptr_t destination; // the enter trampoline, or replace_call if there is no pre/post call
+    ZzHookFunctionEntry *entry;
+    bool isEnabled;
+    ZzCallSite *sites;
+    zz_size_t size;
+    zz_size_t capacity;
+    zz_size_t missed_count; // call sites out of reach of any veneer, left as is
+} ZzCallSiteHook;
+
+typedef struct {
+    ZzCallSiteHook **hooks;
+    zz_size_t size;
+    zz_size_t capacity;
+} ZzCallSiteHookSet;
+
+// a zeroed site appended to the hook
+ZzCallSite *ZzAddCallSite(ZzCallSiteHook *hook);
+
+#endif
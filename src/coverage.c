@@ -0,0 +1,230 @@
+/**
+ *    Copyright 2017 jmpews
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <dlfcn.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "coverage.h"
+#include "tools.h"
+#include "trampoline.h"
+
+static ZzCounterSet g_counter_set;
+
+// the slots are counted lock-free, the set is reallocated by a registration
+static pthread_mutex_t g_counter_set_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static ZzOneShotHit *g_one_shot_hits;
+
+static ZzOneShotRetirement *g_one_shot_retirements;
+
+static ZzCounter *ZzFindCounter(zz_ptr_t address) {
+    zz_size_t i;
+    for (i = 0; i < g_counter_set.size; i++) {
+        if (g_counter_set.counters[i].address == address)
+            return &g_counter_set.counters[i];
+    }
+    return NULL;
+}
+
+static volatile unsigned long *ZzAllocateCounterSlotLocked(zz_ptr_t address, ZZCOUNTERTYPE counter_type) {
+    ZzCounterSet *set = &g_counter_set;
+    ZzCounter *counter;
+    ZzCounterChunk *chunk;
+
+    // instrumented again after a disable, keep counting into the same slot
+    counter = ZzFindCounter(address);
+    if (counter) {
+        counter->counter_type = counter_type;
+        return counter->slot;
+    }
+
+    if (set->size >= set->capacity) {
+        zz_size_t capacity  = set->capacity ? set->capacity * 2 : 64;
+        ZzCounter *counters = (ZzCounter *)realloc(set->counters, sizeof(ZzCounter) * capacity);
+        if (!counters)
+            return NULL;
+        set->counters = counters;
+        set->capacity = capacity;
+    }
+
+    chunk = set->chunk;
+    if (!chunk || chunk->used >= ZZ_COUNTER_CHUNK_SLOT_COUNT) {
+        chunk = (ZzCounterChunk *)zz_malloc_with_zero(sizeof(ZzCounterChunk));
+        if (!chunk)
+            return NULL;
+        chunk->next = set->chunk;
+        set->chunk  = chunk;
+    }
+
+    counter               = &set->counters[set->size++];
+    counter->address      = address;
+    counter->counter_type = counter_type;
+    counter->slot         = &chunk->slots[chunk->used++];
+    return counter->slot;
+}
+
+volatile unsigned long *ZzAllocateCounterSlot(zz_ptr_t address, ZZCOUNTERTYPE counter_type) {
+    volatile unsigned long *slot;
+
+    pthread_mutex_lock(&g_counter_set_lock);
+    slot = ZzAllocateCounterSlotLocked(address, counter_type);
+    pthread_mutex_unlock(&g_counter_set_lock);
+    return slot;
+}
+
+unsigned long ZzGetInstrumentationCounter(zz_ptr_t insn_address) {
+    volatile unsigned long *slot = NULL;
+    ZzCounter *counter;
+
+    pthread_mutex_lock(&g_counter_set_lock);
+    counter = ZzFindCounter(insn_address);
+    if (counter)
+        slot = counter->slot;
+    pthread_mutex_unlock(&g_counter_set_lock);
+    return slot ? __atomic_load_n(slot, __ATOMIC_RELAXED) : 0;
+}
+
+// `module+offset` or `address` if it is in no module
+static void ZzWriteCoverageAddress(FILE *fp, zz_ptr_t address) {
+    Dl_info info;
+
+    if (dladdr(address, &info) && info.dli_fname && info.dli_fbase) {
+        const char *name = strrchr(info.dli_fname, '/');
+        fprintf(fp, "%s+0x%lx", name ? name + 1 : info.dli_fname,
+                (unsigned long)((zz_addr_t)address - (zz_addr_t)info.dli_fbase));
+    } else {
+        fprintf(fp, "0x%lx", (unsigned long)address);
+    }
+}
+
+ZZSTATUS ZzExportCoverage(const char *path) {
+    ZzCounter *counter;
+    FILE *fp;
+    zz_size_t i;
+
+    fp = fopen(path, "w");
+    if (!fp) {
+        ZZ_ERROR_LOG("open coverage file %s failed", path);
+        return ZZ_FAILED;
+    }
+
+    // one `module+offset count` line per instrumented instruction
+    fprintf(fp, "# hookzz coverage\n");
+    pthread_mutex_lock(&g_counter_set_lock);
+    for (i = 0; i < g_counter_set.size; i++) {
+        counter = &g_counter_set.counters[i];
+        ZzWriteCoverageAddress(fp, counter->address);
+        fprintf(fp, " %lu\n", __atomic_load_n(counter->slot, __ATOMIC_RELAXED));
+    }
+    pthread_mutex_unlock(&g_counter_set_lock);
+
+    if (fclose(fp)) {
+        ZZ_ERROR_LOG("write coverage file %s failed", path);
+        return ZZ_FAILED;
+    }
+    return ZZ_SUCCESS;
+}
+
+static void ZzRetireOneShotEntryLocked(ZzHookFunctionEntry *entry) {
+    ZzInterceptor *interceptor = entry->interceptor;
+
+    // a thread may be inside a multi instruction redirect, only stop the world can restore it
+    if (ZzMemoryIsAtomicPatchable((zz_addr_t)entry->origin_prologue.address, entry->origin_prologue.size) ||
+        interceptor->safe_patch_mode) {
+        if (ZzCommitHookFunctionEntriesLocked(&entry, 1, FALSE) != ZZ_FAILED)
+            return;
+    }
+    if (ZzBypassEnterTrampoline(interceptor->backend, entry) == ZZ_FAILED)
+        HookZzDebugInfoLog("one-shot hook %p can't be retired, it stays on the thunk", entry->target_ptr);
+}
+
+// one thread retires the queued entries at a time. if a build or another retirement holds the lock they stay on the
+// thunk until the next hit.
+static void ZzRetireOneShotEntries(void) {
+    ZzOneShotRetirement *retirement, *next;
+    ZzHookFunctionEntry *entry;
+
+    while (__atomic_load_n(&g_one_shot_retirements, __ATOMIC_ACQUIRE) && ZzMaterializeTryLock()) {
+        retirement = __atomic_exchange_n(&g_one_shot_retirements, NULL, __ATOMIC_ACQUIRE);
+        for (; retirement; retirement = next) {
+            next = retirement->next;
+            // freed or hooked again since the hit
+            entry = ZzFindHookFunctionEntry(retirement->address);
+            if (entry && entry->hook_type == HOOK_TYPE_ONE_SHOT && entry->isEnabled)
+                ZzRetireOneShotEntryLocked(entry);
+            free(retirement);
+        }
+        ZzMaterializeUnlock();
+    }
+}
+
+void ZzOneShotHitEntry(ZzHookFunctionEntry *entry) {
+    ZzOneShotRetirement *retirement;
+    ZzOneShotHit *hit;
+
+    // a hit racing the first one, or a call made while it retires the hook, just runs through
+    if (__atomic_exchange_n(&entry->one_shot_hit, 1, __ATOMIC_ACQ_REL))
+        return;
+
+    hit = (ZzOneShotHit *)zz_malloc_with_zero(sizeof(ZzOneShotHit));
+    if (hit) {
+        hit->address = entry->target_ptr;
+        hit->next    = __atomic_load_n(&g_one_shot_hits, __ATOMIC_RELAXED);
+        while (!__atomic_compare_exchange_n(&g_one_shot_hits, &hit->next, hit, TRUE, __ATOMIC_RELEASE,
+                                            __ATOMIC_RELAXED))
+            ;
+    }
+
+    retirement = (ZzOneShotRetirement *)zz_malloc_with_zero(sizeof(ZzOneShotRetirement));
+    if (!retirement)
+        return;
+    retirement->address = entry->target_ptr;
+    retirement->next    = __atomic_load_n(&g_one_shot_retirements, __ATOMIC_RELAXED);
+    while (!__atomic_compare_exchange_n(&g_one_shot_retirements, &retirement->next, retirement, TRUE,
+                                        __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+        ;
+    ZzRetireOneShotEntries();
+}
+
+ZZSTATUS ZzExportOneShotCoverage(const char *path) {
+    ZzOneShotHit *hit;
+    FILE *fp;
+
+    fp = fopen(path, "w");
+    if (!fp) {
+        ZZ_ERROR_LOG("open coverage file %s failed", path);
+        return ZZ_FAILED;
+    }
+
+    // one `module+offset` line per hit
+    for (hit = __atomic_load_n(&g_one_shot_hits, __ATOMIC_ACQUIRE); hit; hit = hit->next) {
+        ZzWriteCoverageAddress(fp, hit->address);
+        fprintf(fp, "\n");
+    }
+
+    if (fclose(fp)) {
+        ZZ_ERROR_LOG("write coverage file %s failed", path);
+        return ZZ_FAILED;
+    }
+    return ZZ_SUCCESS;
+}
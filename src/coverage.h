@@ -0,0 +1,68 @@
+/**
+ *    Copyright 2017 jmpews
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#ifndef coverage_h
+#define coverage_h
+
+#include "hookzz.h"
+#include "kitzz.h"
+
+#include "CommonKit/log/log_kit.h"
+#include "memory.h"
+
+#include "interceptor.h"
+
+// the counter slots are baked into the counter trampolines, a chunk is never moved or freed.
+#define ZZ_COUNTER_CHUNK_SLOT_COUNT 512
+
+typedef struct _ZzCounterChunk {
+    struct _ZzCounterChunk *next;
+    zz_size_t used;
+    volatile unsigned long slots[ZZ_COUNTER_CHUNK_SLOT_COUNT];
+} ZzCounterChunk;
+
+typedef struct _ZzCounter {
+    zz_ptr_t address;
+    ZZCOUNTERTYPE counter_type;
+    volatile unsigned long *slot;
+} ZzCounter;
+
+typedef struct {
+    ZzCounter *counters;
+    zz_size_t size;
+    zz_size_t capacity;
+    ZzCounterChunk *chunk;
+} ZzCounterSet;
+
+// a zeroed slot for the instruction, the same slot if it is instrumented already
+volatile unsigned long *ZzAllocateCounterSlot(zz_ptr_t address, ZZCOUNTERTYPE counter_type);
+
+// the hit list of the one-shot hooks, a push is lock-free. a node is never freed, the entry may be.
+typedef struct _ZzOneShotHit {
+    zz_ptr_t address;
+    struct _ZzOneShotHit *next;
+} ZzOneShotHit;
+
+// a hit entry waits to be retired under the materialize lock, the thread of the hit may hold it already
+typedef struct _ZzOneShotRetirement {
+    zz_ptr_t address;
+    struct _ZzOneShotRetirement *next;
+} ZzOneShotRetirement;
+
+// called from the thunk on a hit of a one-shot entry, only the first one records it and retires the hook
+void ZzOneShotHitEntry(ZzHookFunctionEntry *entry);
+
+#endif
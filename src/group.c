@@ -0,0 +1,132 @@
+/**
+ *    Copyright 2017 jmpews
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "group.h"
+#include "trampoline.h"
+
+static ZzHookGroupSet g_hook_group_set;
+
+ZzHookGroup *ZzFindHookGroup(const char *group_name) {
+    zz_size_t i;
+    for (i = 0; i < g_hook_group_set.size; i++) {
+        if (!strcmp(g_hook_group_set.groups[i]->name, group_name))
+            return g_hook_group_set.groups[i];
+    }
+    return NULL;
+}
+
+static ZzHookGroup *ZzNewHookGroup(const char *group_name) {
+    ZzHookGroupSet *set = &g_hook_group_set;
+    ZzHookGroup *group;
+
+    if (set->size >= set->capacity) {
+        zz_size_t capacity    = set->capacity ? set->capacity * 2 : 4;
+        ZzHookGroup **groups = (ZzHookGroup **)realloc(set->groups, sizeof(ZzHookGroup *) * capacity);
+        if (!groups)
+            return NULL;
+        set->groups   = groups;
+        set->capacity = capacity;
+    }
+
+    group           = (ZzHookGroup *)zz_malloc_with_zero(sizeof(ZzHookGroup));
+    group->name     = strdup(group_name);
+    group->capacity = 4;
+    group->entries  = (ZzHookFunctionEntry **)zz_malloc_with_zero(sizeof(ZzHookFunctionEntry *) * group->capacity);
+    if (!group->name || !group->entries) {
+        free(group->name);
+        free(group->entries);
+        free(group);
+        return NULL;
+    }
+    set->groups[set->size++] = group;
+    return group;
+}
+
+ZZSTATUS ZzAddHookToGroup(const char *group_name, void *target_ptr) {
+    ZzHookFunctionEntry *entry;
+    ZzHookGroup *group;
+    zz_size_t i;
+
+    entry = ZzFindHookFunctionEntry(target_ptr);
+    if (!entry) {
+        ZZ_ERROR_LOG(" %p not build HookFunctionEntry!", target_ptr);
+        return ZZ_NO_BUILD_HOOK;
+    }
+
+    group = ZzFindHookGroup(group_name);
+    if (!group)
+        group = ZzNewHookGroup(group_name);
+    if (!group)
+        return ZZ_FAILED;
+
+    for (i = 0; i < group->size; i++) {
+        if (group->entries[i] == entry)
+            return ZZ_SUCCESS;
+    }
+
+    if (group->size >= group->capacity) {
+        ZzHookFunctionEntry **entries = (ZzHookFunctionEntry **)realloc(
+            group->entries, sizeof(ZzHookFunctionEntry *) * group->capacity * 2);
+        if (!entries)
+            return ZZ_FAILED;
+        group->entries  = entries;
+        group->capacity = group->capacity * 2;
+    }
+    group->entries[group->size++] = entry;
+    return ZZ_SUCCESS;
+}
+
+ZZSTATUS ZzEnableHookGroup(const char *group_name) {
+    ZzHookGroup *group = ZzFindHookGroup(group_name);
+    ZZSTATUS status;
+
+    if (!group)
+        return ZZ_FAILED;
+    status = ZzCommitHookFunctionEntries(group->entries, group->size, TRUE);
+    if (status != ZZ_FAILED)
+        group->isEnabled = TRUE;
+    return status;
+}
+
+ZZSTATUS ZzDisableHookGroup(const char *group_name) {
+    ZzHookGroup *group = ZzFindHookGroup(group_name);
+    ZZSTATUS status;
+
+    if (!group)
+        return ZZ_FAILED;
+    status = ZzCommitHookFunctionEntries(group->entries, group->size, FALSE);
+    if (status != ZZ_FAILED)
+        group->isEnabled = FALSE;
+    return status;
+}
+
+void ZzRemoveHookFromGroups(ZzHookFunctionEntry *entry) {
+    ZzHookGroup *group;
+    zz_size_t i, j;
+
+    for (i = 0; i < g_hook_group_set.size; i++) {
+        group = g_hook_group_set.groups[i];
+        for (j = 0; j < group->size; j++) {
+            if (group->entries[j] == entry) {
+                group->entries[j] = group->entries[--group->size];
+                break;
+            }
+        }
+    }
+}
@@ -0,0 +1,44 @@
+/**
+ *    Copyright 2017 jmpews
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#ifndef group_h
+#define group_h
+
+#include "hookzz.h"
+#include "kitzz.h"
+
+#include "interceptor.h"
+
+typedef struct _ZzHookGroup {
+    char *name;
+    bool isEnabled;
+    ZzHookFunctionEntry **entries;
+    zz_size_t size;
+    zz_size_t capacity;
+} ZzHookGroup;
+
+typedef struct {
+    ZzHookGroup **groups;
+    zz_size_t size;
+    zz_size_t capacity;
+} ZzHookGroupSet;
+
+ZzHookGroup *ZzFindHookGroup(const char *group_name);
+
+// the entry is freed, drop it from every group
+void ZzRemoveHookFromGroups(ZzHookFunctionEntry *entry);
+
+#endif
@@ -0,0 +1,176 @@
+/**
+ *    Copyright 2017 jmpews
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "hookplan.h"
+#include "interceptor.h"
+#include "memory.h"
+#include "tools.h"
+
+#include "CommonKit/log/log_kit.h"
+
+typedef struct _ZzHookPlan {
+    zz_ptr_t map;
+    zz_size_t map_size;
+    const ZzHookPlanHeader *header;
+    const ZzHookPlanRecord *records;
+    bool is_bound;
+    zz_addr_t load_bias;
+} ZzHookPlan;
+
+typedef struct {
+    ZzHookPlan **plans;
+    zz_size_t size;
+    zz_size_t capacity;
+} ZzHookPlanSet;
+
+static ZzHookPlanSet g_hook_plan_set;
+
+static pthread_mutex_t g_hook_plan_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static bool ZzIsHookPlanValid(const ZzHookPlanHeader *header, zz_size_t map_size) {
+    if (map_size < sizeof(ZzHookPlanHeader) || header->magic != ZZ_HOOK_PLAN_MAGIC ||
+        header->version != ZZ_HOOK_PLAN_VERSION || header->build_id_size > ZZ_HOOK_PLAN_MAX_BUILD_ID_SIZE)
+        return FALSE;
+#if defined(__arm64__) || defined(__aarch64__)
+    if (header->arch != ZZ_HOOK_PLAN_ARCH_ARM64)
+        return FALSE;
+#else
+    return FALSE;
+#endif
+    return (map_size - sizeof(ZzHookPlanHeader)) / sizeof(ZzHookPlanRecord) >= header->record_count;
+}
+
+static ZZSTATUS ZzAddHookPlan(ZzHookPlan *plan) {
+    ZzHookPlanSet *set = &g_hook_plan_set;
+
+    if (set->size >= set->capacity) {
+        zz_size_t capacity = set->capacity ? set->capacity * 2 : 4;
+        ZzHookPlan **plans = (ZzHookPlan **)realloc(set->plans, sizeof(ZzHookPlan *) * capacity);
+        if (!plans)
+            return ZZ_FAILED;
+        set->plans    = plans;
+        set->capacity = capacity;
+    }
+    set->plans[set->size++] = plan;
+    return ZZ_SUCCESS;
+}
+
+// a plan is bound when it is loaded and after every module change, a lookup walks no module
+static void ZzBindHookPlan(ZzHookPlan *plan) {
+    plan->is_bound =
+        ZzFindModuleByBuildId(plan->header->build_id, plan->header->build_id_size, &plan->load_bias);
+}
+
+static void ZzHookPlanModuleChanged(void) {
+    zz_size_t i;
+
+    pthread_mutex_lock(&g_hook_plan_lock);
+    for (i = 0; i < g_hook_plan_set.size; i++)
+        ZzBindHookPlan(g_hook_plan_set.plans[i]);
+    pthread_mutex_unlock(&g_hook_plan_lock);
+}
+
+ZZSTATUS ZzLoadHookPlan(const char *path) {
+    ZzHookPlan *plan;
+    struct stat st;
+    zz_ptr_t map;
+    int fd;
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        ZZ_ERROR_LOG("open hook plan %s failed", path);
+        return ZZ_FAILED;
+    }
+    if (fstat(fd, &st) < 0 || !st.st_size) {
+        close(fd);
+        return ZZ_FAILED;
+    }
+    map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+        return ZZ_FAILED;
+
+    if (!ZzIsHookPlanValid((const ZzHookPlanHeader *)map, st.st_size)) {
+        ZZ_ERROR_LOG("%s is no hook plan of this arch", path);
+        munmap(map, st.st_size);
+        return ZZ_FAILED;
+    }
+
+    if (ZzObserveModuleLoad(ZzHookPlanModuleChanged) == ZZ_FAILED)
+        ZZ_ERROR_LOG_STR("module load is not observed, a plan only binds to the modules loaded already!");
+
+    plan = (ZzHookPlan *)zz_malloc_with_zero(sizeof(ZzHookPlan));
+    if (!plan) {
+        munmap(map, st.st_size);
+        return ZZ_FAILED;
+    }
+    plan->map      = map;
+    plan->map_size = st.st_size;
+    plan->header   = (const ZzHookPlanHeader *)map;
+    plan->records  = (const ZzHookPlanRecord *)(plan->header + 1);
+
+    pthread_mutex_lock(&g_hook_plan_lock);
+    ZzBindHookPlan(plan);
+    if (ZzAddHookPlan(plan) == ZZ_FAILED) {
+        pthread_mutex_unlock(&g_hook_plan_lock);
+        free(plan);
+        munmap(map, st.st_size);
+        return ZZ_FAILED;
+    }
+    pthread_mutex_unlock(&g_hook_plan_lock);
+    HookZzDebugInfoLog("hook plan %s: %u functions%s", path, plan->header->record_count,
+                       plan->is_bound ? "" : ", its module is not loaded yet");
+    return ZZ_SUCCESS;
+}
+
+static int ZzHookPlanRecordCompare(const void *key, const void *item) {
+    uint64_t address = *(const uint64_t *)key;
+    if (address < ((const ZzHookPlanRecord *)item)->address)
+        return -1;
+    return address > ((const ZzHookPlanRecord *)item)->address;
+}
+
+const ZzHookPlanRecord *ZzFindHookPlanRecord(zz_addr_t address) {
+    const ZzHookPlanRecord *record = NULL;
+    ZzHookPlan *plan;
+    zz_size_t i;
+    uint64_t key;
+
+    pthread_mutex_lock(&g_hook_plan_lock);
+    for (i = 0; i < g_hook_plan_set.size; i++) {
+        plan = g_hook_plan_set.plans[i];
+        if (!plan->is_bound)
+            continue;
+        key = address - plan->load_bias;
+        if (key < plan->header->image_start || key >= plan->header->image_end)
+            continue;
+        record = (const ZzHookPlanRecord *)bsearch(&key, plan->records, plan->header->record_count,
+                                                   sizeof(ZzHookPlanRecord), ZzHookPlanRecordCompare);
+        if (record && memcmp(record->prologue, (zz_ptr_t)address, ZZ_HOOK_PLAN_WINDOW_SIZE))
+            record = NULL;
+        break;
+    }
+    pthread_mutex_unlock(&g_hook_plan_lock);
+    return record;
+}
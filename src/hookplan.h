@@ -0,0 +1,63 @@
+/**
+ *    Copyright 2017 jmpews
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#ifndef hookplan_h
+#define hookplan_h
+
+#include "hookzz.h"
+#include "kitzz.h"
+
+// a hook plan is the prologue analysis of every function of one build of a module, written offline by tools/HookPlan
+// and mmap'd as is at runtime: a header and the records sorted by address, little endian.
+
+#define ZZ_HOOK_PLAN_MAGIC 0x50485a5a // "ZZHP"
+#define ZZ_HOOK_PLAN_VERSION 1
+#define ZZ_HOOK_PLAN_MAX_BUILD_ID_SIZE 32
+// the prologue bytes a record was analysed for, the full redirect
+#define ZZ_HOOK_PLAN_WINDOW_SIZE 16
+
+typedef enum _ZzHookPlanArch { ZZ_HOOK_PLAN_ARCH_ARM64 = 1 } ZzHookPlanArch;
+
+typedef struct _ZzHookPlanHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t arch;
+    uint32_t record_count;
+    uint32_t build_id_size; // elf: NT_GNU_BUILD_ID, macho: LC_UUID
+    uint8_t build_id[ZZ_HOOK_PLAN_MAX_BUILD_ID_SIZE];
+    // link time span of the loaded segments
+    uint64_t image_start;
+    uint64_t image_end;
+} ZzHookPlanHeader;
+
+typedef struct _ZzHookPlanRecord {
+    uint64_t address; // link time address, the runtime one less the load bias (macho: vm slide)
+    // the window as analysed, the record is ignored if the code differs at runtime (already patched)
+    uint8_t prologue[ZZ_HOOK_PLAN_WINDOW_SIZE];
+    uint32_t limit_offset; // the instruction which shrank the window, from the function start
+    uint32_t scan_size;
+    uint16_t safe_size;
+    uint8_t limit;           // arm64: ZzARM64PrologueLimit
+    uint8_t relocation_mask; // bit n, instruction n of the window is pc relative and is rewritten by the relocator
+    uint8_t redirect_size;   // the full redirect, a near jump only, or 0 if none fits
+    uint8_t reserved[3];
+} ZzHookPlanRecord;
+
+// the record of the function at the address from the loaded plans, a plan is bound to the loaded module of its build
+// id when it is loaded and after every module change. NULL if no plan has it.
+const ZzHookPlanRecord *ZzFindHookPlanRecord(zz_addr_t address);
+
+#endif
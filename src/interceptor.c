@@ -1,7 +1,12 @@
+#include <pthread.h>
+#include <sched.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include "coverage.h"
+#include "group.h"
 #include "interceptor.h"
+#include "tools.h"
 #include "trampoline.h"
 
 #define ZZHOOKENTRIES_DEFAULT 100
@@ -27,6 +32,9 @@ ZZSTATUS ZzInitializeInterceptor(void) {
         /* update g_intercepter */
         g_interceptor = interceptor;
 
+        // the shadow stack of every hook, one pthread key whatever the number of hooks
+        interceptor->shared_thread_local_key = ZzThreadNewThreadLocalKeyPtr();
+
         /* check rwx memory attributes */
         interceptor->is_support_rx_page = ZzMemoryIsSupportAllocateRXPage();
         if (interceptor->is_support_rx_page) {
@@ -57,27 +65,85 @@ static ZzInterceptor *ZzGlobalInterceptorInstance(void) {
 
 }
 
+static zz_size_t ZzHashTargetPtr(zz_ptr_t target_ptr, zz_size_t bucket_capacity) {
+    zz_addr_t hash = (zz_addr_t)target_ptr;
+    hash ^= hash >> 16;
+    hash *= 0x45d9f3b;
+    hash ^= hash >> 16;
+    return hash & (bucket_capacity - 1);
+}
+
+// a removed entry, the probe goes on past it
+#define ZZ_REMOVED_HOOK_FUNCTION_ENTRY ((ZzHookFunctionEntry *)1)
+
+// the writers of the index, the lookups take no lock
+static pthread_mutex_t g_entry_index_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void ZzIndexHookFunctionEntry(ZzHookFunctionEntryIndex *index, ZzHookFunctionEntry *entry) {
+    zz_size_t i = ZzHashTargetPtr(entry->target_ptr, index->capacity);
+    ZzHookFunctionEntry *slot;
+
+    for (;; i = (i + 1) & (index->capacity - 1)) {
+        slot = index->slots[i];
+        if (!slot || slot == ZZ_REMOVED_HOOK_FUNCTION_ENTRY)
+            break;
+    }
+    if (!slot)
+        index->used++;
+    __atomic_store_n(&index->slots[i], entry, __ATOMIC_RELEASE);
+}
+
+// keep the load factor under 1/2, whole-module hooking adds ~100k entries. the new table is filled before it is
+// published.
+static bool ZzGrowHookFunctionEntryIndex(ZzHookFunctionEntrySet *set) {
+    ZzHookFunctionEntryIndex *index;
+    zz_size_t capacity = 256, i;
+
+    while (capacity < set->size * 4)
+        capacity *= 2;
+    index = (ZzHookFunctionEntryIndex *)zz_malloc_with_zero(sizeof(ZzHookFunctionEntryIndex));
+    if (!index)
+        return FALSE;
+    index->slots = (ZzHookFunctionEntry **)zz_malloc_with_zero(sizeof(ZzHookFunctionEntry *) * capacity);
+    if (!index->slots) {
+        free(index);
+        return FALSE;
+    }
+    index->capacity = capacity;
+    for (i = 0; i < set->size; i++)
+        ZzIndexHookFunctionEntry(index, set->entries[i]);
+    index->retired_next = set->index;
+    __atomic_store_n(&set->index, index, __ATOMIC_RELEASE);
+    return TRUE;
+}
+
 ZzHookFunctionEntry *ZzFindHookFunctionEntry(zz_ptr_t target_ptr) {
     ZzInterceptor *interceptor = NULL;
-    ZzHookFunctionEntrySet *hook_function_entry_set = NULL;
+    ZzHookFunctionEntryIndex *index;
+    ZzHookFunctionEntry *entry;
+    zz_size_t i;
 
     interceptor = ZzGlobalInterceptorInstance();
     if(!interceptor) {
         return NULL;
     }
-    hook_function_entry_set = &(interceptor->hook_function_entry_set);
+    index = __atomic_load_n(&interceptor->hook_function_entry_set.index, __ATOMIC_ACQUIRE);
+    if (!index)
+        return NULL;
 
-    for (int i = 0; i < hook_function_entry_set->size; ++i) {
-        if ((hook_function_entry_set->entries)[i] && target_ptr == (hook_function_entry_set->entries)[i]->target_ptr) {
-            return (hook_function_entry_set->entries)[i];
-        }
+    for (i = ZzHashTargetPtr(target_ptr, index->capacity);; i = (i + 1) & (index->capacity - 1)) {
+        entry = __atomic_load_n(&index->slots[i], __ATOMIC_ACQUIRE);
+        if (!entry)
+            return NULL;
+        if (entry != ZZ_REMOVED_HOOK_FUNCTION_ENTRY && entry->target_ptr == target_ptr)
+            return entry;
     }
-    return NULL;
 }
 
 ZZSTATUS ZzAddHookFunctionEntry(ZzHookFunctionEntry *entry) {
     ZzInterceptor *interceptor = NULL;
     ZzHookFunctionEntrySet *hook_function_entry_set = NULL;
+    ZzHookFunctionEntryIndex *index;
 
     interceptor = ZzGlobalInterceptorInstance();
     if(!interceptor) {
@@ -85,16 +151,31 @@ ZZSTATUS ZzAddHookFunctionEntry(ZzHookFunctionEntry *entry) {
     }
     hook_function_entry_set = &(interceptor->hook_function_entry_set);
 
+    pthread_mutex_lock(&g_entry_index_lock);
     if (hook_function_entry_set->size >= hook_function_entry_set->capacity) {
         ZzHookFunctionEntry **entries = (ZzHookFunctionEntry **)realloc(
             hook_function_entry_set->entries, sizeof(ZzHookFunctionEntry *) * hook_function_entry_set->capacity * 2);
-        if (!entries)
+        if (!entries) {
+            pthread_mutex_unlock(&g_entry_index_lock);
             return ZZ_FAILED;
+        }
 
         hook_function_entry_set->capacity = hook_function_entry_set->capacity * 2;
         hook_function_entry_set->entries  = entries;
     }
     hook_function_entry_set->entries[hook_function_entry_set->size++] = entry;
+
+    index = hook_function_entry_set->index;
+    if (!index || (index->used + 1) * 2 > index->capacity) {
+        if (!ZzGrowHookFunctionEntryIndex(hook_function_entry_set)) {
+            hook_function_entry_set->size--;
+            pthread_mutex_unlock(&g_entry_index_lock);
+            return ZZ_FAILED;
+        }
+    } else {
+        ZzIndexHookFunctionEntry(index, entry);
+    }
+    pthread_mutex_unlock(&g_entry_index_lock);
     return ZZ_SUCCESS;
 }
 
@@ -124,10 +205,168 @@ void ZzInitializeHookFunctionEntry(ZzHookFunctionEntry *entry, ZZHOOKTYPE hook_t
 //    entry->on_half_trampoline      = NULL;
     entry->on_leave_trampoline     = NULL;
     entry->origin_prologue.address = target_ptr;
-    entry->thread_local_key        = ZzThreadNewThreadLocalKeyPtr();
+    entry->thread_local_key        = interceptor->shared_thread_local_key;
+    entry->listeners               = NULL;
+    entry->retired_listeners       = NULL;
+
+    if (pre_call || post_call)
+        ZzAttachHookListener(entry, pre_call, post_call);
 }
 
-void ZzFreeHookFunctionEntry(ZzHookFunctionEntry *entry) {
+static void ZzRetireHookListenerArray(ZzHookFunctionEntry *entry, ZzHookListenerArray *listeners) {
+    ZzHookListenerArray *retired;
+    if (!listeners)
+        return;
+    do {
+        retired                 = __atomic_load_n(&entry->retired_listeners, __ATOMIC_ACQUIRE);
+        listeners->retired_next = retired;
+    } while (!__atomic_compare_exchange_n(&entry->retired_listeners, &retired, listeners, false, __ATOMIC_RELEASE,
+                                          __ATOMIC_RELAXED));
+}
+
+// free the retired snapshots if no invocation holds one. a reader counted after the exchange loaded the listeners
+// published before it, so it holds none of them.
+static void ZzReclaimHookListenerArrays(ZzHookFunctionEntry *entry) {
+    ZzHookListenerArray *retired, *last, *head;
+
+    retired = __atomic_exchange_n(&entry->retired_listeners, NULL, __ATOMIC_SEQ_CST);
+    if (!retired)
+        return;
+    if (!__atomic_load_n(&entry->listener_readers, __ATOMIC_SEQ_CST)) {
+        while (retired) {
+            last    = retired;
+            retired = retired->retired_next;
+            free(last);
+        }
+        return;
+    }
+    // still read, back to the retired list for the next attach/detach
+    for (last = retired; last->retired_next; last = last->retired_next)
+        ;
+    do {
+        head               = __atomic_load_n(&entry->retired_listeners, __ATOMIC_ACQUIRE);
+        last->retired_next = head;
+    } while (!__atomic_compare_exchange_n(&entry->retired_listeners, &head, retired, false, __ATOMIC_RELEASE,
+                                          __ATOMIC_RELAXED));
+}
+
+ZZSTATUS ZzAttachHookListener(ZzHookFunctionEntry *entry, PRECALL pre_call_ptr, POSTCALL post_call_ptr) {
+    ZzHookListenerArray *old_listeners, *new_listeners;
+    zz_size_t old_size;
+
+    do {
+        old_listeners = __atomic_load_n(&entry->listeners, __ATOMIC_ACQUIRE);
+        old_size      = old_listeners ? old_listeners->size : 0;
+
+        new_listeners = (ZzHookListenerArray *)zz_malloc_with_zero(sizeof(ZzHookListenerArray) +
+                                                                    sizeof(ZzHookListener) * (old_size + 1));
+        if (!new_listeners)
+            return ZZ_FAILED;
+        if (old_size)
+            memcpy(new_listeners->listeners, old_listeners->listeners, sizeof(ZzHookListener) * old_size);
+        new_listeners->listeners[old_size].pre_call  = pre_call_ptr;
+        new_listeners->listeners[old_size].post_call = post_call_ptr;
+        new_listeners->size                          = old_size + 1;
+
+        if (__atomic_compare_exchange_n(&entry->listeners, &old_listeners, new_listeners, false, __ATOMIC_SEQ_CST,
+                                        __ATOMIC_RELAXED))
+            break;
+        free(new_listeners);
+    } while (1);
+
+    ZzRetireHookListenerArray(entry, old_listeners);
+    ZzReclaimHookListenerArrays(entry);
+    return ZZ_SUCCESS;
+}
+
+ZZSTATUS ZzDetachHookListener(ZzHookFunctionEntry *entry, PRECALL pre_call_ptr, POSTCALL post_call_ptr) {
+    ZzHookListenerArray *old_listeners, *new_listeners;
+    zz_size_t i, j;
+
+    do {
+        old_listeners = __atomic_load_n(&entry->listeners, __ATOMIC_ACQUIRE);
+        if (!old_listeners)
+            return ZZ_FAILED;
+
+        for (i = 0; i < old_listeners->size; i++) {
+            if (old_listeners->listeners[i].pre_call == pre_call_ptr &&
+                old_listeners->listeners[i].post_call == post_call_ptr)
+                break;
+        }
+        if (i == old_listeners->size)
+            return ZZ_FAILED;
+
+        new_listeners = (ZzHookListenerArray *)zz_malloc_with_zero(sizeof(ZzHookListenerArray) +
+                                                                    sizeof(ZzHookListener) * old_listeners->size);
+        if (!new_listeners)
+            return ZZ_FAILED;
+        for (j = 0; j < old_listeners->size; j++) {
+            if (j != i)
+                new_listeners->listeners[new_listeners->size++] = old_listeners->listeners[j];
+        }
+
+        if (__atomic_compare_exchange_n(&entry->listeners, &old_listeners, new_listeners, false, __ATOMIC_SEQ_CST,
+                                        __ATOMIC_RELAXED))
+            break;
+        free(new_listeners);
+    } while (1);
+
+    ZzRetireHookListenerArray(entry, old_listeners);
+    ZzReclaimHookListenerArrays(entry);
+    return ZZ_SUCCESS;
+}
+
+void ZzDispatchPreCall(ZzHookFunctionEntry *entry, RegState *rs, ZzThreadStack *threadstack, ZzCallStack *callstack) {
+    ZzHookListenerArray *listeners;
+    HookEntryInfo entry_info;
+    zz_size_t i;
+
+    // counted before the load, a snapshot retired from now on is not freed until the release.
+    __atomic_fetch_add(&entry->listener_readers, 1, __ATOMIC_SEQ_CST);
+    callstack->is_reading_listeners = TRUE;
+    listeners                       = __atomic_load_n(&entry->listeners, __ATOMIC_SEQ_CST);
+
+    // post_call dispatch from the same snapshot, even if listeners changed in the call.
+    callstack->listeners = (zz_ptr_t)listeners;
+    if (!listeners)
+        return;
+
+    entry_info.hook_id      = entry->id;
+    entry_info.hook_address = entry->target_ptr;
+    for (i = 0; i < listeners->size; i++) {
+        if (listeners->listeners[i].pre_call)
+            (*listeners->listeners[i].pre_call)(rs, (ThreadStack *)threadstack, (CallStack *)callstack,
+                                                (const HookEntryInfo *)&entry_info);
+    }
+}
+
+void ZzDispatchPostCall(ZzHookFunctionEntry *entry, RegState *rs, ZzThreadStack *threadstack, ZzCallStack *callstack) {
+    ZzHookListenerArray *listeners = (ZzHookListenerArray *)callstack->listeners;
+    HookEntryInfo entry_info;
+    zz_size_t i;
+
+    if (listeners) {
+        entry_info.hook_id      = entry->id;
+        entry_info.hook_address = entry->target_ptr;
+        for (i = 0; i < listeners->size; i++) {
+            if (listeners->listeners[i].post_call)
+                (*listeners->listeners[i].post_call)(rs, (ThreadStack *)threadstack, (CallStack *)callstack,
+                                                     (const HookEntryInfo *)&entry_info);
+        }
+    }
+    ZzReleaseHookListeners(entry, callstack);
+}
+
+void ZzReleaseHookListeners(ZzHookFunctionEntry *entry, ZzCallStack *callstack) {
+    if (!callstack->is_reading_listeners)
+        return;
+    callstack->is_reading_listeners = FALSE;
+    callstack->listeners            = NULL;
+    __atomic_fetch_sub(&entry->listener_readers, 1, __ATOMIC_SEQ_CST);
+}
+
+// no lookup finds the entry from now on, a thread already holding it may still run through it
+static void ZzUnlinkHookFunctionEntry(ZzHookFunctionEntry *entry) {
     ZzInterceptor *interceptor                      = NULL;
     ZzHookFunctionEntrySet *hook_function_entry_set = NULL;
     ZzHookFunctionEntry **entries                   = NULL;
@@ -139,28 +378,94 @@ void ZzFreeHookFunctionEntry(ZzHookFunctionEntry *entry) {
     hook_function_entry_set = &(interceptor->hook_function_entry_set);
     entries                   = hook_function_entry_set->entries;
 
+    ZzHookFunctionEntryIndex *index;
+    zz_size_t j;
     int i;
+
+    pthread_mutex_lock(&g_entry_index_lock);
     for (i = 0; i < hook_function_entry_set->size; ++i) {
         if (entries[i] && entry == entries[i]) {
             // exchange with the last item
             entries[i] = entries[hook_function_entry_set->size - 1];
+            hook_function_entry_set->size--;
+            break;
         }
     }
-    hook_function_entry_set->size--;
+    index = hook_function_entry_set->index;
+    if (index) {
+        for (j = ZzHashTargetPtr(entry->target_ptr, index->capacity); index->slots[j];
+             j = (j + 1) & (index->capacity - 1)) {
+            if (index->slots[j] == entry) {
+                __atomic_store_n(&index->slots[j], ZZ_REMOVED_HOOK_FUNCTION_ENTRY, __ATOMIC_RELEASE);
+                break;
+            }
+        }
+    }
+    pthread_mutex_unlock(&g_entry_index_lock);
+    ZzRemoveHookFromGroups(entry);
+}
+
+// the retired entries, never freed
+static ZzHookFunctionEntry *g_retired_hook_function_entries;
+
+void ZzRetireHookFunctionEntry(ZzHookFunctionEntry *entry) {
+    ZzHookFunctionEntry *retired;
+
+    ZzUnlinkHookFunctionEntry(entry);
+    entry->isEnabled = FALSE;
+    do {
+        retired             = __atomic_load_n(&g_retired_hook_function_entries, __ATOMIC_ACQUIRE);
+        entry->retired_next = retired;
+    } while (!__atomic_compare_exchange_n(&g_retired_hook_function_entries, &retired, entry, false, __ATOMIC_RELEASE,
+                                          __ATOMIC_RELAXED));
+}
+
+void ZzFreeHookFunctionEntry(ZzHookFunctionEntry *entry) {
+    ZzUnlinkHookFunctionEntry(entry);
 
-    // free thread local key
-    ZzThreadFreeThreadLocalKeyPtr(entry->thread_local_key);
     ZzFreeTrampoline(entry);
+
+    if (entry->predicates)
+        free(entry->predicates);
+
+    ZzRetireHookListenerArray(entry, entry->listeners);
+    entry->listeners = NULL;
+    while (entry->retired_listeners) {
+        ZzHookListenerArray *retired = entry->retired_listeners;
+        entry->retired_listeners     = retired->retired_next;
+        free(retired);
+    }
 }
 
 ZZSTATUS ZzBuildHook(zz_ptr_t target_ptr, zz_ptr_t replace_call_ptr, zz_ptr_t *origin_ptr, PRECALL pre_call_ptr,
                      POSTCALL post_call_ptr, bool try_near_jump, ZZHOOKTYPE hook_type) {
+    return ZzBuildHookWithPredicate(target_ptr, replace_call_ptr, origin_ptr, pre_call_ptr, post_call_ptr,
+                                    try_near_jump, hook_type, NULL, 0);
+}
+
+// function_size is the symbol size when the caller knows it, the backend picks a redirect which fits or refuses
+static ZZSTATUS ZzBuildHookOfSize(zz_ptr_t target_ptr, zz_size_t function_size, zz_ptr_t replace_call_ptr,
+                                  zz_ptr_t *origin_ptr, PRECALL pre_call_ptr, POSTCALL post_call_ptr,
+                                  bool try_near_jump, ZZHOOKTYPE hook_type, const HookPredicate *predicates,
+                                  zz_size_t predicate_count) {
     // HookZz do not support x86 now.
 #if defined(__i386__) || defined(__x86_64__)
     HookZzDebugInfoLog("%s", "x86 & x86_64 arch not support");
     return ZZ_FAILED;
 #endif
 
+    // predicates are compiled into the arm64 enter trampoline only.
+#if !defined(__arm64__) && !defined(__aarch64__)
+    if (predicate_count) {
+        HookZzDebugInfoLog("%s", "hook predicate only support arm64");
+        return ZZ_FAILED;
+    }
+#endif
+    if (predicate_count > ZZ_MAX_PREDICATE_COUNT) {
+        HookZzDebugInfoLog("too many hook predicates, max is %d", ZZ_MAX_PREDICATE_COUNT);
+        return ZZ_FAILED;
+    }
+
     ZZSTATUS status                                 = ZZ_DONE_HOOK;
     ZzInterceptor *interceptor                      = NULL;
     ZzHookFunctionEntrySet *hook_function_entry_set = NULL;
@@ -183,7 +488,32 @@ ZZSTATUS ZzBuildHook(zz_ptr_t target_ptr, zz_ptr_t replace_call_ptr, zz_ptr_t *o
         // TODO: check return status
         ZzInitializeHookFunctionEntry(entry, hook_type, target_ptr, replace_call_ptr, pre_call_ptr,
                                       post_call_ptr, try_near_jump);
-        ZzBuildTrampoline(interceptor->backend, entry);
+        entry->function_size = function_size;
+        if (predicate_count) {
+            entry->predicates = (HookPredicate *)zz_malloc_with_zero(sizeof(HookPredicate) * predicate_count);
+            memcpy(entry->predicates, predicates, sizeof(HookPredicate) * predicate_count);
+            entry->predicate_count = predicate_count;
+        }
+        ZzMaterializeLock();
+        if (interceptor->shared_dispatcher_mode &&
+            ZzBuildSharedDispatchTrampoline(interceptor->backend, entry) != ZZ_FAILED) {
+            // built already, no trampolines of its own but the relocated prologue
+        } else if (interceptor->lazy_trampoline_mode &&
+                   ZzBuildLazyTrampoline(interceptor->backend, entry) != ZZ_FAILED) {
+            entry->origin_ptr = origin_ptr;
+        } else {
+            if (ZzBuildTrampoline(interceptor->backend, entry) == ZZ_FAILED) {
+                if (entry->predicates)
+                    free(entry->predicates);
+                // the trampolines built before the failure go back to the allocator, a retry reuses them
+                ZzFreeTrampoline(entry);
+                ZzMaterializeUnlock();
+                free(entry);
+                status = ZZ_FAILED;
+                break;
+            }
+        }
+        ZzMaterializeUnlock();
         ZzAddHookFunctionEntry(entry);
 
         if (origin_ptr)
@@ -192,11 +522,21 @@ ZZSTATUS ZzBuildHook(zz_ptr_t target_ptr, zz_ptr_t replace_call_ptr, zz_ptr_t *o
     return status;
 }
 
+ZZSTATUS ZzBuildHookWithPredicate(zz_ptr_t target_ptr, zz_ptr_t replace_call_ptr, zz_ptr_t *origin_ptr,
+                                   PRECALL pre_call_ptr, POSTCALL post_call_ptr, bool try_near_jump,
+                                   ZZHOOKTYPE hook_type, const HookPredicate *predicates,
+                                   zz_size_t predicate_count) {
+    return ZzBuildHookOfSize(target_ptr, 0, replace_call_ptr, origin_ptr, pre_call_ptr, post_call_ptr, try_near_jump,
+                             hook_type, predicates, predicate_count);
+}
+
 ZZSTATUS ZzBuildHookGOT(zz_ptr_t target_ptr, zz_ptr_t replace_call_ptr, zz_ptr_t *origin_ptr, PRECALL pre_call_ptr,
                         POSTCALL post_call_ptr) {
 #if defined(__i386__) || defined(__x86_64__)
-    HookZzDebugInfoLog("%s", "x86 & x86_64 arch not support");
-    return ZZ_FAILED;
+    if (pre_call_ptr || post_call_ptr) {
+        HookZzDebugInfoLog("%s", "x86 & x86_64 arch not support");
+        return ZZ_FAILED;
+    }
 #endif
 
     ZZSTATUS status                                 = ZZ_DONE_HOOK;
@@ -221,7 +561,9 @@ ZZSTATUS ZzBuildHookGOT(zz_ptr_t target_ptr, zz_ptr_t replace_call_ptr, zz_ptr_t
 
         // TODO: check return status
         ZzInitializeHookFunctionEntry(entry, HOOK_TYPE_FUNCTION_via_GOT, target_ptr, replace_call_ptr, pre_call_ptr, post_call_ptr, false);
-        ZzBuildTrampoline(interceptor->backend, entry);
+        // replace only, the slot is bound to replace_call directly, no trampoline needed.
+        if (pre_call_ptr || post_call_ptr)
+            ZzBuildTrampoline(interceptor->backend, entry);
         ZzAddHookFunctionEntry(entry);
 
         if (origin_ptr)
@@ -289,12 +631,152 @@ ZZSTATUS ZzEnableHook(zz_ptr_t target_ptr) {
         status = ZZ_ALREADY_ENABLED;
         ZZ_ERROR_LOG("%p already enable!", target_ptr);
         return status;
-    } else {
-        entry->isEnabled = true;
     }
 
+    // got entries are keyed by the symbol name, there is no code to patch.
+    if (entry->hook_type == HOOK_TYPE_FUNCTION_via_GOT)
+        return ZzEnableHookGOT((const char *)target_ptr);
+    if (interceptor->safe_patch_mode)
+        return ZzCommitHookFunctionEntries(&entry, 1, TRUE);
+    entry->isEnabled = true;
+
     // key function.
-    return ZzActivateTrampoline(interceptor->backend, entry);
+    ZzMaterializeLock();
+    status = ZzActivateTrampoline(interceptor->backend, entry);
+    ZzMaterializeUnlock();
+    return status;
+}
+
+void ZzSetSafePatchMode(bool enable) {
+    ZzInterceptor *interceptor = ZzGlobalInterceptorInstance();
+    if (interceptor)
+        interceptor->safe_patch_mode = enable;
+}
+
+void ZzSetSharedDispatcherMode(bool enable) {
+    ZzInterceptor *interceptor = ZzGlobalInterceptorInstance();
+    if (interceptor)
+        interceptor->shared_dispatcher_mode = enable;
+}
+
+void ZzSetLazyTrampolineMode(bool enable) {
+    ZzInterceptor *interceptor = ZzGlobalInterceptorInstance();
+    if (interceptor)
+        interceptor->lazy_trampoline_mode = enable;
+}
+
+// the backend writer and relocator are shared, one entry is materialized at a time.
+static pthread_mutex_t g_materialize_lock = PTHREAD_MUTEX_INITIALIZER;
+
+void ZzMaterializeLock(void) { pthread_mutex_lock(&g_materialize_lock); }
+
+void ZzMaterializeUnlock(void) { pthread_mutex_unlock(&g_materialize_lock); }
+
+bool ZzMaterializeTryLock(void) { return pthread_mutex_trylock(&g_materialize_lock) == 0; }
+
+static void ZzMaterializeHookFunctionEntryLocked(ZzHookFunctionEntry *entry) {
+    ZzInterceptor *interceptor = entry->interceptor;
+    FunctionBackup redirect_code;
+
+    if (ZzMaterializeTrampoline(interceptor->backend, entry) == ZZ_FAILED) {
+        // give the function its prologue back, the callers run the original code
+        ZZ_ERROR_LOG("materialize %p failed!", entry->target_ptr);
+        ZzMemoryPatchCode((zz_addr_t)entry->origin_prologue.address, entry->origin_prologue.data,
+                          entry->origin_prologue.size);
+        entry->isEnabled = FALSE;
+        __atomic_store_n(&entry->lazy_state, LAZY_STATE_FAILED, __ATOMIC_RELEASE);
+        return;
+    }
+    if (entry->origin_ptr)
+        *entry->origin_ptr = entry->on_invoke_trampoline;
+    __atomic_store_n(&entry->lazy_state, LAZY_STATE_READY, __ATOMIC_RELEASE);
+
+    // swap the first instruction for a `b` to the transfer trampoline. a thread past it keeps going through the
+    // lazy stub, the rest of the lazy prologue is left as is. without a near transfer trampoline the lazy
+    // prologue stays, every call goes through the lazy thunk.
+    if (entry->isEnabled && ZzBuildRedirectCode(interceptor->backend, entry, &redirect_code) != ZZ_FAILED)
+        ZzMemoryPatchCodeAtomic((zz_addr_t)redirect_code.address, redirect_code.data, redirect_code.size);
+}
+
+zz_ptr_t ZzMaterializeHookFunctionEntry(ZzHookFunctionEntry *entry) {
+    int state = LAZY_STATE_WAIT;
+
+    // only the first caller builds, the others wait for it
+    if (__atomic_compare_exchange_n(&entry->lazy_state, &state, LAZY_STATE_BUILDING, FALSE, __ATOMIC_ACQ_REL,
+                                    __ATOMIC_ACQUIRE)) {
+        pthread_mutex_lock(&g_materialize_lock);
+        ZzMaterializeHookFunctionEntryLocked(entry);
+        pthread_mutex_unlock(&g_materialize_lock);
+    }
+    while ((state = __atomic_load_n(&entry->lazy_state, __ATOMIC_ACQUIRE)) == LAZY_STATE_BUILDING)
+        sched_yield();
+
+    if (state == LAZY_STATE_FAILED)
+        return entry->target_ptr;
+    if (entry->on_enter_transfer_trampoline)
+        return entry->on_enter_transfer_trampoline;
+    if (entry->hook_type == HOOK_TYPE_FUNCTION_via_REPLACE)
+        return entry->replace_call;
+    return entry->on_enter_trampoline;
+}
+
+void ZzSetHugePageArenaMode(bool enable) {
+    ZzInterceptor *interceptor = ZzGlobalInterceptorInstance();
+    if (interceptor && interceptor->allocator)
+        interceptor->allocator->huge_page_arena = enable;
+}
+
+// the counts keep moving, sort a snapshot
+typedef struct _ZzHotEntry {
+    ZzHookFunctionEntry *entry;
+    unsigned long hit_count;
+} ZzHotEntry;
+
+static int ZzCompareHitCount(const void *a, const void *b) {
+    unsigned long x = ((const ZzHotEntry *)a)->hit_count;
+    unsigned long y = ((const ZzHotEntry *)b)->hit_count;
+    return x < y ? 1 : (x > y ? -1 : 0);
+}
+
+ZZSTATUS ZzRelocateHotTrampolines(unsigned long min_hit_count) {
+    ZzInterceptor *interceptor = ZzGlobalInterceptorInstance();
+    ZzHookFunctionEntrySet *hook_function_entry_set;
+    ZzHotEntry *hot_entries;
+    ZzHookFunctionEntry *entry;
+    unsigned long hit_count;
+    zz_size_t i, count = 0;
+
+    if (!interceptor || !interceptor->backend)
+        return ZZ_FAILED;
+    hook_function_entry_set = &interceptor->hook_function_entry_set;
+    if (!hook_function_entry_set->size)
+        return ZZ_DONE;
+
+    hot_entries = (ZzHotEntry *)malloc(sizeof(ZzHotEntry) * hook_function_entry_set->size);
+    if (!hot_entries)
+        return ZZ_FAILED;
+    for (i = 0; i < hook_function_entry_set->size; i++) {
+        entry     = hook_function_entry_set->entries[i];
+        hit_count = __atomic_load_n(&entry->hit_count, __ATOMIC_RELAXED);
+        if (entry->isEnabled && !entry->is_hot && entry->hook_type == HOOK_TYPE_FUNCTION_via_PRE_POST &&
+            hit_count >= min_hit_count) {
+            hot_entries[count].entry       = entry;
+            hot_entries[count++].hit_count = hit_count;
+        }
+    }
+
+    // hottest first, the trampolines of the busiest hooks end up on the same cache lines
+    qsort(hot_entries, count, sizeof(ZzHotEntry), ZzCompareHitCount);
+
+    pthread_mutex_lock(&g_materialize_lock);
+    for (i = 0; i < count; i++) {
+        if (ZzRelocateHotTrampoline(interceptor->backend, hot_entries[i].entry) == ZZ_SUCCESS)
+            hot_entries[i].entry->is_hot = TRUE;
+    }
+    pthread_mutex_unlock(&g_materialize_lock);
+
+    free(hot_entries);
+    return count ? ZZ_SUCCESS : ZZ_DONE;
 }
 
 ZZSTATUS ZzDisableHook(zz_ptr_t target_ptr) {
@@ -311,9 +793,15 @@ ZZSTATUS ZzDisableHook(zz_ptr_t target_ptr) {
 
     if (entry->hook_type == HOOK_TYPE_FUNCTION_via_GOT) {
         ZzDisableHookGOT((const char *)target_ptr);
+    } else if (interceptor->safe_patch_mode) {
+        return ZzCommitHookFunctionEntries(&entry, 1, FALSE);
     } else {
-        ZzMemoryPatchCode((const zz_addr_t)entry->origin_prologue.address, entry->origin_prologue.data,
-                          entry->origin_prologue.size);
+        ZzMaterializeLock();
+        if (!ZzMemoryPatchCodeAtomic((const zz_addr_t)entry->origin_prologue.address, entry->origin_prologue.data,
+                                     entry->origin_prologue.size))
+            ZzMemoryPatchCode((const zz_addr_t)entry->origin_prologue.address, entry->origin_prologue.data,
+                              entry->origin_prologue.size);
+        ZzMaterializeUnlock();
     }
 
     entry->isEnabled = false;
@@ -321,6 +809,182 @@ ZZSTATUS ZzDisableHook(zz_ptr_t target_ptr) {
     return status;
 }
 
+// the relocated instruction that contains the origin offset, the offsets are in ascending order.
+static zz_addr_t ZzFindRelocatedAddress(ZzHookFunctionEntry *entry, zz_addr_t origin_offset) {
+    zz_size_t k;
+
+    for (k = entry->relocated_offset_count; k > 0; k--) {
+        if (entry->relocated_offsets[k - 1].origin_offset <= origin_offset)
+            return ((zz_addr_t)entry->on_invoke_trampoline & ~(zz_addr_t)1) +
+                   entry->relocated_offsets[k - 1].relocated_offset;
+    }
+    return 0;
+}
+
+// move the pc of a stopped thread out of a range that is being patched, and the lr of a thread in a function called
+// from the range (a bl of the prologue).
+static void ZzFixupSuspendedThreadsPC(ZzHookFunctionEntry **entries, zz_size_t count, bool enable) {
+    zz_size_t i, j;
+    zz_addr_t pc, lr, start, end, relocated;
+
+    for (i = 0; i < ZzThreadGetSuspendedThreadCount(); i++) {
+        pc = ZzThreadGetSuspendedThreadPC(i);
+        lr = ZzThreadGetSuspendedThreadLR(i);
+        for (j = 0; pc && j < count; j++) {
+            // the patched range is the backup range, both are the redirect code size.
+            start = (zz_addr_t)entries[j]->origin_prologue.address;
+            end   = start + entries[j]->origin_prologue.size;
+            // the thumb bit of the return address is kept
+            if (enable && (lr & ~(zz_addr_t)1) > start && (lr & ~(zz_addr_t)1) < end) {
+                relocated = ZzFindRelocatedAddress(entries[j], (lr & ~(zz_addr_t)1) - start);
+                if (relocated)
+                    ZzThreadSetSuspendedThreadLR(i, relocated | (lr & 1));
+            }
+            if (pc <= start || pc >= end)
+                continue;
+            if (!enable) {
+                // the redirect code only clobbers the scratch register, re-run the prologue from the start.
+                ZzThreadSetSuspendedThreadPC(i, start);
+                continue;
+            }
+            // continue at the relocated instruction that contains the pc.
+            relocated = ZzFindRelocatedAddress(entries[j], pc - start);
+            if (relocated)
+                ZzThreadSetSuspendedThreadPC(i, relocated);
+        }
+    }
+}
+
+ZZSTATUS ZzCommitHookFunctionEntriesLocked(ZzHookFunctionEntry **entries, zz_size_t count, bool enable) {
+    ZzInterceptor *interceptor = NULL;
+    ZzHookFunctionEntry *entry = NULL;
+    ZzHookFunctionEntry **patch_entries;
+    FunctionBackup *redirect_codes;
+    ZzMemoryPatch *patches;
+    ZzMemoryPatchBatch *batch = NULL;
+    zz_size_t i, patch_count = 0, atomic_count = 0;
+    bool need_suspend = FALSE;
+    ZZSTATUS status = ZZ_SUCCESS;
+
+    interceptor = ZzGlobalInterceptorInstance();
+    if (!interceptor)
+        return ZZ_FAILED;
+
+    redirect_codes = (FunctionBackup *)zz_malloc_with_zero(sizeof(FunctionBackup) * (count ? count : 1));
+    patches        = (ZzMemoryPatch *)zz_malloc_with_zero(sizeof(ZzMemoryPatch) * (count ? count : 1));
+    patch_entries  = (ZzHookFunctionEntry **)zz_malloc_with_zero(sizeof(ZzHookFunctionEntry *) * (count ? count : 1));
+    if (!redirect_codes || !patches || !patch_entries) {
+        free(redirect_codes);
+        free(patches);
+        free(patch_entries);
+        return ZZ_FAILED;
+    }
+
+    // build every patch first, nothing is written if one of them fails.
+    for (i = 0; i < count; i++) {
+        entry = entries[i];
+        if (entry->isEnabled == enable || entry->hook_type == HOOK_TYPE_FUNCTION_via_GOT)
+            continue;
+        if (enable) {
+            if (ZzBuildRedirectCode(interceptor->backend, entry, &redirect_codes[patch_count]) == ZZ_FAILED) {
+                ZZ_ERROR_LOG("%p build redirect code failed!", entry->target_ptr);
+                status = ZZ_FAILED;
+                break;
+            }
+            patches[patch_count].address       = (zz_addr_t)redirect_codes[patch_count].address;
+            patches[patch_count].codedata      = redirect_codes[patch_count].data;
+            patches[patch_count].codedata_size = redirect_codes[patch_count].size;
+        } else {
+            patches[patch_count].address       = (zz_addr_t)entry->origin_prologue.address;
+            patches[patch_count].codedata      = entry->origin_prologue.data;
+            patches[patch_count].codedata_size = entry->origin_prologue.size;
+        }
+        patch_entries[patch_count] = entry;
+        patch_count++;
+    }
+
+    // the patches that fit in one aligned word go first, they are published with an atomic store.
+    for (i = 0; i < patch_count; i++) {
+        if (!ZzMemoryIsAtomicPatchable(patches[i].address, patches[i].codedata_size))
+            continue;
+        ZzMemoryPatch tmp_patch        = patches[atomic_count];
+        ZzHookFunctionEntry *tmp_entry = patch_entries[atomic_count];
+        patches[atomic_count]          = patches[i];
+        patch_entries[atomic_count]    = patch_entries[i];
+        patches[i]                     = tmp_patch;
+        patch_entries[i]               = tmp_entry;
+        // a thread can only be inside the patched range if the store is wider than one aligned instruction word, or
+        // the word covers more than one original instruction (two thumb halfwords).
+        if ((patches[atomic_count].address & 3) + patches[atomic_count].codedata_size > 4 ||
+            patch_entries[atomic_count]->relocated_offset_count > 1)
+            need_suspend = TRUE;
+        atomic_count++;
+    }
+    if (patch_count > atomic_count)
+        need_suspend = TRUE;
+    need_suspend = need_suspend && interceptor->safe_patch_mode;
+
+    if (status != ZZ_FAILED && patch_count > atomic_count) {
+        batch = ZzMemoryPreparePatchBatch(patches + atomic_count, patch_count - atomic_count);
+        if (!batch)
+            status = ZZ_FAILED;
+    }
+
+    if (status != ZZ_FAILED && patch_count) {
+        // one stop-the-world covers the whole batch, nothing may allocate until the threads are resumed.
+        if (need_suspend && !ZzThreadSuspendOtherThreads()) {
+            ZZ_ERROR_LOG_STR("suspend other threads failed!");
+            status = ZZ_FAILED;
+        } else {
+            for (i = 0; i < atomic_count; i++) {
+                if (!ZzMemoryPatchCodeAtomic(patches[i].address, patches[i].codedata, patches[i].codedata_size) &&
+                    !ZzMemoryPatchCode(patches[i].address, patches[i].codedata, patches[i].codedata_size))
+                    status = ZZ_FAILED;
+            }
+            if (batch && !ZzMemoryApplyPatchBatch(batch))
+                status = ZZ_FAILED;
+            if (need_suspend) {
+                ZzFixupSuspendedThreadsPC(patch_entries, patch_count, enable);
+                ZzThreadResumeOtherThreads();
+            }
+        }
+    }
+    if (batch)
+        ZzMemoryFreePatchBatch(batch);
+
+    if (status != ZZ_FAILED) {
+        for (i = 0; i < count; i++) {
+            entry = entries[i];
+            if (entry->isEnabled == enable)
+                continue;
+            // got entries are not code patch, switch them one by one.
+            if (entry->hook_type == HOOK_TYPE_FUNCTION_via_GOT) {
+                if (enable)
+                    ZzEnableHook(entry->target_ptr);
+                else
+                    ZzDisableHook(entry->target_ptr);
+                continue;
+            }
+            entry->isEnabled = enable;
+        }
+    }
+
+    free(redirect_codes);
+    free(patches);
+    free(patch_entries);
+    return status;
+}
+
+ZZSTATUS ZzCommitHookFunctionEntries(ZzHookFunctionEntry **entries, zz_size_t count, bool enable) {
+    ZZSTATUS status;
+
+    // the redirects are built with the shared writer, and no other patch may flip the page protection meanwhile
+    pthread_mutex_lock(&g_materialize_lock);
+    status = ZzCommitHookFunctionEntriesLocked(entries, count, enable);
+    pthread_mutex_unlock(&g_materialize_lock);
+    return status;
+}
+
 ZZSTATUS ZzHook(zz_ptr_t target_ptr, zz_ptr_t replace_ptr, zz_ptr_t *origin_ptr, PRECALL pre_call_ptr,
                 POSTCALL post_call_ptr, bool try_near_jump) {
     ZZHOOKTYPE hook_type;
@@ -335,13 +999,135 @@ ZZSTATUS ZzHook(zz_ptr_t target_ptr, zz_ptr_t replace_ptr, zz_ptr_t *origin_ptr,
     return ZZ_SUCCESS;
 }
 
+ZZSTATUS ZzHookByName(const char *module_name, const char *symbol_name, zz_ptr_t replace_ptr, zz_ptr_t *origin_ptr,
+                      PRECALL pre_call_ptr, POSTCALL post_call_ptr) {
+    zz_ptr_t target_ptr = ZzFindSymbolAddress(module_name, symbol_name);
+
+    if (!target_ptr) {
+        ZZ_ERROR_LOG("can't find the symbol %s!", symbol_name);
+        return ZZ_FAILED;
+    }
+    return ZzHook(target_ptr, replace_ptr, origin_ptr, pre_call_ptr, post_call_ptr, FALSE);
+}
+
+// a one-shot entry is retired from the thunk, a single instruction redirect is restored with one atomic store. try the
+// near jump first.
+static ZZSTATUS ZzBuildOneShotHook(zz_ptr_t target_ptr, zz_size_t function_size) {
+    ZZSTATUS status;
+
+    status = ZzBuildHookOfSize(target_ptr, function_size, NULL, NULL, NULL, NULL, TRUE, HOOK_TYPE_ONE_SHOT, NULL, 0);
+    if (status == ZZ_FAILED)
+        status =
+            ZzBuildHookOfSize(target_ptr, function_size, NULL, NULL, NULL, NULL, FALSE, HOOK_TYPE_ONE_SHOT, NULL, 0);
+    return status;
+}
+
+static ZZSTATUS ZzHookModuleFunctions(const char *module_name, PRECALL pre_call_ptr, POSTCALL post_call_ptr,
+                                      MODULEFUNCTIONFILTER filter, ZZHOOKTYPE hook_type) {
+    ZzModuleFunction *functions;
+    ZzHookFunctionEntry **entries;
+    ZzHookFunctionEntry *entry;
+    zz_size_t i, count, entry_count = 0;
+    ZZSTATUS status;
+
+    count = ZzGetModuleFunctions(module_name, &functions);
+    if (!count) {
+        ZZ_ERROR_LOG("can't find the functions of %s!", module_name);
+        return ZZ_FAILED;
+    }
+    entries = (ZzHookFunctionEntry **)zz_malloc_with_zero(sizeof(ZzHookFunctionEntry *) * count);
+    if (!entries) {
+        free(functions);
+        return ZZ_FAILED;
+    }
+
+    for (i = 0; i < count; i++) {
+        if (filter && !filter(functions[i].name, (void *)functions[i].address, functions[i].size))
+            continue;
+        if (ZzFindHookFunctionEntry((zz_ptr_t)functions[i].address))
+            continue;
+        // the symbol size bounds the redirect, a function too small for any is skipped
+        if (hook_type == HOOK_TYPE_ONE_SHOT)
+            status = ZzBuildOneShotHook((zz_ptr_t)functions[i].address, functions[i].size);
+        else
+            status = ZzBuildHookOfSize((zz_ptr_t)functions[i].address, functions[i].size, NULL, NULL, pre_call_ptr,
+                                       post_call_ptr, FALSE, hook_type, NULL, 0);
+        if (status != ZZ_DONE_HOOK)
+            continue;
+        entry = ZzFindHookFunctionEntry((zz_ptr_t)functions[i].address);
+        if (entry)
+            entries[entry_count++] = entry;
+    }
+    HookZzDebugInfoLog("%s: %lu of %lu functions hooked", module_name, (unsigned long)entry_count,
+                       (unsigned long)count);
+
+    // the whole module is switched on with one batched patch, grouped by page
+    status = entry_count ? ZzCommitHookFunctionEntries(entries, entry_count, TRUE) : ZZ_FAILED;
+    free(entries);
+    free(functions);
+    return status;
+}
+
+ZZSTATUS ZzHookModule(const char *module_name, PRECALL pre_call_ptr, POSTCALL post_call_ptr,
+                      MODULEFUNCTIONFILTER filter) {
+    return ZzHookModuleFunctions(module_name, pre_call_ptr, post_call_ptr, filter, HOOK_TYPE_FUNCTION_via_PRE_POST);
+}
+
+ZZSTATUS ZzHookModuleOneShot(const char *module_name, MODULEFUNCTIONFILTER filter) {
+    return ZzHookModuleFunctions(module_name, NULL, NULL, filter, HOOK_TYPE_ONE_SHOT);
+}
+
+ZZSTATUS ZzHookOneShot(zz_ptr_t target_ptr) {
+    ZZSTATUS status;
+
+    status = ZzBuildOneShotHook(target_ptr, 0);
+    if (status != ZZ_DONE_HOOK)
+        return status;
+    return ZzEnableHook(target_ptr);
+}
+
 ZZSTATUS ZzHookPrePost(zz_ptr_t target_ptr, PRECALL pre_call_ptr, POSTCALL post_call_ptr) {
     ZZSTATUS status = ZZ_SUCCESS;
+    ZzHookFunctionEntry *entry;
+
+    // already hooked, share the prologue patch and trampolines, only add a listener.
+    entry = ZzFindHookFunctionEntry(target_ptr);
+    if (entry) {
+        if (entry->hook_type != HOOK_TYPE_FUNCTION_via_PRE_POST || entry->predicate_count)
+            return ZZ_ALREADY_HOOK;
+        status = ZzAttachHookListener(entry, pre_call_ptr, post_call_ptr);
+        if (status == ZZ_FAILED)
+            return status;
+        if (!entry->isEnabled)
+            status = ZzEnableHook(target_ptr);
+        return status;
+    }
+
     status = ZzBuildHook(target_ptr, NULL, NULL, pre_call_ptr, post_call_ptr, FALSE, HOOK_TYPE_FUNCTION_via_PRE_POST);
     status = ZzEnableHook(target_ptr);
     return status;
 }
 
+ZZSTATUS ZzDetachPrePost(zz_ptr_t target_ptr, PRECALL pre_call_ptr, POSTCALL post_call_ptr) {
+    ZzHookFunctionEntry *entry;
+
+    entry = ZzFindHookFunctionEntry(target_ptr);
+    if (!entry)
+        return ZZ_NO_BUILD_HOOK;
+    return ZzDetachHookListener(entry, pre_call_ptr, post_call_ptr);
+}
+
+ZZSTATUS ZzHookPrePostWithPredicate(zz_ptr_t target_ptr, PRECALL pre_call_ptr, POSTCALL post_call_ptr,
+                                    const HookPredicate *predicates, unsigned long predicate_count) {
+    ZZSTATUS status = ZZ_SUCCESS;
+    status = ZzBuildHookWithPredicate(target_ptr, NULL, NULL, pre_call_ptr, post_call_ptr, FALSE,
+                                      HOOK_TYPE_FUNCTION_via_PRE_POST, predicates, predicate_count);
+    if (status == ZZ_FAILED)
+        return status;
+    status = ZzEnableHook(target_ptr);
+    return status;
+}
+
 ZZSTATUS ZzHookReplace(zz_ptr_t target_ptr, zz_ptr_t replace_ptr, zz_ptr_t *origin_ptr) {
     ZZSTATUS status = ZZ_SUCCESS;
     status = ZzBuildHook(target_ptr, replace_ptr, origin_ptr, NULL, NULL, FALSE, HOOK_TYPE_FUNCTION_via_REPLACE);
@@ -372,6 +1158,80 @@ ZZSTATUS ZzDynamicBinaryInstrumentation(zz_ptr_t insn_address, STUBCALL stub_cal
     return status;
 }
 
+ZZSTATUS ZzDynamicBinaryInstrumentationBlock(zz_ptr_t address, zz_ptr_t range_begin, zz_ptr_t range_end,
+                                             STUBCALL block_call_ptr) {
+    ZZSTATUS status = ZZ_SUCCESS;
+    ZzInterceptor *interceptor;
+    ZzHookFunctionEntry *entry;
+    interceptor = ZzGlobalInterceptorInstance();
+    if (!interceptor) {
+        return ZZ_FAILED;
+    }
+
+    if ((zz_addr_t)address < (zz_addr_t)range_begin || (zz_addr_t)address >= (zz_addr_t)range_end)
+        return ZZ_FAILED;
+
+    // check is already hooked ?
+    if (ZzFindHookFunctionEntry(address)) {
+        status = ZZ_ALREADY_HOOK;
+        return status;
+    }
+    entry = (ZzHookFunctionEntry *)zz_malloc_with_zero(sizeof(ZzHookFunctionEntry));
+    ZzInitializeHookFunctionEntry(entry, HOOK_TYPE_DBI_BLOCK, address, NULL, NULL, NULL, false);
+    entry->stub_call         = block_call_ptr;
+    entry->block_range_begin = range_begin;
+    entry->block_range_end   = range_end;
+
+    // the blocks are translated by the threads running them as well
+    ZzMaterializeLock();
+    status = ZzBuildTrampoline(interceptor->backend, entry);
+    ZzMaterializeUnlock();
+    if (status == ZZ_FAILED) {
+        ZzFreeTrampoline(entry);
+        free(entry);
+        return ZZ_FAILED;
+    }
+    ZzAddHookFunctionEntry(entry);
+    status = ZzEnableHook(address);
+    return status;
+}
+
+ZZSTATUS ZzDynamicBinaryInstrumentationCounter(zz_ptr_t insn_address, ZZCOUNTERTYPE counter_type) {
+    ZZSTATUS status = ZZ_SUCCESS;
+    ZzInterceptor *interceptor;
+    ZzHookFunctionEntry *entry;
+    interceptor = ZzGlobalInterceptorInstance();
+    if (!interceptor) {
+        return ZZ_FAILED;
+    }
+
+    // check is already hooked ?
+    if (ZzFindHookFunctionEntry(insn_address)) {
+        status = ZZ_ALREADY_HOOK;
+        return status;
+    }
+    entry = (ZzHookFunctionEntry *)zz_malloc_with_zero(sizeof(ZzHookFunctionEntry));
+    ZzInitializeHookFunctionEntry(entry, HOOK_TYPE_DBI_COUNTER, insn_address, NULL, NULL, NULL, false);
+    entry->counter_type = counter_type;
+    entry->counter_slot = ZzAllocateCounterSlot(insn_address, counter_type);
+    if (!entry->counter_slot) {
+        free(entry);
+        return ZZ_FAILED;
+    }
+
+    ZzMaterializeLock();
+    status = ZzBuildTrampoline(interceptor->backend, entry);
+    ZzMaterializeUnlock();
+    if (status == ZZ_FAILED) {
+        ZzFreeTrampoline(entry);
+        free(entry);
+        return ZZ_FAILED;
+    }
+    ZzAddHookFunctionEntry(entry);
+    status = ZzEnableHook(insn_address);
+    return status;
+}
+
 ZZSTATUS ZzHookOneInstruction(zz_ptr_t insn_address, PRECALL pre_call_ptr,
                        POSTCALL post_call_ptr, bool try_near_jump) {
     ZZSTATUS status = ZZ_SUCCESS;
@@ -10,12 +10,45 @@
 #include "thunker.h"
 #include "writer.h"
 
+#define ZZ_MAX_PREDICATE_COUNT 8
+
 typedef struct _FunctionBackup {
     zz_ptr_t address;
     zz_size_t size;
     char data[32];
 } FunctionBackup;
 
+typedef struct _ZzHookListener {
+    PRECALL pre_call;
+    POSTCALL post_call;
+} ZzHookListener;
+
+// listeners snapshot, never modified after published. attach/detach publish a new one with CAS,
+// the old one is kept in the retired list, a running invocation may still dispatch from it. the retired ones are
+// freed by the next attach/detach that finds no invocation of the entry between its pre and post call.
+typedef struct _ZzHookListenerArray {
+    zz_size_t size;
+    struct _ZzHookListenerArray *retired_next;
+    ZzHookListener listeners[];
+} ZzHookListenerArray;
+
+#define ZZ_MAX_RELOCATED_INSN_COUNT 16
+
+// where a prologue instruction ended up in on_invoke_trampoline, for the pc fixup of the safe patch.
+typedef struct _ZzRelocatedOffset {
+    zz_size_t origin_offset;
+    zz_size_t relocated_offset;
+} ZzRelocatedOffset;
+
+// lazy entry: the prologue jumps to the shared lazy stub, the trampolines are built on the first call.
+typedef enum _ZZLAZYSTATE {
+    LAZY_STATE_NONE = 0,
+    LAZY_STATE_WAIT,
+    LAZY_STATE_BUILDING,
+    LAZY_STATE_READY,
+    LAZY_STATE_FAILED
+} ZZLAZYSTATE;
+
 struct _ZzInterceptor;
 struct _ZzHookFunctionEntryBackend;
 typedef struct _ZzHookFunctionEntry {
@@ -27,6 +60,7 @@ typedef struct _ZzHookFunctionEntry {
     zz_ptr_t thread_local_key;
 
     zz_ptr_t target_ptr;
+    zz_size_t function_size; // 0 if unknown, the redirect must fit in it
 
     zz_addr_t next_insn_addr; // hook one instruction next insn addr
 
@@ -36,6 +70,14 @@ typedef struct _ZzHookFunctionEntry {
     zz_ptr_t stub_call;
     zz_ptr_t replace_call;
 
+    HookPredicate *predicates;
+    zz_size_t predicate_count;
+
+    ZzHookListenerArray *listeners;
+    ZzHookListenerArray *retired_listeners;
+    // invocations holding a listeners snapshot
+    zz_size_t listener_readers;
+
     zz_ptr_t on_enter_transfer_trampoline;
     zz_ptr_t on_enter_trampoline;
     zz_ptr_t on_insn_leave_trampoline;
@@ -44,28 +86,134 @@ typedef struct _ZzHookFunctionEntry {
     zz_ptr_t on_dynamic_binary_instrumentation_trampoline;
 
     FunctionBackup origin_prologue;
+    ZzRelocatedOffset relocated_offsets[ZZ_MAX_RELOCATED_INSN_COUNT];
+    zz_size_t relocated_offset_count;
     struct _ZzHookFunctionEntryBackend *backend;
     struct _ZzInterceptor *interceptor;
+
+    volatile int lazy_state;
+    zz_ptr_t *origin_ptr; // set once a lazy entry is materialized
+
+    zz_ptr_t block_range_begin; // block dbi, the code translated from the entry
+    zz_ptr_t block_range_end;
+
+    volatile unsigned long *counter_slot; // counter dbi
+    ZZCOUNTERTYPE counter_type;
+    volatile int one_shot_hit;
+
+    volatile unsigned long hit_count; // calls through the enter thunk
+    bool is_hot;                      // the trampolines are in the hot region
+
+    struct _ZzHookFunctionEntry *retired_next;
 } ZzHookFunctionEntry;
 
+// target_ptr index, open addressing. the thunks look it up without a lock, a grown table is published with a release
+// store and the old ones are kept, a lookup may still be reading them.
+typedef struct _ZzHookFunctionEntryIndex {
+    ZzHookFunctionEntry **slots;
+    zz_size_t capacity;
+    zz_size_t used; // entries and removed slots
+    struct _ZzHookFunctionEntryIndex *retired_next;
+} ZzHookFunctionEntryIndex;
+
 typedef struct {
     ZzHookFunctionEntry **entries;
     zz_size_t size;
     zz_size_t capacity;
+
+    ZzHookFunctionEntryIndex *index;
 } ZzHookFunctionEntrySet;
 
 struct _ZzInterceptorBackend;
 typedef struct _ZzInterceptor {
     bool is_support_rx_page;
     bool default_trampoline_try_near_jump;
+    bool safe_patch_mode;
+    bool lazy_trampoline_mode;
+    bool shared_dispatcher_mode;
+    // one thread stack for all the entries, the shared leave trampoline pops the innermost call
+    zz_ptr_t shared_thread_local_key;
     ZzHookFunctionEntrySet hook_function_entry_set;
     struct _ZzInterceptorBackend *backend;
     ZzAllocator *allocator;
 } ZzInterceptor;
 
+ZZSTATUS ZzBuildHookWithPredicate(zz_ptr_t target_ptr, zz_ptr_t replace_call_ptr, zz_ptr_t *origin_ptr,
+                                   PRECALL pre_call_ptr, POSTCALL post_call_ptr, bool try_near_jump,
+                                   ZZHOOKTYPE hook_type, const HookPredicate *predicates,
+                                   zz_size_t predicate_count);
+
+// build the trampolines of a lazy entry, called from the lazy thunk on the first call.
+zz_ptr_t ZzMaterializeHookFunctionEntry(ZzHookFunctionEntry *entry);
+
+// the backend writer and relocator are shared, a build at runtime (materialize, block translation) holds the lock.
+// every code patch holds it as well. a hooked thread only tries, it may hit a hook from inside a build.
+void ZzMaterializeLock(void);
+void ZzMaterializeUnlock(void);
+bool ZzMaterializeTryLock(void);
+
+// switch a set of hooks on or off with one batched code patch.
+ZZSTATUS ZzCommitHookFunctionEntries(ZzHookFunctionEntry **entries, zz_size_t count, bool enable);
+
+// the same with the materialize lock held by the caller
+ZZSTATUS ZzCommitHookFunctionEntriesLocked(ZzHookFunctionEntry **entries, zz_size_t count, bool enable);
+
 ZZSTATUS ZzBuildHookGOT(zz_ptr_t target_ptr, zz_ptr_t replace_call_ptr, zz_ptr_t *origin_ptr, PRECALL pre_call_ptr,
                         POSTCALL post_call_ptr);
+// platform symbol lookup, module_name NULL for every loaded module.
+zz_ptr_t ZzFindSymbolAddress(const char *module_name, const char *symbol_name);
+
+ZZSTATUS ZzEnableHookGOT(const char *name);
+
+// for each fnmatch pattern (full path or file name) the first loaded module matching it, NULL if none, from one walk of
+// the loaded modules. the paths are valid until the next lookup. returns the number of patterns matched.
+zz_size_t ZzFindLoadedModules(const char **module_patterns, zz_size_t count, const char **module_paths,
+                              zz_addr_t *load_biases);
+
+typedef struct _ZzModuleFunction {
+    const char *name; // NULL if the function has no symbol
+    zz_addr_t address;
+    zz_size_t size;
+} ZzModuleFunction;
+
+// functions of the first loaded module matching the pattern, sorted by address (elf: .symtab/.dynsym, macho:
+// LC_FUNCTION_STARTS). the caller frees the array.
+zz_size_t ZzGetModuleFunctions(const char *module_pattern, ZzModuleFunction **functions);
+
+// build id (elf: NT_GNU_BUILD_ID, macho: LC_UUID), load bias and [start, end) of the loaded module containing the
+// address, 0 if it is in no module or the module has no build id.
+zz_size_t ZzGetModuleBuildId(zz_addr_t address, zz_addr_t *load_bias, zz_addr_t *module_start, zz_addr_t *module_end,
+                             uint8_t *build_id, zz_size_t max_size);
+
+// load bias of the loaded module of the build id, FALSE if none is loaded.
+bool ZzFindModuleByBuildId(const uint8_t *build_id, zz_size_t build_id_size, zz_addr_t *load_bias);
+
+// runtime address and size of the first program header of the type (elf only) in the loaded module containing the
+// address, 0 if there is none.
+zz_addr_t ZzFindModuleProgramHeader(zz_addr_t address, uint32_t type, zz_addr_t *load_bias, zz_size_t *size);
+
+// callback runs after a dlopen/dlclose changed the loaded modules. each callback is registered once, up to
+// ZZ_MAX_MODULE_LOAD_CALLBACK_COUNT of them.
+#define ZZ_MAX_MODULE_LOAD_CALLBACK_COUNT 8
+ZZSTATUS ZzObserveModuleLoad(void (*callback)(void));
+
 ZZSTATUS ZzDisableHookGOT(const char *name);
 
+void ZzInitializeHookFunctionEntry(ZzHookFunctionEntry *entry, ZZHOOKTYPE hook_type, zz_ptr_t target_ptr,
+                                   zz_ptr_t replace_call, PRECALL pre_call, POSTCALL post_call, bool try_near_jump);
+
 void ZzFreeHookFunctionEntry(ZzHookFunctionEntry *entry);
+
+// drop the entry from the index and the groups but keep it and its trampolines, a lookup or a thread on its leave
+// path may still hold it.
+void ZzRetireHookFunctionEntry(ZzHookFunctionEntry *entry);
+
+ZZSTATUS ZzAttachHookListener(ZzHookFunctionEntry *entry, PRECALL pre_call_ptr, POSTCALL post_call_ptr);
+ZZSTATUS ZzDetachHookListener(ZzHookFunctionEntry *entry, PRECALL pre_call_ptr, POSTCALL post_call_ptr);
+
+void ZzDispatchPreCall(ZzHookFunctionEntry *entry, RegState *rs, ZzThreadStack *threadstack, ZzCallStack *callstack);
+void ZzDispatchPostCall(ZzHookFunctionEntry *entry, RegState *rs, ZzThreadStack *threadstack, ZzCallStack *callstack);
+// the invocation is done with its listeners snapshot, once per invocation. the post call releases it, the begin
+// invocation of a hook with no post call right after the pre call.
+void ZzReleaseHookListeners(ZzHookFunctionEntry *entry, ZzCallStack *callstack);
 #endif
\ No newline at end of file
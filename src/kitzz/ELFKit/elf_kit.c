@@ -0,0 +1,692 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "ELFKit/elf_kit.h"
+
+#include <fcntl.h>
+#include <fnmatch.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__LP64__) || defined(__aarch64__) || defined(__x86_64__)
+#define ELF_R_SYM ELF64_R_SYM
+#define ELF_R_TYPE ELF64_R_TYPE
+#define ELF_ST_TYPE ELF64_ST_TYPE
+#define ELF_ST_BIND ELF64_ST_BIND
+#else
+#define ELF_R_SYM ELF32_R_SYM
+#define ELF_R_TYPE ELF32_R_TYPE
+#define ELF_ST_TYPE ELF32_ST_TYPE
+#define ELF_ST_BIND ELF32_ST_BIND
+#endif
+
+#if defined(__aarch64__)
+#define ELF_R_JUMP_SLOT R_AARCH64_JUMP_SLOT
+#define ELF_R_GLOB_DAT R_AARCH64_GLOB_DAT
+#elif defined(__arm__)
+#define ELF_R_JUMP_SLOT R_ARM_JUMP_SLOT
+#define ELF_R_GLOB_DAT R_ARM_GLOB_DAT
+#elif defined(__x86_64__)
+#define ELF_R_JUMP_SLOT R_X86_64_JUMP_SLOT
+#define ELF_R_GLOB_DAT R_X86_64_GLOB_DAT
+#elif defined(__i386__)
+#define ELF_R_JUMP_SLOT R_386_JMP_SLOT
+#define ELF_R_GLOB_DAT R_386_GLOB_DAT
+#endif
+
+#ifndef NT_GNU_BUILD_ID
+#define NT_GNU_BUILD_ID 3
+#endif
+
+static ElfModuleList g_elf_module_list;
+// a refresh frees the unloaded modules, no walk of the list may run meanwhile
+static pthread_mutex_t g_elf_module_list_lock = PTHREAD_MUTEX_INITIALIZER;
+
+void zz_elf_lock_loaded_modules() { pthread_mutex_lock(&g_elf_module_list_lock); }
+
+void zz_elf_unlock_loaded_modules() { pthread_mutex_unlock(&g_elf_module_list_lock); }
+
+static unsigned long zz_elf_hash_name(const char *name) {
+    unsigned long hash = 5381;
+    while (*name)
+        hash = hash * 33 + (unsigned char)*name++;
+    return hash;
+}
+
+static void zz_elf_module_add_slot(ElfModule *module, const char *name, zz_addr_t *slot) {
+    zz_size_t i = zz_elf_hash_name(name) & (module->slot_capacity - 1);
+    while (module->slots[i].slot)
+        i = (i + 1) & (module->slot_capacity - 1);
+    module->slots[i].name = name;
+    module->slots[i].slot = slot;
+    module->slot_count++;
+}
+
+// some loaders (i.e. bionic) keep the d_ptr of .dynamic unrelocated.
+static zz_addr_t zz_elf_dynamic_ptr(ElfModule *module, zz_addr_t ptr) {
+    if (ptr < module->load_bias)
+        return ptr + module->load_bias;
+    return ptr;
+}
+
+static void zz_elf_module_index_relocations(ElfModule *module, zz_addr_t rel, zz_size_t rel_size, bool is_rela,
+                                            ElfW(Sym) * symtab, const char *strtab, bool count_only,
+                                            zz_size_t *count) {
+    zz_size_t entsize = is_rela ? sizeof(ElfW(Rela)) : sizeof(ElfW(Rel));
+    zz_addr_t p;
+
+    if (!rel || !rel_size)
+        return;
+    for (p = rel; p < rel + rel_size; p += entsize) {
+        ElfW(Rel) *r       = (ElfW(Rel) *)p;
+        unsigned long type = ELF_R_TYPE(r->r_info);
+        unsigned long sym  = ELF_R_SYM(r->r_info);
+        // an absolute relocation may carry an addend, its slot is not the bare symbol address.
+        if ((type != ELF_R_JUMP_SLOT && type != ELF_R_GLOB_DAT) || !sym)
+            continue;
+        if (count_only) {
+            (*count)++;
+            continue;
+        }
+        zz_elf_module_add_slot(module, strtab + symtab[sym].st_name, (zz_addr_t *)(module->load_bias + r->r_offset));
+    }
+}
+
+static void zz_elf_module_read_build_id(ElfModule *module, const ElfW(Phdr) * note) {
+    zz_addr_t cursor = module->load_bias + note->p_vaddr, end = cursor + note->p_memsz;
+    const ElfW(Nhdr) * nhdr;
+
+    while (cursor + sizeof(ElfW(Nhdr)) <= end) {
+        nhdr = (const ElfW(Nhdr) *)cursor;
+        cursor += sizeof(ElfW(Nhdr)) + ((nhdr->n_namesz + 3) & ~3);
+        if (nhdr->n_type == NT_GNU_BUILD_ID && nhdr->n_namesz == 4 &&
+            !memcmp((const char *)(nhdr + 1), "GNU", 4) && nhdr->n_descsz <= ZZ_ELF_MAX_BUILD_ID_SIZE &&
+            cursor + nhdr->n_descsz <= end) {
+            memcpy(module->build_id, (const void *)cursor, nhdr->n_descsz);
+            module->build_id_size = nhdr->n_descsz;
+            return;
+        }
+        cursor += (nhdr->n_descsz + 3) & ~3;
+    }
+}
+
+static bool zz_elf_module_build_index(ElfModule *module, const ElfW(Phdr) * phdr, ElfW(Half) phnum) {
+    ElfW(Dyn) *dyn = NULL;
+    ElfW(Sym) *symtab = NULL;
+    const char *strtab = NULL;
+    zz_addr_t jmprel = 0, rel = 0;
+    zz_size_t jmprel_size = 0, rel_size = 0, count = 0;
+    bool jmprel_is_rela = FALSE, rel_is_rela = FALSE;
+    int i;
+
+    for (i = 0; i < phnum; i++) {
+        if (phdr[i].p_type == PT_LOAD) {
+            if (!module->start || module->load_bias + phdr[i].p_vaddr < module->start)
+                module->start = module->load_bias + phdr[i].p_vaddr;
+            if (module->load_bias + phdr[i].p_vaddr + phdr[i].p_memsz > module->end)
+                module->end = module->load_bias + phdr[i].p_vaddr + phdr[i].p_memsz;
+        } else if (phdr[i].p_type == PT_DYNAMIC)
+            dyn = (ElfW(Dyn) *)(module->load_bias + phdr[i].p_vaddr);
+        else if (phdr[i].p_type == PT_GNU_RELRO) {
+            module->relro_start = module->load_bias + phdr[i].p_vaddr;
+            module->relro_end   = module->relro_start + phdr[i].p_memsz;
+        } else if (phdr[i].p_type == PT_NOTE && !module->build_id_size)
+            zz_elf_module_read_build_id(module, &phdr[i]);
+    }
+    if (!dyn)
+        return FALSE;
+
+    for (; dyn->d_tag != DT_NULL; dyn++) {
+        switch (dyn->d_tag) {
+        case DT_SYMTAB:
+            symtab = (ElfW(Sym) *)zz_elf_dynamic_ptr(module, dyn->d_un.d_ptr);
+            break;
+        case DT_STRTAB:
+            strtab = (const char *)zz_elf_dynamic_ptr(module, dyn->d_un.d_ptr);
+            break;
+        case DT_GNU_HASH:
+            module->gnu_hash = (uint32_t *)zz_elf_dynamic_ptr(module, dyn->d_un.d_ptr);
+            break;
+        case DT_HASH:
+            module->sysv_hash = (uint32_t *)zz_elf_dynamic_ptr(module, dyn->d_un.d_ptr);
+            break;
+        case DT_VERSYM:
+            module->versym = (ElfW(Half) *)zz_elf_dynamic_ptr(module, dyn->d_un.d_ptr);
+            break;
+        case DT_JMPREL:
+            jmprel = zz_elf_dynamic_ptr(module, dyn->d_un.d_ptr);
+            break;
+        case DT_PLTRELSZ:
+            jmprel_size = dyn->d_un.d_val;
+            break;
+        case DT_PLTREL:
+            jmprel_is_rela = dyn->d_un.d_val == DT_RELA;
+            break;
+        case DT_RELA:
+            rel         = zz_elf_dynamic_ptr(module, dyn->d_un.d_ptr);
+            rel_is_rela = TRUE;
+            break;
+        case DT_RELASZ:
+            rel_size = dyn->d_un.d_val;
+            break;
+        case DT_REL:
+            rel = zz_elf_dynamic_ptr(module, dyn->d_un.d_ptr);
+            break;
+        case DT_RELSZ:
+            rel_size = dyn->d_un.d_val;
+            break;
+        default:
+            break;
+        }
+    }
+    if (!symtab || !strtab)
+        return FALSE;
+    module->dynsym = symtab;
+    module->dynstr = strtab;
+
+    // one pass to size the table, one pass to fill it.
+    zz_elf_module_index_relocations(module, jmprel, jmprel_size, jmprel_is_rela, symtab, strtab, TRUE, &count);
+    zz_elf_module_index_relocations(module, rel, rel_size, rel_is_rela, symtab, strtab, TRUE, &count);
+
+    module->slot_capacity = 16;
+    while (module->slot_capacity < count * 2)
+        module->slot_capacity *= 2;
+    module->slots = (ElfRelocationSlot *)calloc(module->slot_capacity, sizeof(ElfRelocationSlot));
+    if (!module->slots)
+        return FALSE;
+
+    zz_elf_module_index_relocations(module, jmprel, jmprel_size, jmprel_is_rela, symtab, strtab, FALSE, NULL);
+    zz_elf_module_index_relocations(module, rel, rel_size, rel_is_rela, symtab, strtab, FALSE, NULL);
+    return TRUE;
+}
+
+static void zz_elf_free_module(ElfModule *module) {
+    if (module->file_map)
+        munmap(module->file_map, module->file_map_size);
+    free(module->path);
+    free(module->slots);
+    free(module->symbols);
+    free(module);
+}
+
+static int zz_elf_iterate_phdr_callback(struct dl_phdr_info *info, size_t size, void *data) {
+    ElfModuleList *list = (ElfModuleList *)data;
+    const char *path    = info->dlpi_name ? info->dlpi_name : "";
+    ElfModule *module;
+    zz_size_t i;
+
+    for (i = 0; i < list->size; i++) {
+        module = list->modules[i];
+        if (module->load_bias == (zz_addr_t)info->dlpi_addr && !strcmp(module->path, path)) {
+            module->is_alive = TRUE;
+            return 0;
+        }
+    }
+
+    module = (ElfModule *)calloc(1, sizeof(ElfModule));
+    if (!module)
+        return 0;
+    module->path      = strdup(path);
+    module->load_bias = (zz_addr_t)info->dlpi_addr;
+    module->phdr      = info->dlpi_phdr;
+    module->phnum     = info->dlpi_phnum;
+    module->is_alive  = TRUE;
+    if (!module->path || !zz_elf_module_build_index(module, info->dlpi_phdr, info->dlpi_phnum)) {
+        zz_elf_free_module(module);
+        return 0;
+    }
+
+    if (list->size >= list->capacity) {
+        zz_size_t capacity = list->capacity ? list->capacity * 2 : 16;
+        ElfModule **modules = (ElfModule **)realloc(list->modules, sizeof(ElfModule *) * capacity);
+        if (!modules) {
+            zz_elf_free_module(module);
+            return 0;
+        }
+        list->modules  = modules;
+        list->capacity = capacity;
+    }
+    list->modules[list->size++] = module;
+    return 0;
+}
+
+typedef struct _ElfLoadCounter {
+    bool is_valid;
+    unsigned long long adds;
+    unsigned long long subs;
+} ElfLoadCounter;
+
+static int zz_elf_load_counter_callback(struct dl_phdr_info *info, size_t size, void *data) {
+    ElfLoadCounter *counter = (ElfLoadCounter *)data;
+
+    // older loaders have no dlpi_adds/dlpi_subs
+    if (size >= offsetof(struct dl_phdr_info, dlpi_subs) + sizeof(info->dlpi_subs)) {
+        counter->is_valid = TRUE;
+        counter->adds     = info->dlpi_adds;
+        counter->subs     = info->dlpi_subs;
+    }
+    return 1;
+}
+
+bool zz_elf_is_loaded_modules_changed() {
+    ElfModuleList *list    = &g_elf_module_list;
+    ElfLoadCounter counter = {0};
+
+    if (!list->size)
+        return TRUE;
+    dl_iterate_phdr(zz_elf_load_counter_callback, &counter);
+    return !counter.is_valid || counter.adds != list->adds || counter.subs != list->subs;
+}
+
+ElfModuleList *zz_elf_get_loaded_modules() {
+    ElfModuleList *list    = &g_elf_module_list;
+    ElfLoadCounter counter = {0};
+    zz_size_t i, j;
+
+    dl_iterate_phdr(zz_elf_load_counter_callback, &counter);
+    list->adds = counter.adds;
+    list->subs = counter.subs;
+
+    for (i = 0; i < list->size; i++)
+        list->modules[i]->is_alive = FALSE;
+    dl_iterate_phdr(zz_elf_iterate_phdr_callback, list);
+
+    for (i = 0, j = 0; i < list->size; i++) {
+        if (list->modules[i]->is_alive)
+            list->modules[j++] = list->modules[i];
+        else
+            zz_elf_free_module(list->modules[i]);
+    }
+    list->size = j;
+    return list;
+}
+
+zz_size_t zz_elf_module_find_relocation_slots(ElfModule *module, const char *name, zz_addr_t **slots,
+                                              zz_size_t max_count) {
+    zz_size_t i, count = 0;
+
+    if (!module->slot_capacity)
+        return 0;
+    for (i = zz_elf_hash_name(name) & (module->slot_capacity - 1); module->slots[i].slot;
+         i = (i + 1) & (module->slot_capacity - 1)) {
+        if (strcmp(module->slots[i].name, name))
+            continue;
+        if (count < max_count)
+            slots[count] = module->slots[i].slot;
+        count++;
+    }
+    return count < max_count ? count : max_count;
+}
+
+bool zz_elf_module_is_in_relro(ElfModule *module, zz_addr_t address) {
+    return address >= module->relro_start && address < module->relro_end;
+}
+
+bool zz_elf_module_contains_address(ElfModule *module, zz_addr_t address) {
+    return address >= module->start && address < module->end;
+}
+
+bool zz_elf_module_match_name(ElfModule *module, const char *module_name) {
+    zz_size_t path_len, name_len;
+
+    if (!module_name)
+        return TRUE;
+    path_len = strlen(module->path);
+    name_len = strlen(module_name);
+    if (name_len > path_len)
+        return FALSE;
+    // match the full path or the file name
+    if (strcmp(module->path + path_len - name_len, module_name))
+        return FALSE;
+    return name_len == path_len || module->path[path_len - name_len - 1] == '/';
+}
+
+bool zz_elf_module_match_pattern(ElfModule *module, const char *pattern) {
+    const char *file_name = strrchr(module->path, '/');
+
+    if (!fnmatch(pattern, module->path, 0))
+        return TRUE;
+    return file_name && !fnmatch(pattern, file_name + 1, 0);
+}
+
+static bool zz_elf_is_defined_symbol(const ElfW(Sym) * sym) {
+    if (sym->st_shndx == SHN_UNDEF || !sym->st_value)
+        return FALSE;
+    // the value of an ifunc is its resolver
+    if (ELF_ST_TYPE(sym->st_info) == STT_GNU_IFUNC)
+        return FALSE;
+    return ELF_ST_TYPE(sym->st_info) == STT_FUNC || ELF_ST_TYPE(sym->st_info) == STT_OBJECT ||
+           ELF_ST_TYPE(sym->st_info) == STT_NOTYPE;
+}
+
+static uint32_t zz_elf_gnu_hash(const char *name) {
+    uint32_t h = 5381;
+    while (*name)
+        h = (h << 5) + h + (unsigned char)*name++;
+    return h;
+}
+
+static unsigned long zz_elf_sysv_hash(const char *name) {
+    unsigned long h = 0, g;
+    while (*name) {
+        h = (h << 4) + (unsigned char)*name++;
+        g = h & 0xf0000000;
+        if (g)
+            h ^= g >> 24;
+        h &= ~g;
+    }
+    return h;
+}
+
+// only the default version (name@@VERSION) is bound by name, same as dlsym.
+static bool zz_elf_module_is_default_version(ElfModule *module, uint32_t index) {
+    return !module->versym || !(module->versym[index] & 0x8000);
+}
+
+static ElfW(Sym) * zz_elf_module_gnu_lookup(ElfModule *module, const char *name) {
+    uint32_t nbuckets   = module->gnu_hash[0];
+    uint32_t symoffset  = module->gnu_hash[1];
+    uint32_t bloom_size = module->gnu_hash[2];
+    uint32_t bloom_shift = module->gnu_hash[3];
+    ElfW(Addr) *bloom   = (ElfW(Addr) *)&module->gnu_hash[4];
+    uint32_t *buckets   = (uint32_t *)&bloom[bloom_size];
+    uint32_t *chain     = &buckets[nbuckets];
+    uint32_t h          = zz_elf_gnu_hash(name);
+    uint32_t bits       = sizeof(ElfW(Addr)) * 8;
+    ElfW(Addr) word, mask;
+    uint32_t i;
+
+    if (!nbuckets || !bloom_size)
+        return NULL;
+    // the bloom filter rejects most misses without touching the chains
+    word = bloom[(h / bits) % bloom_size];
+    mask = ((ElfW(Addr))1 << (h % bits)) | ((ElfW(Addr))1 << ((h >> bloom_shift) % bits));
+    if ((word & mask) != mask)
+        return NULL;
+
+    i = buckets[h % nbuckets];
+    if (i < symoffset)
+        return NULL;
+    for (;; i++) {
+        uint32_t h2 = chain[i - symoffset];
+        if ((h | 1) == (h2 | 1) && !strcmp(name, module->dynstr + module->dynsym[i].st_name) &&
+            zz_elf_module_is_default_version(module, i))
+            return &module->dynsym[i];
+        if (h2 & 1)
+            break;
+    }
+    return NULL;
+}
+
+static ElfW(Sym) * zz_elf_module_sysv_lookup(ElfModule *module, const char *name) {
+    uint32_t nbucket = module->sysv_hash[0];
+    uint32_t *bucket = &module->sysv_hash[2];
+    uint32_t *chain  = &bucket[nbucket];
+    uint32_t i;
+
+    if (!nbucket)
+        return NULL;
+    for (i = bucket[zz_elf_sysv_hash(name) % nbucket]; i; i = chain[i]) {
+        if (!strcmp(name, module->dynstr + module->dynsym[i].st_name) && zz_elf_module_is_default_version(module, i))
+            return &module->dynsym[i];
+    }
+    return NULL;
+}
+
+static void zz_elf_module_add_symbol(ElfModule *module, const char *name, zz_addr_t address, zz_size_t size,
+                                     bool is_local) {
+    zz_size_t i = zz_elf_hash_name(name) & (module->symbol_capacity - 1);
+    while (module->symbols[i].name) {
+        // keep the first definition, same as the loader, a global one replaces a local of the same name
+        if (!strcmp(module->symbols[i].name, name)) {
+            if (!module->symbols[i].is_local || is_local)
+                return;
+            module->symbol_count--;
+            break;
+        }
+        i = (i + 1) & (module->symbol_capacity - 1);
+    }
+    module->symbols[i].name     = name;
+    module->symbols[i].address  = address;
+    module->symbols[i].size     = size;
+    module->symbols[i].is_local = is_local;
+    module->symbol_count++;
+}
+
+// .symtab is not mapped by the loader, map the file read-only, the names are used in place.
+static void zz_elf_module_load_symtab(ElfModule *module) {
+    const char *path = module->path[0] ? module->path : "/proc/self/exe";
+    ElfW(Ehdr) *ehdr;
+    ElfW(Shdr) *shdrs, *symtab_shdr = NULL, *strtab_shdr;
+    ElfW(Sym) *syms;
+    const char *strtab;
+    struct stat st;
+    zz_size_t i, count;
+    int fd;
+
+    module->is_symtab_loaded = TRUE;
+    fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return;
+    if (fstat(fd, &st) != 0 || (zz_size_t)st.st_size < sizeof(ElfW(Ehdr))) {
+        close(fd);
+        return;
+    }
+    module->file_map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (module->file_map == MAP_FAILED) {
+        module->file_map = NULL;
+        return;
+    }
+    module->file_map_size = st.st_size;
+
+    ehdr = (ElfW(Ehdr) *)module->file_map;
+    if (memcmp(ehdr->e_ident, ELFMAG, SELFMAG) || !ehdr->e_shoff ||
+        ehdr->e_shoff + ehdr->e_shnum * sizeof(ElfW(Shdr)) > module->file_map_size)
+        return;
+    shdrs = (ElfW(Shdr) *)((char *)module->file_map + ehdr->e_shoff);
+    for (i = 0; i < ehdr->e_shnum; i++) {
+        if (shdrs[i].sh_type == SHT_SYMTAB) {
+            symtab_shdr = &shdrs[i];
+            break;
+        }
+    }
+    if (!symtab_shdr || symtab_shdr->sh_link >= ehdr->e_shnum)
+        return;
+    strtab_shdr = &shdrs[symtab_shdr->sh_link];
+    if (symtab_shdr->sh_offset + symtab_shdr->sh_size > module->file_map_size ||
+        strtab_shdr->sh_offset + strtab_shdr->sh_size > module->file_map_size)
+        return;
+
+    syms   = (ElfW(Sym) *)((char *)module->file_map + symtab_shdr->sh_offset);
+    strtab = (const char *)module->file_map + strtab_shdr->sh_offset;
+    count  = symtab_shdr->sh_size / sizeof(ElfW(Sym));
+
+    module->symtab       = syms;
+    module->symtab_count = count;
+    module->strtab       = strtab;
+    module->strtab_size  = strtab_shdr->sh_size;
+
+    module->symbol_capacity = 16;
+    while (module->symbol_capacity < count * 2)
+        module->symbol_capacity *= 2;
+    module->symbols = (ElfSymbol *)calloc(module->symbol_capacity, sizeof(ElfSymbol));
+    if (!module->symbols)
+        return;
+    for (i = 0; i < count; i++) {
+        if (!zz_elf_is_defined_symbol(&syms[i]) || syms[i].st_name >= strtab_shdr->sh_size)
+            continue;
+        zz_elf_module_add_symbol(module, strtab + syms[i].st_name, module->load_bias + syms[i].st_value,
+                                 syms[i].st_size, ELF_ST_BIND(syms[i].st_info) == STB_LOCAL);
+    }
+}
+
+static zz_addr_t zz_elf_module_find_dynamic_symbol(ElfModule *module, const char *name) {
+    ElfW(Sym) *sym = NULL;
+
+    if (module->dynsym && module->gnu_hash)
+        sym = zz_elf_module_gnu_lookup(module, name);
+    else if (module->dynsym && module->sysv_hash)
+        sym = zz_elf_module_sysv_lookup(module, name);
+    if (sym && zz_elf_is_defined_symbol(sym))
+        return module->load_bias + sym->st_value;
+    return 0;
+}
+
+static zz_addr_t zz_elf_module_find_static_symbol(ElfModule *module, const char *name, bool skip_local) {
+    zz_size_t i;
+
+    if (!module->is_symtab_loaded)
+        zz_elf_module_load_symtab(module);
+    if (!module->symbol_capacity)
+        return 0;
+    for (i = zz_elf_hash_name(name) & (module->symbol_capacity - 1); module->symbols[i].name;
+         i = (i + 1) & (module->symbol_capacity - 1)) {
+        if (!strcmp(module->symbols[i].name, name))
+            return skip_local && module->symbols[i].is_local ? 0 : module->symbols[i].address;
+    }
+    return 0;
+}
+
+zz_addr_t zz_elf_module_find_symbol(ElfModule *module, const char *name) {
+    zz_addr_t address = zz_elf_module_find_dynamic_symbol(module, name);
+
+    if (!address)
+        address = zz_elf_module_find_static_symbol(module, name, FALSE);
+    return address;
+}
+
+// .dynsym has no size, the hash tables cover every symbol of it.
+static zz_size_t zz_elf_module_get_dynsym_count(ElfModule *module) {
+    zz_size_t count = 0;
+    uint32_t i;
+
+    if (module->sysv_hash)
+        return module->sysv_hash[1];
+    if (module->gnu_hash) {
+        uint32_t nbuckets   = module->gnu_hash[0];
+        uint32_t symoffset  = module->gnu_hash[1];
+        uint32_t bloom_size = module->gnu_hash[2];
+        uint32_t *buckets   = (uint32_t *)&((ElfW(Addr) *)&module->gnu_hash[4])[bloom_size];
+        uint32_t *chain     = &buckets[nbuckets];
+
+        // the last chain ends the table
+        for (i = 0; i < nbuckets; i++) {
+            if (buckets[i] > count)
+                count = buckets[i];
+        }
+        if (count < symoffset)
+            return symoffset;
+        while (!(chain[count - symoffset] & 1))
+            count++;
+        return count + 1;
+    }
+    return 0;
+}
+
+static int zz_elf_compare_symbol_address(const void *a, const void *b) {
+    const ElfSymbol *left = (const ElfSymbol *)a, *right = (const ElfSymbol *)b;
+    if (left->address != right->address)
+        return left->address < right->address ? -1 : 1;
+    return 0;
+}
+
+zz_size_t zz_elf_module_get_functions(ElfModule *module, ElfSymbol **functions) {
+    ElfW(Sym) *syms;
+    const char *strtab;
+    zz_size_t i, j, count, strtab_size, function_count = 0;
+    ElfSymbol *result;
+
+    *functions = NULL;
+    if (!module->is_symtab_loaded)
+        zz_elf_module_load_symtab(module);
+    if (module->symtab) {
+        syms        = module->symtab;
+        count       = module->symtab_count;
+        strtab      = module->strtab;
+        strtab_size = module->strtab_size;
+    } else if (module->dynsym) {
+        syms        = module->dynsym;
+        count       = zz_elf_module_get_dynsym_count(module);
+        strtab      = module->dynstr;
+        strtab_size = (zz_size_t)-1;
+    } else {
+        return 0;
+    }
+
+    result = (ElfSymbol *)calloc(count ? count : 1, sizeof(ElfSymbol));
+    if (!result)
+        return 0;
+    for (i = 0; i < count; i++) {
+        if (ELF_ST_TYPE(syms[i].st_info) != STT_FUNC || syms[i].st_shndx == SHN_UNDEF || !syms[i].st_value ||
+            !syms[i].st_size || syms[i].st_name >= strtab_size)
+            continue;
+        result[function_count].name    = strtab + syms[i].st_name;
+        result[function_count].address = module->load_bias + syms[i].st_value;
+        result[function_count].size    = syms[i].st_size;
+        function_count++;
+    }
+
+    qsort(result, function_count, sizeof(ElfSymbol), zz_elf_compare_symbol_address);
+    for (i = 0, j = 0; i < function_count; i++) {
+        if (j && result[j - 1].address == result[i].address)
+            continue;
+        result[j++] = result[i];
+    }
+    *functions = result;
+    return j;
+}
+
+// the exports of every module first, .symtab (the file is mapped) only when none of them has it. a lookup over every
+// module skips the static locals, they must not shadow an export.
+static zz_addr_t zz_elf_find_symbol_in_list(ElfModuleList *list, const char *module_name, const char *name,
+                                            bool dynamic_only) {
+    zz_addr_t address;
+    zz_size_t i;
+
+    for (i = 0; i < list->size; i++) {
+        if (!zz_elf_module_match_name(list->modules[i], module_name))
+            continue;
+        address = zz_elf_module_find_dynamic_symbol(list->modules[i], name);
+        if (address)
+            return address;
+    }
+    for (i = 0; !dynamic_only && i < list->size; i++) {
+        if (!zz_elf_module_match_name(list->modules[i], module_name))
+            continue;
+        address = zz_elf_module_find_static_symbol(list->modules[i], name, !module_name);
+        if (address)
+            return address;
+    }
+    return 0;
+}
+
+ElfModule *zz_elf_find_module(const char *module_name) {
+    ElfModuleList *list = zz_elf_get_loaded_modules();
+    zz_size_t i;
+
+    for (i = 0; i < list->size; i++) {
+        if (zz_elf_module_match_name(list->modules[i], module_name))
+            return list->modules[i];
+    }
+    return NULL;
+}
+
+zz_addr_t zz_elf_find_symbol(const char *module_name, const char *name) {
+    zz_addr_t address = 0;
+
+    zz_elf_lock_loaded_modules();
+    // the cached exports first, walk the loaded modules (takes the loader lock) only on a miss. after a dlopen or
+    // dlclose the cache may hold an unmapped module, it is refreshed first.
+    if (!zz_elf_is_loaded_modules_changed())
+        address = zz_elf_find_symbol_in_list(&g_elf_module_list, module_name, name, TRUE);
+    if (!address)
+        address = zz_elf_find_symbol_in_list(zz_elf_get_loaded_modules(), module_name, name, FALSE);
+    zz_elf_unlock_loaded_modules();
+    return address;
+}
@@ -0,0 +1,118 @@
+#ifndef elfkit_elf_kit
+#define elfkit_elf_kit
+
+#include <err.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <elf.h>
+#include <link.h>
+
+#include "kitzz.h"
+
+#define ZZ_ELF_MAX_BUILD_ID_SIZE 32
+
+typedef struct _ElfRelocationSlot {
+    const char *name; // points into the .dynstr of the module
+    zz_addr_t *slot;
+} ElfRelocationSlot;
+
+typedef struct _ElfSymbol {
+    const char *name;
+    zz_addr_t address;
+    zz_size_t size;
+    bool is_local; // STB_LOCAL of .symtab, not visible to a lookup over every module
+} ElfSymbol;
+
+typedef struct _ElfModule {
+    char *path;
+    zz_addr_t load_bias;
+    zz_addr_t start; // PT_LOAD span
+    zz_addr_t end;
+    zz_addr_t relro_start;
+    zz_addr_t relro_end;
+    bool is_alive;
+
+    // the program headers as loaded
+    const ElfW(Phdr) * phdr;
+    ElfW(Half) phnum;
+
+    // NT_GNU_BUILD_ID of a PT_NOTE, build_id_size 0 if the module has none
+    uint8_t build_id[ZZ_ELF_MAX_BUILD_ID_SIZE];
+    zz_size_t build_id_size;
+
+    // JUMP_SLOT/GLOB_DAT relocations, open addressing hash table keyed by the symbol name
+    ElfRelocationSlot *slots;
+    zz_size_t slot_capacity;
+    zz_size_t slot_count;
+
+    // .dynsym, looked up through .gnu.hash or .hash
+    ElfW(Sym) * dynsym;
+    const char *dynstr;
+    uint32_t *gnu_hash;
+    uint32_t *sysv_hash;
+    ElfW(Half) * versym;
+
+    // .symtab of the mmap'd file, loaded on the first miss of .dynsym, open addressing hash table keyed by name
+    bool is_symtab_loaded;
+    zz_ptr_t file_map;
+    zz_size_t file_map_size;
+    ElfSymbol *symbols;
+    zz_size_t symbol_capacity;
+    zz_size_t symbol_count;
+    ElfW(Sym) * symtab;
+    zz_size_t symtab_count;
+    const char *strtab;
+    zz_size_t strtab_size;
+} ElfModule;
+
+typedef struct _ElfModuleList {
+    zz_size_t size;
+    zz_size_t capacity;
+    ElfModule **modules;
+
+    // dlpi_adds/dlpi_subs of the last refresh
+    unsigned long long adds;
+    unsigned long long subs;
+} ElfModuleList;
+
+// the list and its modules are shared, the lock is held across a refresh and every walk of the list or use of a
+// module of it. zz_elf_find_symbol takes it itself.
+void zz_elf_lock_loaded_modules();
+void zz_elf_unlock_loaded_modules();
+
+// the relocation index of a module is built once, modules loaded since the last call are indexed, unloaded ones are
+// dropped. the lock is held.
+ElfModuleList *zz_elf_get_loaded_modules();
+
+// a module was loaded or unloaded since the last zz_elf_get_loaded_modules, only the first module is visited. the
+// lock is held.
+bool zz_elf_is_loaded_modules_changed();
+
+zz_size_t zz_elf_module_find_relocation_slots(ElfModule *module, const char *name, zz_addr_t **slots,
+                                              zz_size_t max_count);
+
+bool zz_elf_module_is_in_relro(ElfModule *module, zz_addr_t address);
+
+bool zz_elf_module_contains_address(ElfModule *module, zz_addr_t address);
+
+bool zz_elf_module_match_name(ElfModule *module, const char *module_name);
+
+// fnmatch pattern against the full path or the file name
+bool zz_elf_module_match_pattern(ElfModule *module, const char *pattern);
+
+// the lock is held, the module is valid until it is released
+ElfModule *zz_elf_find_module(const char *module_name);
+
+// defined symbol of the module, .dynsym first then .symtab. 0 if not found, or an ifunc.
+zz_addr_t zz_elf_module_find_symbol(ElfModule *module, const char *name);
+
+// STT_FUNC symbols with a size, .symtab if the file has one else .dynsym. sorted by address, aliases dropped, the
+// caller frees the array.
+zz_size_t zz_elf_module_get_functions(ElfModule *module, ElfSymbol **functions);
+
+// module_name NULL, search every module in load order. the cached modules are searched first while no module was
+// loaded or unloaded since they were.
+zz_addr_t zz_elf_find_symbol(const char *module_name, const char *name);
+
+#endif
@@ -4,6 +4,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
 #include <unistd.h>
 
 
@@ -118,3 +119,95 @@ zz_ptr_t zz_linux_vm_search_code_cave(zz_addr_t address, zz_size_t range_size, z
     free(mlayout);
     return NULL;
 }
+
+// the lowest address the kernel maps by default (vm.mmap_min_addr is at most this on the usual configs)
+#define ZZ_LINUX_VM_MIN_MAP_ADDRESS 0x10000
+
+zz_addr_t zz_linux_vm_search_free_gap(zz_addr_t address, zz_size_t range_size, zz_size_t size) {
+    zz_addr_t start, end, prev_end = ZZ_LINUX_VM_MIN_MAP_ADDRESS, low, high, candidate, best = 0;
+    bool is_line_start = TRUE, was_line_start;
+    char buf[512];
+    FILE *fp;
+
+    low  = address > range_size ? address - range_size : 0;
+    high = address + range_size < address ? (zz_addr_t)-1 : address + range_size;
+
+    fp = fopen("/proc/self/maps", "r");
+    if (!fp)
+        return 0;
+    // the mappings are sorted, every hole between two of them is a gap
+    while (1) {
+        if (fgets(buf, sizeof(buf), fp)) {
+            // a long path is read on in pieces, only the line starts have the range
+            was_line_start = is_line_start;
+            is_line_start  = strchr(buf, '\n') != NULL;
+            if (!was_line_start || sscanf(buf, "%lx-%lx", &start, &end) != 2)
+                continue;
+        } else {
+            start = (zz_addr_t)-1;
+            end   = (zz_addr_t)-1;
+        }
+        if (start > prev_end) {
+            // the aligned candidate nearest to the address, in the gap and in range
+            candidate = (address & ~(size - 1));
+            if (candidate < prev_end)
+                candidate = (prev_end + size - 1) & ~(size - 1);
+            if (candidate + size > start)
+                candidate = (start - size) & ~(size - 1);
+            if (candidate >= prev_end && candidate + size <= start && candidate >= low && candidate + size <= high &&
+                candidate + size > candidate) {
+                if (!best || (candidate > address ? candidate - address : address - candidate) <
+                                 (best > address ? best - address : address - best))
+                    best = candidate;
+            }
+        }
+        if (end > prev_end)
+            prev_end = end;
+        if (start == (zz_addr_t)-1)
+            break;
+    }
+    fclose(fp);
+    return best;
+}
+
+zz_ptr_t zz_linux_vm_allocate_near_huge_page_arena(zz_addr_t address, zz_size_t range_size, zz_size_t size) {
+    zz_addr_t gap = zz_linux_vm_search_free_gap(address, range_size, size);
+    zz_ptr_t region;
+
+    if (!gap)
+        return NULL;
+    // a hint only, another thread may have taken the gap since, the region is checked instead of MAP_FIXED
+    region = mmap((zz_ptr_t)gap, size, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+    if (region == MAP_FAILED)
+        return NULL;
+    if ((zz_addr_t)region != gap) {
+        munmap(region, size);
+        return NULL;
+    }
+#ifdef MADV_HUGEPAGE
+    madvise(region, size, MADV_HUGEPAGE);
+#endif
+    return region;
+}
+
+zz_ptr_t zz_linux_vm_allocate_huge_page_arena(zz_addr_t address, zz_size_t size) {
+    zz_addr_t start, aligned_start;
+    zz_ptr_t region;
+
+    // reserve twice the size, keep the aligned half
+    region = mmap((zz_ptr_t)(address & ~(size - 1)), size * 2, PROT_READ | PROT_WRITE | PROT_EXEC,
+                  MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+    if (region == MAP_FAILED)
+        return NULL;
+
+    start         = (zz_addr_t)region;
+    aligned_start = (start + size - 1) & ~(size - 1);
+    if (aligned_start > start)
+        munmap(region, aligned_start - start);
+    munmap((zz_ptr_t)(aligned_start + size), start + size - aligned_start);
+
+#ifdef MADV_HUGEPAGE
+    madvise((zz_ptr_t)aligned_start, size, MADV_HUGEPAGE);
+#endif
+    return (zz_ptr_t)aligned_start;
+}
@@ -5,3 +5,14 @@
 #include "kitzz.h"
 
 zz_ptr_t zz_linux_vm_search_code_cave(zz_addr_t address, zz_size_t range_size, zz_size_t size);
+
+// a rwx region aligned to its size (a power of two), backed by a transparent huge page where the kernel allows it.
+// address is a hint, 0 for anywhere.
+zz_ptr_t zz_linux_vm_allocate_huge_page_arena(zz_addr_t address, zz_size_t size);
+
+// the start of a free gap of /proc/self/maps which holds size bytes aligned to size (a power of two), nearest to the
+// address and within range_size of it. 0 if there is none.
+zz_addr_t zz_linux_vm_search_free_gap(zz_addr_t address, zz_size_t range_size, zz_size_t size);
+
+// the same arena mapped in such a gap, NULL if there is none or it was taken meanwhile.
+zz_ptr_t zz_linux_vm_allocate_near_huge_page_arena(zz_addr_t address, zz_size_t range_size, zz_size_t size);
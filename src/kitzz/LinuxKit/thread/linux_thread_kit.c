@@ -0,0 +1,279 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "LinuxKit/thread/linux_thread_kit.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#define LINUX_THREAD_STATE_SIGNALED 1
+#define LINUX_THREAD_STATE_SUSPENDED 2
+#define LINUX_THREAD_STATE_RESUMED 3
+#define LINUX_THREAD_STATE_GONE 4
+
+#define LINUX_THREAD_SUSPEND_TIMEOUT_MS 1000
+
+struct linux_dirent64 {
+    unsigned long long d_ino;
+    long long d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+};
+
+static LinuxSuspendedThreadList *g_suspend_list;
+static int g_resume_flag;
+static int g_suspend_lock;
+static bool g_suspend_handler_installed;
+
+static pid_t zz_linux_thread_gettid() { return (pid_t)syscall(SYS_gettid); }
+
+static int zz_linux_thread_suspend_signal() { return SIGRTMIN + 5; }
+
+static void zz_linux_thread_suspend_handler(int signo, siginfo_t *info, void *context) {
+    LinuxSuspendedThreadList *list = __atomic_load_n(&g_suspend_list, __ATOMIC_ACQUIRE);
+    pid_t tid                      = zz_linux_thread_gettid();
+    int saved_errno                = errno;
+    zz_size_t i;
+
+    if (!list)
+        return;
+    for (i = 0; i < list->size; i++) {
+        LinuxSuspendedThread *thread = &list->threads[i];
+        if (thread->tid != tid)
+            continue;
+        thread->context = (ucontext_t *)context;
+        __atomic_store_n(&thread->state, LINUX_THREAD_STATE_SUSPENDED, __ATOMIC_RELEASE);
+        while (!__atomic_load_n(&g_resume_flag, __ATOMIC_ACQUIRE))
+            sched_yield();
+        // the suspender may have changed the pc in the context, it takes effect at sigreturn.
+        __atomic_store_n(&thread->state, LINUX_THREAD_STATE_RESUMED, __ATOMIC_RELEASE);
+        break;
+    }
+    errno = saved_errno;
+}
+
+static long zz_linux_thread_now_ms() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// iterate /proc/self/task with getdents64, opendir is avoided as it allocates with the other threads stopped.
+static zz_size_t zz_linux_thread_enumerate_tasks(pid_t *tids, zz_size_t capacity) {
+    char buffer[1024];
+    zz_size_t count = 0;
+    long nread, offset;
+    int fd;
+
+    fd = open("/proc/self/task", O_RDONLY | O_DIRECTORY);
+    if (fd < 0)
+        return 0;
+    while ((nread = syscall(SYS_getdents64, fd, buffer, sizeof(buffer))) > 0) {
+        for (offset = 0; offset < nread;) {
+            struct linux_dirent64 *dirent = (struct linux_dirent64 *)(buffer + offset);
+            pid_t tid                     = 0;
+            char *p;
+            offset += dirent->d_reclen;
+            for (p = dirent->d_name; *p >= '0' && *p <= '9'; p++)
+                tid = tid * 10 + (*p - '0');
+            if (!tid || *p)
+                continue;
+            if (count < capacity)
+                tids[count] = tid;
+            count++;
+        }
+    }
+    close(fd);
+    return count;
+}
+
+static bool zz_linux_thread_install_suspend_handler() {
+    struct sigaction action;
+
+    if (g_suspend_handler_installed)
+        return TRUE;
+    memset(&action, 0, sizeof(action));
+    action.sa_sigaction = zz_linux_thread_suspend_handler;
+    action.sa_flags     = SA_SIGINFO | SA_RESTART;
+    sigfillset(&action.sa_mask);
+    if (sigaction(zz_linux_thread_suspend_signal(), &action, NULL) != 0)
+        return FALSE;
+    g_suspend_handler_installed = TRUE;
+    return TRUE;
+}
+
+static bool zz_linux_thread_wait_suspended(LinuxSuspendedThread *thread) {
+    long deadline = zz_linux_thread_now_ms() + LINUX_THREAD_SUSPEND_TIMEOUT_MS;
+
+    while (__atomic_load_n(&thread->state, __ATOMIC_ACQUIRE) != LINUX_THREAD_STATE_SUSPENDED) {
+        // exited before handling the signal
+        if (syscall(SYS_tgkill, getpid(), thread->tid, 0) != 0 && errno == ESRCH) {
+            thread->state = LINUX_THREAD_STATE_GONE;
+            return TRUE;
+        }
+        if (zz_linux_thread_now_ms() > deadline)
+            return FALSE;
+        sched_yield();
+    }
+    return TRUE;
+}
+
+static bool zz_linux_thread_suspend_round(LinuxSuspendedThreadList *list, pid_t *tids, zz_size_t tid_capacity,
+                                          bool *found) {
+    pid_t self_tid = zz_linux_thread_gettid();
+    zz_size_t tid_count, i, j, first;
+
+    *found    = FALSE;
+    tid_count = zz_linux_thread_enumerate_tasks(tids, tid_capacity);
+    if (tid_count > tid_capacity)
+        return FALSE;
+
+    first = list->size;
+    for (i = 0; i < tid_count; i++) {
+        if (tids[i] == self_tid)
+            continue;
+        for (j = 0; j < list->size; j++) {
+            if (list->threads[j].tid == tids[i])
+                break;
+        }
+        if (j < list->size)
+            continue;
+        if (list->size >= list->capacity)
+            return FALSE;
+
+        list->threads[list->size].tid     = tids[i];
+        list->threads[list->size].context = NULL;
+        list->threads[list->size].state   = LINUX_THREAD_STATE_SIGNALED;
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+        list->size++;
+        if (syscall(SYS_tgkill, getpid(), tids[i], zz_linux_thread_suspend_signal()) != 0)
+            list->threads[list->size - 1].state = LINUX_THREAD_STATE_GONE;
+        *found = TRUE;
+    }
+
+    for (i = first; i < list->size; i++) {
+        if (list->threads[i].state == LINUX_THREAD_STATE_GONE)
+            continue;
+        if (!zz_linux_thread_wait_suspended(&list->threads[i]))
+            return FALSE;
+    }
+    return TRUE;
+}
+
+bool zz_linux_thread_suspend_other_threads(LinuxSuspendedThreadList *list) {
+    zz_size_t capacity;
+    pid_t *tids;
+    bool found = TRUE;
+    bool ok    = TRUE;
+
+    if (!zz_linux_thread_install_suspend_handler())
+        return FALSE;
+
+    while (__atomic_exchange_n(&g_suspend_lock, 1, __ATOMIC_ACQUIRE))
+        sched_yield();
+
+    // allocate with all the threads running, threads created meanwhile are picked up by the next round.
+    capacity        = zz_linux_thread_enumerate_tasks(NULL, 0) * 2 + 16;
+    list->size      = 0;
+    list->capacity  = capacity;
+    list->threads   = (LinuxSuspendedThread *)malloc(sizeof(LinuxSuspendedThread) * capacity);
+    tids            = (pid_t *)malloc(sizeof(pid_t) * capacity);
+    if (!list->threads || !tids) {
+        free(list->threads);
+        free(tids);
+        list->threads = NULL;
+        __atomic_store_n(&g_suspend_lock, 0, __ATOMIC_RELEASE);
+        return FALSE;
+    }
+
+    __atomic_store_n(&g_resume_flag, 0, __ATOMIC_RELEASE);
+    __atomic_store_n(&g_suspend_list, list, __ATOMIC_RELEASE);
+
+    while (ok && found)
+        ok = zz_linux_thread_suspend_round(list, tids, capacity, &found);
+    free(tids);
+
+    if (!ok) {
+        zz_linux_thread_resume_threads(list);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+void zz_linux_thread_resume_threads(LinuxSuspendedThreadList *list) {
+    zz_size_t i;
+
+    __atomic_store_n(&g_resume_flag, 1, __ATOMIC_RELEASE);
+    for (i = 0; i < list->size; i++) {
+        LinuxSuspendedThread *thread = &list->threads[i];
+        // wait the handler leave, it still reads the list.
+        while (__atomic_load_n(&thread->state, __ATOMIC_ACQUIRE) == LINUX_THREAD_STATE_SUSPENDED)
+            sched_yield();
+    }
+    __atomic_store_n(&g_suspend_list, NULL, __ATOMIC_RELEASE);
+
+    free(list->threads);
+    list->threads  = NULL;
+    list->size     = 0;
+    list->capacity = 0;
+    __atomic_store_n(&g_suspend_lock, 0, __ATOMIC_RELEASE);
+}
+
+zz_addr_t zz_linux_thread_get_pc(LinuxSuspendedThread *thread) {
+    if (thread->state != LINUX_THREAD_STATE_SUSPENDED || !thread->context)
+        return 0;
+#if defined(__aarch64__)
+    return (zz_addr_t)thread->context->uc_mcontext.pc;
+#elif defined(__arm__)
+    return (zz_addr_t)thread->context->uc_mcontext.arm_pc;
+#elif defined(__x86_64__)
+    return (zz_addr_t)thread->context->uc_mcontext.gregs[REG_RIP];
+#elif defined(__i386__)
+    return (zz_addr_t)thread->context->uc_mcontext.gregs[REG_EIP];
+#else
+    return 0;
+#endif
+}
+
+void zz_linux_thread_set_pc(LinuxSuspendedThread *thread, zz_addr_t pc) {
+    if (thread->state != LINUX_THREAD_STATE_SUSPENDED || !thread->context)
+        return;
+#if defined(__aarch64__)
+    thread->context->uc_mcontext.pc = pc;
+#elif defined(__arm__)
+    thread->context->uc_mcontext.arm_pc = pc;
+#elif defined(__x86_64__)
+    thread->context->uc_mcontext.gregs[REG_RIP] = pc;
+#elif defined(__i386__)
+    thread->context->uc_mcontext.gregs[REG_EIP] = pc;
+#endif
+}
+
+zz_addr_t zz_linux_thread_get_lr(LinuxSuspendedThread *thread) {
+    if (thread->state != LINUX_THREAD_STATE_SUSPENDED || !thread->context)
+        return 0;
+#if defined(__aarch64__)
+    return (zz_addr_t)thread->context->uc_mcontext.regs[30];
+#elif defined(__arm__)
+    return (zz_addr_t)thread->context->uc_mcontext.arm_lr;
+#else
+    return 0;
+#endif
+}
+
+void zz_linux_thread_set_lr(LinuxSuspendedThread *thread, zz_addr_t lr) {
+    if (thread->state != LINUX_THREAD_STATE_SUSPENDED || !thread->context)
+        return;
+#if defined(__aarch64__)
+    thread->context->uc_mcontext.regs[30] = lr;
+#elif defined(__arm__)
+    thread->context->uc_mcontext.arm_lr = lr;
+#endif
+}
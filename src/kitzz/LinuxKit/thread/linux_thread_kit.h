@@ -0,0 +1,40 @@
+#ifndef linuxkit_thread_thread_kit
+#define linuxkit_thread_thread_kit
+
+#include <err.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <signal.h>
+#include <sys/types.h>
+#include <ucontext.h>
+
+#include "kitzz.h"
+
+typedef struct _LinuxSuspendedThread {
+    pid_t tid;
+    ucontext_t *context; // published by the thread in the suspend signal handler
+    volatile int state;
+} LinuxSuspendedThread;
+
+typedef struct _LinuxSuspendedThreadList {
+    zz_size_t size;
+    zz_size_t capacity;
+    LinuxSuspendedThread *threads;
+} LinuxSuspendedThreadList;
+
+// stop every other thread of the process, all of them spin in a signal handler until resume.
+bool zz_linux_thread_suspend_other_threads(LinuxSuspendedThreadList *list);
+
+void zz_linux_thread_resume_threads(LinuxSuspendedThreadList *list);
+
+zz_addr_t zz_linux_thread_get_pc(LinuxSuspendedThread *thread);
+
+void zz_linux_thread_set_pc(LinuxSuspendedThread *thread, zz_addr_t pc);
+
+// the link register, 0 where the return address is on the stack (x86)
+zz_addr_t zz_linux_thread_get_lr(LinuxSuspendedThread *thread);
+
+void zz_linux_thread_set_lr(LinuxSuspendedThread *thread, zz_addr_t lr);
+
+#endif
@@ -160,3 +160,55 @@ zz_ptr_t zz_macho_get_section_64_address_via_name(struct mach_header_64 *header,
     }
     return NULL;
 }
+
+zz_size_t zz_macho_get_function_starts(struct mach_header_64 *header, zz_addr_t **starts) {
+    struct segment_command_64 *seg_cmd_64_text, *seg_cmd_64_linkedit;
+    struct linkedit_data_command *function_starts_cmd;
+    zz_addr_t address, *result;
+    zz_size_t slide, linkEditBase, count = 0, capacity = 64;
+    uint8_t *data, *end;
+    uint64_t delta;
+    int shift;
+
+    *starts             = NULL;
+    seg_cmd_64_text     = zz_macho_get_segment_64_via_name(header, (char *)"__TEXT");
+    seg_cmd_64_linkedit = zz_macho_get_segment_64_via_name(header, (char *)"__LINKEDIT");
+    function_starts_cmd =
+        (struct linkedit_data_command *)zz_macho_get_load_command_via_cmd(header, LC_FUNCTION_STARTS);
+    if (!seg_cmd_64_text || !seg_cmd_64_linkedit || !function_starts_cmd)
+        return 0;
+
+    slide        = (zz_addr_t)header - (zz_addr_t)seg_cmd_64_text->vmaddr;
+    linkEditBase = seg_cmd_64_linkedit->vmaddr - seg_cmd_64_linkedit->fileoff + slide;
+    data         = (uint8_t *)(linkEditBase + function_starts_cmd->dataoff);
+    end          = data + function_starts_cmd->datasize;
+
+    result = (zz_addr_t *)malloc(capacity * sizeof(zz_addr_t));
+    if (!result)
+        return 0;
+
+    // uleb128 deltas, the first one from the start of __TEXT, a 0 delta ends the list
+    address = (zz_addr_t)header;
+    while (data < end) {
+        delta = 0;
+        shift = 0;
+        do {
+            delta |= (uint64_t)(*data & 0x7f) << shift;
+            shift += 7;
+        } while ((*data++ & 0x80) && data < end);
+        if (!delta)
+            break;
+        address += delta;
+
+        if (count == capacity) {
+            zz_addr_t *grown = (zz_addr_t *)realloc(result, capacity * 2 * sizeof(zz_addr_t));
+            if (!grown)
+                break;
+            result = grown;
+            capacity *= 2;
+        }
+        result[count++] = address;
+    }
+    *starts = result;
+    return count;
+}
@@ -23,3 +23,6 @@ zz_ptr_t zz_macho_get_section_64_address_via_name(struct mach_header_64 *header,
 zz_ptr_t zz_macho_get_symbol_via_name(struct mach_header_64 *header, const char *name);
 
 struct load_command *zz_macho_get_load_command_via_cmd(struct mach_header_64 *header, uint32_t cmd);
+
+// LC_FUNCTION_STARTS of a loaded image, slid and sorted by address. the caller frees the array.
+zz_size_t zz_macho_get_function_starts(struct mach_header_64 *header, zz_addr_t **starts);
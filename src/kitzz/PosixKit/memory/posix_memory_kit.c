@@ -228,3 +228,59 @@ bool zz_posix_vm_patch_code(const zz_addr_t address, const zz_ptr_t codedata, zz
     munmap(code_mmap, range_size);
     return TRUE;
 }
+
+/*
+  a patch that fits in one aligned word can be published with a single store, a running thread sees either the old
+  or the new instructions, never a torn one. 4 bytes everywhere, 8 bytes on the 64-bit targets
+  (i.e. the 5-byte jmp of x86_64).
+ */
+bool zz_posix_vm_is_atomic_patchable(const zz_addr_t address, zz_size_t codedata_size) {
+    if (!codedata_size)
+        return FALSE;
+    if ((address & 3) + codedata_size <= 4)
+        return TRUE;
+#if defined(__x86_64__) || defined(__aarch64__)
+    if ((address & 7) + codedata_size <= 8)
+        return TRUE;
+#endif
+    return FALSE;
+}
+
+bool zz_posix_vm_patch_code_atomic(const zz_addr_t address, const zz_ptr_t codedata, zz_size_t codedata_size) {
+    zz_size_t page_size;
+    zz_addr_t word_addr, page_addr;
+
+    if (!zz_posix_vm_is_atomic_patchable(address, codedata_size))
+        return FALSE;
+
+    page_size = zz_posix_vm_get_page_size();
+    word_addr = address & ~(zz_addr_t)3;
+    if ((address & 3) + codedata_size > 4)
+        word_addr = address & ~(zz_addr_t)7;
+    page_addr = word_addr & ~(page_size - 1);
+
+    // keep the page executable, other threads may be running on it.
+    if (!zz_posix_vm_protect(page_addr, page_size, PROT_READ | PROT_WRITE | PROT_EXEC))
+        return FALSE;
+
+    if ((address & 3) + codedata_size <= 4) {
+        uint32_t old_word = __atomic_load_n((uint32_t *)word_addr, __ATOMIC_RELAXED);
+        uint32_t new_word = old_word;
+        memcpy((char *)&new_word + (address - word_addr), codedata, codedata_size);
+        __atomic_store_n((uint32_t *)word_addr, new_word, __ATOMIC_RELEASE);
+    } else {
+#if defined(__x86_64__) || defined(__aarch64__)
+        uint64_t old_word = __atomic_load_n((uint64_t *)word_addr, __ATOMIC_RELAXED);
+        uint64_t new_word;
+        do {
+            new_word = old_word;
+            memcpy((char *)&new_word + (address - word_addr), codedata, codedata_size);
+        } while (!__atomic_compare_exchange_n((uint64_t *)word_addr, &old_word, new_word, FALSE, __ATOMIC_RELEASE,
+                                              __ATOMIC_RELAXED));
+#endif
+    }
+
+    zz_posix_vm_protect(page_addr, page_size, PROT_READ | PROT_EXEC);
+    __builtin___clear_cache((char *)word_addr, (char *)word_addr + 8);
+    return TRUE;
+}
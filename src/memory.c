@@ -30,4 +30,96 @@ ZZSTATUS ZzRuntimeCodePatch(void *address, void *codedata, unsigned long codedat
     if (!ZzMemoryPatchCode((zz_addr_t )address, codedata, codedata_size))
         return ZZ_FAILED;
     return ZZ_SUCCESS;
-}
\ No newline at end of file
+}
+void ZzMemoryClearCache(zz_addr_t address, zz_size_t size) {
+    __builtin___clear_cache((char *)address, (char *)(address + size));
+}
+
+static int ZzMemoryPatchCompare(const void *a, const void *b) {
+    const ZzMemoryPatch *x = (const ZzMemoryPatch *)a;
+    const ZzMemoryPatch *y = (const ZzMemoryPatch *)b;
+    if (x->address == y->address)
+        return 0;
+    return x->address < y->address ? -1 : 1;
+}
+
+ZzMemoryPatchBatch *ZzMemoryPreparePatchBatch(ZzMemoryPatch *patches, zz_size_t count) {
+    zz_size_t page_size = ZzMemoryGetPageSzie();
+    ZzMemoryPatchBatch *batch;
+    ZzMemoryPatch *run;
+    zz_addr_t run_start, run_end;
+    zz_size_t i, j, k;
+
+    qsort(patches, count, sizeof(ZzMemoryPatch), ZzMemoryPatchCompare);
+    for (i = 1; i < count; i++) {
+        if (patches[i - 1].address + patches[i - 1].codedata_size > patches[i].address)
+            return NULL;
+    }
+
+    batch       = (ZzMemoryPatchBatch *)zz_malloc_with_zero(sizeof(ZzMemoryPatchBatch));
+    batch->runs = (ZzMemoryPatch *)zz_malloc_with_zero(sizeof(ZzMemoryPatch) * (count ? count : 1));
+
+    // merge the patches that share a page into one run, one write per run. the code between the patches is written
+    // back as is, a run never spans more than the pages of its patches.
+    for (i = 0; i < count; i = j) {
+        run_start = patches[i].address;
+        run_end   = patches[i].address + patches[i].codedata_size;
+        for (j = i + 1; j < count; j++) {
+            if ((patches[j].address & ~(page_size - 1)) != ((run_end - 1) & ~(page_size - 1)))
+                break;
+            run_end = patches[j].address + patches[j].codedata_size;
+        }
+
+        run                = &batch->runs[batch->run_count];
+        run->address       = run_start;
+        run->codedata_size = run_end - run_start;
+        run->codedata      = malloc(run->codedata_size);
+        if (!run->codedata) {
+            ZzMemoryFreePatchBatch(batch);
+            return NULL;
+        }
+        memcpy(run->codedata, (zz_ptr_t)run_start, run->codedata_size);
+        for (k = i; k < j; k++)
+            memcpy((char *)run->codedata + (patches[k].address - run_start), patches[k].codedata,
+                   patches[k].codedata_size);
+        batch->run_count++;
+    }
+    return batch;
+}
+
+bool ZzMemoryApplyPatchBatch(ZzMemoryPatchBatch *batch) {
+    bool ok = TRUE;
+    zz_size_t i;
+
+    for (i = 0; ok && i < batch->run_count; i++)
+        ok = ZzMemoryPatchCode(batch->runs[i].address, batch->runs[i].codedata, batch->runs[i].codedata_size);
+
+    // flush once the whole batch is in place.
+    for (i = 0; i < batch->run_count; i++)
+        ZzMemoryClearCache(batch->runs[i].address, batch->runs[i].codedata_size);
+    return ok;
+}
+
+void ZzMemoryFreePatchBatch(ZzMemoryPatchBatch *batch) {
+    zz_size_t i;
+
+    for (i = 0; i < batch->run_count; i++)
+        free(batch->runs[i].codedata);
+    free(batch->runs);
+    free(batch);
+}
+
+bool ZzMemoryPatchCodeBatch(ZzMemoryPatch *patches, zz_size_t count) {
+    ZzMemoryPatchBatch *batch;
+    bool ok;
+
+    if (!count)
+        return TRUE;
+    // all runs are prepared before the first write, so a failed allocation leaves the code untouched.
+    batch = ZzMemoryPreparePatchBatch(patches, count);
+    if (!batch)
+        return FALSE;
+    ok = ZzMemoryApplyPatchBatch(batch);
+    ZzMemoryFreePatchBatch(batch);
+    return ok;
+}
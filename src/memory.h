@@ -28,8 +28,42 @@ zz_ptr_t ZzMemoryAllocateNearPages(zz_addr_t address, zz_size_t redirect_range_s
 
 zz_ptr_t ZzMemoryAllocate(zz_size_t size);
 
+// a rwx region aligned to its size, huge page backed where possible, NULL if the platform can't map rwx.
+zz_ptr_t ZzMemoryAllocateHugePageArena(zz_addr_t address, zz_size_t size);
+
+// the same arena whole within redirect_range_size of the address, NULL if no free gap there holds it.
+zz_ptr_t ZzMemoryAllocateNearHugePageArena(zz_addr_t address, zz_size_t redirect_range_size, zz_size_t size);
+
 bool ZzMemoryPatchCode(const zz_addr_t address, const zz_ptr_t codedata, zz_size_t codedata_size);
 
+// publish a patch that fits in one aligned word with a single atomic store, no thread suspension needed.
+bool ZzMemoryIsAtomicPatchable(const zz_addr_t address, zz_size_t codedata_size);
+
+bool ZzMemoryPatchCodeAtomic(const zz_addr_t address, const zz_ptr_t codedata, zz_size_t codedata_size);
+
+typedef struct _ZzMemoryPatch {
+    zz_addr_t address;
+    zz_ptr_t codedata;
+    zz_size_t codedata_size;
+} ZzMemoryPatch;
+
+typedef struct _ZzMemoryPatchBatch {
+    ZzMemoryPatch *runs;
+    zz_size_t run_count;
+} ZzMemoryPatchBatch;
+
+// apply all patches at once, patches that share a page are merged into one write.
+bool ZzMemoryPatchCodeBatch(ZzMemoryPatch *patches, zz_size_t count);
+
+// prepare does all the allocation, apply only writes, so it can run with the other threads stopped.
+ZzMemoryPatchBatch *ZzMemoryPreparePatchBatch(ZzMemoryPatch *patches, zz_size_t count);
+
+bool ZzMemoryApplyPatchBatch(ZzMemoryPatchBatch *batch);
+
+void ZzMemoryFreePatchBatch(ZzMemoryPatchBatch *batch);
+
+void ZzMemoryClearCache(zz_addr_t address, zz_size_t size);
+
 bool ZzMemoryProtectAsExecutable(const zz_addr_t address, zz_size_t size);
 
 bool ZzMemoryProtectAsWritable(const zz_addr_t address, zz_size_t size);
@@ -0,0 +1,185 @@
+/**
+ *    Copyright 2017 jmpews
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pending.h"
+#include "trampoline.h"
+
+static ZzPendingHookSet g_pending_hook_set;
+static pthread_mutex_t g_pending_hook_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static ZzPendingHook *ZzNewPendingHook(const char *module_pattern, const char *symbol_name) {
+    ZzPendingHookSet *set = &g_pending_hook_set;
+    ZzPendingHook *hook;
+
+    if (set->size >= set->capacity) {
+        zz_size_t capacity    = set->capacity ? set->capacity * 2 : 8;
+        ZzPendingHook **hooks = (ZzPendingHook **)realloc(set->hooks, sizeof(ZzPendingHook *) * capacity);
+        if (!hooks)
+            return NULL;
+        set->hooks    = hooks;
+        set->capacity = capacity;
+    }
+
+    hook                 = (ZzPendingHook *)zz_malloc_with_zero(sizeof(ZzPendingHook));
+    hook->module_pattern = strdup(module_pattern);
+    hook->symbol_name    = symbol_name ? strdup(symbol_name) : NULL;
+    if (!hook->module_pattern || (symbol_name && !hook->symbol_name)) {
+        free(hook->module_pattern);
+        free(hook->symbol_name);
+        free(hook);
+        return NULL;
+    }
+    set->hooks[set->size++] = hook;
+    return hook;
+}
+
+// the module is gone, so is the patched code. the entry is retired, not freed, a lookup or a thread returning
+// through the leave trampoline may still hold it.
+static void ZzReclaimPendingHook(ZzPendingHook *hook) {
+    ZzHookFunctionEntry *entry;
+
+    if (hook->state == PENDING_STATE_INSTALLED) {
+        entry = ZzFindHookFunctionEntry(hook->target_ptr);
+        if (entry)
+            ZzRetireHookFunctionEntry(entry);
+        if (hook->origin_ptr)
+            *hook->origin_ptr = NULL;
+    }
+    hook->state      = PENDING_STATE_WAIT;
+    hook->load_bias  = 0;
+    hook->target_ptr = NULL;
+}
+
+static ZzHookFunctionEntry *ZzBuildPendingHook(ZzPendingHook *hook, const char *module_path, zz_addr_t load_bias) {
+    ZZHOOKTYPE hook_type;
+    ZZSTATUS status;
+
+    hook->load_bias = load_bias;
+    hook->state     = PENDING_STATE_FAILED;
+    if (hook->symbol_name)
+        hook->target_ptr = ZzFindSymbolAddress(module_path, hook->symbol_name);
+    else
+        hook->target_ptr = (zz_ptr_t)(load_bias + hook->offset);
+    if (!hook->target_ptr) {
+        ZZ_ERROR_LOG("can't find the symbol %s in %s!", hook->symbol_name, module_path);
+        return NULL;
+    }
+
+    hook_type = (hook->pre_call || hook->post_call) ? HOOK_TYPE_FUNCTION_via_PRE_POST : HOOK_TYPE_FUNCTION_via_REPLACE;
+    status    = ZzBuildHook(hook->target_ptr, hook->replace_call, hook->origin_ptr, hook->pre_call, hook->post_call,
+                         FALSE, hook_type);
+    if (status != ZZ_DONE_HOOK) {
+        ZZ_ERROR_LOG("%p is already hooked or can't be hooked!", hook->target_ptr);
+        return NULL;
+    }
+    hook->state = PENDING_STATE_INSTALLED;
+    return ZzFindHookFunctionEntry(hook->target_ptr);
+}
+
+// match the hooks [first, set->size) against one walk of the loaded modules. the lock is held.
+static ZZSTATUS ZzCheckPendingHooksFrom(zz_size_t first) {
+    ZzPendingHookSet *set         = &g_pending_hook_set;
+    ZzHookFunctionEntry **entries = NULL;
+    const char **module_patterns  = NULL;
+    const char **module_paths     = NULL;
+    zz_addr_t *load_biases        = NULL;
+    ZzPendingHook *hook;
+    zz_size_t i, size, count = 0;
+    ZZSTATUS status = ZZ_SUCCESS;
+
+    if (first >= set->size)
+        return ZZ_SUCCESS;
+    size            = set->size - first;
+    entries         = (ZzHookFunctionEntry **)zz_malloc_with_zero(sizeof(ZzHookFunctionEntry *) * size);
+    module_patterns = (const char **)zz_malloc_with_zero(sizeof(const char *) * size);
+    module_paths    = (const char **)zz_malloc_with_zero(sizeof(const char *) * size);
+    load_biases     = (zz_addr_t *)zz_malloc_with_zero(sizeof(zz_addr_t) * size);
+    if (!entries || !module_patterns || !module_paths || !load_biases) {
+        status = ZZ_FAILED;
+        goto out;
+    }
+
+    for (i = 0; i < size; i++)
+        module_patterns[i] = set->hooks[first + i]->module_pattern;
+    ZzFindLoadedModules(module_patterns, size, module_paths, load_biases);
+
+    for (i = 0; i < size; i++) {
+        hook = set->hooks[first + i];
+
+        // unloaded, or reloaded at another address
+        if (hook->state != PENDING_STATE_WAIT && (!module_paths[i] || load_biases[i] != hook->load_bias))
+            ZzReclaimPendingHook(hook);
+        if (hook->state != PENDING_STATE_WAIT || !module_paths[i])
+            continue;
+
+        ZzHookFunctionEntry *entry = ZzBuildPendingHook(hook, module_paths[i], load_biases[i]);
+        if (entry)
+            entries[count++] = entry;
+    }
+
+    // all the hooks of the new modules are switched on with one batched patch
+    if (count)
+        status = ZzCommitHookFunctionEntries(entries, count, TRUE);
+out:
+    free(entries);
+    free(module_patterns);
+    free(module_paths);
+    free(load_biases);
+    return status;
+}
+
+ZZSTATUS ZzCheckPendingHooks(void) {
+    ZZSTATUS status;
+
+    pthread_mutex_lock(&g_pending_hook_lock);
+    status = ZzCheckPendingHooksFrom(0);
+    pthread_mutex_unlock(&g_pending_hook_lock);
+    return status;
+}
+
+static void ZzPendingModuleChanged(void) { ZzCheckPendingHooks(); }
+
+ZZSTATUS ZzHookPending(const char *module_pattern, const char *symbol_name, unsigned long offset, zz_ptr_t replace_ptr,
+                       zz_ptr_t *origin_ptr, PRECALL pre_call_ptr, POSTCALL post_call_ptr) {
+    ZzPendingHook *hook;
+    ZZSTATUS status;
+
+    if (!module_pattern)
+        return ZZ_FAILED;
+
+    if (ZzObserveModuleLoad(ZzPendingModuleChanged) == ZZ_FAILED)
+        ZZ_ERROR_LOG_STR("module load is not observed, call ZzCheckPendingHooks after loading a module!");
+
+    pthread_mutex_lock(&g_pending_hook_lock);
+    hook = ZzNewPendingHook(module_pattern, symbol_name);
+    if (!hook) {
+        pthread_mutex_unlock(&g_pending_hook_lock);
+        return ZZ_FAILED;
+    }
+    hook->offset       = offset;
+    hook->replace_call = replace_ptr;
+    hook->origin_ptr   = origin_ptr;
+    hook->pre_call     = pre_call_ptr;
+    hook->post_call    = post_call_ptr;
+    // the module may be loaded already. nothing was loaded for the other hooks, only the new one is matched.
+    status = ZzCheckPendingHooksFrom(g_pending_hook_set.size - 1);
+    pthread_mutex_unlock(&g_pending_hook_lock);
+    return status;
+}
@@ -0,0 +1,48 @@
+/**
+ *    Copyright 2017 jmpews
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#ifndef pending_h
+#define pending_h
+
+#include "hookzz.h"
+#include "kitzz.h"
+
+#include "interceptor.h"
+
+typedef enum _ZZPENDINGSTATE { PENDING_STATE_WAIT, PENDING_STATE_INSTALLED, PENDING_STATE_FAILED } ZZPENDINGSTATE;
+
+typedef struct _ZzPendingHook {
+    char *module_pattern;
+    char *symbol_name; // NULL, hook module base + offset
+    zz_addr_t offset;
+    zz_ptr_t replace_call;
+    zz_ptr_t *origin_ptr;
+    PRECALL pre_call;
+    POSTCALL post_call;
+
+    ZZPENDINGSTATE state;
+    // the module instance the hook is installed into (or failed on)
+    zz_addr_t load_bias;
+    zz_ptr_t target_ptr;
+} ZzPendingHook;
+
+typedef struct {
+    ZzPendingHook **hooks;
+    zz_size_t size;
+    zz_size_t capacity;
+} ZzPendingHookSet;
+
+#endif
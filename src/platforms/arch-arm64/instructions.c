@@ -3,6 +3,12 @@
 
 uint32_t get_insn_sub(uint32_t insn, int start, int length) { return (insn >> start) & ((1 << length) - 1); }
 
+int64_t sign_extend(uint64_t value, int length) {
+    uint64_t sign = (uint64_t)1 << (length - 1);
+    value &= ((uint64_t)1 << length) - 1;
+    return (int64_t)((value ^ sign) - sign);
+}
+
 bool insn_equal(uint32_t insn, char *opstr) {
     uint32_t mask = 0, value = 0;
     zz_size_t length = strlen(opstr);
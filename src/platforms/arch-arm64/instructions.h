@@ -14,6 +14,9 @@ typedef struct _ZzARM64Instruction {
 // get hex insn sub
 uint32_t get_insn_sub(uint32_t insn, int start, int length);
 
+// sign extend the low length bits, for the pc relative immediates
+int64_t sign_extend(uint64_t value, int length);
+
 // equal insn with mask string
 bool insn_equal(uint32_t insn, char *opstr);
 #endif
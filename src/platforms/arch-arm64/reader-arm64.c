@@ -19,20 +19,30 @@ void zz_arm64_reader_reset(ZzARM64Reader *self, zz_ptr_t insn_address) {
     self->start_pc                = (zz_addr_t )insn_address;
     self->current_pc                = (zz_addr_t )insn_address;
     self->size              = 0;
-    self->insn_size         = 0;
+
+    ZzArenaReset(&self->arena);
+    self->insns         = NULL;
+    self->insn_size     = 0;
+    self->insn_capacity = 0;
 }
 
 void zz_arm64_reader_free(ZzARM64Reader *self) {
-    if (self->insn_size) {
-        for (int i = 0; i < self->insn_size; i++) {
-            free(self->insns[i]);
-        }
-    }
+    ZzArenaFree(&self->arena);
     free(self);
 }
 
 ZzARM64Instruction *zz_arm64_reader_read_one_instruction(ZzARM64Reader *self) {
-    ZzARM64Instruction *insn_ctx          = (ZzARM64Instruction *)zz_malloc_with_zero(sizeof(ZzARM64Instruction));
+    if (self->insn_size == self->insn_capacity) {
+        zz_size_t capacity = self->insn_capacity ? self->insn_capacity * 2 : 16;
+        ZzARM64Instruction *insns = (ZzARM64Instruction *)ZzArenaGrow(
+            &self->arena, self->insns, self->insn_capacity * sizeof(ZzARM64Instruction), capacity * sizeof(ZzARM64Instruction));
+        if (!insns)
+            return NULL;
+        self->insns         = insns;
+        self->insn_capacity = capacity;
+    }
+
+    ZzARM64Instruction *insn_ctx = &self->insns[self->insn_size++];
     insn_ctx->address = (zz_addr_t)self->r_current_address;
     insn_ctx->pc      = (zz_addr_t)self->current_pc;
     insn_ctx->insn    = *(uint32_t *)self->r_current_address;
@@ -40,7 +50,6 @@ ZzARM64Instruction *zz_arm64_reader_read_one_instruction(ZzARM64Reader *self) {
 
     self->current_pc += insn_ctx->size;
     self->r_current_address += insn_ctx->size;
-    self->insns[self->insn_size++] = insn_ctx;
     self->size += insn_ctx->size;
     return insn_ctx;
 }
@@ -78,5 +87,30 @@ ARM64InsnType GetARM64InsnType(uint32_t insn) {
         return ARM64_INS_B_cond;
     }
 
+    // CBZ, CBNZ
+    if (insn_equal(insn, "x011010xxxxxxxxxxxxxxxxxxxxxxxxx")) {
+        return ARM64_INS_CBZ_CBNZ;
+    }
+
+    // TBZ, TBNZ
+    if (insn_equal(insn, "x011011xxxxxxxxxxxxxxxxxxxxxxxxx")) {
+        return ARM64_INS_TBZ_TBNZ;
+    }
+
+    // BR
+    if (insn_equal(insn, "1101011000011111000000xxxxx00000")) {
+        return ARM64_INS_BR;
+    }
+
+    // BLR
+    if (insn_equal(insn, "1101011000111111000000xxxxx00000")) {
+        return ARM64_INS_BLR;
+    }
+
+    // RET
+    if (insn_equal(insn, "1101011001011111000000xxxxx00000")) {
+        return ARM64_INS_RET;
+    }
+
     return ARM64_UNDEF;
 }
\ No newline at end of file
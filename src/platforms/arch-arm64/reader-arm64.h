@@ -3,6 +3,7 @@
 
 #include "kitzz.h"
 
+#include "arena.h"
 #include "instructions.h"
 
 #include "platforms/backend-linux/memory-linux.h"
@@ -14,20 +15,27 @@ typedef enum _ARM64InsnType {
     ARM64_INS_B,
     ARM64_INS_BL,
     ARM64_INS_B_cond,
+    ARM64_INS_CBZ_CBNZ,
+    ARM64_INS_TBZ_TBNZ,
+    ARM64_INS_BR,
+    ARM64_INS_BLR,
+    ARM64_INS_RET,
     ARM64_UNDEF
 } ARM64InsnType;
 
 ARM64InsnType GetARM64InsnType(uint32_t insn);
 
-#define MAX_INSN_SIZE 256
 typedef struct _ZzARM64Reader {
-    ZzARM64Instruction *insns[MAX_INSN_SIZE];
+    // inline records, live in the arena until the next reset
+    ZzARM64Instruction *insns;
     zz_size_t insn_size;
+    zz_size_t insn_capacity;
     zz_addr_t r_start_address;
     zz_addr_t r_current_address;
     zz_addr_t start_pc;
     zz_addr_t current_pc;
     zz_size_t size;
+    ZzArena arena;
 } ZzARM64Reader;
 
 ZzARM64Reader *zz_arm64_reader_new(zz_ptr_t insn_address);
@@ -19,6 +19,7 @@ void zz_arm64_relocator_init(ZzARM64Relocator *relocator, ZzARM64Reader *input,
 }
 
 void zz_arm64_relocator_free(ZzARM64Relocator *relocator) {
+    ZzArenaFree(&relocator->arena);
 
     zz_arm64_reader_free(relocator->input);
     zz_arm64_writer_free(relocator->output);
@@ -31,20 +32,27 @@ zz_arm64_relocator_reset(ZzARM64Relocator *self, ZzARM64Reader *input, ZzARM64As
     self->outpos = 0;
     self->input = input;
     self->output = output;
-    self->literal_insn_size = 0;
     self->try_relocated_length = 0;
+
+    ZzArenaReset(&self->arena);
+    self->literal_insns = NULL;
+    self->literal_insn_size = 0;
+    self->literal_insn_capacity = 0;
+    self->relocator_insns = NULL;
+    self->relocator_insn_size = 0;
+    self->relocator_insn_capacity = 0;
 }
 
 void zz_arm64_relocator_read_one(ZzARM64Relocator *self, ZzARM64Instruction *instruction) {
     ZzARM64Instruction *insn_ctx;
 
-    zz_arm64_reader_read_one_instruction(self->input);
+    insn_ctx = zz_arm64_reader_read_one_instruction(self->input);
 
     // switch (1) {}
 
     self->inpos++;
 
-    if (instruction != NULL)
+    if (instruction != NULL && insn_ctx != NULL)
         *instruction = *insn_ctx;
 }
 
@@ -55,10 +63,13 @@ void zz_arm64_relocator_try_relocate(zz_ptr_t address, zz_size_t min_bytes, zz_s
     bool early_end = FALSE;
     zz_addr_t target_addr = (zz_addr_t) address;
     ZzARM64Instruction *insn_ctx;
-    ZzARM64Reader *reader = zz_arm64_reader_new(address);
+    ZzARM64Reader reader = {0};
 
+    zz_arm64_reader_init(&reader, address);
     do {
-        insn_ctx = zz_arm64_reader_read_one_instruction(reader);
+        insn_ctx = zz_arm64_reader_read_one_instruction(&reader);
+        if (!insn_ctx)
+            break;
         switch (GetARM64InsnType(insn_ctx->insn)) {
         case ARM64_INS_B:
             early_end = TRUE;
@@ -73,13 +84,13 @@ void zz_arm64_relocator_try_relocate(zz_ptr_t address, zz_size_t min_bytes, zz_s
         *max_bytes = tmp_size;
     }
 
-    zz_arm64_reader_free(reader);
+    ZzArenaFree(&reader.arena);
     return;
 }
 
 static ZzARM64RelocatorInstruction *zz_arm64_relocator_get_relocator_insn_with_address(ZzARM64Relocator *self, zz_addr_t insn_address) {
     for (int i = 0; i < self->relocator_insn_size; ++i) {
-        if((self->relocator_insns[i].origin_insn->pc) == insn_address) {
+        if((self->input->insns[self->relocator_insns[i].origin_index].pc) == insn_address) {
             return &self->relocator_insns[i];
         }
 
@@ -92,12 +103,12 @@ void zz_arm64_relocator_relocate_writer(ZzARM64Relocator *relocator, zz_addr_t f
     if (relocator->literal_insn_size) {
         zz_addr_t *literal_target_address_ptr;
         for (int i = 0; i < relocator->literal_insn_size; i++) {
-            literal_target_address_ptr = (zz_addr_t *)relocator->literal_insns[i]->address;
+            literal_target_address_ptr = (zz_addr_t *)relocator->output->insns[relocator->literal_insns[i]].address;
             // literal instruction in the range of instructions-need-fix
             if(*literal_target_address_ptr > relocator->input->start_pc && *literal_target_address_ptr < (relocator->input->start_pc + relocator->input->size)) {
                 relocated_insn = zz_arm64_relocator_get_relocator_insn_with_address(relocator, *literal_target_address_ptr);
                 assert(relocated_insn);
-                *literal_target_address_ptr = (*relocated_insn->relocated_insns)->pc - relocator->output->start_pc + final_relocate_address;
+                *literal_target_address_ptr = relocator->output->insns[relocated_insn->output_index_start].pc - relocator->output->start_pc + final_relocate_address;
             }
         }
     }
@@ -112,8 +123,18 @@ void zz_arm64_relocator_write_all(ZzARM64Relocator *self) {
         count++;
 }
 
-static void zz_arm64_relocator_register_literal_insn(ZzARM64Relocator *self, ZzARM64Instruction *insn_ctx) {
-    self->literal_insns[self->literal_insn_size++] = insn_ctx;
+static void zz_arm64_relocator_register_literal_insn(ZzARM64Relocator *self, zz_size_t insn_index) {
+    if (self->literal_insn_size == self->literal_insn_capacity) {
+        zz_size_t capacity = self->literal_insn_capacity ? self->literal_insn_capacity * 2 : 16;
+        zz_size_t *literal_insns = (zz_size_t *)ZzArenaGrow(&self->arena, self->literal_insns,
+                                                            self->literal_insn_capacity * sizeof(zz_size_t),
+                                                            capacity * sizeof(zz_size_t));
+        if (!literal_insns)
+            return;
+        self->literal_insns = literal_insns;
+        self->literal_insn_capacity = capacity;
+    }
+    self->literal_insns[self->literal_insn_size++] = insn_index;
     // convert the temportary absolute address with offset.
 //    zz_addr_t *temp_address = (zz_addr_t  *)insn_ctx->address;
 //    *temp_address = insn_ctx->pc - self->output->start_pc;
@@ -135,14 +156,14 @@ static bool zz_arm64_relocator_rewrite_LDR_literal(ZzARM64Relocator *self, const
     uint32_t insn = insn_ctx->insn;
     // TODO: check opc == 10, with signed
     uint32_t imm19  = get_insn_sub(insn, 5, 19);
-    uint64_t offset = imm19 << 2;
+    int64_t offset  = sign_extend((uint64_t)imm19 << 2, 21);
 
     zz_addr_t target_address;
     target_address = insn_ctx->pc + offset;
     int Rt_ndx     = get_insn_sub(insn, 0, 4);
 
     zz_arm64_writer_put_ldr_b_reg_address(self->output, Rt_ndx, target_address);
-    zz_arm64_relocator_register_literal_insn(self, self->output->insns[self->output->insn_size - 1]);
+    zz_arm64_relocator_register_literal_insn(self, self->output->insn_size - 1);
     zz_arm64_writer_put_ldr_reg_reg_offset(self->output, Rt_ndx, Rt_ndx, 0);
 
     return TRUE;
@@ -154,7 +175,7 @@ static bool zz_arm64_relocator_rewrite_ADR(ZzARM64Relocator *self, const ZzARM64
     uint32_t insn  = insn_ctx->insn;
     uint32_t immhi = get_insn_sub(insn, 5, 19);
     uint32_t immlo = get_insn_sub(insn, 29, 2);
-    uint64_t imm   = immhi << 2 | immlo;
+    int64_t imm    = sign_extend((uint64_t)immhi << 2 | immlo, 21);
 
     zz_addr_t target_address;
     target_address = insn_ctx->pc + imm;
@@ -172,7 +193,7 @@ static bool zz_arm64_relocator_rewrite_ADRP(ZzARM64Relocator *self, const ZzARM6
     uint32_t immhi = get_insn_sub(insn, 5, 19);
     uint32_t immlo = get_insn_sub(insn, 29, 2);
     // 12 is PAGE-SIZE
-    uint64_t imm = immhi << 2 << 12 | immlo << 12;
+    int64_t imm = sign_extend(((uint64_t)immhi << 2 | immlo) << 12, 33);
 
     zz_addr_t target_address;
     target_address = (insn_ctx->pc & 0xFFFFFFFFFFFFF000) + imm;
@@ -189,13 +210,13 @@ static bool zz_arm64_relocator_rewrite_B(ZzARM64Relocator *self, const ZzARM64In
     uint32_t insn  = insn_ctx->insn;
     uint32_t imm26 = get_insn_sub(insn, 0, 26);
 
-    uint64_t offset = imm26 << 2;
+    int64_t offset = sign_extend((uint64_t)imm26 << 2, 28);
 
     zz_addr_t target_address;
     target_address = insn_ctx->pc + offset;
 
     zz_arm64_writer_put_ldr_br_reg_address(self->output, ZZ_ARM64_REG_X17, target_address);
-    zz_arm64_relocator_register_literal_insn(self, self->output->insns[self->output->insn_size - 1]);
+    zz_arm64_relocator_register_literal_insn(self, self->output->insn_size - 1);
 
     return TRUE;
 }
@@ -206,15 +227,15 @@ static bool zz_arm64_relocator_rewrite_BL(ZzARM64Relocator *self, const ZzARM64I
     uint32_t insn  = insn_ctx->insn;
     uint32_t imm26 = get_insn_sub(insn, 0, 26);
 
-    uint64_t offset = imm26 << 2;
+    int64_t offset = sign_extend((uint64_t)imm26 << 2, 28);
 
     zz_addr_t target_address;
     target_address = insn_ctx->pc + offset;
 
     zz_arm64_writer_put_ldr_blr_b_reg_address(self->output, ZZ_ARM64_REG_X17, target_address);
-    zz_arm64_relocator_register_literal_insn(self, self->output->insns[self->output->insn_size - 1]);
+    zz_arm64_relocator_register_literal_insn(self, self->output->insn_size - 1);
     zz_arm64_writer_put_ldr_br_reg_address(self->output, ZZ_ARM64_REG_X17, insn_ctx->pc + 4);
-    zz_arm64_relocator_register_literal_insn(self, self->output->insns[self->output->insn_size - 1]);
+    zz_arm64_relocator_register_literal_insn(self, self->output->insn_size - 1);
 
     return TRUE;
 }
@@ -236,7 +257,7 @@ static bool zz_arm64_relocator_rewrite_B_cond(ZzARM64Relocator *self, const ZzAR
     uint32_t insn  = insn_ctx->insn;
     uint32_t imm19 = get_insn_sub(insn, 5, 19);
 
-    uint64_t offset = imm19 << 2;
+    int64_t offset = sign_extend((uint64_t)imm19 << 2, 21);
 
     zz_addr_t target_address;
     target_address = insn_ctx->pc + offset;
@@ -246,23 +267,31 @@ static bool zz_arm64_relocator_rewrite_B_cond(ZzARM64Relocator *self, const ZzAR
     zz_arm64_writer_put_b_cond_imm(self->output, cond, 0x8);
     zz_arm64_writer_put_b_imm(self->output, 0x14);
     zz_arm64_writer_put_ldr_br_reg_address(self->output, ZZ_ARM64_REG_X17, target_address);
-    zz_arm64_relocator_register_literal_insn(self, self->output->insns[self->output->insn_size - 1]);
+    zz_arm64_relocator_register_literal_insn(self, self->output->insn_size - 1);
 
     return TRUE;
 }
 
 bool zz_arm64_relocator_write_one(ZzARM64Relocator *self) {
-    ZzARM64Instruction *insn_ctx, **input_insns;
+    ZzARM64Instruction *insn_ctx;
     ZzARM64RelocatorInstruction *relocator_insn;
     zz_size_t tmp_size;
-    relocator_insn = self->relocator_insns + self->relocator_insn_size;
     bool rewritten = FALSE;
 
     if (self->inpos != self->outpos) {
-        input_insns = self->input->insns;
-        insn_ctx    = input_insns[self->outpos];
-        relocator_insn->origin_insn = insn_ctx;
-        relocator_insn->relocated_insns = self->output->insns+self->output->insn_size;
+        if (self->relocator_insn_size == self->relocator_insn_capacity) {
+            zz_size_t capacity = self->relocator_insn_capacity ? self->relocator_insn_capacity * 2 : 16;
+            ZzARM64RelocatorInstruction *relocator_insns = (ZzARM64RelocatorInstruction *)ZzArenaGrow(
+                &self->arena, self->relocator_insns, self->relocator_insn_capacity * sizeof(ZzARM64RelocatorInstruction),
+                capacity * sizeof(ZzARM64RelocatorInstruction));
+            if (!relocator_insns)
+                return FALSE;
+            self->relocator_insns = relocator_insns;
+            self->relocator_insn_capacity = capacity;
+        }
+        relocator_insn = self->relocator_insns + self->relocator_insn_size;
+        insn_ctx    = &self->input->insns[self->outpos];
+        relocator_insn->origin_index = self->outpos;
         relocator_insn->output_index_start = self->output->insn_size;
         tmp_size = self->output->size;
         self->outpos++;
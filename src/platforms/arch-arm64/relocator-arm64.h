@@ -11,9 +11,9 @@
 #include "regs-arm64.h"
 #include "writer-arm64.h"
 
+// indexes into the reader/writer records, which move when the arena grows them.
 typedef struct _ZzARM64RelocatorInstruction {
-    ZzARM64Instruction *origin_insn;
-    ZzARM64Instruction **relocated_insns;
+    zz_size_t origin_index;
     zz_size_t output_index_start;
     zz_size_t ouput_index_end;
     zz_size_t relocated_insn_size;
@@ -28,12 +28,16 @@ typedef struct _ZzARM64Relocator {
     int inpos;
     int outpos;
     // memory patch can't confirm the code slice length, so last setp of memory patch need repair the literal instruction.
-    ZzARM64Instruction *literal_insns[MAX_INSN_SIZE];
+    zz_size_t *literal_insns;
     zz_size_t literal_insn_size;
+    zz_size_t literal_insn_capacity;
 
     // record for every instruction need to be relocated
-    ZzARM64RelocatorInstruction relocator_insns[MAX_INSN_SIZE];
+    ZzARM64RelocatorInstruction *relocator_insns;
     zz_size_t relocator_insn_size;
+    zz_size_t relocator_insn_capacity;
+
+    ZzArena arena;
 } ZzARM64Relocator;
 
 void zz_arm64_relocator_init(ZzARM64Relocator *relocator, ZzARM64Reader *input, ZzARM64AssemblerWriter *output);
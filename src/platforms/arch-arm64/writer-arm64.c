@@ -34,20 +34,17 @@ void zz_arm64_writer_reset(ZzARM64AssemblerWriter *self, zz_ptr_t data_ptr, zz_a
     self->start_pc = target_align_address;
     self->size = 0;
 
-    if(self->insn_size) {
-        for (int i = 0; i < self->insn_size; ++i) {
-            free(self->insns[i]);
-        }
-    }
+    ZzArenaReset(&self->arena);
+    self->insns = NULL;
     self->insn_size = 0;
+    self->insn_capacity = 0;
+    self->fixup_count = 0;
+    self->label_count = 0;
+    self->fixup_overflow = FALSE;
 }
 
 void zz_arm64_writer_free(ZzARM64AssemblerWriter *self) {
-    if (self->insn_size) {
-        for (int i = 0; i < self->insn_size; i++) {
-            free(self->insns[i]);
-        }
-    }
+    ZzArenaFree(&self->arena);
     free(self);
 }
 
@@ -81,6 +78,193 @@ void zz_arm64_writer_put_ldr_br_b_reg_address(ZzARM64AssemblerWriter *self, ZzAR
     zz_arm64_writer_put_bytes(self, (zz_ptr_t)&address, sizeof(address));
 }
 
+void zz_arm64_writer_put_adrp_add_reg_address(ZzARM64AssemblerWriter *self, ZzARM64Reg reg, zz_addr_t address) {
+    zz_arm64_writer_put_adrp_reg_imm(self, reg, (int64_t)(address >> 12) - (int64_t)(self->current_pc >> 12));
+    zz_arm64_writer_put_add_reg_reg_imm(self, reg, reg, address & 0xFFF);
+}
+
+// ======= label =======
+
+static void zz_arm64_writer_put_fixup(ZzARM64AssemblerWriter *self, ZzARM64FixupType type, zz_addr_t value,
+                                      ZzARM64Reg reg, uint32_t condition) {
+    ZzARM64Fixup *fixup;
+
+    if (self->fixup_count >= ZZ_ARM64_MAX_FIXUP_COUNT) {
+        self->fixup_overflow = TRUE;
+        return;
+    }
+    fixup            = &self->fixups[self->fixup_count++];
+    fixup->type      = type;
+    fixup->offset    = self->size;
+    fixup->value     = value;
+    fixup->reg       = reg;
+    fixup->condition = condition;
+    fixup->size      = type == ZZ_ARM64_FIXUP_LABEL ? 0 : 4;
+}
+
+ZzARM64Label zz_arm64_writer_new_label(ZzARM64AssemblerWriter *self) { return self->label_count++; }
+
+void zz_arm64_writer_put_label(ZzARM64AssemblerWriter *self, ZzARM64Label label) {
+    zz_arm64_writer_put_fixup(self, ZZ_ARM64_FIXUP_LABEL, label, 0, 0);
+}
+
+void zz_arm64_writer_put_b_label(ZzARM64AssemblerWriter *self, ZzARM64Label label) {
+    zz_arm64_writer_put_fixup(self, ZZ_ARM64_FIXUP_B_LABEL, label, 0, 0);
+}
+
+void zz_arm64_writer_put_b_cond_label(ZzARM64AssemblerWriter *self, uint32_t condition, ZzARM64Label label) {
+    zz_arm64_writer_put_fixup(self, ZZ_ARM64_FIXUP_B_COND_LABEL, label, 0, condition);
+}
+
+void zz_arm64_writer_put_ldr_reg_literal(ZzARM64AssemblerWriter *self, ZzARM64Reg reg, uint64_t value) {
+    zz_arm64_writer_put_fixup(self, ZZ_ARM64_FIXUP_LDR_LITERAL, (zz_addr_t)value, reg, 0);
+}
+
+void zz_arm64_writer_put_jump_address(ZzARM64AssemblerWriter *self, ZzARM64Reg reg, zz_addr_t address) {
+    zz_arm64_writer_put_fixup(self, ZZ_ARM64_FIXUP_JUMP, address, reg, 0);
+}
+
+void zz_arm64_writer_put_call_address(ZzARM64AssemblerWriter *self, ZzARM64Reg reg, zz_addr_t address) {
+    zz_arm64_writer_put_fixup(self, ZZ_ARM64_FIXUP_CALL, address, reg, 0);
+}
+
+zz_size_t zz_arm64_writer_relax_size_limit(ZzARM64AssemblerWriter *self) {
+    // every fixup as a far jump (8) with its literal (8), plus the pool alignment
+    return self->size + self->fixup_count * 16 + 4;
+}
+
+static bool zz_arm64_writer_is_in_b_range(zz_addr_t pc, zz_addr_t address) {
+    int64_t offset = (int64_t)(address - pc);
+    return offset >= -(int64_t)zz_arm64_writer_near_jump_range_size() &&
+           offset < (int64_t)zz_arm64_writer_near_jump_range_size();
+}
+
+static bool zz_arm64_writer_fixup_needs_literal(ZzARM64Fixup *fixup) {
+    return fixup->type == ZZ_ARM64_FIXUP_LDR_LITERAL ||
+           ((fixup->type == ZZ_ARM64_FIXUP_JUMP || fixup->type == ZZ_ARM64_FIXUP_CALL) && fixup->size == 8);
+}
+
+// positions of the fixups in the relaxed code, return the code size (without the pool)
+static zz_size_t zz_arm64_writer_layout(ZzARM64AssemblerWriter *self, zz_size_t *positions) {
+    zz_size_t shift = 0;
+    zz_size_t i;
+
+    for (i = 0; i < self->fixup_count; i++) {
+        positions[i] = self->fixups[i].offset + shift;
+        shift += self->fixups[i].size;
+    }
+    return self->size + shift;
+}
+
+static zz_size_t zz_arm64_writer_label_position(ZzARM64AssemblerWriter *self, zz_size_t *positions,
+                                                ZzARM64Label label) {
+    zz_size_t i;
+
+    for (i = 0; i < self->fixup_count; i++) {
+        if (self->fixups[i].type == ZZ_ARM64_FIXUP_LABEL && self->fixups[i].value == label)
+            return positions[i];
+    }
+    return 0;
+}
+
+zz_size_t zz_arm64_writer_relax(ZzARM64AssemblerWriter *self, zz_addr_t pc, zz_ptr_t out) {
+    zz_size_t positions[ZZ_ARM64_MAX_FIXUP_COUNT];
+    zz_addr_t literals[ZZ_ARM64_MAX_FIXUP_COUNT];
+    zz_size_t literal_count = 0;
+    zz_size_t code_size, pool_offset, raw_offset, i, j;
+    ZzARM64Fixup *fixup;
+    ZzARM64RegInfo ri;
+    uint32_t *insn;
+    int64_t offset;
+    bool changed;
+
+    // start with everything near, a jump out of range grows to the far form until nothing moves
+    for (i = 0; i < self->fixup_count; i++) {
+        if (self->fixups[i].type == ZZ_ARM64_FIXUP_JUMP || self->fixups[i].type == ZZ_ARM64_FIXUP_CALL)
+            self->fixups[i].size = 4;
+    }
+    do {
+        changed   = FALSE;
+        code_size = zz_arm64_writer_layout(self, positions);
+        for (i = 0; i < self->fixup_count; i++) {
+            fixup = &self->fixups[i];
+            if ((fixup->type == ZZ_ARM64_FIXUP_JUMP || fixup->type == ZZ_ARM64_FIXUP_CALL) && fixup->size == 4 &&
+                !zz_arm64_writer_is_in_b_range(pc + positions[i], fixup->value)) {
+                fixup->size = 8;
+                changed     = TRUE;
+            }
+        }
+    } while (changed);
+
+    // the pool is 8-byte aligned, one slot per distinct value
+    for (i = 0; i < self->fixup_count; i++) {
+        if (!zz_arm64_writer_fixup_needs_literal(&self->fixups[i]))
+            continue;
+        for (j = 0; j < literal_count; j++) {
+            if (literals[j] == self->fixups[i].value)
+                break;
+        }
+        if (j == literal_count)
+            literals[literal_count++] = self->fixups[i].value;
+    }
+    pool_offset = code_size;
+    if (literal_count && (pc + pool_offset) % 8)
+        pool_offset += 4;
+
+    raw_offset = 0;
+    for (i = 0; i <= self->fixup_count; i++) {
+        zz_size_t raw_end = i < self->fixup_count ? self->fixups[i].offset : self->size;
+        zz_size_t position = i < self->fixup_count ? positions[i] : code_size;
+
+        memcpy((char *)out + position - (raw_end - raw_offset), (zz_ptr_t)(self->w_start_address + raw_offset),
+               raw_end - raw_offset);
+        raw_offset = raw_end;
+        if (i == self->fixup_count)
+            break;
+
+        fixup = &self->fixups[i];
+        insn  = (uint32_t *)((char *)out + position);
+        zz_arm64_register_describe(fixup->reg, &ri);
+        if (zz_arm64_writer_fixup_needs_literal(fixup)) {
+            for (j = 0; literals[j] != fixup->value; j++)
+                ;
+            offset  = (int64_t)(pool_offset + j * 8) - (int64_t)position;
+            insn[0] = 0x58000000 | (((uint32_t)(offset >> 2) & 0x7ffff) << 5) | ri.index;
+        }
+
+        switch (fixup->type) {
+        case ZZ_ARM64_FIXUP_B_LABEL:
+        case ZZ_ARM64_FIXUP_B_COND_LABEL:
+            offset = (int64_t)zz_arm64_writer_label_position(self, positions, fixup->value) - (int64_t)position;
+            if (fixup->type == ZZ_ARM64_FIXUP_B_LABEL)
+                insn[0] = 0x14000000 | ((uint32_t)(offset >> 2) & 0x03ffffff);
+            else
+                insn[0] = 0x54000000 | (((uint32_t)(offset >> 2) & 0x7ffff) << 5) | fixup->condition;
+            break;
+        case ZZ_ARM64_FIXUP_JUMP:
+        case ZZ_ARM64_FIXUP_CALL:
+            if (fixup->size == 4) {
+                offset  = (int64_t)(fixup->value - (pc + position));
+                insn[0] = (fixup->type == ZZ_ARM64_FIXUP_JUMP ? 0x14000000 : 0x94000000) |
+                          ((uint32_t)(offset >> 2) & 0x03ffffff);
+            } else {
+                insn[1] = (fixup->type == ZZ_ARM64_FIXUP_JUMP ? 0xd61f0000 : 0xd63f0000) | ri.index << 5;
+            }
+            break;
+        default:
+            break;
+        }
+    }
+
+    if (!literal_count)
+        return code_size;
+    if (pool_offset > code_size)
+        *(uint32_t *)((char *)out + code_size) = 0xd503201f; // nop
+    for (j = 0; j < literal_count; j++)
+        memcpy((char *)out + pool_offset + j * 8, &literals[j], sizeof(zz_addr_t));
+    return pool_offset + literal_count * 8;
+}
+
 // ======= default =======
 
 void zz_arm64_writer_put_bytes(ZzARM64AssemblerWriter *self, char *data, zz_size_t data_size) {
@@ -89,14 +273,21 @@ void zz_arm64_writer_put_bytes(ZzARM64AssemblerWriter *self, char *data, zz_size
     self->current_pc += data_size;
     self->size += data_size;
 
+    if (self->insn_size == self->insn_capacity) {
+        zz_size_t capacity = self->insn_capacity ? self->insn_capacity * 2 : 16;
+        ZzARM64Instruction *insns = (ZzARM64Instruction *)ZzArenaGrow(
+            &self->arena, self->insns, self->insn_capacity * sizeof(ZzARM64Instruction), capacity * sizeof(ZzARM64Instruction));
+        if (!insns)
+            return;
+        self->insns         = insns;
+        self->insn_capacity = capacity;
+    }
 
-    ZzARM64Instruction *arm64_insn = (ZzARM64Instruction *)zz_malloc_with_zero(sizeof(ZzARM64Instruction));
+    ZzARM64Instruction *arm64_insn = &self->insns[self->insn_size++];
     arm64_insn->pc = self->current_pc - data_size;
     arm64_insn->address = self->w_current_address-data_size;
     arm64_insn->size = data_size;
     arm64_insn->insn = 0;
-
-    self->insns[self->insn_size++] = arm64_insn;
 }
 
 void zz_arm64_writer_put_instruction(ZzARM64AssemblerWriter *self, uint32_t insn) {
@@ -163,6 +354,26 @@ void zz_arm64_writer_put_ldr_reg_reg_offset(ZzARM64AssemblerWriter *self, ZzARM6
     return;
 }
 
+// C6-535
+void zz_arm64_writer_put_adr_reg_imm(ZzARM64AssemblerWriter *self, ZzARM64Reg reg, int64_t offset) {
+    ZzARM64RegInfo ri;
+    zz_arm64_register_describe(reg, &ri);
+
+    uint32_t immlo = offset & 0x3, immhi = (offset >> 2) & 0x7FFFF, Rd_ndx = ri.index;
+    zz_arm64_writer_put_instruction(self, 0x10000000 | immlo << 29 | immhi << 5 | Rd_ndx);
+    return;
+}
+
+// C6-536
+void zz_arm64_writer_put_adrp_reg_imm(ZzARM64AssemblerWriter *self, ZzARM64Reg reg, int64_t page_offset) {
+    ZzARM64RegInfo ri;
+    zz_arm64_register_describe(reg, &ri);
+
+    uint32_t immlo = page_offset & 0x3, immhi = (page_offset >> 2) & 0x7FFFF, Rd_ndx = ri.index;
+    zz_arm64_writer_put_instruction(self, 0x90000000 | immlo << 29 | immhi << 5 | Rd_ndx);
+    return;
+}
+
 // C6-562
 void zz_arm64_writer_put_br_reg(ZzARM64AssemblerWriter *self, ZzARM64Reg reg) {
     ZzARM64RegInfo ri;
@@ -241,4 +452,40 @@ void zz_arm64_writer_put_sub_reg_reg_imm(ZzARM64AssemblerWriter *self, ZzARM64Re
     zz_arm64_writer_put_instruction(self, 0x11000000 | sf << 31 | op << 30 | S << 29 | shift << 22 | imm12 << 10 |
                                               Rn_ndx << 5 | Rd_ndx);
     return;
-}
\ No newline at end of file
+}
+// C6-605, alias of `SUBS XZR, Xn, Xm`
+void zz_arm64_writer_put_cmp_reg_reg(ZzARM64AssemblerWriter *self, ZzARM64Reg left_reg, ZzARM64Reg right_reg) {
+    ZzARM64RegInfo rl, rr;
+
+    zz_arm64_register_describe(left_reg, &rl);
+    zz_arm64_register_describe(right_reg, &rr);
+
+    uint32_t sf = 1, op = 1, S = 1, shift = 0b00, imm6 = 0, Rm_ndx, Rn_ndx, Rd_ndx = 0b11111;
+
+    Rm_ndx = rr.index;
+    Rn_ndx = rl.index;
+
+    zz_arm64_writer_put_instruction(self, 0x0b000000 | sf << 31 | op << 30 | S << 29 | shift << 22 | Rm_ndx << 16 |
+                                              imm6 << 10 | Rn_ndx << 5 | Rd_ndx);
+    return;
+}
+
+// C6-530
+void zz_arm64_writer_put_and_reg_reg_reg(ZzARM64AssemblerWriter *self, ZzARM64Reg dst_reg, ZzARM64Reg left_reg,
+                                         ZzARM64Reg right_reg) {
+    ZzARM64RegInfo rd, rl, rr;
+
+    zz_arm64_register_describe(dst_reg, &rd);
+    zz_arm64_register_describe(left_reg, &rl);
+    zz_arm64_register_describe(right_reg, &rr);
+
+    uint32_t sf = 1, opc = 0b00, shift = 0b00, N = 0, imm6 = 0, Rm_ndx, Rn_ndx, Rd_ndx;
+
+    Rd_ndx = rd.index;
+    Rn_ndx = rl.index;
+    Rm_ndx = rr.index;
+
+    zz_arm64_writer_put_instruction(self, 0x0a000000 | sf << 31 | opc << 29 | shift << 22 | N << 21 | Rm_ndx << 16 |
+                                              imm6 << 10 | Rn_ndx << 5 | Rd_ndx);
+    return;
+}
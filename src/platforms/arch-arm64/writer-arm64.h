@@ -22,20 +22,61 @@
 #include "memory.h"
 #include "writer.h"
 
+#include "arena.h"
 #include "instructions.h"
 #include "regs-arm64.h"
 #include "writer-arm64.h"
 
-#define MAX_INSN_SIZE 256
+
+// C1.2.4 Condition code
+#define ZZ_ARM64_COND_EQ 0b0000
+#define ZZ_ARM64_COND_NE 0b0001
+#define ZZ_ARM64_COND_HS 0b0010
+#define ZZ_ARM64_COND_LO 0b0011
+#define ZZ_ARM64_COND_HI 0b1000
+#define ZZ_ARM64_COND_LS 0b1001
+
+#define ZZ_ARM64_MAX_FIXUP_COUNT 64
+
+// a code position, placed once with zz_arm64_writer_put_label
+typedef zz_size_t ZzARM64Label;
+
+typedef enum _ZzARM64FixupType {
+    ZZ_ARM64_FIXUP_LABEL = 0,
+    ZZ_ARM64_FIXUP_B_LABEL,
+    ZZ_ARM64_FIXUP_B_COND_LABEL,
+    ZZ_ARM64_FIXUP_LDR_LITERAL,
+    ZZ_ARM64_FIXUP_JUMP,
+    ZZ_ARM64_FIXUP_CALL
+} ZzARM64FixupType;
+
+// an instruction laid out by the relaxation, offset is its position in the fixed code.
+typedef struct _ZzARM64Fixup {
+    ZzARM64FixupType type;
+    zz_size_t offset;
+    zz_addr_t value; // label, literal or destination
+    ZzARM64Reg reg;
+    uint32_t condition;
+    zz_size_t size;
+} ZzARM64Fixup;
 
 typedef struct _ZzARM64AssemblerWriter {
-    ZzARM64Instruction *insns[MAX_INSN_SIZE];
+    // records of put_bytes, live in the arena until the next reset
+    ZzARM64Instruction *insns;
     zz_size_t insn_size;
+    zz_size_t insn_capacity;
     zz_addr_t w_start_address;
     zz_addr_t w_current_address;
     zz_addr_t start_pc;
     zz_addr_t current_pc;
     zz_size_t size;
+
+    ZzARM64Fixup fixups[ZZ_ARM64_MAX_FIXUP_COUNT];
+    zz_size_t fixup_count;
+    zz_size_t label_count;
+    bool fixup_overflow; // a fixup was dropped, the code can't be relaxed
+
+    ZzArena arena;
 } ZzARM64AssemblerWriter;
 
 ZzARM64AssemblerWriter *zz_arm64_writer_new(zz_ptr_t data_ptr);
@@ -54,6 +95,37 @@ void zz_arm64_writer_put_ldr_b_reg_address(ZzARM64AssemblerWriter *self, ZzARM64
 
 void zz_arm64_writer_put_ldr_br_b_reg_address(ZzARM64AssemblerWriter *self, ZzARM64Reg reg, zz_addr_t address);
 
+// adrp + add, the address must be in +-4GB of the pc
+void zz_arm64_writer_put_adrp_add_reg_address(ZzARM64AssemblerWriter *self, ZzARM64Reg reg, zz_addr_t address);
+
+// ======= label =======
+
+// labels, literals and relaxed jumps take no room in the fixed code, zz_arm64_writer_relax lays them out once the
+// address of the code slice is known. a fixed pc-relative offset must not cross them.
+
+ZzARM64Label zz_arm64_writer_new_label(ZzARM64AssemblerWriter *self);
+
+void zz_arm64_writer_put_label(ZzARM64AssemblerWriter *self, ZzARM64Label label);
+
+void zz_arm64_writer_put_b_label(ZzARM64AssemblerWriter *self, ZzARM64Label label);
+
+void zz_arm64_writer_put_b_cond_label(ZzARM64AssemblerWriter *self, uint32_t condition, ZzARM64Label label);
+
+// ldr reg, =value, the literals are pooled after the code
+void zz_arm64_writer_put_ldr_reg_literal(ZzARM64AssemblerWriter *self, ZzARM64Reg reg, uint64_t value);
+
+// b, ldr reg, =address + br reg out of the b range
+void zz_arm64_writer_put_jump_address(ZzARM64AssemblerWriter *self, ZzARM64Reg reg, zz_addr_t address);
+
+// bl, ldr reg, =address + blr reg out of the bl range
+void zz_arm64_writer_put_call_address(ZzARM64AssemblerWriter *self, ZzARM64Reg reg, zz_addr_t address);
+
+// the relaxed size is never more than this, whatever the address
+zz_size_t zz_arm64_writer_relax_size_limit(ZzARM64AssemblerWriter *self);
+
+// lay the code out for pc into out, return its size
+zz_size_t zz_arm64_writer_relax(ZzARM64AssemblerWriter *self, zz_addr_t pc, zz_ptr_t out);
+
 // ======= default =======
 
 void zz_arm64_writer_put_ldr_reg_imm(ZzARM64AssemblerWriter *self, ZzARM64Reg reg, uint32_t offset);
@@ -64,6 +136,10 @@ void zz_arm64_writer_put_str_reg_reg_offset(ZzARM64AssemblerWriter *self, ZzARM6
 void zz_arm64_writer_put_ldr_reg_reg_offset(ZzARM64AssemblerWriter *self, ZzARM64Reg dst_reg, ZzARM64Reg src_reg,
                                             uint64_t offset);
 
+void zz_arm64_writer_put_adr_reg_imm(ZzARM64AssemblerWriter *self, ZzARM64Reg reg, int64_t offset);
+
+void zz_arm64_writer_put_adrp_reg_imm(ZzARM64AssemblerWriter *self, ZzARM64Reg reg, int64_t page_offset);
+
 void zz_arm64_writer_put_br_reg(ZzARM64AssemblerWriter *self, ZzARM64Reg reg);
 
 void zz_arm64_writer_put_blr_reg(ZzARM64AssemblerWriter *self, ZzARM64Reg reg);
@@ -78,6 +154,11 @@ void zz_arm64_writer_put_add_reg_reg_imm(ZzARM64AssemblerWriter *self, ZzARM64Re
 void zz_arm64_writer_put_sub_reg_reg_imm(ZzARM64AssemblerWriter *self, ZzARM64Reg dst_reg, ZzARM64Reg left_reg,
                                          uint64_t imm);
 
+void zz_arm64_writer_put_cmp_reg_reg(ZzARM64AssemblerWriter *self, ZzARM64Reg left_reg, ZzARM64Reg right_reg);
+
+void zz_arm64_writer_put_and_reg_reg_reg(ZzARM64AssemblerWriter *self, ZzARM64Reg dst_reg, ZzARM64Reg left_reg,
+                                         ZzARM64Reg right_reg);
+
 void zz_arm64_writer_put_bytes(ZzARM64AssemblerWriter *self, char *data, zz_size_t size);
 
 void zz_arm64_writer_put_instruction(ZzARM64AssemblerWriter *self, uint32_t insn);
@@ -1,2 +1,24 @@
 #include "instructions.h"
 #include <string.h>
+
+int64_t zz_x86_insn_read_signed(const ZzX86Instruction *insn_ctx, uint8_t offset, uint8_t size) {
+    const uint8_t *p = insn_ctx->bytes + offset;
+    int32_t value32;
+    int16_t value16;
+    int64_t value64;
+
+    switch (size) {
+    case 1:
+        return (int8_t)p[0];
+    case 2:
+        memcpy(&value16, p, 2);
+        return value16;
+    case 4:
+        memcpy(&value32, p, 4);
+        return value32;
+    case 8:
+        memcpy(&value64, p, 8);
+        return value64;
+    }
+    return 0;
+}
@@ -17,15 +17,37 @@
 #ifndef platforms_arch_x86_instructions_h
 #define platforms_arch_x86_instructions_h
 
-#include "hookzz.h"
+#include "kitzz.h"
 
-typedef struct _ZzInstruction {
-} ZzInstruction;
+#define ZZ_X86_MAX_INSN_SIZE 15
 
-typedef struct _ZzRelocateInstruction {
-    const ZzInstruction *insn_ctx;
-    zz_addr_t relocated_offset;
-    zz_size_t relocated_length;
-} ZzRelocateInstruction;
+// what the decoder found, only what the length and the relocation need
+#define ZZ_X86_INSN_MODRM 0x1
+#define ZZ_X86_INSN_SIB 0x2
+#define ZZ_X86_INSN_RIP_RELATIVE 0x4
+#define ZZ_X86_INSN_REX 0x8
+#define ZZ_X86_INSN_VEX 0x10
+#define ZZ_X86_INSN_EVEX 0x20
+#define ZZ_X86_INSN_XOP 0x40
+#define ZZ_X86_INSN_INVALID 0x80
 
-#endif
\ No newline at end of file
+typedef struct _ZzX86Instruction {
+    zz_addr_t pc;
+    zz_addr_t address;
+    uint8_t size;
+    uint32_t flags;
+    uint8_t prefix_size; // legacy, rex and vex/evex/xop bytes
+    uint8_t opcode_map;  // 0: one byte, 1: 0f, 2: 0f 38, 3: 0f 3a, 8-10: xop
+    uint8_t opcode;      // the last opcode byte
+    uint8_t modrm;
+    uint8_t disp_offset; // offsets in the instruction, 0 if there is none
+    uint8_t disp_size;
+    uint8_t imm_offset;
+    uint8_t imm_size;
+    uint8_t bytes[ZZ_X86_MAX_INSN_SIZE];
+} ZzX86Instruction;
+
+// the signed displacement/immediate of the size at the offset of the instruction
+int64_t zz_x86_insn_read_signed(const ZzX86Instruction *insn_ctx, uint8_t offset, uint8_t size);
+
+#endif
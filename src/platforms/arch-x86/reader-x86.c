@@ -15,9 +15,330 @@
  */
 
 #include "reader-x86.h"
-#include "zzdeps/common/debugbreak.h"
-#include "zzdeps/zz.h"
 
-zz_ptr_t zz_x86_reader_read_one_instruction(zz_ptr_t address, ZzInstruction *insn_ctx) { return NULL; }
+#include <stdlib.h>
+#include <string.h>
 
-X86InsnType GetX86InsnType(uint32_t insn) { return X86_UNDEF; }
\ No newline at end of file
+// REF:
+// Intel 64 and IA-32 Architectures Software Developer's Manual, Volume 2
+// Appendix A Opcode Map, Appendix B Instruction Formats and Encodings
+
+#define OP_MODRM 0x01
+#define OP_IMM8 0x02
+#define OP_IMM16 0x04
+#define OP_IMMZ 0x08 // 16 or 32 bits by the operand size
+#define OP_IMMV 0x10 // 16, 32 or 64 bits by the operand size, `mov reg, imm` only
+#define OP_INVALID 0x20
+#define OP_PREFIX 0x40 // prefix or escape, decoded before the table
+
+#define M OP_MODRM
+#define I8 OP_IMM8
+#define I16 OP_IMM16
+#define IZ OP_IMMZ
+#define IV OP_IMMV
+#define X OP_INVALID
+#define P OP_PREFIX
+
+static const uint8_t one_byte_opcode_table[256] = {
+    /*       0     1     2       3     4      5       6     7     8       9       a       b       c       d      e  f */
+    /* 0 */ M,    M,    M,      M,    I8,    IZ,     X,    X,    M,      M,      M,      M,      I8,     IZ,    X, P,
+    /* 1 */ M,    M,    M,      M,    I8,    IZ,     X,    X,    M,      M,      M,      M,      I8,     IZ,    X, X,
+    /* 2 */ M,    M,    M,      M,    I8,    IZ,     P,    X,    M,      M,      M,      M,      I8,     IZ,    P, X,
+    /* 3 */ M,    M,    M,      M,    I8,    IZ,     P,    X,    M,      M,      M,      M,      I8,     IZ,    P, X,
+    /* 4 */ P,    P,    P,      P,    P,     P,      P,    P,    P,      P,      P,      P,      P,      P,     P, P,
+    /* 5 */ 0,    0,    0,      0,    0,     0,      0,    0,    0,      0,      0,      0,      0,      0,     0, 0,
+    /* 6 */ X,    X,    P,      M,    P,     P,      P,    P,    IZ,     M | IZ, I8,     M | I8, 0,      0,     0, 0,
+    /* 7 */ I8,   I8,   I8,     I8,   I8,    I8,     I8,   I8,   I8,     I8,     I8,     I8,     I8,     I8,    I8, I8,
+    /* 8 */ M|I8, M|IZ, X,      M|I8, M,     M,      M,    M,    M,      M,      M,      M,      M,      M,     M, M,
+    /* 9 */ 0,    0,    0,      0,    0,     0,      0,    0,    0,      0,      X,      0,      0,      0,     0, 0,
+    /* a */ 0,    0,    0,      0,    0,     0,      0,    0,    I8,     IZ,     0,      0,      0,      0,     0, 0,
+    /* b */ I8,   I8,   I8,     I8,   I8,    I8,     I8,   I8,   IV,     IV,     IV,     IV,     IV,     IV,    IV, IV,
+    /* c */ M|I8, M|I8, I16,    0,    P,     P,      M|I8, M|IZ, I16|I8, 0,      I16,    0,      0,      I8,    X, 0,
+    /* d */ M,    M,    M,      M,    X,     X,      X,    0,    M,      M,      M,      M,      M,      M,     M, M,
+    /* e */ I8,   I8,   I8,     I8,   I8,    I8,     I8,   I8,   IZ,     IZ,     X,      I8,     0,      0,     0, 0,
+    /* f */ P,    0,    P,      P,    0,     0,      M,    M,    0,      0,      0,      0,      0,      0,     M, M,
+};
+
+static const uint8_t two_byte_opcode_table[256] = {
+    /*       0     1     2       3     4      5       6     7     8       9       a       b       c       d      e  f */
+    /* 0 */ M,    M,    M,      M,    X,     0,      0,    0,    0,      0,      X,      0,      X,      M,     0, M|I8,
+    /* 1 */ M,    M,    M,      M,    M,     M,      M,    M,    M,      M,      M,      M,      M,      M,     M, M,
+    /* 2 */ M,    M,    M,      M,    X,     X,      X,    X,    M,      M,      M,      M,      M,      M,     M, M,
+    /* 3 */ 0,    0,    0,      0,    0,     0,      X,    0,    P,      X,      P,      X,      X,      X,     X, X,
+    /* 4 */ M,    M,    M,      M,    M,     M,      M,    M,    M,      M,      M,      M,      M,      M,     M, M,
+    /* 5 */ M,    M,    M,      M,    M,     M,      M,    M,    M,      M,      M,      M,      M,      M,     M, M,
+    /* 6 */ M,    M,    M,      M,    M,     M,      M,    M,    M,      M,      M,      M,      M,      M,     M, M,
+    /* 7 */ M|I8, M|I8, M|I8,   M|I8, M,     M,      M,    0,    M,      M,      X,      X,      M,      M,     M, M,
+    /* 8 */ IZ,   IZ,   IZ,     IZ,   IZ,    IZ,     IZ,   IZ,   IZ,     IZ,     IZ,     IZ,     IZ,     IZ,    IZ, IZ,
+    /* 9 */ M,    M,    M,      M,    M,     M,      M,    M,    M,      M,      M,      M,      M,      M,     M, M,
+    /* a */ 0,    0,    0,      M,    M|I8,  M,      X,    X,    0,      0,      0,      M,      M|I8,   M,     M, M,
+    /* b */ M,    M,    M,      M,    M,     M,      M,    M,    M,      M,      M|I8,   M,      M,      M,     M, M,
+    /* c */ M,    M,    M|I8,   M,    M|I8,  M|I8,   M|I8, M,    0,      0,      0,      0,      0,      0,     0, 0,
+    /* d */ M,    M,    M,      M,    M,     M,      M,    M,    M,      M,      M,      M,      M,      M,     M, M,
+    /* e */ M,    M,    M,      M,    M,     M,      M,    M,    M,      M,      M,      M,      M,      M,     M, M,
+    /* f */ M,    M,    M,      M,    M,     M,      M,    M,    M,      M,      M,      M,      M,      M,     M, M,
+};
+
+#undef M
+#undef I8
+#undef I16
+#undef IZ
+#undef IV
+#undef X
+#undef P
+
+static bool is_legacy_prefix(uint8_t byte) {
+    switch (byte) {
+    case 0xf0: // lock
+    case 0xf2: // repne
+    case 0xf3: // rep
+    case 0x2e: // cs
+    case 0x36: // ss
+    case 0x3e: // ds
+    case 0x26: // es
+    case 0x64: // fs
+    case 0x65: // gs
+    case 0x66: // operand size
+    case 0x67: // address size
+        return TRUE;
+    }
+    return FALSE;
+}
+
+zz_size_t zz_x86_decode_instruction(const uint8_t *code, zz_addr_t pc, ZzX86Instruction *insn_ctx) {
+    bool operand_size_16 = FALSE, address_size_32 = FALSE;
+    uint8_t rex = 0, byte, flags = 0;
+    const uint8_t *p = code;
+    zz_size_t size;
+
+    memset(insn_ctx, 0, sizeof(ZzX86Instruction));
+    insn_ctx->address = (zz_addr_t)code;
+    insn_ctx->pc      = pc;
+
+    // legacy prefixes, a rex only counts right before the opcode
+    for (;; p++) {
+        if (p - code >= ZZ_X86_MAX_INSN_SIZE)
+            goto invalid;
+        byte = *p;
+        if (is_legacy_prefix(byte)) {
+            if (byte == 0x66)
+                operand_size_16 = TRUE;
+            else if (byte == 0x67)
+                address_size_32 = TRUE;
+            rex = 0;
+        } else if ((byte & 0xf0) == 0x40) {
+            rex = byte;
+        } else {
+            break;
+        }
+    }
+    if (rex) {
+        insn_ctx->flags |= ZZ_X86_INSN_REX;
+        // rex.w wins over the operand size prefix
+        if (rex & 0x8)
+            operand_size_16 = FALSE;
+    }
+
+    byte = *p;
+    if (byte == 0xc5) {
+        // 2 byte vex, map 0f
+        insn_ctx->flags |= ZZ_X86_INSN_VEX;
+        insn_ctx->opcode_map = 1;
+        p += 2;
+    } else if (byte == 0xc4) {
+        insn_ctx->flags |= ZZ_X86_INSN_VEX;
+        insn_ctx->opcode_map = p[1] & 0x1f;
+        p += 3;
+    } else if (byte == 0x62) {
+        insn_ctx->flags |= ZZ_X86_INSN_EVEX;
+        insn_ctx->opcode_map = p[1] & 0x7;
+        p += 4;
+    } else if (byte == 0x8f && (p[1] & 0x1f) >= 8) {
+        // xop, `pop r/m` has a zero map field
+        insn_ctx->flags |= ZZ_X86_INSN_XOP;
+        insn_ctx->opcode_map = p[1] & 0x1f;
+        p += 3;
+    } else if (byte == 0x0f) {
+        if (p[1] == 0x38) {
+            insn_ctx->opcode_map = 2;
+            p += 2;
+        } else if (p[1] == 0x3a) {
+            insn_ctx->opcode_map = 3;
+            p += 2;
+        } else {
+            insn_ctx->opcode_map = 1;
+            p += 1;
+        }
+    }
+    // escape bytes count as prefix, only the opcode is left
+    insn_ctx->prefix_size = (uint8_t)(p - code);
+
+    insn_ctx->opcode = byte = *p++;
+    switch (insn_ctx->opcode_map) {
+    case 0:
+        flags = one_byte_opcode_table[byte];
+        break;
+    case 1:
+        flags = two_byte_opcode_table[byte];
+        // vex/evex only reuse the modrm and imm8 columns of the 0f map
+        if (insn_ctx->flags & (ZZ_X86_INSN_VEX | ZZ_X86_INSN_EVEX))
+            flags &= OP_MODRM | OP_IMM8;
+        break;
+    case 2:
+    case 5:
+    case 6:
+    case 9:
+        flags = OP_MODRM;
+        break;
+    case 3:
+    case 8:
+        flags = OP_MODRM | OP_IMM8;
+        break;
+    case 10:
+        flags = OP_MODRM;
+        break;
+    default:
+        goto invalid;
+    }
+    if (flags & OP_INVALID)
+        goto invalid;
+
+    if (flags & OP_MODRM) {
+        uint8_t modrm = *p++, mod = modrm >> 6, rm = modrm & 0x7;
+
+        insn_ctx->flags |= ZZ_X86_INSN_MODRM;
+        insn_ctx->modrm = modrm;
+        if (mod != 3) {
+            if (rm == 4) {
+                uint8_t sib = *p++;
+                insn_ctx->flags |= ZZ_X86_INSN_SIB;
+                if (mod == 0 && (sib & 0x7) == 5)
+                    insn_ctx->disp_size = 4;
+            } else if (mod == 0 && rm == 5) {
+                // rip (eip with the address size prefix) relative
+                insn_ctx->flags |= ZZ_X86_INSN_RIP_RELATIVE;
+                insn_ctx->disp_size = 4;
+            }
+            if (mod == 1)
+                insn_ctx->disp_size = 1;
+            else if (mod == 2)
+                insn_ctx->disp_size = 4;
+        }
+        if (insn_ctx->disp_size) {
+            insn_ctx->disp_offset = (uint8_t)(p - code);
+            p += insn_ctx->disp_size;
+        }
+
+        // test r/m, imm of group 3
+        if (insn_ctx->opcode_map == 0 && (byte == 0xf6 || byte == 0xf7) && ((modrm >> 3) & 0x7) < 2)
+            flags |= byte == 0xf6 ? OP_IMM8 : OP_IMMZ;
+    }
+
+    insn_ctx->imm_offset = (uint8_t)(p - code);
+    if (insn_ctx->opcode_map == 0 && byte >= 0xa0 && byte <= 0xa3) {
+        // mov al/ax/eax/rax, moffs
+        insn_ctx->imm_size = address_size_32 ? 4 : 8;
+    } else if (insn_ctx->opcode_map == 10) {
+        insn_ctx->imm_size = 4;
+    } else if (flags & OP_IMMZ) {
+        // near branches stay rel32 with the operand size prefix in 64-bit mode
+        if ((insn_ctx->opcode_map == 0 && (byte == 0xe8 || byte == 0xe9)) || insn_ctx->opcode_map == 1)
+            insn_ctx->imm_size = 4;
+        else
+            insn_ctx->imm_size = operand_size_16 ? 2 : 4;
+    } else if (flags & OP_IMMV) {
+        insn_ctx->imm_size = (rex & 0x8) ? 8 : (operand_size_16 ? 2 : 4);
+    } else {
+        insn_ctx->imm_size = ((flags & OP_IMM16) ? 2 : 0) + ((flags & OP_IMM8) ? 1 : 0);
+    }
+    if (!insn_ctx->imm_size)
+        insn_ctx->imm_offset = 0;
+    p += insn_ctx->imm_size;
+
+    size = p - code;
+    if (size > ZZ_X86_MAX_INSN_SIZE)
+        goto invalid;
+    insn_ctx->size = (uint8_t)size;
+    memcpy(insn_ctx->bytes, code, size);
+    return size;
+
+invalid:
+    insn_ctx->flags |= ZZ_X86_INSN_INVALID;
+    insn_ctx->size = 0;
+    return 0;
+}
+
+X86InsnType GetX86InsnType(const ZzX86Instruction *insn_ctx) {
+    uint8_t opcode = insn_ctx->opcode;
+    bool legacy    = !(insn_ctx->flags & (ZZ_X86_INSN_VEX | ZZ_X86_INSN_EVEX | ZZ_X86_INSN_XOP));
+
+    if (legacy && insn_ctx->opcode_map == 0) {
+        if (opcode == 0xeb)
+            return X86_INS_JMP_rel8;
+        if (opcode == 0xe9)
+            return X86_INS_JMP_rel32;
+        if ((opcode & 0xf0) == 0x70)
+            return X86_INS_Jcc_rel8;
+        if (opcode == 0xe8)
+            return X86_INS_CALL_rel32;
+        if (opcode >= 0xe0 && opcode <= 0xe3)
+            return X86_INS_LOOP_JRCXZ;
+        if (opcode == 0xc3 || opcode == 0xc2)
+            return X86_INS_RET;
+    }
+    if (legacy && insn_ctx->opcode_map == 1 && (opcode & 0xf0) == 0x80)
+        return X86_INS_Jcc_rel32;
+    if (insn_ctx->flags & ZZ_X86_INSN_RIP_RELATIVE)
+        return X86_INS_RIP_RELATIVE;
+    return X86_UNDEF;
+}
+
+ZzX86Reader *zz_x86_reader_new(zz_ptr_t insn_address) {
+    ZzX86Reader *reader = (ZzX86Reader *)zz_malloc_with_zero(sizeof(ZzX86Reader));
+    zz_x86_reader_reset(reader, insn_address);
+    return reader;
+}
+
+void zz_x86_reader_init(ZzX86Reader *self, zz_ptr_t insn_address) { zz_x86_reader_reset(self, insn_address); }
+
+void zz_x86_reader_reset(ZzX86Reader *self, zz_ptr_t insn_address) {
+    self->r_start_address   = (zz_addr_t)insn_address;
+    self->r_current_address = (zz_addr_t)insn_address;
+    self->start_pc          = (zz_addr_t)insn_address;
+    self->current_pc        = (zz_addr_t)insn_address;
+    self->size              = 0;
+
+    ZzArenaReset(&self->arena);
+    self->insns         = NULL;
+    self->insn_size     = 0;
+    self->insn_capacity = 0;
+}
+
+void zz_x86_reader_free(ZzX86Reader *self) {
+    ZzArenaFree(&self->arena);
+    free(self);
+}
+
+ZzX86Instruction *zz_x86_reader_read_one_instruction(ZzX86Reader *self) {
+    ZzX86Instruction *insn_ctx;
+
+    if (self->insn_size == self->insn_capacity) {
+        zz_size_t capacity      = self->insn_capacity ? self->insn_capacity * 2 : 16;
+        ZzX86Instruction *insns = (ZzX86Instruction *)ZzArenaGrow(
+            &self->arena, self->insns, self->insn_capacity * sizeof(ZzX86Instruction), capacity * sizeof(ZzX86Instruction));
+        if (!insns)
+            return NULL;
+        self->insns         = insns;
+        self->insn_capacity = capacity;
+    }
+
+    insn_ctx = &self->insns[self->insn_size];
+    if (!zz_x86_decode_instruction((const uint8_t *)self->r_current_address, self->current_pc, insn_ctx))
+        return NULL;
+    self->insn_size++;
+
+    self->current_pc += insn_ctx->size;
+    self->r_current_address += insn_ctx->size;
+    self->size += insn_ctx->size;
+    return insn_ctx;
+}
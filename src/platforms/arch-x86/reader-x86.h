@@ -17,21 +17,49 @@
 #ifndef platforms_arch_x86_reader_h
 #define platforms_arch_x86_reader_h
 
-// platforms
+#include "kitzz.h"
+
+#include "memory.h"
+
+#include "arena.h"
 #include "instructions.h"
 
-// hookzz
+typedef enum _X86InsnType {
+    X86_INS_JMP_rel8,
+    X86_INS_JMP_rel32,
+    X86_INS_Jcc_rel8,
+    X86_INS_Jcc_rel32,
+    X86_INS_CALL_rel32,
+    X86_INS_LOOP_JRCXZ,
+    X86_INS_RIP_RELATIVE,
+    X86_INS_RET,
+    X86_UNDEF
+} X86InsnType;
 
-// zzdeps
-#include "hookzz.h"
-#include "zzdefs.h"
-#include "zzdeps/common/debugbreak.h"
-#include "zzdeps/zz.h"
+X86InsnType GetX86InsnType(const ZzX86Instruction *insn_ctx);
 
-typedef enum _X86InsnType { X86_UNDEF } X86InsnType;
+// decode the 64-bit mode instruction at code, 0 if it is invalid or longer than 15 bytes. table driven, legacy/rex/
+// vex/evex/xop prefixes, modrm/sib, displacements and immediates.
+zz_size_t zz_x86_decode_instruction(const uint8_t *code, zz_addr_t pc, ZzX86Instruction *insn_ctx);
 
-X86InsnType GetX86InsnType(uint32_t insn);
+typedef struct _ZzX86Reader {
+    // inline records, live in the arena until the next reset
+    ZzX86Instruction *insns;
+    zz_size_t insn_size;
+    zz_size_t insn_capacity;
+    zz_addr_t r_start_address;
+    zz_addr_t r_current_address;
+    zz_addr_t start_pc;
+    zz_addr_t current_pc;
+    zz_size_t size;
+    ZzArena arena;
+} ZzX86Reader;
 
-zz_ptr_t zz_x86_reader_read_one_instruction(zz_ptr_t address, ZzInstruction *insn_ctx);
+ZzX86Reader *zz_x86_reader_new(zz_ptr_t insn_address);
+void zz_x86_reader_init(ZzX86Reader *self, zz_ptr_t insn_address);
+void zz_x86_reader_reset(ZzX86Reader *self, zz_ptr_t insn_address);
+void zz_x86_reader_free(ZzX86Reader *self);
+// NULL if the instruction can't be decoded
+ZzX86Instruction *zz_x86_reader_read_one_instruction(ZzX86Reader *self);
 
-#endif
\ No newline at end of file
+#endif
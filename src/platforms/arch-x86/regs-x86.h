@@ -17,16 +17,9 @@
 #ifndef platforms_arch_x86_regs_h
 #define platforms_arch_x86_regs_h
 
-// platforms
-#include "instructions.h"
-
-// hookzz
+#include "kitzz.h"
 
-// zzdeps
-#include "hookzz.h"
-#include "zzdefs.h"
-#include "zzdeps/common/debugbreak.h"
-#include "zzdeps/zz.h"
+#include "instructions.h"
 
 typedef enum _ZzX86Reg { X86_REG_UNDEF } ZzX86Reg;
 
@@ -18,22 +18,149 @@
 #include <stdlib.h>
 #include <string.h>
 
-#define MAX_RELOCATOR_INSTRUCIONS_SIZE 64
+void zz_x86_relocator_init(ZzX86Relocator *relocator, ZzX86Reader *input, ZzX86Writer *output) {
+    memset(relocator, 0, sizeof(ZzX86Relocator));
+    relocator->input  = input;
+    relocator->output = output;
+}
 
-void zz_x86_relocator_init(ZzX86Relocator *relocator, zz_ptr_t input_code, ZzX86Writer *output) {}
+void zz_x86_relocator_free(ZzX86Relocator *relocator) {
+    zz_x86_reader_free(relocator->input);
+    zz_x86_writer_free(relocator->output);
+    free(relocator);
+}
 
-void zz_x86_relocator_free(ZzX86Relocator *relocator) {}
+void zz_x86_relocator_reset(ZzX86Relocator *self, ZzX86Reader *input, ZzX86Writer *output) {
+    self->inpos                = 0;
+    self->outpos               = 0;
+    self->input                = input;
+    self->output               = output;
+    self->try_relocated_length = 0;
+    self->relocate_failed      = FALSE;
+}
 
-void zz_x86_relocator_reset(ZzX86Relocator *self, zz_ptr_t input_code, ZzX86Writer *output) {}
+zz_size_t zz_x86_relocator_read_one(ZzX86Relocator *self, ZzX86Instruction *instruction) {
+    ZzX86Instruction *insn_ctx;
 
-zz_size_t zz_x86_relocator_read_one(ZzX86Relocator *self, ZzInstruction *instruction) { return 0; }
+    insn_ctx = zz_x86_reader_read_one_instruction(self->input);
+    if (!insn_ctx)
+        return 0;
+    self->inpos++;
 
-zz_addr_t zz_x86_relocator_get_insn_relocated_offset(ZzX86Relocator *self, zz_addr_t address) { return 0; }
+    if (instruction != NULL)
+        *instruction = *insn_ctx;
+    return insn_ctx->size;
+}
 
-void zz_x86_relocator_relocate_writer(ZzX86Relocator *relocator, zz_addr_t code_address) {}
+void zz_x86_relocator_try_relocate(zz_ptr_t address, zz_size_t min_bytes, zz_size_t *max_bytes) {
+    zz_size_t tmp_size = 0;
+    bool early_end     = FALSE;
+    ZzX86Instruction *insn_ctx;
+    ZzX86Reader reader = {0};
 
-void zz_x86_relocator_write_all(ZzX86Relocator *self) {}
+    zz_x86_reader_init(&reader, address);
+    do {
+        insn_ctx = zz_x86_reader_read_one_instruction(&reader);
+        if (!insn_ctx)
+            break;
+        switch (GetX86InsnType(insn_ctx)) {
+        case X86_INS_JMP_rel8:
+        case X86_INS_JMP_rel32:
+        case X86_INS_RET:
+            early_end = TRUE;
+            break;
+        default:;
+        }
+        tmp_size += insn_ctx->size;
+    } while (tmp_size < min_bytes && !early_end);
 
-void zz_x86_relocator_try_relocate(zz_ptr_t address, zz_size_t min_bytes, zz_size_t *max_bytes) {}
+    if (early_end || !insn_ctx) {
+        *max_bytes = tmp_size;
+    }
 
-bool zz_x86_relocator_write_one(ZzX86Relocator *self) { return TRUE; }
\ No newline at end of file
+    ZzArenaFree(&reader.arena);
+}
+
+// the target of a branch into the relocated instructions would run the patched code
+static bool zz_x86_relocator_is_internal_target(ZzX86Relocator *self, zz_addr_t target) {
+    return target > self->input->start_pc && target < self->input->start_pc + self->input->size;
+}
+
+bool zz_x86_relocator_write_one(ZzX86Relocator *self) {
+    ZzX86Writer *x86_writer = self->output;
+    ZzX86Instruction *insn_ctx;
+    zz_addr_t target;
+    uint8_t bytes[ZZ_X86_MAX_INSN_SIZE];
+    int64_t rel;
+
+    if (self->relocate_failed || self->outpos >= self->inpos)
+        return FALSE;
+    insn_ctx = &self->input->insns[self->outpos];
+
+    switch (GetX86InsnType(insn_ctx)) {
+    case X86_INS_JMP_rel8:
+    case X86_INS_JMP_rel32:
+    case X86_INS_Jcc_rel8:
+    case X86_INS_Jcc_rel32:
+    case X86_INS_CALL_rel32:
+    case X86_INS_LOOP_JRCXZ:
+        target = insn_ctx->pc + insn_ctx->size +
+                 zz_x86_insn_read_signed(insn_ctx, insn_ctx->imm_offset, insn_ctx->imm_size);
+        if (zz_x86_relocator_is_internal_target(self, target)) {
+            self->relocate_failed = TRUE;
+            return FALSE;
+        }
+        break;
+    default:
+        target = 0;
+    }
+
+    switch (GetX86InsnType(insn_ctx)) {
+    case X86_INS_JMP_rel8:
+    case X86_INS_JMP_rel32:
+        zz_x86_writer_put_jmp_absolute_address(x86_writer, target);
+        break;
+    case X86_INS_Jcc_rel8:
+    case X86_INS_Jcc_rel32:
+        // the inverted condition skips the absolute jump
+        zz_x86_writer_put_jcc_rel8(x86_writer, (insn_ctx->opcode & 0xf) ^ 1, ZZ_X86_JMP_ABSOLUTE_SIZE);
+        zz_x86_writer_put_jmp_absolute_address(x86_writer, target);
+        break;
+    case X86_INS_CALL_rel32:
+        zz_x86_writer_put_call_absolute_address(x86_writer, target);
+        break;
+    case X86_INS_LOOP_JRCXZ:
+        // `loop +2; jmp +14; jmp [rip]; .quad target`, there is no inverted loop
+        memcpy(bytes, insn_ctx->bytes, insn_ctx->size);
+        bytes[insn_ctx->size - 1] = 2;
+        zz_x86_writer_put_bytes(x86_writer, bytes, insn_ctx->size);
+        zz_x86_writer_put_jmp_rel8(x86_writer, ZZ_X86_JMP_ABSOLUTE_SIZE);
+        zz_x86_writer_put_jmp_absolute_address(x86_writer, target);
+        break;
+    case X86_INS_RIP_RELATIVE: {
+        int32_t disp;
+
+        target = insn_ctx->pc + insn_ctx->size + zz_x86_insn_read_signed(insn_ctx, insn_ctx->disp_offset, 4);
+        rel    = (int64_t)(target - (x86_writer->current_pc + insn_ctx->size));
+        if (rel < INT32_MIN || rel > INT32_MAX) {
+            self->relocate_failed = TRUE;
+            return FALSE;
+        }
+        disp = (int32_t)rel;
+        memcpy(bytes, insn_ctx->bytes, insn_ctx->size);
+        memcpy(bytes + insn_ctx->disp_offset, &disp, sizeof(disp));
+        zz_x86_writer_put_bytes(x86_writer, bytes, insn_ctx->size);
+        break;
+    }
+    default:
+        zz_x86_writer_put_bytes(x86_writer, insn_ctx->bytes, insn_ctx->size);
+    }
+
+    self->outpos++;
+    return TRUE;
+}
+
+void zz_x86_relocator_write_all(ZzX86Relocator *self) {
+    while (zz_x86_relocator_write_one(self))
+        ;
+}
@@ -17,48 +17,41 @@
 #ifndef platforms_arch_x86_relocator_h
 #define platforms_arch_x86_relocator_h
 
-// platforms
+#include "kitzz.h"
+
+#include "memory.h"
+#include "writer.h"
+
 #include "instructions.h"
 #include "reader-x86.h"
 #include "regs-x86.h"
 #include "writer-x86.h"
 
-// hookzz
-#include "writer.h"
-
-// zzdeps
-#include "hookzz.h"
-#include "zzdefs.h"
-#include "zzdeps/common/debugbreak.h"
-#include "zzdeps/zz.h"
-
 typedef struct _ZzX86Relocator {
     bool try_relocated_again;
     zz_size_t try_relocated_length;
-    zz_ptr_t input_start;
-    zz_ptr_t input_cur;
-    zz_addr_t input_pc;
+    ZzX86Writer *output;
+    ZzX86Reader *input;
     int inpos;
     int outpos;
-    ZzInstruction *input_insns;
-    ZzRelocateInstruction *output_insns;
-    ZzX86Writer *output;
-    ZzLiteralInstruction **relocate_literal_insns;
-    zz_size_t relocate_literal_insns_size;
+    // a rip relative operand out of rel32 range of the output, or a branch into the relocated instructions
+    bool relocate_failed;
 } ZzX86Relocator;
 
-void zz_x86_relocator_init(ZzX86Relocator *relocator, zz_ptr_t input_code, ZzX86Writer *writer);
+void zz_x86_relocator_init(ZzX86Relocator *relocator, ZzX86Reader *input, ZzX86Writer *output);
 
 void zz_x86_relocator_free(ZzX86Relocator *relocator);
 
-void zz_x86_relocator_reset(ZzX86Relocator *self, zz_ptr_t input_code, ZzX86Writer *output);
+void zz_x86_relocator_reset(ZzX86Relocator *self, ZzX86Reader *input, ZzX86Writer *output);
 
-zz_size_t zz_x86_relocator_read_one(ZzX86Relocator *self, ZzInstruction *instruction);
+// the size of the instruction read, 0 if it can't be decoded
+zz_size_t zz_x86_relocator_read_one(ZzX86Relocator *self, ZzX86Instruction *instruction);
 
+// FALSE if every instruction read is written, or if one can't be relocated (relocate_failed)
 bool zz_x86_relocator_write_one(ZzX86Relocator *self);
 
 void zz_x86_relocator_write_all(ZzX86Relocator *self);
 
 void zz_x86_relocator_try_relocate(zz_ptr_t address, zz_size_t min_bytes, zz_size_t *max_bytes);
 
-#endif
\ No newline at end of file
+#endif
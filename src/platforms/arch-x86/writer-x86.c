@@ -19,20 +19,74 @@
 
 #include "writer-x86.h"
 
-ZzX86Writer *zz_x86_writer_new(zz_ptr_t data_ptr) { return NULL; }
+ZzX86Writer *zz_x86_writer_new(zz_ptr_t data_ptr) {
+    ZzX86Writer *writer = (ZzX86Writer *)zz_malloc_with_zero(sizeof(ZzX86Writer));
+    zz_x86_writer_reset(writer, data_ptr, (zz_addr_t)data_ptr);
+    return writer;
+}
 
-void zz_x86_writer_init(ZzX86Writer *self, zz_ptr_t target_addr) { zz_x86_writer_reset(self, target_addr); }
+void zz_x86_writer_init(ZzX86Writer *self, zz_ptr_t data_ptr, zz_addr_t target_ptr) {
+    zz_x86_writer_reset(self, data_ptr, target_ptr);
+}
 
-void zz_x86_writer_reset(ZzX86Writer *self, zz_ptr_t data_ptr) {}
+void zz_x86_writer_reset(ZzX86Writer *self, zz_ptr_t data_ptr, zz_addr_t target_ptr) {
+    self->w_start_address   = (zz_addr_t)data_ptr;
+    self->w_current_address = (zz_addr_t)data_ptr;
+    self->start_pc          = target_ptr;
+    self->current_pc        = target_ptr;
+    self->size              = 0;
+}
 
-zz_size_t zz_x86_writer_near_jump_range_size() { return 0; }
+void zz_x86_writer_free(ZzX86Writer *self) { free(self); }
 
-void zz_x86_writer_put_bytes(ZzAssemblerWriter *self, char *data, zz_size_t size) {}
+// rel32, +-2GB
+zz_size_t zz_x86_writer_near_jump_range_size() { return (zz_size_t)1 << 31; }
 
-void zz_x86_writer_put_instruction(ZzAssemblerWriter *self, uint32_t insn) {}
-
-// ======= relocator =======
+void zz_x86_writer_put_bytes(ZzX86Writer *self, zz_ptr_t data, zz_size_t size) {
+    memcpy((zz_ptr_t)self->w_current_address, data, size);
+    self->w_current_address += size;
+    self->current_pc += size;
+    self->size += size;
+}
 
 // ======= user custom =======
 
+void zz_x86_writer_put_jmp_address(ZzX86Writer *self, zz_addr_t address) {
+    int64_t offset = (int64_t)(address - (self->current_pc + 5));
+
+    if (offset >= INT32_MIN && offset <= INT32_MAX)
+        zz_x86_writer_put_jmp_rel32(self, (int32_t)offset);
+    else
+        zz_x86_writer_put_jmp_absolute_address(self, address);
+}
+
+void zz_x86_writer_put_jmp_absolute_address(ZzX86Writer *self, zz_addr_t address) {
+    uint8_t jmp[6] = {0xff, 0x25, 0x00, 0x00, 0x00, 0x00};
+    zz_x86_writer_put_bytes(self, jmp, sizeof(jmp));
+    zz_x86_writer_put_bytes(self, &address, sizeof(address));
+}
+
+void zz_x86_writer_put_call_absolute_address(ZzX86Writer *self, zz_addr_t address) {
+    uint8_t call[6] = {0xff, 0x15, 0x02, 0x00, 0x00, 0x00};
+    zz_x86_writer_put_bytes(self, call, sizeof(call));
+    zz_x86_writer_put_jmp_rel8(self, sizeof(address));
+    zz_x86_writer_put_bytes(self, &address, sizeof(address));
+}
+
 // ======= default =======
+
+void zz_x86_writer_put_jmp_rel8(ZzX86Writer *self, int8_t offset) {
+    uint8_t jmp[2] = {0xeb, (uint8_t)offset};
+    zz_x86_writer_put_bytes(self, jmp, sizeof(jmp));
+}
+
+void zz_x86_writer_put_jmp_rel32(ZzX86Writer *self, int32_t offset) {
+    uint8_t jmp = 0xe9;
+    zz_x86_writer_put_bytes(self, &jmp, 1);
+    zz_x86_writer_put_bytes(self, &offset, sizeof(offset));
+}
+
+void zz_x86_writer_put_jcc_rel8(ZzX86Writer *self, uint8_t condition, int8_t offset) {
+    uint8_t jcc[2] = {(uint8_t)(0x70 | (condition & 0xf)), (uint8_t)offset};
+    zz_x86_writer_put_bytes(self, jcc, sizeof(jcc));
+}
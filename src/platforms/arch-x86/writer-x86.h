@@ -17,36 +17,51 @@
 #ifndef platforms_arch_x86_writer_h
 #define platforms_arch_x86_writer_h
 
-// platforms
-#include "instructions.h"
-#include "regs-x86.h"
-#include "writer-x86.h"
+#include "kitzz.h"
 
-// hookzz
+#include "memory.h"
 #include "writer.h"
 
-// zzdeps
-#include "hookzz.h"
-#include "zzdefs.h"
-#include "zzdeps/common/debugbreak.h"
-#include "zzdeps/zz.h"
+#include "instructions.h"
+#include "regs-x86.h"
+
+// `jmp [rip]; .quad address`
+#define ZZ_X86_JMP_ABSOLUTE_SIZE 14
 
-typedef ZzAssemblerWriter ZzX86Writer;
+typedef struct _ZzX86Writer {
+    zz_addr_t w_start_address;
+    zz_addr_t w_current_address;
+    zz_addr_t start_pc;
+    zz_addr_t current_pc;
+    zz_size_t size;
+} ZzX86Writer;
 
 ZzX86Writer *zz_x86_writer_new(zz_ptr_t data_ptr);
+void zz_x86_writer_init(ZzX86Writer *self, zz_ptr_t data_ptr, zz_addr_t target_ptr);
+void zz_x86_writer_reset(ZzX86Writer *self, zz_ptr_t data_ptr, zz_addr_t target_ptr);
+void zz_x86_writer_free(ZzX86Writer *self);
+zz_size_t zz_x86_writer_near_jump_range_size();
 
-void zz_x86_writer_reset(ZzX86Writer *self, zz_ptr_t data_ptr);
+void zz_x86_writer_put_bytes(ZzX86Writer *self, zz_ptr_t data, zz_size_t size);
 
-void zz_x86_writer_init(ZzX86Writer *self, zz_ptr_t target_addr);
+// ======= user custom =======
 
-zz_size_t zz_x86_writer_near_jump_range_size();
-void zz_x86_writer_put_bytes(ZzAssemblerWriter *self, char *data, zz_size_t size);
-void zz_x86_writer_put_instruction(ZzAssemblerWriter *self, uint32_t insn);
+// jmp rel32 if the address is in range of the pc, the absolute jump otherwise
+void zz_x86_writer_put_jmp_address(ZzX86Writer *self, zz_addr_t address);
 
-// ======= user custom =======
+// `jmp [rip]; .quad address`, no register is clobbered
+void zz_x86_writer_put_jmp_absolute_address(ZzX86Writer *self, zz_addr_t address);
+
+// `call [rip + 2]; jmp +8; .quad address`, returns behind the literal
+void zz_x86_writer_put_call_absolute_address(ZzX86Writer *self, zz_addr_t address);
 
 // ======= default =======
 
-// ======= relocator =======
+void zz_x86_writer_put_jmp_rel8(ZzX86Writer *self, int8_t offset);
+
+void zz_x86_writer_put_jmp_rel32(ZzX86Writer *self, int32_t offset);
+
+// condition is the low nibble of the jcc opcode
+void zz_x86_writer_put_jcc_rel8(ZzX86Writer *self, uint8_t condition, int8_t offset);
 
-#endif
\ No newline at end of file
+#endif
@@ -14,7 +14,7 @@ ZzCodeSlice *zz_thumb_code_patch(ZzThumbAssemblerWriter *thumb_writer, ZzAllocat
     if (!code_slice)
         return NULL;
 
-    if (!ZzMemoryPatchCode((zz_addr_t)code_slice->data, (zz_ptr_t )thumb_writer->w_start_address, thumb_writer->size)) {
+    if (!ZzAllocatorPatchCode(allocator, (zz_addr_t)code_slice->data, (zz_ptr_t )thumb_writer->w_start_address, thumb_writer->size)) {
 
         free(code_slice);
         return NULL;
@@ -35,7 +35,7 @@ ZzCodeSlice *zz_thumb_relocate_code_patch(ZzThumbRelocator *relocator, ZzThumbAs
 
     zz_thumb_relocator_relocate_writer(relocator, (zz_addr_t)code_slice->data);
 
-    if (!ZzMemoryPatchCode((zz_addr_t)code_slice->data, (zz_ptr_t )thumb_writer->w_start_address, thumb_writer->size)) {
+    if (!ZzAllocatorPatchCode(allocator, (zz_addr_t)code_slice->data, (zz_ptr_t )thumb_writer->w_start_address, thumb_writer->size)) {
 
         free(code_slice);
         return NULL;
@@ -54,7 +54,7 @@ ZzCodeSlice *zz_arm_code_patch(ZzARMAssemblerWriter *arm_writer, ZzAllocator *al
     if (!code_slice)
         return NULL;
 
-    if (!ZzMemoryPatchCode((zz_addr_t)code_slice->data, (zz_ptr_t )arm_writer->w_start_address, arm_writer->size)) {
+    if (!ZzAllocatorPatchCode(allocator, (zz_addr_t)code_slice->data, (zz_ptr_t )arm_writer->w_start_address, arm_writer->size)) {
         free(code_slice);
         return NULL;
     }
@@ -74,7 +74,7 @@ ZzCodeSlice *zz_arm_relocate_code_patch(ZzARMRelocator *relocator, ZzARMAssemble
 
     zz_arm_relocator_relocate_writer(relocator, (zz_addr_t)code_slice->data);
 
-    if (!ZzMemoryPatchCode((zz_addr_t)code_slice->data, (zz_ptr_t )arm_writer->w_start_address, arm_writer->size)) {
+    if (!ZzAllocatorPatchCode(allocator, (zz_addr_t)code_slice->data, (zz_ptr_t )arm_writer->w_start_address, arm_writer->size)) {
         free(code_slice);
         return NULL;
     }
@@ -1,6 +1,7 @@
 #include "interceptor-arm.h"
 #include "backend-arm-helper.h"
 #include <stdlib.h>
+#include <string.h>
 
 #define ZZ_THUMB_TINY_REDIRECT_SIZE 4
 #define ZZ_THUMB_FULL_REDIRECT_SIZE 8
@@ -44,24 +45,27 @@ ZzInterceptorBackend *ZzBuildInteceptorBackend(ZzAllocator *allocator) {
 }
 
 ZZSTATUS ZzFreeTrampoline(ZzHookFunctionEntry *entry) {
-    if (entry->on_invoke_trampoline) {
-        //TODO
+    ZzAllocator *allocator = entry->interceptor->allocator;
+    zz_ptr_t trampolines[] = {entry->on_enter_transfer_trampoline, entry->on_enter_trampoline,
+                              entry->on_insn_leave_trampoline,     entry->on_invoke_trampoline,
+                              entry->on_leave_trampoline,          entry->on_dynamic_binary_instrumentation_trampoline};
+    zz_size_t i;
+
+    // the slices go back to the allocator, the next trampoline of the same size reuses them.
+    for (i = 0; i < sizeof(trampolines) / sizeof(trampolines[0]); i++) {
+        if (trampolines[i])
+            ZzFreeCodeSlice(allocator, (zz_ptr_t)((zz_addr_t)trampolines[i] & ~(zz_addr_t)1));
     }
-
-    if (entry->on_enter_trampoline) {
-        //TODO
-    }
-
-    if (entry->on_enter_transfer_trampoline) {
-        //TODO
-    }
-
-    if (entry->on_leave_trampoline) {
-        //TODO
-    }
-
-    if (entry->on_invoke_trampoline) {
-        //TODO
+    entry->on_enter_transfer_trampoline                 = NULL;
+    entry->on_enter_trampoline                          = NULL;
+    entry->on_insn_leave_trampoline                     = NULL;
+    entry->on_invoke_trampoline                         = NULL;
+    entry->on_leave_trampoline                          = NULL;
+    entry->on_dynamic_binary_instrumentation_trampoline = NULL;
+
+    if (entry->backend) {
+        free(entry->backend);
+        entry->backend = NULL;
     }
     return ZZ_SUCCESS;
 }
@@ -101,6 +105,13 @@ ZZSTATUS ZzPrepareTrampoline(ZzInterceptorBackend *self, ZzHookFunctionEntry *en
                 }
             }
         }
+        // the redirect must not run past the end of a function of known size
+        if (entry->function_size && entry_backend->redirect_code_size > entry->function_size) {
+            if (entry->function_size < ZZ_THUMB_TINY_REDIRECT_SIZE)
+                return ZZ_FAILED;
+            entry->try_near_jump = TRUE;
+            entry_backend->redirect_code_size = ZZ_THUMB_TINY_REDIRECT_SIZE;
+        }
         self->thumb_relocator.try_relocated_length = entry_backend->redirect_code_size;
     } else {
         if (entry->try_near_jump) {
@@ -119,6 +130,12 @@ ZZSTATUS ZzPrepareTrampoline(ZzInterceptorBackend *self, ZzHookFunctionEntry *en
                 entry_backend->redirect_code_size = ZZ_ARM_FULL_REDIRECT_SIZE;
             }
         }
+        if (entry->function_size && entry_backend->redirect_code_size > entry->function_size) {
+            if (entry->function_size < ZZ_ARM_TINY_REDIRECT_SIZE)
+                return ZZ_FAILED;
+            entry->try_near_jump = TRUE;
+            entry_backend->redirect_code_size = ZZ_ARM_TINY_REDIRECT_SIZE;
+        }
         self->arm_relocator.try_relocated_length = entry_backend->redirect_code_size;
     }
 
@@ -256,7 +273,7 @@ ZZSTATUS ZzBuildEnterTrampoline(ZzInterceptorBackend *self, ZzHookFunctionEntry
     }
 
     // build the double trampline aka enter_transfer_trampoline
-    if (entry->hook_type != HOOK_TYPE_FUNCTION_via_GOT) {
+    if (entry->hook_type != HOOK_TYPE_FUNCTION_via_GOT && entry->hook_type != HOOK_TYPE_FUNCTION_via_CALL_SITE) {
         if ((is_thumb && entry_backend->redirect_code_size == ZZ_THUMB_TINY_REDIRECT_SIZE) ||
             (!is_thumb && entry_backend->redirect_code_size == ZZ_ARM_TINY_REDIRECT_SIZE)) {
             ZzBuildEnterTransferTrampoline(self, entry);
@@ -386,6 +403,16 @@ ZZSTATUS ZzBuildInvokeTrampoline(ZzInterceptorBackend *self, ZzHookFunctionEntry
         else
             return ZZ_FAILED;
 
+        // record where every prologue instruction is relocated to, for the pc fixup of the safe patch.
+        entry->relocated_offset_count = 0;
+        for (int i = 0; i < thumb_relocator->relocator_insn_size && i < ZZ_MAX_RELOCATED_INSN_COUNT; i++) {
+            ZzARMRelocatorInstruction *relocator_insn = &thumb_relocator->relocator_insns[i];
+            entry->relocated_offsets[i].origin_offset = relocator_insn->origin_insn->pc - thumb_relocator->input->start_pc;
+            entry->relocated_offsets[i].relocated_offset =
+                    relocator_insn->relocated_insns[0]->pc - thumb_relocator->output->start_pc;
+            entry->relocated_offset_count++;
+        }
+
         if (entry->hook_type == HOOK_TYPE_ONE_INSTRUCTION) {
             ZzARMRelocatorInstruction relocator_insn = thumb_relocator->relocator_insns[1];
             entry->next_insn_addr =
@@ -441,6 +468,16 @@ ZZSTATUS ZzBuildInvokeTrampoline(ZzInterceptorBackend *self, ZzHookFunctionEntry
         else
             return ZZ_FAILED;
 
+        // record where every prologue instruction is relocated to, for the pc fixup of the safe patch.
+        entry->relocated_offset_count = 0;
+        for (int i = 0; i < arm_relocator->relocator_insn_size && i < ZZ_MAX_RELOCATED_INSN_COUNT; i++) {
+            ZzARMRelocatorInstruction *relocator_insn = &arm_relocator->relocator_insns[i];
+            entry->relocated_offsets[i].origin_offset = relocator_insn->origin_insn->pc - arm_relocator->input->start_pc;
+            entry->relocated_offsets[i].relocated_offset =
+                    relocator_insn->relocated_insns[0]->pc - arm_relocator->output->start_pc;
+            entry->relocated_offset_count++;
+        }
+
         //
         if (entry->hook_type == HOOK_TYPE_ONE_INSTRUCTION) {
             ZzARMRelocatorInstruction relocator_insn = arm_relocator->relocator_insns[1];
@@ -526,6 +563,7 @@ ZZSTATUS ZzBuildInsnLeaveTrampoline(ZzInterceptorBackend *self, ZzHookFunctionEn
     return status;
 }
 
+// the entry is popped from the shadow stack, so the leave trampoline only passes the shared thread local key.
 ZZSTATUS ZzBuildLeaveTrampoline(ZzInterceptorBackend *self, ZzHookFunctionEntry *entry) {
     char temp_code_slice[256] = {0};
     ZzCodeSlice *code_slice = NULL;
@@ -533,14 +571,17 @@ ZZSTATUS ZzBuildLeaveTrampoline(ZzInterceptorBackend *self, ZzHookFunctionEntry
     bool is_thumb = TRUE;
     ZzARMAssemblerWriter *thumb_writer;
 
+    if (self->leave_trampoline)
+        return ZZ_DONE;
+
     thumb_writer = &self->thumb_writer;
     zz_thumb_writer_reset(thumb_writer, temp_code_slice, 0);
 
-    // prepare 2 stack space: 1. next_hop 2. entry arg
+    // prepare 2 stack space: 1. next_hop 2. thread local key arg
     zz_thumb_writer_put_sub_reg_imm(thumb_writer, ZZ_ARM_REG_SP, 0xc);
     zz_thumb_writer_put_str_reg_reg_offset(thumb_writer, ZZ_ARM_REG_R1, ZZ_ARM_REG_SP,
                                            0x0); // push r7
-    zz_thumb_writer_put_ldr_b_reg_address(thumb_writer, ZZ_ARM_REG_R1, (zz_addr_t) entry);
+    zz_thumb_writer_put_ldr_b_reg_address(thumb_writer, ZZ_ARM_REG_R1, (zz_addr_t) entry->thread_local_key);
     zz_thumb_writer_put_str_reg_reg_offset(thumb_writer, ZZ_ARM_REG_R1, ZZ_ARM_REG_SP, 0x4);
     zz_thumb_writer_put_ldr_reg_reg_offset(thumb_writer, ZZ_ARM_REG_R1, ZZ_ARM_REG_SP,
                                            0x0); // pop r7
@@ -551,7 +592,7 @@ ZZSTATUS ZzBuildLeaveTrampoline(ZzInterceptorBackend *self, ZzHookFunctionEntry
 
     code_slice = zz_thumb_code_patch(thumb_writer, self->allocator, 0, 0);
     if (code_slice)
-        entry->on_leave_trampoline = code_slice->data + 1;
+        self->leave_trampoline = code_slice->data + 1;
     else
         return ZZ_FAILED;
 
@@ -560,7 +601,7 @@ ZZSTATUS ZzBuildLeaveTrampoline(ZzInterceptorBackend *self, ZzHookFunctionEntry
         char buffer[1024] = {};
         sprintf(buffer + strlen(buffer), "%s\n", "ZzBuildLeaveTrampoline:");
         sprintf(buffer + strlen(buffer),
-                "LogInfo: on_leave_trampoline at %p, length: %ld. and will jump to leave_thunk(%p).\n",
+                "LogInfo: leave_trampoline at %p, length: %ld. and will jump to leave_thunk(%p).\n",
                 code_slice->data, code_slice->size, self->leave_thunk);
         HookZzDebugInfoLog("%s", buffer);
     }
@@ -569,7 +610,7 @@ ZZSTATUS ZzBuildLeaveTrampoline(ZzInterceptorBackend *self, ZzHookFunctionEntry
     return ZZ_DONE;
 }
 
-ZZSTATUS ZzActivateTrampoline(ZzInterceptorBackend *self, ZzHookFunctionEntry *entry) {
+ZZSTATUS ZzBuildRedirectCode(ZzInterceptorBackend *self, ZzHookFunctionEntry *entry, FunctionBackup *redirect_code) {
     char temp_code_slice[256] = {0};
     ZzCodeSlice *code_slice = NULL;
     ZzARMHookFunctionEntryBackend *entry_backend = (ZzARMHookFunctionEntryBackend *) entry->backend;
@@ -613,9 +654,8 @@ ZZSTATUS ZzActivateTrampoline(ZzInterceptorBackend *self, ZzHookFunctionEntry *e
                                                     (zz_addr_t) entry->on_enter_trampoline);
             }
         }
-        if (!ZzMemoryPatchCode((zz_addr_t) target_addr, (zz_ptr_t) thumb_writer->w_start_address,
-                               thumb_writer->size))
-            return ZZ_FAILED;
+        redirect_code->size = thumb_writer->size;
+        memcpy(redirect_code->data, (zz_ptr_t) thumb_writer->w_start_address, thumb_writer->size);
 //        zz_thumb_writer_free(thumb_writer);
     } else {
         ZzARMAssemblerWriter *arm_writer;
@@ -641,11 +681,46 @@ ZZSTATUS ZzActivateTrampoline(ZzInterceptorBackend *self, ZzHookFunctionEntry *e
                                                   (zz_addr_t) entry->on_enter_trampoline);
             }
         }
-        if (!ZzMemoryPatchCode((zz_addr_t) target_addr, (zz_ptr_t) arm_writer->w_start_address,
-                               arm_writer->size))
-            return ZZ_FAILED;
+        redirect_code->size = arm_writer->size;
+        memcpy(redirect_code->data, (zz_ptr_t) arm_writer->w_start_address, arm_writer->size);
 //        zz_arm_writer_free(arm_writer);
     }
 
+    redirect_code->address = (zz_ptr_t) target_addr;
+    return ZZ_DONE_HOOK;
+}
+
+// no lazy stub on arm/thumb by design, ZzBuildHook builds the trampolines eagerly instead
+ZZSTATUS ZzBuildLazyTrampoline(ZzInterceptorBackend *self, ZzHookFunctionEntry *entry) { return ZZ_FAILED; }
+
+ZZSTATUS ZzBuildSharedDispatchTrampoline(ZzInterceptorBackend *self, ZzHookFunctionEntry *entry) { return ZZ_FAILED; }
+
+ZZSTATUS ZzRelocateHotTrampoline(ZzInterceptorBackend *self, ZzHookFunctionEntry *entry) { return ZZ_FAILED; }
+
+ZZSTATUS ZzBuildBlockTranslationTrampoline(ZzInterceptorBackend *self, ZzHookFunctionEntry *entry) { return ZZ_FAILED; }
+
+ZZSTATUS ZzBuildCounterTrampoline(ZzInterceptorBackend *self, ZzHookFunctionEntry *entry) { return ZZ_FAILED; }
+
+ZZSTATUS ZzBypassEnterTrampoline(ZzInterceptorBackend *self, ZzHookFunctionEntry *entry) { return ZZ_FAILED; }
+
+zz_size_t ZzBuildCallSiteRedirects(ZzInterceptorBackend *self, struct _ZzCallSiteHook *hook,
+                                   ZzModuleFunction *functions, zz_size_t count) {
+    return 0;
+}
+
+ZZSTATUS ZzBuildSolidifyTrampoline(ZzInterceptorBackend *self, ZzHookFunctionEntry *entry, uint64_t *enter_thunk_slot) {
+    return ZZ_FAILED;
+}
+
+ZZSTATUS ZzActivateTrampoline(ZzInterceptorBackend *self, ZzHookFunctionEntry *entry) {
+    FunctionBackup redirect_code;
+
+    if (ZzBuildRedirectCode(self, entry, &redirect_code) == ZZ_FAILED)
+        return ZZ_FAILED;
+    // a single aligned instruction (tiny redirect) is published with one atomic store.
+    if (ZzMemoryPatchCodeAtomic((zz_addr_t)redirect_code.address, (zz_ptr_t)redirect_code.data, redirect_code.size))
+        return ZZ_DONE_HOOK;
+    if (!ZzMemoryPatchCode((zz_addr_t)redirect_code.address, (zz_ptr_t)redirect_code.data, redirect_code.size))
+        return ZZ_FAILED;
     return ZZ_DONE_HOOK;
 }
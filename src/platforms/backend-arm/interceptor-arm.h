@@ -30,6 +30,8 @@ typedef struct _ZzInterceptorBackend {
     zz_ptr_t insn_leave_thunk;
     zz_ptr_t leave_thunk;
     zz_ptr_t dynamic_binary_instrumentation_thunk;
+    // return address of every pre/post call, built with the first entry
+    zz_ptr_t leave_trampoline;
 
 } ZzInterceptorBackend;
 
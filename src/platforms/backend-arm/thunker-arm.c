@@ -1,5 +1,6 @@
 #include "thunker-arm.h"
 #include "backend-arm-helper.h"
+#include "coverage.h"
 
 // 前提: arm 可以直接访问 pc 寄存器, 也就是说无需中间寄存器就可以实现 `abs
 // jump`.
@@ -73,23 +74,18 @@ void function_context_begin_invocation(ZzHookFunctionEntry *entry, zz_ptr_t next
                                        zz_ptr_t caller_ret_addr) {
 
     ZZ_DEBUG_LOG("target %p call begin-invocation", entry->target_ptr);
+    __atomic_fetch_add(&entry->hit_count, 1, __ATOMIC_RELAXED);
 
     ZzThreadStack *threadstack = ZzGetCurrentThreadStack(entry->thread_local_key);
     if (!threadstack) {
         threadstack = ZzNewThreadStack(entry->thread_local_key);
     }
     ZzCallStack *callstack = ZzNewCallStack();
+    callstack->entry       = entry;
     ZzPushCallStack(threadstack, callstack);
 
-    /* call pre_call */
-    if (entry->pre_call) {
-        PRECALL pre_call;
-        HookEntryInfo entry_info;
-        entry_info.hook_id      = entry->id;
-        entry_info.hook_address = entry->target_ptr;
-        pre_call                = entry->pre_call;
-        (*pre_call)(rs, (ThreadStack *)threadstack, (CallStack *)callstack, (const HookEntryInfo *)&entry_info);
-    }
+    /* call pre_call of each listener */
+    ZzDispatchPreCall(entry, rs, threadstack, callstack);
 
     /* set next hop */
     if (entry->replace_call) {
@@ -98,9 +94,14 @@ void function_context_begin_invocation(ZzHookFunctionEntry *entry, zz_ptr_t next
         *(zz_ptr_t *)next_hop = entry->on_invoke_trampoline;
     }
 
-    if (entry->hook_type == HOOK_TYPE_FUNCTION_via_PRE_POST) {
+    // every hook returns through the shared leave trampoline, the callstack knows the entry
+    if (entry->hook_type == HOOK_TYPE_FUNCTION_via_PRE_POST || entry->hook_type == HOOK_TYPE_FUNCTION_via_GOT ||
+        entry->hook_type == HOOK_TYPE_FUNCTION_via_CALL_SITE) {
         callstack->caller_ret_addr   = *(zz_ptr_t *)caller_ret_addr;
-        *(zz_ptr_t *)caller_ret_addr = entry->on_leave_trampoline;
+        *(zz_ptr_t *)caller_ret_addr = ((ZzInterceptorBackend *)entry->interceptor->backend)->leave_trampoline;
+    } else if (entry->hook_type != HOOK_TYPE_ONE_INSTRUCTION) {
+        // no post call, the insn hook has its own in insn_context_end_invocation
+        ZzReleaseHookListeners(entry, callstack);
     }
 
 }
@@ -117,14 +118,8 @@ void insn_context_end_invocation(ZzHookFunctionEntry *entry, zz_ptr_t next_hop,
     }
     ZzCallStack *callstack = ZzPopCallStack(threadstack);
 
-    if (entry->post_call) {
-        POSTCALL post_call;
-        HookEntryInfo entry_info;
-        entry_info.hook_id      = entry->id;
-        entry_info.hook_address = entry->target_ptr;
-        post_call               = entry->post_call;
-        (*post_call)(rs, (ThreadStack *)threadstack, (CallStack *)callstack, (const HookEntryInfo *)&entry_info);
-    }
+    /* call post_call of each listener */
+    ZzDispatchPostCall(entry, rs, threadstack, callstack);
 
     // set next hop
     *(zz_ptr_t *)next_hop = (zz_ptr_t)entry->next_insn_addr;
@@ -134,8 +129,11 @@ void insn_context_end_invocation(ZzHookFunctionEntry *entry, zz_ptr_t next_hop,
 
 void dynamic_binary_instrumentation_invocation(ZzHookFunctionEntry *entry, zz_ptr_t next_hop, RegState *rs) {
 
-    /* call pre_call */
-    if (entry->pre_call) {
+    if (entry->hook_type == HOOK_TYPE_ONE_SHOT)
+        ZzOneShotHitEntry(entry);
+
+    /* call stub_call */
+    if (entry->stub_call) {
         STUBCALL pre_call;
         HookEntryInfo entry_info;
         entry_info.hook_id      = entry->id;
@@ -148,26 +146,21 @@ void dynamic_binary_instrumentation_invocation(ZzHookFunctionEntry *entry, zz_pt
     *(zz_ptr_t *)next_hop = entry->on_invoke_trampoline;
 }
 
-// just like post_call, wow!
-void function_context_end_invocation(ZzHookFunctionEntry *entry, zz_ptr_t next_hop, RegState *rs) {
-    ZZ_DEBUG_LOG("%p call end-invocation", entry->target_ptr);
-
-    ZzThreadStack *threadstack = ZzGetCurrentThreadStack(entry->thread_local_key);
+// just like post_call, wow! the shared leave trampoline passes the thread local key, the entry is the innermost call.
+void function_context_end_invocation(zz_ptr_t thread_local_key, zz_ptr_t next_hop, RegState *rs) {
+    ZzThreadStack *threadstack = ZzGetCurrentThreadStack(thread_local_key);
     if (!threadstack) {
 #if defined(DEBUG_MODE)
         debug_break();
 #endif
     }
-    ZzCallStack *callstack = ZzPopCallStack(threadstack);
+    ZzCallStack *callstack     = ZzPopCallStack(threadstack);
+    ZzHookFunctionEntry *entry = (ZzHookFunctionEntry *)callstack->entry;
 
-    if (entry->post_call) {
-        POSTCALL post_call;
-        HookEntryInfo entry_info;
-        entry_info.hook_id      = entry->id;
-        entry_info.hook_address = entry->target_ptr;
-        post_call               = entry->post_call;
-        (*post_call)(rs, (ThreadStack *)threadstack, (CallStack *)callstack, (const HookEntryInfo *)&entry_info);
-    }
+    ZZ_DEBUG_LOG("%p call end-invocation", entry->target_ptr);
+
+    /* call post_call of each listener */
+    ZzDispatchPostCall(entry, rs, threadstack, callstack);
 
     // set next hop
     *(zz_ptr_t *)next_hop = callstack->caller_ret_addr;
@@ -308,14 +301,14 @@ void zz_thumb_thunker_build_leave_thunk(ZzThumbAssemblerWriter *writer) {
     zz_thumb_writer_put_str_reg_reg_offset(writer, ZZ_ARM_REG_R1, ZZ_ARM_REG_SP, 0x4);
 
     // pass enter func args
-    // entry
+    // thread local key
     zz_thumb_writer_put_ldr_reg_reg_offset(writer, ZZ_ARM_REG_R0, ZZ_ARM_REG_SP, CTX_SAVE_STACK_OFFSET + 0x8);
     // next hop
     zz_thumb_writer_put_add_reg_reg_imm(writer, ZZ_ARM_REG_R1, ZZ_ARM_REG_SP, CTX_SAVE_STACK_OFFSET + 0x8 + 0x4);
     // RegState
     zz_thumb_writer_put_add_reg_reg_imm(writer, ZZ_ARM_REG_R2, ZZ_ARM_REG_SP, 0x4);
 
-    // call function_context_begin_invocation
+    // call function_context_end_invocation
     zz_thumb_writer_put_ldr_b_reg_address(writer, ZZ_ARM_REG_LR, (zz_addr_t)function_context_end_invocation);
     zz_thumb_writer_put_blx_reg(writer, ZZ_ARM_REG_LR);
 
@@ -4,10 +4,47 @@
 
 #include "backend-arm64-helper.h"
 
+// the slice is allocated for the worst case, the code is laid out at its address and the rest given back.
+static ZzCodeSlice *zz_arm64_relax_code_patch(ZzARM64Relocator *relocator, ZzARM64AssemblerWriter *arm64_writer,
+                                              ZzAllocator *allocator, zz_addr_t target_addr, zz_size_t range_size) {
+    char relaxed_code[1024];
+    zz_size_t size_limit    = zz_arm64_writer_relax_size_limit(arm64_writer);
+    ZzCodeSlice *code_slice = NULL;
+    zz_size_t size;
+
+    if (arm64_writer->fixup_overflow) {
+        ZZ_ERROR_LOG("more than %d fixups, can't relax the code!", ZZ_ARM64_MAX_FIXUP_COUNT);
+        return NULL;
+    }
+    if (size_limit > sizeof(relaxed_code))
+        return NULL;
+    if (range_size > 0) {
+        code_slice = ZzNewNearCodeSlice(allocator, target_addr, range_size, size_limit);
+    } else {
+        code_slice = ZzNewCodeSlice(allocator, size_limit);
+    }
+
+    if (!code_slice)
+        return NULL;
+
+    if (relocator)
+        zz_arm64_relocator_relocate_writer(relocator, (zz_addr_t)code_slice->data);
+    size = zz_arm64_writer_relax(arm64_writer, (zz_addr_t)code_slice->data, relaxed_code);
+    ZzShrinkCodeSlice(allocator, code_slice, size);
+
+    if (!ZzAllocatorPatchCode(allocator, (zz_addr_t)code_slice->data, (zz_ptr_t)relaxed_code, size)) {
+        free(code_slice);
+        return NULL;
+    }
+    return code_slice;
+}
 
 ZzCodeSlice *zz_arm64_code_patch(ZzARM64AssemblerWriter *arm64_writer, ZzAllocator *allocator, zz_addr_t target_addr,
                                  zz_size_t range_size) {
     ZzCodeSlice *code_slice = NULL;
+    if (arm64_writer->fixup_count)
+        return zz_arm64_relax_code_patch(NULL, arm64_writer, allocator, target_addr, range_size);
+
     if (range_size > 0) {
         code_slice = ZzNewNearCodeSlice(allocator, target_addr, range_size, arm64_writer->size);
     } else {
@@ -17,7 +54,7 @@ ZzCodeSlice *zz_arm64_code_patch(ZzARM64AssemblerWriter *arm64_writer, ZzAllocat
     if (!code_slice)
         return NULL;
 
-    if (!ZzMemoryPatchCode((zz_addr_t)code_slice->data, (zz_addr_t )arm64_writer->w_start_address, arm64_writer->size)) {
+    if (!ZzAllocatorPatchCode(allocator, (zz_addr_t)code_slice->data, (zz_ptr_t)arm64_writer->w_start_address, arm64_writer->size)) {
         free(code_slice);
         return NULL;
     }
@@ -27,6 +64,9 @@ ZzCodeSlice *zz_arm64_code_patch(ZzARM64AssemblerWriter *arm64_writer, ZzAllocat
 ZzCodeSlice *zz_arm64_relocate_code_patch(ZzARM64Relocator *relocator, ZzARM64AssemblerWriter *arm64_writer,
                                           ZzAllocator *allocator, zz_addr_t target_addr, zz_size_t range_size) {
     ZzCodeSlice *code_slice = NULL;
+    if (arm64_writer->fixup_count)
+        return zz_arm64_relax_code_patch(relocator, arm64_writer, allocator, target_addr, range_size);
+
     if (range_size > 0) {
         code_slice = ZzNewNearCodeSlice(allocator, target_addr, range_size, arm64_writer->size);
     } else {
@@ -38,7 +78,7 @@ ZzCodeSlice *zz_arm64_relocate_code_patch(ZzARM64Relocator *relocator, ZzARM64As
 
     zz_arm64_relocator_relocate_writer(relocator, (zz_addr_t)code_slice->data);
 
-    if (!ZzMemoryPatchCode((zz_addr_t)code_slice->data, (zz_ptr_t )arm64_writer->w_start_address, arm64_writer->size)) {
+    if (!ZzAllocatorPatchCode(allocator, (zz_addr_t)code_slice->data, (zz_ptr_t )arm64_writer->w_start_address, arm64_writer->size)) {
         free(code_slice);
         return NULL;
     }
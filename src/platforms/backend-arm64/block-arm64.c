@@ -0,0 +1,334 @@
+#include "block-arm64.h"
+#include "backend-arm64-helper.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define ZZ_ARM64_BLOCK_TABLE_CAPACITY 256
+
+#define ZZ_ARM64_BLOCK_HASH(address) ((zz_size_t)(((address) >> 2) ^ ((address) >> 14)))
+
+static ZzARM64BlockTable *ZzARM64NewBlockTable(zz_size_t capacity) {
+    ZzARM64BlockTable *table;
+
+    table = (ZzARM64BlockTable *)zz_malloc_with_zero(sizeof(ZzARM64BlockTable) + capacity * sizeof(ZzARM64Block *));
+    if (!table)
+        return NULL;
+    table->capacity = capacity;
+    return table;
+}
+
+ZzARM64BlockCache *ZzARM64NewBlockCache(ZzInterceptorBackend *backend, ZzHookFunctionEntry *entry) {
+    ZzARM64BlockCache *cache = (ZzARM64BlockCache *)zz_malloc_with_zero(sizeof(ZzARM64BlockCache));
+    if (!cache)
+        return NULL;
+
+    cache->table = ZzARM64NewBlockTable(ZZ_ARM64_BLOCK_TABLE_CAPACITY);
+    if (!cache->table) {
+        free(cache);
+        return NULL;
+    }
+    cache->backend     = backend;
+    cache->entry       = entry;
+    cache->range_begin = (zz_addr_t)entry->block_range_begin;
+    cache->range_end   = (zz_addr_t)entry->block_range_end;
+    return cache;
+}
+
+ZzARM64Block *ZzARM64LookupBlock(ZzARM64BlockCache *cache, zz_addr_t address) {
+    ZzARM64BlockTable *table = __atomic_load_n(&cache->table, __ATOMIC_ACQUIRE);
+    zz_size_t mask           = table->capacity - 1;
+    zz_size_t i;
+    ZzARM64Block *block;
+
+    for (i = ZZ_ARM64_BLOCK_HASH(address) & mask;; i = (i + 1) & mask) {
+        block = __atomic_load_n(&table->slots[i], __ATOMIC_ACQUIRE);
+        if (!block || block->address == address)
+            return block;
+    }
+}
+
+static void ZzARM64PutBlock(ZzARM64BlockTable *table, ZzARM64Block *block) {
+    zz_size_t mask = table->capacity - 1;
+    zz_size_t i;
+
+    for (i = ZZ_ARM64_BLOCK_HASH(block->address) & mask; table->slots[i]; i = (i + 1) & mask)
+        ;
+    __atomic_store_n(&table->slots[i], block, __ATOMIC_RELEASE);
+}
+
+static bool ZzARM64InsertBlock(ZzARM64BlockCache *cache, ZzARM64Block *block) {
+    ZzARM64BlockTable *table = cache->table;
+    ZzARM64BlockTable *new_table;
+    zz_size_t i;
+
+    // keep the load factor under 1/2
+    if ((cache->size + 1) * 2 > table->capacity) {
+        new_table = ZzARM64NewBlockTable(table->capacity * 2);
+        if (!new_table)
+            return FALSE;
+        for (i = 0; i < table->capacity; i++) {
+            if (table->slots[i])
+                ZzARM64PutBlock(new_table, table->slots[i]);
+        }
+        new_table->retired_next = table;
+        __atomic_store_n(&cache->table, new_table, __ATOMIC_RELEASE);
+        table = new_table;
+    }
+    ZzARM64PutBlock(table, block);
+    cache->size++;
+    return TRUE;
+}
+
+static bool ZzARM64IsInBlockRange(ZzARM64BlockCache *cache, zz_addr_t address) {
+    return address >= cache->range_begin && address < cache->range_end && !(address & 3);
+}
+
+// near: b destination, far: the literal first, then ldr x17, #8. a running thread sees the old or the new jump.
+static void ZzARM64ChainBlockExit(ZzARM64BlockExit *exit, zz_addr_t destination) {
+    ZzAllocator *allocator = exit->cache->backend->allocator;
+    zz_addr_t distance     = destination > exit->address ? destination - exit->address : exit->address - destination;
+    uint32_t insn;
+
+    if (distance < zz_arm64_writer_near_jump_range_size()) {
+        insn = 0x14000000 | (((destination - exit->address) >> 2) & 0x03ffffff);
+    } else {
+        ZzAllocatorPatchCode(allocator, exit->address + 8, (zz_ptr_t)&destination, sizeof(destination));
+        insn = 0x58000051;
+    }
+    ZzAllocatorPatchCode(allocator, exit->address, (zz_ptr_t)&insn, sizeof(insn));
+}
+
+static void zz_arm64_block_put_exit(ZzARM64BlockCache *cache, ZzARM64Block *block, zz_addr_t target) {
+    ZzARM64AssemblerWriter *arm64_writer = &cache->backend->arm64_writer;
+    ZzARM64BlockExit *exit               = &block->exits[block->exit_count++];
+    zz_addr_t literal                    = 0;
+
+    exit->cache   = cache;
+    exit->target  = target;
+    exit->address = arm64_writer->size;
+
+    zz_arm64_writer_put_b_imm(arm64_writer, 0x10);
+    zz_arm64_writer_put_br_reg(arm64_writer, ZZ_ARM64_REG_X17);
+    zz_arm64_writer_put_bytes(arm64_writer, (char *)&literal, sizeof(literal));
+
+    zz_arm64_writer_put_sub_reg_reg_imm(arm64_writer, ZZ_ARM64_REG_SP, ZZ_ARM64_REG_SP, 2 * 0x8);
+    zz_arm64_writer_put_ldr_b_reg_address(arm64_writer, ZZ_ARM64_REG_X17, (zz_addr_t)exit);
+    zz_arm64_writer_put_str_reg_reg_offset(arm64_writer, ZZ_ARM64_REG_X17, ZZ_ARM64_REG_SP, 0x0);
+    zz_arm64_writer_put_ldr_br_reg_address(arm64_writer, ZZ_ARM64_REG_X17,
+                                           (zz_addr_t)cache->backend->block_translate_thunk);
+}
+
+// the target stays in [sp], the cache goes to the next hop slot
+static void zz_arm64_block_put_indirect_exit(ZzARM64BlockCache *cache, ZzARM64Reg reg) {
+    ZzARM64AssemblerWriter *arm64_writer = &cache->backend->arm64_writer;
+
+    zz_arm64_writer_put_sub_reg_reg_imm(arm64_writer, ZZ_ARM64_REG_SP, ZZ_ARM64_REG_SP, 2 * 0x8);
+    zz_arm64_writer_put_str_reg_reg_offset(arm64_writer, reg, ZZ_ARM64_REG_SP, 0x0);
+    zz_arm64_writer_put_ldr_b_reg_address(arm64_writer, ZZ_ARM64_REG_X17, (zz_addr_t)cache);
+    zz_arm64_writer_put_str_reg_reg_offset(arm64_writer, ZZ_ARM64_REG_X17, ZZ_ARM64_REG_SP, 0x8);
+    zz_arm64_writer_put_ldr_br_reg_address(arm64_writer, ZZ_ARM64_REG_X17,
+                                           (zz_addr_t)cache->backend->block_indirect_thunk);
+}
+
+// the branch of the block tail, the taken exit follows the fall through one
+static void zz_arm64_block_put_tail(ZzARM64BlockCache *cache, ZzARM64Block *block, ARM64InsnType type,
+                                    ZzARM64Instruction *insn_ctx) {
+    ZzARM64AssemblerWriter *arm64_writer = &cache->backend->arm64_writer;
+    uint32_t insn                        = insn_ctx->insn;
+    uint32_t skip                        = (4 + ZZ_ARM64_BLOCK_EXIT_SIZE) >> 2;
+    zz_addr_t next_pc                    = insn_ctx->pc + insn_ctx->size;
+    int Rn_ndx                           = get_insn_sub(insn, 5, 5);
+
+    switch (type) {
+    case ARM64_INS_B:
+        zz_arm64_block_put_exit(cache, block, insn_ctx->pc + sign_extend((uint64_t)get_insn_sub(insn, 0, 26) << 2, 28));
+        break;
+    case ARM64_INS_BL:
+        // the callee returns to the fall through exit
+        zz_arm64_writer_put_instruction(arm64_writer, 0x94000000 | skip);
+        zz_arm64_block_put_exit(cache, block, next_pc);
+        zz_arm64_block_put_exit(cache, block, insn_ctx->pc + sign_extend((uint64_t)get_insn_sub(insn, 0, 26) << 2, 28));
+        break;
+    case ARM64_INS_B_cond:
+    case ARM64_INS_CBZ_CBNZ:
+        zz_arm64_writer_put_instruction(arm64_writer, (insn & 0xff00001f) | skip << 5);
+        zz_arm64_block_put_exit(cache, block, next_pc);
+        zz_arm64_block_put_exit(cache, block, insn_ctx->pc + sign_extend((uint64_t)get_insn_sub(insn, 5, 19) << 2, 21));
+        break;
+    case ARM64_INS_TBZ_TBNZ:
+        zz_arm64_writer_put_instruction(arm64_writer, (insn & 0xfff8001f) | skip << 5);
+        zz_arm64_block_put_exit(cache, block, next_pc);
+        zz_arm64_block_put_exit(cache, block, insn_ctx->pc + sign_extend((uint64_t)get_insn_sub(insn, 5, 14) << 2, 16));
+        break;
+    case ARM64_INS_BR:
+        zz_arm64_block_put_indirect_exit(cache, (ZzARM64Reg)Rn_ndx);
+        break;
+    case ARM64_INS_BLR:
+        // mov x17, xn, the bl overwrites x30
+        zz_arm64_writer_put_instruction(arm64_writer, 0xaa0003f1 | Rn_ndx << 16);
+        zz_arm64_writer_put_instruction(arm64_writer, 0x94000000 | skip);
+        zz_arm64_block_put_exit(cache, block, next_pc);
+        zz_arm64_block_put_indirect_exit(cache, ZZ_ARM64_REG_X17);
+        break;
+    case ARM64_INS_RET:
+        zz_arm64_writer_put_instruction(arm64_writer, insn);
+        break;
+    default:
+        // too long or the end of the range
+        zz_arm64_block_put_exit(cache, block, next_pc);
+        break;
+    }
+}
+
+static bool ZzARM64IsBlockTail(ARM64InsnType type) {
+    switch (type) {
+    case ARM64_INS_B:
+    case ARM64_INS_BL:
+    case ARM64_INS_B_cond:
+    case ARM64_INS_CBZ_CBNZ:
+    case ARM64_INS_TBZ_TBNZ:
+    case ARM64_INS_BR:
+    case ARM64_INS_BLR:
+    case ARM64_INS_RET:
+        return TRUE;
+    default:
+        return FALSE;
+    }
+}
+
+ZzARM64Block *ZzARM64TranslateBlock(ZzARM64BlockCache *cache, zz_addr_t address) {
+    char temp_code_slice[ZZ_ARM64_BLOCK_MAX_CODE_SIZE] = {0};
+    uint32_t guest_code[ZZ_ARM64_BLOCK_MAX_INSN_COUNT];
+    ZzInterceptorBackend *self           = cache->backend;
+    ZzARM64AssemblerWriter *arm64_writer = &self->arm64_writer;
+    ZzARM64Reader *arm64_reader          = &self->arm64_reader;
+    ZzARM64Relocator *arm64_relocator    = &self->arm64_relocator;
+    FunctionBackup *origin_prologue      = &cache->entry->origin_prologue;
+    ARM64InsnType type                   = ARM64_UNDEF;
+    zz_addr_t overlap_begin, overlap_end;
+    zz_size_t guest_size, body_offset, i;
+    ZzARM64Instruction insn_ctx;
+    ZzCodeSlice *code_slice;
+    ZzARM64Block *block, *target_block;
+
+    block = ZzARM64LookupBlock(cache, address);
+    if (block || !ZzARM64IsInBlockRange(cache, address) || cache->range_end - address < 4)
+        return block;
+
+    // copy the guest code, the patched prologue of the entry reads from its backup
+    guest_size = cache->range_end - address;
+    if (guest_size > sizeof(guest_code))
+        guest_size = sizeof(guest_code);
+    guest_size &= ~(zz_size_t)3;
+    memcpy(guest_code, (zz_ptr_t)address, guest_size);
+    overlap_begin = (zz_addr_t)origin_prologue->address > address ? (zz_addr_t)origin_prologue->address : address;
+    overlap_end   = (zz_addr_t)origin_prologue->address + origin_prologue->size;
+    if (overlap_end > address + guest_size)
+        overlap_end = address + guest_size;
+    if (overlap_begin < overlap_end)
+        memcpy((char *)guest_code + (overlap_begin - address),
+               origin_prologue->data + (overlap_begin - (zz_addr_t)origin_prologue->address), overlap_end - overlap_begin);
+
+    block = (ZzARM64Block *)zz_malloc_with_zero(sizeof(ZzARM64Block));
+    if (!block)
+        return NULL;
+    block->address = address;
+    block->cache   = cache;
+
+    zz_arm64_writer_reset(arm64_writer, temp_code_slice, 0);
+    zz_arm64_reader_reset(arm64_reader, (zz_ptr_t)guest_code);
+    arm64_reader->start_pc   = address;
+    arm64_reader->current_pc = address;
+    zz_arm64_relocator_reset(arm64_relocator, arm64_reader, arm64_writer);
+
+    // head: call the callback through the block thunk, it comes back to the body
+    if (cache->entry->stub_call) {
+        zz_arm64_writer_put_sub_reg_reg_imm(arm64_writer, ZZ_ARM64_REG_SP, ZZ_ARM64_REG_SP, 2 * 0x8);
+        zz_arm64_writer_put_ldr_b_reg_address(arm64_writer, ZZ_ARM64_REG_X17, (zz_addr_t)block);
+        zz_arm64_writer_put_str_reg_reg_offset(arm64_writer, ZZ_ARM64_REG_X17, ZZ_ARM64_REG_SP, 0x0);
+        zz_arm64_writer_put_ldr_br_reg_address(arm64_writer, ZZ_ARM64_REG_X17, (zz_addr_t)self->block_thunk);
+    }
+    body_offset = arm64_writer->size;
+
+    // the pc relative instructions are rewritten by the relocator, the branches end the block
+    for (i = 0; i < ZZ_ARM64_BLOCK_MAX_INSN_COUNT && arm64_reader->size < guest_size; i++) {
+        zz_arm64_relocator_read_one(arm64_relocator, &insn_ctx);
+        type = GetARM64InsnType(insn_ctx.insn);
+        if (ZzARM64IsBlockTail(type))
+            break;
+        type = ARM64_UNDEF;
+        zz_arm64_relocator_write_one(arm64_relocator);
+    }
+    zz_arm64_block_put_tail(cache, block, type, &insn_ctx);
+
+    code_slice = zz_arm64_code_patch(arm64_writer, self->allocator, 0, 0);
+    if (!code_slice) {
+        free(block);
+        return NULL;
+    }
+    block->code = code_slice->data;
+    block->body = (zz_ptr_t)((zz_addr_t)code_slice->data + body_offset);
+    for (i = 0; i < block->exit_count; i++)
+        block->exits[i].address += (zz_addr_t)code_slice->data;
+    free(code_slice);
+
+    // if it can't be indexed, the next exit to the address translates it again
+    ZzARM64InsertBlock(cache, block);
+
+    // the exits to a translated block or out of the range are chained right away
+    for (i = 0; i < block->exit_count; i++) {
+        target_block = ZzARM64LookupBlock(cache, block->exits[i].target);
+        if (target_block)
+            ZzARM64ChainBlockExit(&block->exits[i], (zz_addr_t)target_block->code);
+        else if (!ZzARM64IsInBlockRange(cache, block->exits[i].target))
+            ZzARM64ChainBlockExit(&block->exits[i], block->exits[i].target);
+    }
+
+    if (HookZzDebugInfoIsEnable()) {
+        HookZzDebugInfoLog("ZzARM64TranslateBlock: block %p translated at %p, exits %ld.", (zz_ptr_t)address,
+                           block->code, (long)block->exit_count);
+    }
+    return block;
+}
+
+void block_context_begin_invocation(ZzARM64Block *block, zz_ptr_t next_hop, RegState *rs, zz_ptr_t caller_ret_addr) {
+    ZzHookFunctionEntry *entry = block->cache->entry;
+    HookEntryInfo entry_info;
+    STUBCALL stub_call;
+
+    entry_info.hook_id      = entry->id;
+    entry_info.hook_address = (zz_ptr_t)block->address;
+    stub_call               = (STUBCALL)entry->stub_call;
+    (*stub_call)(rs, (const HookEntryInfo *)&entry_info);
+
+    *(zz_ptr_t *)next_hop = block->body;
+}
+
+void block_context_translate_invocation(ZzARM64BlockExit *exit, zz_ptr_t next_hop, RegState *rs,
+                                        zz_ptr_t caller_ret_addr) {
+    zz_addr_t destination = exit->target;
+    ZzARM64Block *block;
+
+    ZzMaterializeLock();
+    block = ZzARM64TranslateBlock(exit->cache, exit->target);
+    if (block)
+        destination = (zz_addr_t)block->code;
+    // a failed translation leaves the cache for good at this exit
+    ZzARM64ChainBlockExit(exit, destination);
+    ZzMaterializeUnlock();
+
+    *(zz_ptr_t *)next_hop = (zz_ptr_t)destination;
+}
+
+void block_context_indirect_invocation(zz_addr_t target, zz_ptr_t next_hop, RegState *rs, zz_ptr_t caller_ret_addr) {
+    ZzARM64BlockCache *cache = *(ZzARM64BlockCache **)next_hop;
+    ZzARM64Block *block      = ZzARM64LookupBlock(cache, target);
+
+    if (!block && ZzARM64IsInBlockRange(cache, target)) {
+        ZzMaterializeLock();
+        block = ZzARM64TranslateBlock(cache, target);
+        ZzMaterializeUnlock();
+    }
+
+    *(zz_ptr_t *)next_hop = block ? block->code : (zz_ptr_t)target;
+}
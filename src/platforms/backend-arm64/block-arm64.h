@@ -0,0 +1,74 @@
+#ifndef platforms_backend_arm64_block_arm64
+#define platforms_backend_arm64_block_arm64
+
+#include "hookzz.h"
+#include "kitzz.h"
+
+#include "interceptor-arm64.h"
+
+// block dbi: the basic blocks of [range_begin, range_end) reached from the entry are translated into the code cache.
+// a block runs the callback at its head, the direct branches of its tail go through exits chained to the translated
+// target on first use, the indirect branches look the target up in the block table. `ret` is left as is, a call
+// made from the cache returns into it. x17 is the scratch register of the translated code.
+
+#define ZZ_ARM64_BLOCK_MAX_INSN_COUNT 64
+
+#define ZZ_ARM64_BLOCK_MAX_CODE_SIZE 2048
+
+// + 0: b +16, chained: b block (near) or ldr x17, #8 (far)
+// + 4: br x17
+// + 8: .quad block (far)
+// +16: the translate stub, sub sp, sp, #16; ldr x17, =exit; str x17, [sp]; ldr x17, =translate thunk; br x17
+#define ZZ_ARM64_BLOCK_EXIT_SIZE 56
+
+struct _ZzARM64BlockCache;
+
+typedef struct _ZzARM64BlockExit {
+    struct _ZzARM64BlockCache *cache;
+    zz_addr_t target;
+    zz_addr_t address;
+} ZzARM64BlockExit;
+
+typedef struct _ZzARM64Block {
+    zz_addr_t address;
+    zz_ptr_t code;
+    zz_ptr_t body; // past the callback
+    struct _ZzARM64BlockCache *cache;
+    ZzARM64BlockExit exits[2];
+    zz_size_t exit_count;
+} ZzARM64Block;
+
+// open addressing, a lookup runs without the lock. a grown table is published with a release store, the old one is
+// kept in the retired list, a lookup may still probe it.
+typedef struct _ZzARM64BlockTable {
+    zz_size_t capacity;
+    struct _ZzARM64BlockTable *retired_next;
+    ZzARM64Block *slots[];
+} ZzARM64BlockTable;
+
+typedef struct _ZzARM64BlockCache {
+    ZzInterceptorBackend *backend;
+    ZzHookFunctionEntry *entry;
+    zz_addr_t range_begin;
+    zz_addr_t range_end;
+    ZzARM64BlockTable *table;
+    zz_size_t size;
+} ZzARM64BlockCache;
+
+ZzARM64BlockCache *ZzARM64NewBlockCache(ZzInterceptorBackend *backend, ZzHookFunctionEntry *entry);
+
+// the materialize lock is held
+ZzARM64Block *ZzARM64TranslateBlock(ZzARM64BlockCache *cache, zz_addr_t address);
+
+ZzARM64Block *ZzARM64LookupBlock(ZzARM64BlockCache *cache, zz_addr_t address);
+
+// the invocations of the block thunks, the stub has stored the block, the exit or the indirect target in [sp]
+void block_context_begin_invocation(ZzARM64Block *block, zz_ptr_t next_hop, RegState *rs, zz_ptr_t caller_ret_addr);
+
+void block_context_translate_invocation(ZzARM64BlockExit *exit, zz_ptr_t next_hop, RegState *rs,
+                                        zz_ptr_t caller_ret_addr);
+
+// the cache is in the next hop slot
+void block_context_indirect_invocation(zz_addr_t target, zz_ptr_t next_hop, RegState *rs, zz_ptr_t caller_ret_addr);
+
+#endif
@@ -0,0 +1,147 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "backend-arm64-helper.h"
+#include "callsite.h"
+#include "interceptor-arm64.h"
+#include "trampoline.h"
+
+#include <dlfcn.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int zz_arm64_function_compare(const void *key, const void *item) {
+    zz_addr_t address = *(const zz_addr_t *)key;
+    if (address < ((const ZzModuleFunction *)item)->address)
+        return -1;
+    return address > ((const ZzModuleFunction *)item)->address;
+}
+
+// a plt (elf) or stubs (macho) entry, `adrp xn, page; ldr xt, [xn, #off]; (add xn, xn, #off;) br xt`, the bound target
+// in its slot. a lazily bound one still points to the resolver.
+static zz_addr_t zz_arm64_resolve_stub(zz_addr_t stub) {
+    uint32_t *insns = (uint32_t *)stub;
+    uint32_t adrp, ldr, br;
+    zz_addr_t page;
+    Dl_info info;
+
+    // a `bl` decoded from data may point anywhere
+    if (!dladdr((void *)stub, &info))
+        return 0;
+
+    adrp = insns[0];
+    ldr  = insns[1];
+    if (GetARM64InsnType(adrp) != ARM64_INS_ADRP)
+        return 0;
+    // ldr xt, [xn, #imm], unsigned offset
+    if ((ldr & 0xffc00000) != 0xf9400000 || get_insn_sub(ldr, 5, 5) != get_insn_sub(adrp, 0, 5))
+        return 0;
+    br = 0xd61f0000 | get_insn_sub(ldr, 0, 5) << 5;
+    if (insns[2] != br && insns[3] != br)
+        return 0;
+
+    page = (stub & ~(zz_addr_t)0xfff) +
+           sign_extend(((uint64_t)get_insn_sub(adrp, 5, 19) << 2 | get_insn_sub(adrp, 29, 2)) << 12, 33);
+    return *(zz_addr_t *)(page + get_insn_sub(ldr, 10, 12) * 8);
+}
+
+typedef struct _ZzARM64VeneerSet {
+    zz_addr_t *veneers;
+    zz_size_t size;
+    zz_size_t capacity;
+} ZzARM64VeneerSet;
+
+// `ldr x17, #8; br x17; .quad destination` near the call site, x16/x17 may be clobbered across a call.
+static zz_addr_t zz_arm64_call_site_veneer(ZzInterceptorBackend *self, zz_addr_t site, zz_addr_t destination,
+                                           ZzARM64VeneerSet *set) {
+    char temp_code_slice[64]             = {0};
+    ZzARM64AssemblerWriter *arm64_writer = &self->arm64_writer;
+    zz_size_t range                      = zz_arm64_writer_near_jump_range_size();
+    ZzCodeSlice *code_slice;
+    zz_addr_t veneer;
+    zz_size_t i;
+
+    for (i = 0; i < set->size; i++) {
+        if ((set->veneers[i] > site ? set->veneers[i] - site : site - set->veneers[i]) < range)
+            return set->veneers[i];
+    }
+    if (set->size >= set->capacity) {
+        zz_size_t capacity  = set->capacity ? set->capacity * 2 : 16;
+        zz_addr_t *veneers = (zz_addr_t *)realloc(set->veneers, sizeof(zz_addr_t) * capacity);
+        if (!veneers)
+            return 0;
+        set->veneers  = veneers;
+        set->capacity = capacity;
+    }
+
+    zz_arm64_writer_reset(arm64_writer, temp_code_slice, 0);
+    zz_arm64_writer_put_ldr_br_reg_address(arm64_writer, ZZ_ARM64_REG_X17, destination);
+    code_slice = zz_arm64_code_patch(arm64_writer, self->allocator, site, range);
+    if (!code_slice)
+        return 0;
+    veneer = (zz_addr_t)code_slice->data;
+    free(code_slice);
+
+    set->veneers[set->size++] = veneer;
+    return veneer;
+}
+
+zz_size_t ZzBuildCallSiteRedirects(ZzInterceptorBackend *self, ZzCallSiteHook *hook, ZzModuleFunction *functions,
+                                   zz_size_t count) {
+    ZzARM64Reader *arm64_reader = &self->arm64_reader;
+    zz_addr_t target            = (zz_addr_t)hook->target_ptr;
+    ZzARM64VeneerSet veneer_set = {0};
+    zz_addr_t stub = 0, call_target, branch_target;
+    zz_size_t site_count = 0, i;
+    ZzARM64Instruction *insn_ctx;
+    ZzCallSite *site;
+    uint32_t insn;
+
+    for (i = 0; i < count; i++) {
+        zz_addr_t end = functions[i].address + functions[i].size;
+
+        zz_arm64_reader_reset(arm64_reader, (zz_ptr_t)functions[i].address);
+        while (arm64_reader->r_current_address + 4 <= end) {
+            insn_ctx = zz_arm64_reader_read_one_instruction(arm64_reader);
+            if (GetARM64InsnType(insn_ctx->insn) != ARM64_INS_BL)
+                continue;
+
+            call_target = insn_ctx->pc + sign_extend((uint64_t)get_insn_sub(insn_ctx->insn, 0, 26) << 2, 28);
+            // a function of the module is not a stub, most calls stop here
+            if (call_target != target && call_target != stub) {
+                if (bsearch(&call_target, functions, count, sizeof(ZzModuleFunction), zz_arm64_function_compare))
+                    continue;
+                if (zz_arm64_resolve_stub(call_target) != target)
+                    continue;
+                stub = call_target;
+            }
+
+            branch_target = (zz_addr_t)hook->destination;
+            if ((branch_target > insn_ctx->pc ? branch_target - insn_ctx->pc : insn_ctx->pc - branch_target) >=
+                zz_arm64_writer_near_jump_range_size()) {
+                branch_target =
+                    zz_arm64_call_site_veneer(self, insn_ctx->pc, (zz_addr_t)hook->destination, &veneer_set);
+                if (!branch_target) {
+                    HookZzDebugInfoLog("no veneer in range of the call site %p", (void *)insn_ctx->pc);
+                    hook->missed_count++;
+                    continue;
+                }
+            }
+
+            site = ZzAddCallSite(hook);
+            if (!site) {
+                free(veneer_set.veneers);
+                return site_count;
+            }
+            insn          = 0x94000000 | (((branch_target - insn_ctx->pc) >> 2) & 0x03ffffff);
+            site->address = insn_ctx->pc;
+            site->size    = 4;
+            memcpy(site->origin_insn, &insn_ctx->insn, 4);
+            memcpy(site->redirect_insn, &insn, 4);
+            site_count++;
+        }
+    }
+    free(veneer_set.veneers);
+    return site_count;
+}
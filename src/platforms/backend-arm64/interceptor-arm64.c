@@ -1,13 +1,14 @@
 #include "interceptor-arm64.h"
 #include "backend-arm64-helper.h"
+#include "block-arm64.h"
+#include "hookplan.h"
 #include "thunker-arm64.h"
+#include "trampolinecache.h"
 
+#include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
 
-#define ZZ_ARM64_TINY_REDIRECT_SIZE 4
-#define ZZ_ARM64_FULL_REDIRECT_SIZE 16
-
 ZzInterceptorBackend *ZzBuildInteceptorBackend(ZzAllocator *allocator) {
     if (!ZzMemoryIsSupportAllocateRXPage()) {
         ZZ_DEBUG_LOG_STR("memory is not support allocate r-x Page!");
@@ -41,52 +42,137 @@ ZzInterceptorBackend *ZzBuildInteceptorBackend(ZzAllocator *allocator) {
 
 
 ZZSTATUS ZzFreeTrampoline(ZzHookFunctionEntry *entry) {
-    if (entry->on_invoke_trampoline) {
-        //TODO
+    ZzAllocator *allocator = entry->interceptor->allocator;
+    zz_ptr_t trampolines[] = {entry->on_enter_transfer_trampoline, entry->on_enter_trampoline,
+                              entry->on_insn_leave_trampoline,     entry->on_invoke_trampoline,
+                              entry->on_leave_trampoline,          entry->on_dynamic_binary_instrumentation_trampoline};
+    zz_size_t i;
+
+    // the block cache stays, a thread may still run in it
+    if (entry->hook_type == HOOK_TYPE_DBI_BLOCK)
+        trampolines[1] = NULL;
+
+    // the slices go back to the allocator, the next trampoline of the same size reuses them.
+    for (i = 0; i < sizeof(trampolines) / sizeof(trampolines[0]); i++) {
+        if (trampolines[i])
+            ZzFreeCodeSlice(allocator, (zz_ptr_t)((zz_addr_t)trampolines[i]));
     }
-
-    if (entry->on_enter_trampoline) {
-        //TODO
+    entry->on_enter_transfer_trampoline                 = NULL;
+    entry->on_enter_trampoline                          = NULL;
+    entry->on_insn_leave_trampoline                     = NULL;
+    entry->on_invoke_trampoline                         = NULL;
+    entry->on_leave_trampoline                          = NULL;
+    entry->on_dynamic_binary_instrumentation_trampoline = NULL;
+
+    if (entry->backend) {
+        // reserved for a tiny redirect, the build failed before the transfer trampoline
+        if (((ZzARM64HookFunctionEntryBackend *)entry->backend)->near_transfer_trampoline)
+            ZzFreeCodeSlice(allocator,
+                            ((ZzARM64HookFunctionEntryBackend *)entry->backend)->near_transfer_trampoline);
+        free(entry->backend);
+        entry->backend = NULL;
     }
+    return ZZ_SUCCESS;
+}
 
-    if (entry->on_enter_transfer_trampoline) {
-        //TODO
-    }
+// an offline hook plan of the module saves the sweep
+static void ZzARM64AnalyzePrologueWithPlan(zz_addr_t target_addr, zz_size_t function_size,
+                                           ZzARM64PrologueAnalysis *analysis) {
+    const ZzHookPlanRecord *record = ZzFindHookPlanRecord(target_addr);
 
-    if (entry->on_leave_trampoline) {
-        //TODO
+    if (!record) {
+        ZzARM64AnalyzePrologue(target_addr, ZZ_ARM64_FULL_REDIRECT_SIZE, function_size, analysis);
+        return;
     }
-
-    if (entry->on_invoke_trampoline) {
-        //TODO
+    analysis->safe_size     = record->safe_size;
+    analysis->limit         = (ZzARM64PrologueLimit)record->limit;
+    analysis->limit_address = record->limit == ZZ_ARM64_PROLOGUE_LIMIT_NONE ? 0 : target_addr + record->limit_offset;
+    analysis->scan_size     = record->scan_size;
+    if (function_size && analysis->safe_size > function_size) {
+        analysis->safe_size     = function_size;
+        analysis->limit         = ZZ_ARM64_PROLOGUE_LIMIT_FUNCTION_END;
+        analysis->limit_address = target_addr + function_size;
     }
-    return ZZ_SUCCESS;
 }
 
-ZZSTATUS ZzPrepareTrampoline(ZzInterceptorBackend *self, ZzHookFunctionEntry *entry) {
-    zz_addr_t target_addr    = (zz_addr_t)entry->target_ptr;
-    zz_size_t redirect_limit = 0;
+// `ldr x17, #8; br x17; .quad`
+#define ZZ_ARM64_TRANSFER_TRAMPOLINE_SIZE 16
+
+// the `b` of the tiny redirect only reaches a transfer trampoline near the target, it is reserved before the
+// prologue is relocated for it. only a page of HookZz, a code cave is for an explicit try_near_jump.
+static bool ZzReserveNearTransferTrampoline(ZzInterceptorBackend *self, ZzHookFunctionEntry *entry) {
+    ZzARM64HookFunctionEntryBackend *entry_backend = (ZzARM64HookFunctionEntryBackend *)entry->backend;
+    ZzCodeSlice *code_slice;
+
+    code_slice = ZzNewNearOwnedCodeSlice(self->allocator, (zz_addr_t)entry->target_ptr,
+                                         zz_arm64_writer_near_jump_range_size(), ZZ_ARM64_TRANSFER_TRAMPOLINE_SIZE);
+    if (!code_slice)
+        return FALSE;
+    entry_backend->near_transfer_trampoline = code_slice->data;
+    free(code_slice);
+    return TRUE;
+}
+
+// the full redirect when its window is safe. the tiny one (one instruction relocated) when the caller asked for near
+// jumps, or for a window too short for the full one if a page of HookZz near the target takes the transfer
+// trampoline. the lazy and shared dispatch redirects are always full ones.
+static ZZSTATUS ZzPrepareTrampolineWithRedirect(ZzInterceptorBackend *self, ZzHookFunctionEntry *entry,
+                                                bool allow_tiny) {
+    zz_addr_t target_addr = (zz_addr_t)entry->target_ptr;
     ZzARM64HookFunctionEntryBackend *entry_backend;
+    const ZzTrampolineCacheRecord *cache_record;
+    ZzARM64PrologueAnalysis analysis;
+    zz_addr_t cache_load_bias;
+
+    // the redirect must not run past the end of a function of known size
+    if (entry->function_size && entry->function_size < ZZ_ARM64_TINY_REDIRECT_SIZE) {
+        HookZzDebugInfoLog("%p: no redirect fits a %lu byte function", entry->target_ptr,
+                           (unsigned long)entry->function_size);
+        return ZZ_FAILED;
+    }
 
     entry_backend  = (ZzARM64HookFunctionEntryBackend *)zz_malloc_with_zero(sizeof(ZzARM64HookFunctionEntryBackend));
     entry->backend = (struct _ZzHookFunctionEntryBackend *)entry_backend;
 
+    cache_record = ZzFindTrampolineCacheRecord(target_addr, (const uint8_t *)target_addr, &cache_load_bias);
+    if (cache_record && ((entry->function_size && cache_record->redirect_size > entry->function_size) ||
+                         (!allow_tiny && cache_record->redirect_size == ZZ_ARM64_TINY_REDIRECT_SIZE)))
+        cache_record = NULL;
+
+    // a cached tiny redirect needs its transfer trampoline near the target as well
+    if (cache_record && !entry->try_near_jump && cache_record->redirect_size == ZZ_ARM64_TINY_REDIRECT_SIZE &&
+        !ZzReserveNearTransferTrampoline(self, entry))
+        cache_record = NULL;
+
     if (entry->try_near_jump) {
         entry_backend->redirect_code_size = ZZ_ARM64_TINY_REDIRECT_SIZE;
+    } else if (cache_record) {
+        // the cached trampoline was relocated for the redirect the analysis chose then
+        entry_backend->redirect_code_size = cache_record->redirect_size;
+        entry->try_near_jump              = cache_record->redirect_size == ZZ_ARM64_TINY_REDIRECT_SIZE;
     } else {
-        // check the first few instructions, preparatory work of instruction-fix
-        zz_arm64_relocator_try_relocate((zz_ptr_t)target_addr, ZZ_ARM64_FULL_REDIRECT_SIZE, &redirect_limit);
-        if (redirect_limit != 0 && redirect_limit > ZZ_ARM64_TINY_REDIRECT_SIZE &&
-            redirect_limit < ZZ_ARM64_FULL_REDIRECT_SIZE) {
+        // the tiny redirect only needs the first instruction, the full one the whole window
+        ZzARM64AnalyzePrologueWithPlan(target_addr, entry->function_size, &analysis);
+        entry_backend->redirect_limit         = analysis.limit;
+        entry_backend->redirect_limit_address = analysis.limit_address;
+        if (analysis.safe_size >= ZZ_ARM64_FULL_REDIRECT_SIZE) {
+            entry_backend->redirect_code_size = ZZ_ARM64_FULL_REDIRECT_SIZE;
+        } else if (allow_tiny && analysis.safe_size >= ZZ_ARM64_TINY_REDIRECT_SIZE &&
+                   ZzReserveNearTransferTrampoline(self, entry)) {
             entry->try_near_jump              = TRUE;
             entry_backend->redirect_code_size = ZZ_ARM64_TINY_REDIRECT_SIZE;
-        } else if (redirect_limit != 0 && redirect_limit < ZZ_ARM64_TINY_REDIRECT_SIZE) {
-            return ZZ_FAILED;
         } else {
-            entry_backend->redirect_code_size = ZZ_ARM64_FULL_REDIRECT_SIZE;
+            HookZzDebugInfoLog("%p: no redirect fits, %s (%p)", entry->target_ptr,
+                               ZzARM64PrologueLimitDescription(analysis.limit), (void *)analysis.limit_address);
+            return ZZ_FAILED;
         }
     }
 
+    if (cache_record && cache_record->redirect_size == entry_backend->redirect_code_size) {
+        entry_backend->cache_record    = cache_record;
+        entry_backend->cache_load_bias = cache_load_bias;
+    }
+
     self->arm64_relocator.try_relocated_length = entry_backend->redirect_code_size;
 
     // save original prologue
@@ -95,10 +181,14 @@ ZZSTATUS ZzPrepareTrampoline(ZzInterceptorBackend *self, ZzHookFunctionEntry *en
     entry->origin_prologue.address = (zz_ptr_t)target_addr;
 
     // relocator initialize
-    zz_arm64_relocator_init(&self->arm64_relocator, (zz_ptr_t)target_addr, &self->arm64_writer);
+    zz_arm64_relocator_reset(&self->arm64_relocator, &self->arm64_reader, &self->arm64_writer);
     return ZZ_SUCCESS;
 }
 
+ZZSTATUS ZzPrepareTrampoline(ZzInterceptorBackend *self, ZzHookFunctionEntry *entry) {
+    return ZzPrepareTrampolineWithRedirect(self, entry, TRUE);
+}
+
 // double jump
 ZZSTATUS ZzBuildEnterTransferTrampoline(ZzInterceptorBackend *self, ZzHookFunctionEntry *entry) {
     char temp_code_slice[256]                 = {0};
@@ -107,16 +197,28 @@ ZZSTATUS ZzBuildEnterTransferTrampoline(ZzInterceptorBackend *self, ZzHookFuncti
     ZzARM64HookFunctionEntryBackend *entry_backend = (ZzARM64HookFunctionEntryBackend *)entry->backend;
     ZZSTATUS status                                = ZZ_SUCCESS;
     zz_addr_t target_addr                          = (zz_addr_t)entry->target_ptr;
+    ZzCodeSlice reserved_slice                     = {0};
 
     arm64_writer = &self->arm64_writer;
     zz_arm64_writer_reset(arm64_writer, temp_code_slice, 0);
+    // keep the fixed `ldr x17, #8; br x17` shape, the hot relocation repoints its literal in place
     if (entry->hook_type == HOOK_TYPE_FUNCTION_via_REPLACE) {
         zz_arm64_writer_put_ldr_br_reg_address(arm64_writer, ZZ_ARM64_REG_X17, (zz_addr_t)entry->replace_call);
     } else {
         zz_arm64_writer_put_ldr_br_reg_address(arm64_writer, ZZ_ARM64_REG_X17, (zz_addr_t)entry->on_enter_trampoline);
     }
 
-    if (entry_backend->redirect_code_size == ZZ_ARM64_TINY_REDIRECT_SIZE) {
+    // a materialized lazy entry jumps here with a single `b`
+    if (entry_backend->near_transfer_trampoline) {
+        // reserved by the prepare, the code has no fixup and goes there as is
+        reserved_slice.data = entry_backend->near_transfer_trampoline;
+        reserved_slice.size = arm64_writer->size;
+        if (!ZzAllocatorPatchCode(self->allocator, (zz_addr_t)reserved_slice.data,
+                                  (zz_ptr_t)arm64_writer->w_start_address, arm64_writer->size))
+            return ZZ_FAILED;
+        entry_backend->near_transfer_trampoline = NULL;
+        code_slice                              = &reserved_slice;
+    } else if (entry_backend->redirect_code_size == ZZ_ARM64_TINY_REDIRECT_SIZE || entry_backend->is_lazy) {
         code_slice =
             zz_arm64_code_patch(arm64_writer, self->allocator, target_addr, zz_arm64_writer_near_jump_range_size());
     } else {
@@ -137,12 +239,78 @@ ZZSTATUS ZzBuildEnterTransferTrampoline(ZzInterceptorBackend *self, ZzHookFuncti
         HookZzDebugInfoLog("%s", buffer);
     }
 
-    free(code_slice);
+    if (code_slice != &reserved_slice)
+        free(code_slice);
     return status;
 }
 
+// compile the predicates before the enter sequence, a mismatch branch to `skip`, which jump to
+// `entry->on_invoke_trampoline` directly, without context save and thunk.
+// use x16 and x17 as scratch registers, they are free at the function entry.
+static ZZSTATUS ZzBuildEnterPredicate(ZzInterceptorBackend *self, ZzHookFunctionEntry *entry) {
+    ZzARM64AssemblerWriter *arm64_writer = &self->arm64_writer;
+    ZzARM64Label skip, match;
+    HookPredicate *predicate;
+    ZzARM64Reg reg;
+    int i;
+
+    for (i = 0; i < entry->predicate_count; i++) {
+        predicate = &entry->predicates[i];
+        if (predicate->reg > ZZ_ARM64_REG_X28 || predicate->reg == ZZ_ARM64_REG_X16 ||
+            predicate->reg == ZZ_ARM64_REG_X17) {
+            HookZzDebugInfoLog("predicate register x%d is not support", predicate->reg);
+            return ZZ_FAILED;
+        }
+    }
+
+    skip  = zz_arm64_writer_new_label(arm64_writer);
+    match = zz_arm64_writer_new_label(arm64_writer);
+    for (i = 0; i < entry->predicate_count; i++) {
+        predicate = &entry->predicates[i];
+        reg       = (ZzARM64Reg)(ZZ_ARM64_REG_X0 + predicate->reg);
+        switch (predicate->type) {
+        case PREDICATE_TYPE_EQ:
+        case PREDICATE_TYPE_NE:
+            zz_arm64_writer_put_ldr_reg_literal(arm64_writer, ZZ_ARM64_REG_X17, predicate->value);
+            zz_arm64_writer_put_cmp_reg_reg(arm64_writer, reg, ZZ_ARM64_REG_X17);
+            zz_arm64_writer_put_b_cond_label(
+                arm64_writer, predicate->type == PREDICATE_TYPE_EQ ? ZZ_ARM64_COND_NE : ZZ_ARM64_COND_EQ, skip);
+            break;
+        case PREDICATE_TYPE_MASK:
+            zz_arm64_writer_put_ldr_reg_literal(arm64_writer, ZZ_ARM64_REG_X16, predicate->mask);
+            zz_arm64_writer_put_and_reg_reg_reg(arm64_writer, ZZ_ARM64_REG_X16, reg, ZZ_ARM64_REG_X16);
+            zz_arm64_writer_put_ldr_reg_literal(arm64_writer, ZZ_ARM64_REG_X17, predicate->value);
+            zz_arm64_writer_put_cmp_reg_reg(arm64_writer, ZZ_ARM64_REG_X16, ZZ_ARM64_REG_X17);
+            zz_arm64_writer_put_b_cond_label(arm64_writer, ZZ_ARM64_COND_NE, skip);
+            break;
+        case PREDICATE_TYPE_RANGE:
+            zz_arm64_writer_put_ldr_reg_literal(arm64_writer, ZZ_ARM64_REG_X17, predicate->value);
+            zz_arm64_writer_put_cmp_reg_reg(arm64_writer, reg, ZZ_ARM64_REG_X17);
+            zz_arm64_writer_put_b_cond_label(arm64_writer, ZZ_ARM64_COND_LO, skip);
+            zz_arm64_writer_put_ldr_reg_literal(arm64_writer, ZZ_ARM64_REG_X17, predicate->upper);
+            zz_arm64_writer_put_cmp_reg_reg(arm64_writer, reg, ZZ_ARM64_REG_X17);
+            zz_arm64_writer_put_b_cond_label(arm64_writer, ZZ_ARM64_COND_HI, skip);
+            break;
+        default:
+            return ZZ_FAILED;
+        }
+    }
+
+    // match: jump over `skip`
+    zz_arm64_writer_put_b_label(arm64_writer, match);
+
+    // skip: `on_invoke_trampoline` is built after the enter trampoline, so load it from entry.
+    zz_arm64_writer_put_label(arm64_writer, skip);
+    zz_arm64_writer_put_ldr_reg_literal(arm64_writer, ZZ_ARM64_REG_X17, (zz_addr_t)entry);
+    zz_arm64_writer_put_ldr_reg_reg_offset(arm64_writer, ZZ_ARM64_REG_X17, ZZ_ARM64_REG_X17,
+                                           offsetof(ZzHookFunctionEntry, on_invoke_trampoline));
+    zz_arm64_writer_put_br_reg(arm64_writer, ZZ_ARM64_REG_X17);
+    zz_arm64_writer_put_label(arm64_writer, match);
+    return ZZ_SUCCESS;
+}
+
 ZZSTATUS ZzBuildEnterTrampoline(ZzInterceptorBackend *self, ZzHookFunctionEntry *entry) {
-    char temp_code_slice[256]                 = {0};
+    char temp_code_slice[512]                 = {0};
     ZzARM64AssemblerWriter *arm64_writer           = NULL;
     ZzCodeSlice *code_slice                        = NULL;
     ZzARM64HookFunctionEntryBackend *entry_backend = (ZzARM64HookFunctionEntryBackend *)entry->backend;
@@ -151,13 +319,18 @@ ZZSTATUS ZzBuildEnterTrampoline(ZzInterceptorBackend *self, ZzHookFunctionEntry
     arm64_writer = &self->arm64_writer;
     zz_arm64_writer_reset(arm64_writer, temp_code_slice, 0);
 
+    if (entry->predicate_count) {
+        if (ZzBuildEnterPredicate(self, entry) == ZZ_FAILED)
+            return ZZ_FAILED;
+    }
+
     // prepare 2 stack space: 1. next_hop 2. entry arg
     zz_arm64_writer_put_sub_reg_reg_imm(arm64_writer, ZZ_ARM64_REG_SP, ZZ_ARM64_REG_SP, 2 * 0x8);
-    zz_arm64_writer_put_ldr_b_reg_address(arm64_writer, ZZ_ARM64_REG_X17, (zz_addr_t)entry);
+    zz_arm64_writer_put_ldr_reg_literal(arm64_writer, ZZ_ARM64_REG_X17, (zz_addr_t)entry);
     zz_arm64_writer_put_str_reg_reg_offset(arm64_writer, ZZ_ARM64_REG_X17, ZZ_ARM64_REG_SP, 0x0);
 
     // jump to enter thunk
-    zz_arm64_writer_put_ldr_br_reg_address(arm64_writer, ZZ_ARM64_REG_X17, (zz_addr_t)self->enter_thunk);
+    zz_arm64_writer_put_jump_address(arm64_writer, ZZ_ARM64_REG_X17, (zz_addr_t)self->enter_thunk);
 
     code_slice = zz_arm64_code_patch(arm64_writer, self->allocator, 0, 0);
     if (code_slice)
@@ -174,10 +347,13 @@ ZZSTATUS ZzBuildEnterTrampoline(ZzInterceptorBackend *self, ZzHookFunctionEntry
         HookZzDebugInfoLog("%s", buffer);
     }
 
-    // build the double trampline aka enter_transfer_trampoline
-    if (entry->hook_type != HOOK_TYPE_FUNCTION_via_GOT)
-        if (entry_backend->redirect_code_size == ZZ_ARM64_TINY_REDIRECT_SIZE) {
-            ZzBuildEnterTransferTrampoline(self, entry);
+    // build the double trampline aka enter_transfer_trampoline, a hot rebuild repoints the existing one
+    if (entry->hook_type != HOOK_TYPE_FUNCTION_via_GOT && entry->hook_type != HOOK_TYPE_FUNCTION_via_CALL_SITE &&
+        !entry->on_enter_transfer_trampoline)
+        if (entry_backend->redirect_code_size == ZZ_ARM64_TINY_REDIRECT_SIZE || entry_backend->is_lazy) {
+            // the `b` of the tiny redirect has nowhere to go without it
+            if (ZzBuildEnterTransferTrampoline(self, entry) == ZZ_FAILED)
+                status = ZZ_FAILED;
         }
 
     free(code_slice);
@@ -196,11 +372,11 @@ ZZSTATUS ZzBuildDynamicBinaryInstrumentationTrampoline(ZzInterceptorBackend *sel
 
     // prepare 2 stack space: 1. next_hop 2. entry arg
     zz_arm64_writer_put_sub_reg_reg_imm(arm64_writer, ZZ_ARM64_REG_SP, ZZ_ARM64_REG_SP, 2 * 0x8);
-    zz_arm64_writer_put_ldr_b_reg_address(arm64_writer, ZZ_ARM64_REG_X17, (zz_addr_t)entry);
+    zz_arm64_writer_put_ldr_reg_literal(arm64_writer, ZZ_ARM64_REG_X17, (zz_addr_t)entry);
     zz_arm64_writer_put_str_reg_reg_offset(arm64_writer, ZZ_ARM64_REG_X17, ZZ_ARM64_REG_SP, 0x0);
 
     // jump to enter thunk
-    zz_arm64_writer_put_ldr_br_reg_address(arm64_writer, ZZ_ARM64_REG_X17, (zz_addr_t)self->dynamic_binary_instrumentation_thunk);
+    zz_arm64_writer_put_jump_address(arm64_writer, ZZ_ARM64_REG_X17, (zz_addr_t)self->dynamic_binary_instrumentation_thunk);
 
     code_slice = zz_arm64_code_patch(arm64_writer, self->allocator, 0, 0);
     if (code_slice)
@@ -216,14 +392,174 @@ ZZSTATUS ZzBuildDynamicBinaryInstrumentationTrampoline(ZzInterceptorBackend *sel
                 code_slice->data, code_slice->size, (void *)entry, (void *)self->dynamic_binary_instrumentation_thunk);
         HookZzDebugInfoLog("%s", buffer);
     }
+    free(code_slice);
+
+    // build the double trampline aka enter_transfer_trampoline
+    if (entry_backend->redirect_code_size == ZZ_ARM64_TINY_REDIRECT_SIZE) {
+        status = ZzBuildEnterTransferTrampoline(self, entry);
+    }
+    return status;
+}
+
+ZZSTATUS ZzBuildBlockTranslationTrampoline(ZzInterceptorBackend *self, ZzHookFunctionEntry *entry) {
+    ZzARM64HookFunctionEntryBackend *entry_backend = (ZzARM64HookFunctionEntryBackend *)entry->backend;
+    ZzARM64Block *block;
+
+    if (!entry_backend->block_cache)
+        entry_backend->block_cache = ZzARM64NewBlockCache(self, entry);
+    if (!entry_backend->block_cache)
+        return ZZ_FAILED;
+
+    block = ZzARM64TranslateBlock(entry_backend->block_cache, (zz_addr_t)entry->target_ptr);
+    if (!block)
+        return ZZ_FAILED;
+    entry->on_enter_trampoline = block->code;
+
+    // debug log
+    if (HookZzDebugInfoIsEnable()) {
+        char buffer[1024] = {};
+        sprintf(buffer + strlen(buffer), "%s\n", "ZzBuildBlockTranslationTrampoline:");
+        sprintf(buffer + strlen(buffer), "LogInfo: block cache %p, the entry block at %p. hook-entry: %p.\n",
+                (void *)entry_backend->block_cache, block->code, (void *)entry);
+        HookZzDebugInfoLog("%s", buffer);
+    }
 
     // build the double trampline aka enter_transfer_trampoline
     if (entry_backend->redirect_code_size == ZZ_ARM64_TINY_REDIRECT_SIZE) {
-        ZzBuildEnterTransferTrampoline(self, entry);
+        if (ZzBuildEnterTransferTrampoline(self, entry) == ZZ_FAILED)
+            return ZZ_FAILED;
     }
+    return ZZ_SUCCESS;
+}
+
+// x17 is clobbered by the full redirect already, x15/x16 are saved. the exclusive loop works without the lse atomics,
+// the flags are not touched.
+ZZSTATUS ZzBuildCounterTrampoline(ZzInterceptorBackend *self, ZzHookFunctionEntry *entry) {
+    char temp_code_slice[256]                      = {0};
+    ZzARM64AssemblerWriter *arm64_writer           = NULL;
+    ZzCodeSlice *code_slice                        = NULL;
+    ZzARM64HookFunctionEntryBackend *entry_backend = (ZzARM64HookFunctionEntryBackend *)entry->backend;
+
+    arm64_writer = &self->arm64_writer;
+    zz_arm64_writer_reset(arm64_writer, temp_code_slice, 0);
 
+    if (entry->counter_type == COUNTER_TYPE_COVERAGE) {
+        // str x16, [sp, #-16]!
+        zz_arm64_writer_put_instruction(arm64_writer, 0xf81f0ff0);
+        zz_arm64_writer_put_ldr_reg_literal(arm64_writer, ZZ_ARM64_REG_X16, (zz_addr_t)entry->counter_slot);
+        // movz x17, #1
+        zz_arm64_writer_put_instruction(arm64_writer, 0xd2800031);
+        zz_arm64_writer_put_str_reg_reg_offset(arm64_writer, ZZ_ARM64_REG_X17, ZZ_ARM64_REG_X16, 0x0);
+        // ldr x16, [sp], #16
+        zz_arm64_writer_put_instruction(arm64_writer, 0xf84107f0);
+    } else {
+        // stp x15, x16, [sp, #-16]!
+        zz_arm64_writer_put_instruction(arm64_writer, 0xa9bf43ef);
+        zz_arm64_writer_put_ldr_reg_literal(arm64_writer, ZZ_ARM64_REG_X16, (zz_addr_t)entry->counter_slot);
+        // ldxr x17, [x16]
+        zz_arm64_writer_put_instruction(arm64_writer, 0xc85f7e11);
+        zz_arm64_writer_put_add_reg_reg_imm(arm64_writer, ZZ_ARM64_REG_X17, ZZ_ARM64_REG_X17, 1);
+        // stxr w15, x17, [x16]
+        zz_arm64_writer_put_instruction(arm64_writer, 0xc80f7e11);
+        // cbnz w15, ldxr
+        zz_arm64_writer_put_instruction(arm64_writer, 0x35ffffaf);
+        // ldp x15, x16, [sp], #16
+        zz_arm64_writer_put_instruction(arm64_writer, 0xa8c143ef);
+    }
+
+    zz_arm64_writer_put_jump_address(arm64_writer, ZZ_ARM64_REG_X17, (zz_addr_t)entry->on_invoke_trampoline);
+
+    code_slice = zz_arm64_code_patch(arm64_writer, self->allocator, 0, 0);
+    if (code_slice)
+        entry->on_enter_trampoline = code_slice->data;
+    else
+        return ZZ_FAILED;
+
+    // debug log
+    if (HookZzDebugInfoIsEnable()) {
+        char buffer[1024] = {};
+        sprintf(buffer + strlen(buffer), "%s\n", "ZzBuildCounterTrampoline:");
+        sprintf(buffer + strlen(buffer),
+                "LogInfo: counter_trampoline at %p, length: %ld. counter slot: %p. and will jump to on_invoke_trampoline(%p).\n",
+                code_slice->data, code_slice->size, (void *)entry->counter_slot, entry->on_invoke_trampoline);
+        HookZzDebugInfoLog("%s", buffer);
+    }
     free(code_slice);
-    return status;
+
+    // build the double trampline aka enter_transfer_trampoline
+    if (entry_backend->redirect_code_size == ZZ_ARM64_TINY_REDIRECT_SIZE) {
+        if (ZzBuildEnterTransferTrampoline(self, entry) == ZZ_FAILED)
+            return ZZ_FAILED;
+    }
+    return ZZ_SUCCESS;
+}
+
+// copy and fix up, no decoding and no relocation
+static ZZSTATUS ZzBuildCachedInvokeTrampoline(ZzInterceptorBackend *self, ZzHookFunctionEntry *entry) {
+    char temp_code_slice[ZZ_TRAMPOLINE_CACHE_MAX_CODE_SIZE] = {0};
+    ZzARM64HookFunctionEntryBackend *entry_backend          = (ZzARM64HookFunctionEntryBackend *)entry->backend;
+    const ZzTrampolineCacheRecord *cache_record             = entry_backend->cache_record;
+    ZzCodeSlice *code_slice;
+    zz_size_t i;
+
+    code_slice = ZzNewCodeSlice(self->allocator, cache_record->code_size + 4);
+    if (!code_slice)
+        return ZZ_FAILED;
+    ZzInstantiateTrampolineCacheRecord(cache_record, entry_backend->cache_load_bias, (zz_addr_t)code_slice->data,
+                                       temp_code_slice);
+    if (!ZzAllocatorPatchCode(self->allocator, (zz_addr_t)code_slice->data, temp_code_slice, cache_record->code_size)) {
+        free(code_slice);
+        return ZZ_FAILED;
+    }
+    entry->on_invoke_trampoline = code_slice->data;
+
+    entry->relocated_offset_count = cache_record->relocated_offset_count;
+    for (i = 0; i < cache_record->relocated_offset_count; i++) {
+        entry->relocated_offsets[i].origin_offset    = cache_record->relocated_offsets[i][0];
+        entry->relocated_offsets[i].relocated_offset = cache_record->relocated_offsets[i][1];
+    }
+
+    HookZzDebugInfoLog("on_invoke_trampoline of %p at %p, from the trampoline cache", entry->target_ptr,
+                       code_slice->data);
+    free(code_slice);
+    return ZZ_SUCCESS;
+}
+
+// the relocated prologue and `ldr x17, #8; br x17; .quad rest` as the template of the cache. the literals are the 8
+// byte data the relocator put.
+static void ZzAddInvokeTrampolineToCache(ZzInterceptorBackend *self, ZzHookFunctionEntry *entry,
+                                         zz_size_t relocated_size, zz_addr_t trampoline) {
+    ZzARM64HookFunctionEntryBackend *entry_backend = (ZzARM64HookFunctionEntryBackend *)entry->backend;
+    ZzARM64Relocator *arm64_relocator              = &self->arm64_relocator;
+    ZzARM64AssemblerWriter *arm64_writer           = &self->arm64_writer;
+    zz_size_t literal_offsets[ZZ_TRAMPOLINE_CACHE_MAX_FIXUP_COUNT];
+    char code[ZZ_TRAMPOLINE_CACHE_MAX_CODE_SIZE];
+    zz_size_t literal_count = 0, i, j;
+    uint32_t insns[2]       = {0x58000051, 0xd61f0220};
+    zz_addr_t rest;
+
+    if (relocated_size + 16 > sizeof(code))
+        return;
+    memcpy(code, (zz_ptr_t)arm64_writer->w_start_address, relocated_size);
+    for (i = 0; i < arm64_relocator->relocator_insn_size; i++) {
+        ZzARM64RelocatorInstruction *relocator_insn = &arm64_relocator->relocator_insns[i];
+        for (j = relocator_insn->output_index_start; j < relocator_insn->ouput_index_end; j++) {
+            if (arm64_writer->insns[j].size != sizeof(uint64_t))
+                continue;
+            if (literal_count + 1 >= ZZ_TRAMPOLINE_CACHE_MAX_FIXUP_COUNT)
+                return;
+            literal_offsets[literal_count++] = arm64_writer->insns[j].address - arm64_writer->w_start_address;
+        }
+    }
+
+    rest = (zz_addr_t)entry->target_ptr + arm64_relocator->input->size;
+    memcpy(code + relocated_size, insns, sizeof(insns));
+    memcpy(code + relocated_size + sizeof(insns), &rest, sizeof(rest));
+    literal_offsets[literal_count++] = relocated_size + sizeof(insns);
+
+    ZzAddTrampolineCacheRecord((zz_addr_t)entry->target_ptr, (const uint8_t *)entry->origin_prologue.data,
+                               entry_backend->redirect_code_size, code, relocated_size + 16, trampoline,
+                               literal_offsets, literal_count, entry->relocated_offsets, entry->relocated_offset_count);
 }
 
 ZZSTATUS ZzBuildInvokeTrampoline(ZzInterceptorBackend *self, ZzHookFunctionEntry *entry) {
@@ -236,12 +572,21 @@ ZZSTATUS ZzBuildInvokeTrampoline(ZzInterceptorBackend *self, ZzHookFunctionEntry
     ZzARM64Relocator *arm64_relocator;
     ZzARM64AssemblerWriter *arm64_writer;
     ZzARM64Reader *arm64_reader;
+    zz_size_t relocated_size;
+
+    if (entry_backend->cache_record && entry->hook_type != HOOK_TYPE_ONE_INSTRUCTION)
+        return ZzBuildCachedInvokeTrampoline(self, entry);
 
     arm64_relocator = &self->arm64_relocator;
     arm64_writer    = &self->arm64_writer;
     arm64_reader    = &self->arm64_reader;
     zz_arm64_writer_reset(arm64_writer, temp_code_slice, 0);
     zz_arm64_reader_reset(arm64_reader, (zz_ptr_t )target_addr);
+    // the prologue is the lazy stub jump (or the redirect of a hot rebuild) already, relocate the backup at the same pc
+    if (entry_backend->is_lazy || entry->on_invoke_trampoline) {
+        arm64_reader->r_start_address   = (zz_addr_t)entry->origin_prologue.data;
+        arm64_reader->r_current_address = (zz_addr_t)entry->origin_prologue.data;
+    }
     zz_arm64_relocator_reset(arm64_relocator, arm64_reader, arm64_writer);
 
     if (entry->hook_type == HOOK_TYPE_ONE_INSTRUCTION) {
@@ -262,8 +607,9 @@ ZZSTATUS ZzBuildInvokeTrampoline(ZzInterceptorBackend *self, ZzHookFunctionEntry
     }
 
     // jump to rest target address
+    relocated_size         = arm64_writer->size;
     restore_next_insn_addr = (zz_ptr_t)((zz_addr_t)target_addr + arm64_relocator->input->size);
-    zz_arm64_writer_put_ldr_br_reg_address(arm64_writer, ZZ_ARM64_REG_X17, (zz_addr_t)restore_next_insn_addr);
+    zz_arm64_writer_put_jump_address(arm64_writer, ZZ_ARM64_REG_X17, (zz_addr_t)restore_next_insn_addr);
 
     code_slice = zz_arm64_relocate_code_patch(arm64_relocator, arm64_writer, self->allocator, 0, 0);
     if (code_slice)
@@ -271,11 +617,26 @@ ZZSTATUS ZzBuildInvokeTrampoline(ZzInterceptorBackend *self, ZzHookFunctionEntry
     else
         return ZZ_FAILED;
 
+    // record where every prologue instruction is relocated to, for the pc fixup of the safe patch.
+    entry->relocated_offset_count = 0;
+    for (int i = 0; i < arm64_relocator->relocator_insn_size && i < ZZ_MAX_RELOCATED_INSN_COUNT; i++) {
+        ZzARM64RelocatorInstruction *relocator_insn = &arm64_relocator->relocator_insns[i];
+        entry->relocated_offsets[i].origin_offset =
+                arm64_relocator->input->insns[relocator_insn->origin_index].pc - arm64_relocator->input->start_pc;
+        entry->relocated_offsets[i].relocated_offset =
+                arm64_relocator->output->insns[relocator_insn->output_index_start].pc - arm64_relocator->output->start_pc;
+        entry->relocated_offset_count++;
+    }
+
+    if (entry->hook_type != HOOK_TYPE_ONE_INSTRUCTION && ZzIsTrampolineCacheEnabled())
+        ZzAddInvokeTrampolineToCache(self, entry, relocated_size, (zz_addr_t)code_slice->data);
+
     //
     if (entry->hook_type == HOOK_TYPE_ONE_INSTRUCTION) {
         ZzARM64RelocatorInstruction relocator_insn = arm64_relocator->relocator_insns[1];
         entry->next_insn_addr =
-                (relocator_insn.relocated_insns[0]->pc - arm64_relocator->output->start_pc) + (zz_addr_t) code_slice->data;
+                (arm64_relocator->output->insns[relocator_insn.output_index_start].pc - arm64_relocator->output->start_pc) +
+                (zz_addr_t) code_slice->data;
     }
 
     /* debug log */
@@ -315,10 +676,10 @@ ZZSTATUS ZzBuildInsnLeaveTrampoline(ZzInterceptorBackend *self, ZzHookFunctionEn
 
     // prepare 2 stack space: 1. next_hop 2. entry arg
     zz_arm64_writer_put_sub_reg_reg_imm(arm64_writer, ZZ_ARM64_REG_SP, ZZ_ARM64_REG_SP, 2 * 0x8);
-    zz_arm64_writer_put_ldr_b_reg_address(arm64_writer, ZZ_ARM64_REG_X17, (zz_addr_t)entry);
+    zz_arm64_writer_put_ldr_reg_literal(arm64_writer, ZZ_ARM64_REG_X17, (zz_addr_t)entry);
     zz_arm64_writer_put_str_reg_reg_offset(arm64_writer, ZZ_ARM64_REG_X17, ZZ_ARM64_REG_SP, 0x0);
 
-    zz_arm64_writer_put_ldr_br_reg_address(arm64_writer, ZZ_ARM64_REG_X17, (zz_addr_t)self->insn_leave_thunk);
+    zz_arm64_writer_put_jump_address(arm64_writer, ZZ_ARM64_REG_X17, (zz_addr_t)self->insn_leave_thunk);
 
     code_slice = zz_arm64_code_patch(arm64_writer, self->allocator, 0, 0);
     if (code_slice)
@@ -329,25 +690,28 @@ ZZSTATUS ZzBuildInsnLeaveTrampoline(ZzInterceptorBackend *self, ZzHookFunctionEn
     return status;
 }
 
+// the entry is popped from the shadow stack, so the leave trampoline only passes the shared thread local key.
 ZZSTATUS ZzBuildLeaveTrampoline(ZzInterceptorBackend *self, ZzHookFunctionEntry *entry) {
-    char temp_code_slice[256]                 = {0};
-    ZzCodeSlice *code_slice                        = NULL;
-    ZzARM64HookFunctionEntryBackend *entry_backend = (ZzARM64HookFunctionEntryBackend *)entry->backend;
-    ZzARM64AssemblerWriter *arm64_writer           = NULL;
+    char temp_code_slice[256]            = {0};
+    ZzCodeSlice *code_slice              = NULL;
+    ZzARM64AssemblerWriter *arm64_writer = NULL;
+
+    if (self->leave_trampoline)
+        return ZZ_DONE;
 
     arm64_writer = &self->arm64_writer;
     zz_arm64_writer_reset(arm64_writer, temp_code_slice, 0);
 
-    // prepare 2 stack space: 1. next_hop 2. entry arg
+    // prepare 2 stack space: 1. next_hop 2. thread local key arg
     zz_arm64_writer_put_sub_reg_reg_imm(arm64_writer, ZZ_ARM64_REG_SP, ZZ_ARM64_REG_SP, 2 * 0x8);
-    zz_arm64_writer_put_ldr_b_reg_address(arm64_writer, ZZ_ARM64_REG_X17, (zz_addr_t)entry);
+    zz_arm64_writer_put_ldr_reg_literal(arm64_writer, ZZ_ARM64_REG_X17, (zz_addr_t)entry->thread_local_key);
     zz_arm64_writer_put_str_reg_reg_offset(arm64_writer, ZZ_ARM64_REG_X17, ZZ_ARM64_REG_SP, 0x0);
 
-    zz_arm64_writer_put_ldr_br_reg_address(arm64_writer, ZZ_ARM64_REG_X17, (zz_addr_t)self->leave_thunk);
+    zz_arm64_writer_put_jump_address(arm64_writer, ZZ_ARM64_REG_X17, (zz_addr_t)self->leave_thunk);
 
     code_slice = zz_arm64_code_patch(arm64_writer, self->allocator, 0, 0);
     if (code_slice)
-        entry->on_leave_trampoline = code_slice->data;
+        self->leave_trampoline = code_slice->data;
     else
         return ZZ_FAILED;
 
@@ -356,7 +720,7 @@ ZZSTATUS ZzBuildLeaveTrampoline(ZzInterceptorBackend *self, ZzHookFunctionEntry
         char buffer[1024] = {};
         sprintf(buffer + strlen(buffer), "%s\n", "ZzBuildLeaveTrampoline:");
         sprintf(buffer + strlen(buffer),
-                "LogInfo: on_leave_trampoline at %p, length: %ld. and will jump to leave_thunk(%p).\n",
+                "LogInfo: leave_trampoline at %p, length: %ld. and will jump to leave_thunk(%p).\n",
                 code_slice->data, code_slice->size, self->leave_thunk);
         HookZzDebugInfoLog("%s", buffer);
     }
@@ -365,7 +729,15 @@ ZZSTATUS ZzBuildLeaveTrampoline(ZzInterceptorBackend *self, ZzHookFunctionEntry
     return ZZ_DONE;
 }
 
-ZZSTATUS ZzActivateTrampoline(ZzInterceptorBackend *self, ZzHookFunctionEntry *entry) {
+ZZSTATUS ZzBuildSolidifyTrampoline(ZzInterceptorBackend *self, ZzHookFunctionEntry *entry, uint64_t *enter_thunk_slot) {
+    // built once for the backend, not per hook
+    if (entry->hook_type == HOOK_TYPE_FUNCTION_via_PRE_POST && ZzBuildLeaveTrampoline(self, entry) == ZZ_FAILED)
+        return ZZ_FAILED;
+    __atomic_store_n(enter_thunk_slot, (uint64_t)(zz_addr_t)self->enter_thunk, __ATOMIC_RELEASE);
+    return ZZ_SUCCESS;
+}
+
+ZZSTATUS ZzBuildRedirectCode(ZzInterceptorBackend *self, ZzHookFunctionEntry *entry, FunctionBackup *redirect_code) {
     char temp_code_slice[256]                 = {0};
     ZzCodeSlice *code_slice                        = NULL;
     ZzARM64HookFunctionEntryBackend *entry_backend = (ZzARM64HookFunctionEntryBackend *)entry->backend;
@@ -376,7 +748,15 @@ ZZSTATUS ZzActivateTrampoline(ZzInterceptorBackend *self, ZzHookFunctionEntry *e
     arm64_writer = &self->arm64_writer;
     zz_arm64_writer_reset(arm64_writer, temp_code_slice, target_addr);
 
-    if (entry->hook_type == HOOK_TYPE_FUNCTION_via_REPLACE) {
+    if (entry_backend->is_lazy && entry->lazy_state == LAZY_STATE_READY && entry->on_enter_transfer_trampoline) {
+        zz_arm64_writer_put_b_imm(arm64_writer,
+                                  (zz_addr_t)entry->on_enter_transfer_trampoline - (zz_addr_t)arm64_writer->start_pc);
+    } else if (entry_backend->is_lazy || entry_backend->is_shared_dispatch) {
+        // x16 carries the target to the shared stub, x16/x17 are free at the function entry
+        zz_arm64_writer_put_adr_reg_imm(arm64_writer, ZZ_ARM64_REG_X16, 0);
+        zz_arm64_writer_put_adrp_add_reg_address(arm64_writer, ZZ_ARM64_REG_X17, (zz_addr_t)entry_backend->shared_stub);
+        zz_arm64_writer_put_br_reg(arm64_writer, ZZ_ARM64_REG_X17);
+    } else if (entry->hook_type == HOOK_TYPE_FUNCTION_via_REPLACE) {
         if (entry_backend->redirect_code_size == ZZ_ARM64_TINY_REDIRECT_SIZE) {
             zz_arm64_writer_put_b_imm(arm64_writer,
                                       (zz_addr_t)entry->on_enter_transfer_trampoline - (zz_addr_t)arm64_writer->start_pc);
@@ -394,12 +774,224 @@ ZZSTATUS ZzActivateTrampoline(ZzInterceptorBackend *self, ZzHookFunctionEntry *e
         }
     }
 
-    if (!ZzMemoryPatchCode((zz_addr_t)target_addr, (zz_ptr_t )arm64_writer->w_start_address, arm64_writer->size))
-        status = ZZ_FAILED;
-
+    redirect_code->address = (zz_ptr_t)target_addr;
+    redirect_code->size    = arm64_writer->size;
+    memcpy(redirect_code->data, (zz_ptr_t)arm64_writer->w_start_address, arm64_writer->size);
     return status;
 }
 
+// adrp reach, one page of margin
+#define ZZ_ARM64_ADRP_RANGE_SIZE (((zz_size_t)1 << 32) - 0x1000)
+
+static bool ZzIsInAdrpRange(zz_addr_t address, zz_addr_t target_addr) {
+    zz_addr_t distance = address > target_addr ? address - target_addr : target_addr - address;
+    return distance < ZZ_ARM64_ADRP_RANGE_SIZE;
+}
+
+// the stub only records the target in the entry arg slot and jumps to the shared thunk.
+static zz_ptr_t ZzGetSharedStub(ZzInterceptorBackend *self, ZzARM64SharedStubSet *set, zz_ptr_t thunk,
+                                zz_addr_t target_addr) {
+    char temp_code_slice[64]             = {0};
+    ZzARM64AssemblerWriter *arm64_writer = &self->arm64_writer;
+    ZzCodeSlice *code_slice;
+    zz_ptr_t stub;
+    zz_size_t i;
+
+    for (i = 0; i < set->size; i++) {
+        if (ZzIsInAdrpRange((zz_addr_t)set->stubs[i], target_addr))
+            return set->stubs[i];
+    }
+
+    if (set->size >= set->capacity) {
+        zz_size_t capacity = set->capacity ? set->capacity * 2 : 4;
+        zz_ptr_t *stubs    = (zz_ptr_t *)realloc(set->stubs, sizeof(zz_ptr_t) * capacity);
+        if (!stubs)
+            return NULL;
+        set->stubs    = stubs;
+        set->capacity = capacity;
+    }
+
+    zz_arm64_writer_reset(arm64_writer, temp_code_slice, 0);
+    zz_arm64_writer_put_sub_reg_reg_imm(arm64_writer, ZZ_ARM64_REG_SP, ZZ_ARM64_REG_SP, 2 * 0x8);
+    zz_arm64_writer_put_str_reg_reg_offset(arm64_writer, ZZ_ARM64_REG_X16, ZZ_ARM64_REG_SP, 0x0);
+    zz_arm64_writer_put_jump_address(arm64_writer, ZZ_ARM64_REG_X17, (zz_addr_t)thunk);
+
+    // an anonymous page is usually in range of the modules already, a code cave is the last resort
+    code_slice = zz_arm64_code_patch(arm64_writer, self->allocator, 0, 0);
+    if (code_slice && !ZzIsInAdrpRange((zz_addr_t)code_slice->data, target_addr)) {
+        ZzFreeCodeSlice(self->allocator, code_slice->data);
+        free(code_slice);
+        code_slice = zz_arm64_code_patch(arm64_writer, self->allocator, target_addr, ZZ_ARM64_ADRP_RANGE_SIZE);
+    }
+    if (!code_slice)
+        return NULL;
+    stub = code_slice->data;
+    free(code_slice);
+    set->stubs[set->size++] = stub;
+    return stub;
+}
+
+ZZSTATUS ZzBuildLazyTrampoline(ZzInterceptorBackend *self, ZzHookFunctionEntry *entry) {
+    ZzARM64HookFunctionEntryBackend *entry_backend;
+
+    if (entry->hook_type != HOOK_TYPE_FUNCTION_via_REPLACE && entry->hook_type != HOOK_TYPE_FUNCTION_via_PRE_POST)
+        return ZZ_FAILED;
+    if (entry->try_near_jump || !self->lazy_thunk)
+        return ZZ_FAILED;
+
+    if (ZzPrepareTrampolineWithRedirect(self, entry, FALSE) == ZZ_FAILED)
+        goto fail;
+    entry_backend = (ZzARM64HookFunctionEntryBackend *)entry->backend;
+    // adr + adrp + add + br
+    if (entry_backend->redirect_code_size != ZZ_ARM64_FULL_REDIRECT_SIZE)
+        goto fail;
+    entry_backend->shared_stub = ZzGetSharedStub(self, &self->lazy_stubs, self->lazy_thunk, (zz_addr_t)entry->target_ptr);
+    if (!entry_backend->shared_stub)
+        goto fail;
+
+    entry_backend->is_lazy = TRUE;
+    entry->lazy_state      = LAZY_STATE_WAIT;
+    return ZZ_SUCCESS;
+
+fail:
+    // the eager build prepares again
+    free(entry->backend);
+    entry->backend       = NULL;
+    entry->try_near_jump = FALSE;
+    return ZZ_FAILED;
+}
+
+ZZSTATUS ZzBuildSharedDispatchTrampoline(ZzInterceptorBackend *self, ZzHookFunctionEntry *entry) {
+    ZzARM64HookFunctionEntryBackend *entry_backend;
+
+    if (entry->hook_type != HOOK_TYPE_FUNCTION_via_PRE_POST || entry->predicate_count)
+        return ZZ_FAILED;
+    if (entry->try_near_jump || !self->dispatch_thunk)
+        return ZZ_FAILED;
+    if (ZzBuildLeaveTrampoline(self, entry) == ZZ_FAILED)
+        return ZZ_FAILED;
+
+    if (ZzPrepareTrampolineWithRedirect(self, entry, FALSE) == ZZ_FAILED)
+        goto fail;
+    entry_backend = (ZzARM64HookFunctionEntryBackend *)entry->backend;
+    if (entry_backend->redirect_code_size != ZZ_ARM64_FULL_REDIRECT_SIZE)
+        goto fail;
+    entry_backend->shared_stub =
+        ZzGetSharedStub(self, &self->dispatch_stubs, self->dispatch_thunk, (zz_addr_t)entry->target_ptr);
+    if (!entry_backend->shared_stub)
+        goto fail;
+
+    // the relocated prologue is the only code of the entry
+    entry_backend->is_shared_dispatch = TRUE;
+    if (ZzBuildInvokeTrampoline(self, entry) == ZZ_FAILED)
+        goto fail;
+    return ZZ_SUCCESS;
+
+fail:
+    free(entry->backend);
+    entry->backend       = NULL;
+    entry->try_near_jump = FALSE;
+    return ZZ_FAILED;
+}
+
+// write the bytes that changed only, a new branch literal is a single word store. a literal straddling the atomic
+// width is written with the other threads suspended, none of them may load it half written.
+static bool ZzRepatchCode(ZzAllocator *allocator, zz_addr_t address, zz_ptr_t codedata, zz_size_t codedata_size) {
+    zz_size_t begin = 0, end = codedata_size;
+    bool patched;
+
+    while (begin < end && ((char *)address)[begin] == ((char *)codedata)[begin])
+        begin++;
+    while (end > begin && ((char *)address)[end - 1] == ((char *)codedata)[end - 1])
+        end--;
+    if (begin == end)
+        return TRUE;
+    if (ZzMemoryIsAtomicPatchable(address + begin, end - begin))
+        return ZzAllocatorPatchCode(allocator, address + begin, (char *)codedata + begin, end - begin);
+
+    if (!ZzThreadSuspendOtherThreads()) {
+        ZZ_ERROR_LOG_STR("suspend other threads failed!");
+        return FALSE;
+    }
+    patched = ZzAllocatorPatchCode(allocator, address + begin, (char *)codedata + begin, end - begin);
+    ZzThreadResumeOtherThreads();
+    return patched;
+}
+
+ZZSTATUS ZzRelocateHotTrampoline(ZzInterceptorBackend *self, ZzHookFunctionEntry *entry) {
+    char temp_code_slice[64]                       = {0};
+    ZzARM64HookFunctionEntryBackend *entry_backend = (ZzARM64HookFunctionEntryBackend *)entry->backend;
+    ZzARM64AssemblerWriter *arm64_writer           = &self->arm64_writer;
+    zz_ptr_t transfer                              = entry->on_enter_transfer_trampoline;
+    ZZSTATUS status                                = ZZ_FAILED;
+    FunctionBackup redirect_code;
+
+    if (!entry_backend || entry->hook_type != HOOK_TYPE_FUNCTION_via_PRE_POST || !entry->on_invoke_trampoline)
+        return ZZ_FAILED;
+    if (entry_backend->is_lazy && entry->lazy_state != LAZY_STATE_READY)
+        return ZZ_FAILED;
+
+    // a shared dispatch entry has the invoke trampoline only
+    self->allocator->allocate_hot = TRUE;
+    if (entry->on_enter_trampoline && ZzBuildEnterTrampoline(self, entry) == ZZ_FAILED)
+        goto out;
+    if (ZzBuildInvokeTrampoline(self, entry) == ZZ_FAILED)
+        goto out;
+    status = ZZ_SUCCESS;
+out:
+    self->allocator->allocate_hot = FALSE;
+    if (status == ZZ_FAILED)
+        return ZZ_FAILED;
+
+    if (transfer) {
+        zz_arm64_writer_reset(arm64_writer, temp_code_slice, (zz_addr_t)transfer);
+        zz_arm64_writer_put_ldr_br_reg_address(arm64_writer, ZZ_ARM64_REG_X17, (zz_addr_t)entry->on_enter_trampoline);
+        if (!ZzRepatchCode(self->allocator, (zz_addr_t)transfer, (zz_ptr_t)arm64_writer->w_start_address,
+                           arm64_writer->size))
+            return ZZ_FAILED;
+    } else if (entry->on_enter_trampoline && entry->isEnabled) {
+        if (ZzBuildRedirectCode(self, entry, &redirect_code) == ZZ_FAILED)
+            return ZZ_FAILED;
+        if (!ZzRepatchCode(self->allocator, (zz_addr_t)redirect_code.address, (zz_ptr_t)redirect_code.data,
+                           redirect_code.size))
+            return ZZ_FAILED;
+    }
+    return ZZ_SUCCESS;
+}
+
+// a thread already past the first instruction finishes the thunk path, the old trampoline is left as is. the `b` is
+// encoded by hand, the hit may come from a build holding the shared writer.
+ZZSTATUS ZzBypassEnterTrampoline(ZzInterceptorBackend *self, ZzHookFunctionEntry *entry) {
+    zz_addr_t enter  = (zz_addr_t)entry->on_enter_trampoline;
+    zz_addr_t invoke = (zz_addr_t)entry->on_invoke_trampoline;
+    zz_size_t distance;
+    uint32_t insn;
+
+    if (!enter || !invoke)
+        return ZZ_FAILED;
+    distance = invoke > enter ? invoke - enter : enter - invoke;
+    if (distance >= zz_arm64_writer_near_jump_range_size())
+        return ZZ_FAILED;
+
+    insn = 0x14000000 | (((invoke - enter) >> 2) & 0x03ffffff);
+    if (!ZzAllocatorPatchCode(self->allocator, enter, (zz_ptr_t)&insn, sizeof(insn)))
+        return ZZ_FAILED;
+    return ZZ_SUCCESS;
+}
+
+ZZSTATUS ZzActivateTrampoline(ZzInterceptorBackend *self, ZzHookFunctionEntry *entry) {
+    FunctionBackup redirect_code;
+
+    if (ZzBuildRedirectCode(self, entry, &redirect_code) == ZZ_FAILED)
+        return ZZ_FAILED;
+    // a single aligned instruction (tiny redirect) is published with one atomic store.
+    if (ZzMemoryPatchCodeAtomic((zz_addr_t)redirect_code.address, (zz_ptr_t)redirect_code.data, redirect_code.size))
+        return ZZ_SUCCESS;
+    if (!ZzMemoryPatchCode((zz_addr_t)redirect_code.address, (zz_ptr_t)redirect_code.data, redirect_code.size))
+        return ZZ_FAILED;
+    return ZZ_SUCCESS;
+}
+
 #ifdef TARGET_IS_IOS
 
 #include "MachoKit/macho_kit.h"
@@ -24,6 +24,8 @@
 #include "platforms/arch-arm64/writer-arm64.h"
 #include "platforms/arch-arm64/reader-arm64.h"
 
+#include "prologue-arm64.h"
+
 
 #include "allocator.h"
 #include "interceptor.h"
@@ -32,6 +34,13 @@
 
 #define CTX_SAVE_STACK_OFFSET (8 + 30 * 8 + 8 * 16)
 
+// stubs passing the target in x16 to a shared thunk, one per adrp range (+-4GB)
+typedef struct _ZzARM64SharedStubSet {
+    zz_ptr_t *stubs;
+    zz_size_t size;
+    zz_size_t capacity;
+} ZzARM64SharedStubSet;
+
 typedef struct _ZzInterceptorBackend {
     ZzAllocator *allocator;
     ZzARM64Relocator arm64_relocator;
@@ -42,11 +51,34 @@ typedef struct _ZzInterceptorBackend {
     zz_ptr_t insn_leave_thunk;
     zz_ptr_t leave_thunk;
     zz_ptr_t dynamic_binary_instrumentation_thunk;
+    zz_ptr_t lazy_thunk;
+    zz_ptr_t dispatch_thunk;
+    // block dbi: the head callback, the translation of an unchained exit, the indirect branch lookup
+    zz_ptr_t block_thunk;
+    zz_ptr_t block_translate_thunk;
+    zz_ptr_t block_indirect_thunk;
+    // return address of every pre/post call, built with the first entry
+    zz_ptr_t leave_trampoline;
+
+    ZzARM64SharedStubSet lazy_stubs;
+    ZzARM64SharedStubSet dispatch_stubs;
 } ZzInterceptorBackend;
 
 typedef struct _ZzARM64HookFuntionEntryBackend {
     bool is_thumb;
     zz_size_t redirect_code_size;
+    // why the prologue window is smaller than the full redirect, and the instruction that says so
+    ZzARM64PrologueLimit redirect_limit;
+    zz_addr_t redirect_limit_address;
+    // the near slice of the tiny redirect transfer trampoline until it is built
+    zz_ptr_t near_transfer_trampoline;
+    bool is_lazy;
+    bool is_shared_dispatch;
+    zz_ptr_t shared_stub;
+    struct _ZzARM64BlockCache *block_cache;
+    // the invoke trampoline of the trampoline cache, and the load bias of its module
+    const struct _ZzTrampolineCacheRecord *cache_record;
+    zz_addr_t cache_load_bias;
 } ZzARM64HookFunctionEntryBackend;
 
 void ctx_save();
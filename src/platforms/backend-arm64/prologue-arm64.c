@@ -0,0 +1,100 @@
+#include "prologue-arm64.h"
+#include "platforms/arch-arm64/instructions.h"
+#include "platforms/arch-arm64/reader-arm64.h"
+
+static void ZzARM64LimitPrologue(ZzARM64PrologueAnalysis *analysis, zz_size_t safe_size, ZzARM64PrologueLimit limit,
+                                 zz_addr_t insn_address) {
+    if (safe_size >= analysis->safe_size)
+        return;
+    analysis->safe_size     = safe_size;
+    analysis->limit         = limit;
+    analysis->limit_address = insn_address;
+}
+
+// the pc relative target of a direct branch, a literal load or adr, 0 for the rest
+static zz_addr_t ZzARM64DirectTarget(zz_addr_t pc, uint32_t insn, bool *is_literal) {
+    *is_literal = FALSE;
+    switch (GetARM64InsnType(insn)) {
+    case ARM64_INS_B:
+    case ARM64_INS_BL:
+        return pc + sign_extend((uint64_t)get_insn_sub(insn, 0, 26) << 2, 28);
+    case ARM64_INS_B_cond:
+    case ARM64_INS_CBZ_CBNZ:
+        return pc + sign_extend((uint64_t)get_insn_sub(insn, 5, 19) << 2, 21);
+    case ARM64_INS_TBZ_TBNZ:
+        return pc + sign_extend((uint64_t)get_insn_sub(insn, 5, 14) << 2, 16);
+    case ARM64_INS_ADR:
+        *is_literal = TRUE;
+        return pc + sign_extend((uint64_t)get_insn_sub(insn, 5, 19) << 2 | get_insn_sub(insn, 29, 2), 21);
+    default:;
+    }
+    // ldr (w/x/s/d/q/sw) and prfm literal
+    if ((insn & 0x3b000000) == 0x18000000) {
+        *is_literal = TRUE;
+        return pc + sign_extend((uint64_t)get_insn_sub(insn, 5, 19) << 2, 21);
+    }
+    return 0;
+}
+
+void ZzARM64AnalyzePrologue(zz_addr_t address, zz_size_t window_size, zz_size_t size_limit,
+                            ZzARM64PrologueAnalysis *analysis) {
+    zz_size_t scan_size = ZZ_ARM64_PROLOGUE_SCAN_SIZE;
+    zz_addr_t furthest = address, pc, target;
+    ARM64InsnType type;
+    bool is_literal;
+    uint32_t insn;
+
+    if (size_limit && size_limit < scan_size)
+        scan_size = size_limit & ~(zz_size_t)3;
+    if (window_size > scan_size)
+        window_size = scan_size;
+
+    analysis->safe_size     = window_size;
+    analysis->limit         = ZZ_ARM64_PROLOGUE_LIMIT_NONE;
+    analysis->limit_address = 0;
+
+    for (pc = address; pc < address + scan_size; pc += 4) {
+        insn = *(uint32_t *)pc;
+        // `udf #0`, nothing falls through it
+        if (insn == 0) {
+            ZzARM64LimitPrologue(analysis, pc - address, ZZ_ARM64_PROLOGUE_LIMIT_DATA, pc);
+            break;
+        }
+
+        target = ZzARM64DirectTarget(pc, insn, &is_literal);
+        // a branch to the start runs the redirect again, that is fine
+        if (target > address && target < address + window_size)
+            ZzARM64LimitPrologue(analysis, target - address,
+                                 is_literal ? ZZ_ARM64_PROLOGUE_LIMIT_LITERAL : ZZ_ARM64_PROLOGUE_LIMIT_BRANCH_TARGET,
+                                 pc);
+
+        // a call or a tail call far away does not extend the function
+        type = GetARM64InsnType(insn);
+        if (!is_literal && type != ARM64_INS_BL && target > furthest && target < address + scan_size)
+            furthest = target;
+
+        if (type == ARM64_INS_B || type == ARM64_INS_BR || type == ARM64_INS_RET) {
+            ZzARM64LimitPrologue(analysis, pc + 4 - address, ZZ_ARM64_PROLOGUE_LIMIT_FUNCTION_END, pc);
+            // no branch jumps over it, the function ends here
+            if (pc >= furthest)
+                break;
+        }
+    }
+    analysis->scan_size = pc - address;
+}
+
+const char *ZzARM64PrologueLimitDescription(ZzARM64PrologueLimit limit) {
+    switch (limit) {
+    case ZZ_ARM64_PROLOGUE_LIMIT_NONE:
+        return "none";
+    case ZZ_ARM64_PROLOGUE_LIMIT_FUNCTION_END:
+        return "the function ends (ret, tail call or br) inside the window";
+    case ZZ_ARM64_PROLOGUE_LIMIT_BRANCH_TARGET:
+        return "a branch lands inside the window";
+    case ZZ_ARM64_PROLOGUE_LIMIT_LITERAL:
+        return "a literal load or adr reads inside the window";
+    case ZZ_ARM64_PROLOGUE_LIMIT_DATA:
+        return "data or padding inside the window";
+    }
+    return "unknown";
+}
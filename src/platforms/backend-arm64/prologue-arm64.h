@@ -0,0 +1,38 @@
+#ifndef platforms_backend_arm64_prologue_arm64
+#define platforms_backend_arm64_prologue_arm64
+
+#include "hookzz.h"
+#include "kitzz.h"
+
+// the prologue window a redirect may overwrite. the function is swept from its start until the last terminator no
+// forward branch jumps over (at most ZZ_ARM64_PROLOGUE_SCAN_SIZE bytes, or the function size if known), every branch
+// or literal reaching into the window, and every terminator inside it, shrinks the window.
+
+#define ZZ_ARM64_PROLOGUE_SCAN_SIZE 4096
+
+// `b` near jump, `ldr x17, #8; br x17; .quad` (or adr + adrp + add + br to a shared stub)
+#define ZZ_ARM64_TINY_REDIRECT_SIZE 4
+#define ZZ_ARM64_FULL_REDIRECT_SIZE 16
+
+typedef enum _ZzARM64PrologueLimit {
+    ZZ_ARM64_PROLOGUE_LIMIT_NONE = 0,
+    ZZ_ARM64_PROLOGUE_LIMIT_FUNCTION_END,  // ret, b (tail call) or br inside the window, the next bytes are not ours
+    ZZ_ARM64_PROLOGUE_LIMIT_BRANCH_TARGET, // a branch of the function lands inside the window
+    ZZ_ARM64_PROLOGUE_LIMIT_LITERAL,       // a literal load or adr reads inside the window
+    ZZ_ARM64_PROLOGUE_LIMIT_DATA           // a zero word inside the window, padding or a literal pool
+} ZzARM64PrologueLimit;
+
+typedef struct _ZzARM64PrologueAnalysis {
+    zz_size_t safe_size; // bytes from the start which may be overwritten, at most the window size
+    ZzARM64PrologueLimit limit;
+    zz_addr_t limit_address; // the instruction which shrank the window most
+    zz_size_t scan_size;
+} ZzARM64PrologueAnalysis;
+
+// size_limit is the size of the function (0 if unknown), neither the sweep nor the window go past it
+void ZzARM64AnalyzePrologue(zz_addr_t address, zz_size_t window_size, zz_size_t size_limit,
+                            ZzARM64PrologueAnalysis *analysis);
+
+const char *ZzARM64PrologueLimitDescription(ZzARM64PrologueLimit limit);
+
+#endif
@@ -1,5 +1,8 @@
 #include "thunker-arm64.h"
 #include "backend-arm64-helper.h"
+#include "block-arm64.h"
+#include "coverage.h"
+#include "trampoline.h"
 #include <string.h>
 
 /*
@@ -88,6 +91,7 @@
 void function_context_begin_invocation(ZzHookFunctionEntry *entry, zz_ptr_t next_hop, RegState *rs,
                                        zz_ptr_t caller_ret_addr) {
     ZZ_DEBUG_LOG("target %p call begin-invocation", entry->target_ptr);
+    __atomic_fetch_add(&entry->hit_count, 1, __ATOMIC_RELAXED);
 
     /* for easy debug */
     // if (!strcmp((char *)(rs->general.regs.x1), "_beginBackgroundTaskWithName:expirationHandler:")) {
@@ -98,17 +102,11 @@ void function_context_begin_invocation(ZzHookFunctionEntry *entry, zz_ptr_t next
         stack = ZzNewThreadStack(entry->thread_local_key);
     }
     ZzCallStack *callstack = ZzNewCallStack();
+    callstack->entry       = entry;
     ZzPushCallStack(stack, callstack);
 
-    /* call pre_call */
-    if (entry->pre_call) {
-        PRECALL pre_call;
-        HookEntryInfo entry_info;
-        entry_info.hook_id      = entry->id;
-        entry_info.hook_address = entry->target_ptr;
-        pre_call                = entry->pre_call;
-        (*pre_call)(rs, (ThreadStack *)stack, (CallStack *)callstack, &entry_info);
-    }
+    /* call pre_call of each listener */
+    ZzDispatchPreCall(entry, rs, stack, callstack);
 
     /* set next hop */
     if (entry->replace_call) {
@@ -117,9 +115,14 @@ void function_context_begin_invocation(ZzHookFunctionEntry *entry, zz_ptr_t next
         *(zz_ptr_t *)next_hop = entry->on_invoke_trampoline;
     }
 
-    if (entry->hook_type == HOOK_TYPE_FUNCTION_via_PRE_POST) {
+    // every hook returns through the shared leave trampoline, the callstack knows the entry
+    if (entry->hook_type == HOOK_TYPE_FUNCTION_via_PRE_POST || entry->hook_type == HOOK_TYPE_FUNCTION_via_GOT ||
+        entry->hook_type == HOOK_TYPE_FUNCTION_via_CALL_SITE) {
         callstack->caller_ret_addr   = *(zz_ptr_t *)caller_ret_addr;
-        *(zz_ptr_t *)caller_ret_addr = entry->on_leave_trampoline;
+        *(zz_ptr_t *)caller_ret_addr = ((ZzInterceptorBackend *)entry->interceptor->backend)->leave_trampoline;
+    } else if (entry->hook_type != HOOK_TYPE_ONE_INSTRUCTION) {
+        // no post call, the insn hook has its own in insn_context_end_invocation
+        ZzReleaseHookListeners(entry, callstack);
     }
 }
 
@@ -135,14 +138,8 @@ void insn_context_end_invocation(ZzHookFunctionEntry *entry, zz_ptr_t next_hop,
     }
     ZzCallStack *callstack = ZzPopCallStack(threadstack);
 
-    if (entry->post_call) {
-        POSTCALL post_call;
-        HookEntryInfo entry_info;
-        entry_info.hook_id      = entry->id;
-        entry_info.hook_address = entry->target_ptr;
-        post_call               = entry->post_call;
-        (*post_call)(rs, (ThreadStack *)threadstack, (CallStack *)callstack, (const HookEntryInfo *)&entry_info);
-    }
+    /* call post_call of each listener */
+    ZzDispatchPostCall(entry, rs, threadstack, callstack);
 
     // set next hop
     *(zz_ptr_t *)next_hop = (zz_ptr_t)entry->next_insn_addr;
@@ -153,8 +150,11 @@ void insn_context_end_invocation(ZzHookFunctionEntry *entry, zz_ptr_t next_hop,
 
 void dynamic_binary_instrumentation_invocation(ZzHookFunctionEntry *entry, zz_ptr_t next_hop, RegState *rs) {
 
-    /* call pre_call */
-    if (entry->pre_call) {
+    if (entry->hook_type == HOOK_TYPE_ONE_SHOT)
+        ZzOneShotHitEntry(entry);
+
+    /* call stub_call */
+    if (entry->stub_call) {
         STUBCALL pre_call;
         HookEntryInfo entry_info;
         entry_info.hook_id      = entry->id;
@@ -167,26 +167,48 @@ void dynamic_binary_instrumentation_invocation(ZzHookFunctionEntry *entry, zz_pt
     *(zz_ptr_t *)next_hop = entry->on_invoke_trampoline;
 }
 
-void function_context_end_invocation(ZzHookFunctionEntry *entry, zz_ptr_t next_hop, RegState *rs) {
-    ZZ_DEBUG_LOG("%p call end-invocation", entry->target_ptr);
+// the lazy stub passes the target instead of the entry.
+void lazy_context_materialize(zz_ptr_t target_ptr, zz_ptr_t next_hop, RegState *rs, zz_ptr_t caller_ret_addr) {
+    ZzHookFunctionEntry *entry = ZzFindHookFunctionEntry(target_ptr);
 
-    ZzThreadStack *stack = ZzGetCurrentThreadStack(entry->thread_local_key);
+    ZZ_DEBUG_LOG("target %p call materialize", target_ptr);
+    // freed by now, its prologue is given back, run the original code
+    if (!entry) {
+        ZZ_ERROR_LOG("no entry of %p, run the origin function!", target_ptr);
+        *(zz_ptr_t *)next_hop = target_ptr;
+        return;
+    }
+    *(zz_ptr_t *)next_hop = ZzMaterializeHookFunctionEntry(entry);
+}
+
+// the shared dispatcher passes the target instead of the entry.
+void dispatch_context_begin_invocation(zz_ptr_t target_ptr, zz_ptr_t next_hop, RegState *rs, zz_ptr_t caller_ret_addr) {
+    ZzHookFunctionEntry *entry = ZzFindHookFunctionEntry(target_ptr);
+
+    // freed by now, its prologue is given back, run the original code
+    if (!entry) {
+        ZZ_ERROR_LOG("no entry of %p, run the origin function!", target_ptr);
+        *(zz_ptr_t *)next_hop = target_ptr;
+        return;
+    }
+    function_context_begin_invocation(entry, next_hop, rs, caller_ret_addr);
+}
+
+// the shared leave trampoline passes the thread local key, the entry is the one of the innermost call.
+void function_context_end_invocation(zz_ptr_t thread_local_key, zz_ptr_t next_hop, RegState *rs) {
+    ZzThreadStack *stack = ZzGetCurrentThreadStack(thread_local_key);
     if (!stack) {
 #if defined(DEBUG_MODE)
         debug_break();
 #endif
     }
-    ZzCallStack *callstack = ZzPopCallStack(stack);
+    ZzCallStack *callstack     = ZzPopCallStack(stack);
+    ZzHookFunctionEntry *entry = (ZzHookFunctionEntry *)callstack->entry;
 
-    /* call post_call */
-    if (entry->post_call) {
-        POSTCALL post_call;
-        HookEntryInfo entry_info;
-        entry_info.hook_id      = entry->id;
-        entry_info.hook_address = entry->target_ptr;
-        post_call               = entry->post_call;
-        (*post_call)(rs, (ThreadStack *)stack, (CallStack *)callstack, (const HookEntryInfo *)&entry_info);
-    }
+    ZZ_DEBUG_LOG("%p call end-invocation", entry->target_ptr);
+
+    /* call post_call of each listener */
+    ZzDispatchPostCall(entry, rs, stack, callstack);
 
     /* set next hop */
     *(zz_ptr_t *)next_hop = callstack->caller_ret_addr;
@@ -493,7 +515,7 @@ void zz_arm64_thunker_build_leave_thunk(ZzARM64AssemblerWriter *writer) {
     zz_arm64_writer_put_sub_reg_reg_imm(writer, ZZ_ARM64_REG_SP, ZZ_ARM64_REG_SP, 2 * 8);
 
     // pass enter func args
-    /* 1. entry */
+    /* 1. thread local key */
     zz_arm64_writer_put_ldr_reg_reg_offset(writer, ZZ_ARM64_REG_X0, ZZ_ARM64_REG_SP, 2 * 8 + 8 + CTX_SAVE_STACK_OFFSET);
     /* 2. next hop*/
     zz_arm64_writer_put_add_reg_reg_imm(writer, ZZ_ARM64_REG_X1, ZZ_ARM64_REG_SP,
@@ -562,6 +584,89 @@ void zz_arm64_thunker_build_dynamic_binary_instrumentation_thunk(ZzARM64Assemble
     zz_arm64_writer_put_br_reg(writer, ZZ_ARM64_REG_X17);
 }
 
+// the frame of the enter thunk, the stub has stored the invocation arg in [sp]. a mid function stub (the block dbi)
+// is not at a call boundary, the flags and q8-q31 may be live too.
+static void zz_arm64_thunker_build_context_thunk(ZzARM64AssemblerWriter *writer, zz_addr_t invocation,
+                                                 bool mid_function) {
+    // save general registers and sp
+    zz_arm64_writer_put_bytes(writer, (void *)ctx_save, 23 * 4);
+    zz_arm64_writer_put_add_reg_reg_imm(writer, ZZ_ARM64_REG_X1, ZZ_ARM64_REG_SP, 8 + CTX_SAVE_STACK_OFFSET + 2 * 8);
+
+    // trick: use the `ctx_save` left [sp]
+    zz_arm64_writer_put_str_reg_reg_offset(writer, ZZ_ARM64_REG_X1, ZZ_ARM64_REG_SP, 0 * 8);
+
+    // alignment padding + dummy PC
+    zz_arm64_writer_put_sub_reg_reg_imm(writer, ZZ_ARM64_REG_SP, ZZ_ARM64_REG_SP, 2 * 8);
+
+    // pass invocation func args
+    // stub arg
+    zz_arm64_writer_put_ldr_reg_reg_offset(writer, ZZ_ARM64_REG_X0, ZZ_ARM64_REG_SP, 2 * 8 + 8 + CTX_SAVE_STACK_OFFSET);
+    // next hop
+    zz_arm64_writer_put_add_reg_reg_imm(writer, ZZ_ARM64_REG_X1, ZZ_ARM64_REG_SP,
+                                        2 * 8 + 8 + CTX_SAVE_STACK_OFFSET + 0x8);
+    // RegState
+    zz_arm64_writer_put_add_reg_reg_imm(writer, ZZ_ARM64_REG_X2, ZZ_ARM64_REG_SP, 2 * 8);
+    // caller ret address
+    zz_arm64_writer_put_add_reg_reg_imm(writer, ZZ_ARM64_REG_X3, ZZ_ARM64_REG_SP, 2 * 8 + 2 * 8 + 28 * 8 + 8);
+
+    if (mid_function) {
+        // x19 is callee saved and restored by `ctx_restore`
+        // mrs x19, nzcv
+        zz_arm64_writer_put_instruction(writer, 0xd53b4213);
+        zz_arm64_writer_put_sub_reg_reg_imm(writer, ZZ_ARM64_REG_SP, ZZ_ARM64_REG_SP, 24 * 16);
+        // stp q8 ... q31, [sp, #(i * 16)]
+        for (int i = 0; i < 24; i += 2)
+            zz_arm64_writer_put_instruction(writer, 0xad000000 | (i & 0x7f) << 15 | (9 + i) << 10 |
+                                                        31 << 5 | (8 + i));
+    }
+
+    zz_arm64_writer_put_ldr_blr_b_reg_address(writer, ZZ_ARM64_REG_X17, invocation);
+
+    if (mid_function) {
+        // ldp q8 ... q31, [sp, #(i * 16)]
+        for (int i = 0; i < 24; i += 2)
+            zz_arm64_writer_put_instruction(writer, 0xad400000 | (i & 0x7f) << 15 | (9 + i) << 10 |
+                                                        31 << 5 | (8 + i));
+        zz_arm64_writer_put_add_reg_reg_imm(writer, ZZ_ARM64_REG_SP, ZZ_ARM64_REG_SP, 24 * 16);
+        // msr nzcv, x19
+        zz_arm64_writer_put_instruction(writer, 0xd51b4213);
+    }
+
+    // alignment padding + dummy PC
+    zz_arm64_writer_put_add_reg_reg_imm(writer, ZZ_ARM64_REG_SP, ZZ_ARM64_REG_SP, 2 * 8);
+
+    /* restore general registers stack */
+    zz_arm64_writer_put_bytes(writer, (void *)ctx_restore, 21 * 4);
+
+    /* load next hop to x17 */
+    zz_arm64_writer_put_ldr_reg_reg_offset(writer, ZZ_ARM64_REG_X17, ZZ_ARM64_REG_SP, 0x8);
+
+    /* restore next hop and arg stack */
+    zz_arm64_writer_put_add_reg_reg_imm(writer, ZZ_ARM64_REG_SP, ZZ_ARM64_REG_SP, 2 * 8);
+
+    /* jump to next hop */
+    zz_arm64_writer_put_br_reg(writer, ZZ_ARM64_REG_X17);
+}
+
+void zz_arm64_thunker_build_lazy_thunk(ZzARM64AssemblerWriter *writer) {
+    zz_arm64_thunker_build_context_thunk(writer, (zz_addr_t)lazy_context_materialize, FALSE);
+}
+
+void zz_arm64_thunker_build_dispatch_thunk(ZzARM64AssemblerWriter *writer) {
+    zz_arm64_thunker_build_context_thunk(writer, (zz_addr_t)dispatch_context_begin_invocation, FALSE);
+}
+
+void zz_arm64_thunker_build_block_thunk(ZzARM64AssemblerWriter *writer) {
+    zz_arm64_thunker_build_context_thunk(writer, (zz_addr_t)block_context_begin_invocation, TRUE);
+}
+
+void zz_arm64_thunker_build_block_translate_thunk(ZzARM64AssemblerWriter *writer) {
+    zz_arm64_thunker_build_context_thunk(writer, (zz_addr_t)block_context_translate_invocation, TRUE);
+}
+
+void zz_arm64_thunker_build_block_indirect_thunk(ZzARM64AssemblerWriter *writer) {
+    zz_arm64_thunker_build_context_thunk(writer, (zz_addr_t)block_context_indirect_invocation, TRUE);
+}
 
 ZZSTATUS ZzThunkerBuildThunk(ZzInterceptorBackend *self) {
     char temp_code_slice[512]       = {0};
@@ -655,5 +760,105 @@ ZZSTATUS ZzThunkerBuildThunk(ZzInterceptorBackend *self) {
         HookZzDebugInfoLog("%s", buffer);
     }
 
+    /* build lazy_thunk */
+    zz_arm64_writer_reset(arm64_writer, temp_code_slice, 0);
+    zz_arm64_thunker_build_lazy_thunk(arm64_writer);
+
+    /* code patch */
+    code_slice = zz_arm64_code_patch(arm64_writer, self->allocator, 0, 0);
+    if (code_slice)
+        self->lazy_thunk = code_slice->data;
+    else
+        return ZZ_FAILED;
+
+    /* debug log */
+    if (HookZzDebugInfoIsEnable()) {
+        char buffer[1024] = {};
+        sprintf(buffer + strlen(buffer), "%s\n", "ZzThunkerBuildThunk:");
+        sprintf(buffer + strlen(buffer), "LogInfo: lazy_thunk at %p, length: %ld.\n", code_slice->data,
+                code_slice->size);
+        HookZzDebugInfoLog("%s", buffer);
+    }
+
+    /* build dispatch_thunk */
+    zz_arm64_writer_reset(arm64_writer, temp_code_slice, 0);
+    zz_arm64_thunker_build_dispatch_thunk(arm64_writer);
+
+    /* code patch */
+    code_slice = zz_arm64_code_patch(arm64_writer, self->allocator, 0, 0);
+    if (code_slice)
+        self->dispatch_thunk = code_slice->data;
+    else
+        return ZZ_FAILED;
+
+    /* debug log */
+    if (HookZzDebugInfoIsEnable()) {
+        char buffer[1024] = {};
+        sprintf(buffer + strlen(buffer), "%s\n", "ZzThunkerBuildThunk:");
+        sprintf(buffer + strlen(buffer), "LogInfo: dispatch_thunk at %p, length: %ld.\n", code_slice->data,
+                code_slice->size);
+        HookZzDebugInfoLog("%s", buffer);
+    }
+
+    /* build block_thunk */
+    zz_arm64_writer_reset(arm64_writer, temp_code_slice, 0);
+    zz_arm64_thunker_build_block_thunk(arm64_writer);
+
+    /* code patch */
+    code_slice = zz_arm64_code_patch(arm64_writer, self->allocator, 0, 0);
+    if (code_slice)
+        self->block_thunk = code_slice->data;
+    else
+        return ZZ_FAILED;
+
+    /* debug log */
+    if (HookZzDebugInfoIsEnable()) {
+        char buffer[1024] = {};
+        sprintf(buffer + strlen(buffer), "%s\n", "ZzThunkerBuildThunk:");
+        sprintf(buffer + strlen(buffer), "LogInfo: block_thunk at %p, length: %ld.\n", code_slice->data,
+                code_slice->size);
+        HookZzDebugInfoLog("%s", buffer);
+    }
+
+    /* build block_translate_thunk */
+    zz_arm64_writer_reset(arm64_writer, temp_code_slice, 0);
+    zz_arm64_thunker_build_block_translate_thunk(arm64_writer);
+
+    /* code patch */
+    code_slice = zz_arm64_code_patch(arm64_writer, self->allocator, 0, 0);
+    if (code_slice)
+        self->block_translate_thunk = code_slice->data;
+    else
+        return ZZ_FAILED;
+
+    /* debug log */
+    if (HookZzDebugInfoIsEnable()) {
+        char buffer[1024] = {};
+        sprintf(buffer + strlen(buffer), "%s\n", "ZzThunkerBuildThunk:");
+        sprintf(buffer + strlen(buffer), "LogInfo: block_translate_thunk at %p, length: %ld.\n", code_slice->data,
+                code_slice->size);
+        HookZzDebugInfoLog("%s", buffer);
+    }
+
+    /* build block_indirect_thunk */
+    zz_arm64_writer_reset(arm64_writer, temp_code_slice, 0);
+    zz_arm64_thunker_build_block_indirect_thunk(arm64_writer);
+
+    /* code patch */
+    code_slice = zz_arm64_code_patch(arm64_writer, self->allocator, 0, 0);
+    if (code_slice)
+        self->block_indirect_thunk = code_slice->data;
+    else
+        return ZZ_FAILED;
+
+    /* debug log */
+    if (HookZzDebugInfoIsEnable()) {
+        char buffer[1024] = {};
+        sprintf(buffer + strlen(buffer), "%s\n", "ZzThunkerBuildThunk:");
+        sprintf(buffer + strlen(buffer), "LogInfo: block_indirect_thunk at %p, length: %ld.\n", code_slice->data,
+                code_slice->size);
+        HookZzDebugInfoLog("%s", buffer);
+    }
+
     return status;
 }
@@ -6,7 +6,9 @@
 #include "trampoline.h"
 
 #include <dlfcn.h>
+#include <fnmatch.h>
 #include <mach-o/dyld.h>
+#include <pthread.h>
 
 ZZSTATUS ZzHookGOT(const char *name, zz_ptr_t replace_ptr, zz_ptr_t *origin_ptr, PRECALL pre_call_ptr,
                    POSTCALL post_call_ptr) {
@@ -25,7 +27,51 @@ ZZSTATUS ZzHookGOT(const char *name, zz_ptr_t replace_ptr, zz_ptr_t *origin_ptr,
     ZzHookFunctionEntry *entry = ZzFindHookFunctionEntry((zz_ptr_t)name);
     // TODO: fix here
     rebind_symbols_image((void *)header, slide,
-                         (struct rebinding[1]){{name, entry->on_enter_trampoline, (void **)origin_ptr}}, 1);
+                         (struct rebinding[1]){{name,
+                                                entry->on_enter_trampoline ? entry->on_enter_trampoline
+                                                                           : entry->replace_call,
+                                                (void **)origin_ptr}},
+                         1);
+    entry->isEnabled = TRUE;
+    return ZZ_SUCCESS;
+}
+
+zz_ptr_t ZzFindSymbolAddress(const char *module_name, const char *symbol_name) {
+    zz_ptr_t address;
+    void *handle;
+
+    if (!module_name)
+        return dlsym(RTLD_DEFAULT, symbol_name);
+    handle = dlopen(module_name, RTLD_NOLOAD | RTLD_LAZY);
+    if (!handle)
+        return NULL;
+    address = dlsym(handle, symbol_name);
+    dlclose(handle);
+    return address;
+}
+
+ZZSTATUS ZzHookGOTInModule(const char *module_name, const char *name, zz_ptr_t replace_ptr, zz_ptr_t *origin_ptr,
+                           PRECALL pre_call_ptr, POSTCALL post_call_ptr) {
+    ZZ_ERROR_LOG_STR("got hook of a single module is not supported on macho!");
+    return ZZ_FAILED;
+}
+
+ZZSTATUS ZzEnableHookGOT(const char *name) {
+    intptr_t (*pub_dyld_get_image_slide)(const struct mach_header *mh);
+    pub_dyld_get_image_slide         = dlsym((void *)dlopen(0, RTLD_LAZY), "_dyld_get_image_slide");
+    const struct mach_header *header = _dyld_get_image_header(0);
+    zz_size_t slide                  = pub_dyld_get_image_slide(header);
+    ZzHookFunctionEntry *entry       = ZzFindHookFunctionEntry((zz_ptr_t)name);
+
+    if (!entry)
+        return ZZ_NO_BUILD_HOOK;
+    rebind_symbols_image((void *)header, slide,
+                         (struct rebinding[1]){{name,
+                                                entry->on_enter_trampoline ? entry->on_enter_trampoline
+                                                                           : entry->replace_call,
+                                                NULL}},
+                         1);
+    entry->isEnabled = TRUE;
     return ZZ_SUCCESS;
 }
 
@@ -41,6 +87,190 @@ ZZSTATUS ZzDisableHookGOT(const char *name) {
     return ZZ_SUCCESS;
 }
 
+zz_size_t ZzFindLoadedModules(const char **module_patterns, zz_size_t count, const char **module_paths,
+                              zz_addr_t *load_biases) {
+    const char *path, *file_name;
+    zz_size_t j, matched = 0;
+    uint32_t i;
+
+    for (j = 0; j < count; j++) {
+        module_paths[j] = NULL;
+        load_biases[j]  = 0;
+    }
+    for (i = 0; i < _dyld_image_count() && matched < count; i++) {
+        path = _dyld_get_image_name(i);
+        if (!path)
+            continue;
+        file_name = strrchr(path, '/');
+        for (j = 0; j < count; j++) {
+            if (module_paths[j])
+                continue;
+            if (fnmatch(module_patterns[j], path, 0) && (!file_name || fnmatch(module_patterns[j], file_name + 1, 0)))
+                continue;
+            module_paths[j] = path;
+            load_biases[j]  = (zz_addr_t)_dyld_get_image_vmaddr_slide(i);
+            matched++;
+        }
+    }
+    return matched;
+}
+
+zz_size_t ZzGetModuleFunctions(const char *module_pattern, ZzModuleFunction **functions) {
+    const struct mach_header *header = NULL;
+    struct section_64 *text_section;
+    zz_addr_t *starts, text_end = 0, slide = 0;
+    const char *path, *file_name;
+    zz_size_t i, count;
+    Dl_info info;
+
+    *functions = NULL;
+    for (i = 0; i < _dyld_image_count(); i++) {
+        path = _dyld_get_image_name(i);
+        if (!path)
+            continue;
+        file_name = strrchr(path, '/');
+        if (fnmatch(module_pattern, path, 0) && (!file_name || fnmatch(module_pattern, file_name + 1, 0)))
+            continue;
+        header = _dyld_get_image_header(i);
+        slide  = (zz_addr_t)_dyld_get_image_vmaddr_slide(i);
+        break;
+    }
+    if (!header)
+        return 0;
+
+    count = zz_macho_get_function_starts((struct mach_header_64 *)header, &starts);
+    if (!count) {
+        free(starts);
+        return 0;
+    }
+    *functions = (ZzModuleFunction *)malloc(count * sizeof(ZzModuleFunction));
+    if (!*functions) {
+        free(starts);
+        return 0;
+    }
+
+    // a function ends where the next one starts, the last one at the end of __text
+    text_section = zz_macho_get_section_64_via_name((struct mach_header_64 *)header, (char *)"__text");
+    if (text_section)
+        text_end = text_section->addr + slide + text_section->size;
+    for (i = 0; i < count; i++) {
+        (*functions)[i].address = starts[i];
+        (*functions)[i].size    = i + 1 < count ? starts[i + 1] - starts[i]
+                                                : (text_end > starts[i] ? text_end - starts[i] : 0);
+        (*functions)[i].name    = NULL;
+        if (dladdr((void *)starts[i], &info) && (zz_addr_t)info.dli_saddr == starts[i])
+            (*functions)[i].name = info.dli_sname;
+    }
+    free(starts);
+    return count;
+}
+
+zz_size_t ZzGetModuleBuildId(zz_addr_t address, zz_addr_t *load_bias, zz_addr_t *module_start, zz_addr_t *module_end,
+                             uint8_t *build_id, zz_size_t max_size) {
+    struct mach_header_64 *header;
+    struct segment_command_64 *seg_cmd_64;
+    struct load_command *load_cmd;
+    struct uuid_command *uuid_cmd;
+    zz_addr_t start = (zz_addr_t)-1, end = 0;
+    Dl_info info;
+    uint32_t i, j;
+
+    if (!dladdr((void *)address, &info) || !info.dli_fbase || max_size < sizeof(uuid_cmd->uuid))
+        return 0;
+    uuid_cmd = (struct uuid_command *)zz_macho_get_load_command_via_cmd((struct mach_header_64 *)info.dli_fbase,
+                                                                         LC_UUID);
+    if (!uuid_cmd)
+        return 0;
+    for (i = 0; i < _dyld_image_count(); i++) {
+        if (_dyld_get_image_header(i) != (const struct mach_header *)info.dli_fbase)
+            continue;
+        // the mapped segments, __PAGEZERO maps nothing
+        header   = (struct mach_header_64 *)info.dli_fbase;
+        load_cmd = (struct load_command *)((zz_addr_t)header + sizeof(struct mach_header_64));
+        for (j = 0; j < header->ncmds; j++, load_cmd = (struct load_command *)((zz_addr_t)load_cmd + load_cmd->cmdsize)) {
+            if (load_cmd->cmd != LC_SEGMENT_64)
+                continue;
+            seg_cmd_64 = (struct segment_command_64 *)load_cmd;
+            if (!seg_cmd_64->initprot)
+                continue;
+            if (seg_cmd_64->vmaddr < start)
+                start = seg_cmd_64->vmaddr;
+            if (seg_cmd_64->vmaddr + seg_cmd_64->vmsize > end)
+                end = seg_cmd_64->vmaddr + seg_cmd_64->vmsize;
+        }
+        memcpy(build_id, uuid_cmd->uuid, sizeof(uuid_cmd->uuid));
+        *load_bias    = (zz_addr_t)_dyld_get_image_vmaddr_slide(i);
+        *module_start = start + *load_bias;
+        *module_end   = end + *load_bias;
+        return sizeof(uuid_cmd->uuid);
+    }
+    return 0;
+}
+
+bool ZzFindModuleByBuildId(const uint8_t *build_id, zz_size_t build_id_size, zz_addr_t *load_bias) {
+    struct uuid_command *uuid_cmd;
+    uint32_t i;
+
+    if (build_id_size != sizeof(uuid_cmd->uuid))
+        return FALSE;
+    for (i = 0; i < _dyld_image_count(); i++) {
+        uuid_cmd = (struct uuid_command *)zz_macho_get_load_command_via_cmd(
+            (struct mach_header_64 *)_dyld_get_image_header(i), LC_UUID);
+        if (!uuid_cmd || memcmp(uuid_cmd->uuid, build_id, build_id_size))
+            continue;
+        *load_bias = (zz_addr_t)_dyld_get_image_vmaddr_slide(i);
+        return TRUE;
+    }
+    return FALSE;
+}
+
+// macho has no program headers, the HookZzData segment of the ios solidify is looked up by name
+zz_addr_t ZzFindModuleProgramHeader(zz_addr_t address, uint32_t type, zz_addr_t *load_bias, zz_size_t *size) {
+    return 0;
+}
+
+static void (*g_module_load_callbacks[ZZ_MAX_MODULE_LOAD_CALLBACK_COUNT])(void);
+static zz_size_t g_module_load_callback_count;
+static pthread_mutex_t g_module_load_callback_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void ZzImageChanged(const struct mach_header *header, intptr_t slide) {
+    zz_size_t i, count;
+
+    pthread_mutex_lock(&g_module_load_callback_lock);
+    count = g_module_load_callback_count;
+    pthread_mutex_unlock(&g_module_load_callback_lock);
+    // a registered callback is never removed
+    for (i = 0; i < count; i++)
+        g_module_load_callbacks[i]();
+}
+
+ZZSTATUS ZzObserveModuleLoad(void (*callback)(void)) {
+    bool is_registered;
+    zz_size_t i;
+
+    pthread_mutex_lock(&g_module_load_callback_lock);
+    is_registered = g_module_load_callback_count != 0;
+    for (i = 0; i < g_module_load_callback_count; i++) {
+        if (g_module_load_callbacks[i] == callback)
+            break;
+    }
+    if (i == g_module_load_callback_count) {
+        if (g_module_load_callback_count >= ZZ_MAX_MODULE_LOAD_CALLBACK_COUNT) {
+            pthread_mutex_unlock(&g_module_load_callback_lock);
+            return ZZ_FAILED;
+        }
+        g_module_load_callbacks[g_module_load_callback_count++] = callback;
+    }
+    pthread_mutex_unlock(&g_module_load_callback_lock);
+    if (!is_registered) {
+        // dyld runs the add callback for every image already loaded as well. the remove callback runs before the
+        // image is unmapped, its hooks are reclaimed on the next change.
+        _dyld_register_func_for_add_image(ZzImageChanged);
+        _dyld_register_func_for_remove_image(ZzImageChanged);
+    }
+    return ZZ_SUCCESS;
+}
+
 // ZZSTATUS StaticBinaryInstrumentation(zz_ptr_t target_fileoff, zz_ptr_t replace_call_ptr, zz_ptr_t *origin_ptr,
 //                                      PRECALL pre_call_ptr, POSTCALL post_call_ptr) {
 //     ZZSTATUS status                                 = ZZ_DONE_HOOK;
@@ -1 +1,2 @@
 #include "deps/fishhook/fishhook.h"
+#include "MachoKit/macho_kit.h"
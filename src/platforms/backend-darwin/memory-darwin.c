@@ -28,10 +28,24 @@ zz_ptr_t ZzMemoryAllocateNearPages(zz_addr_t address, zz_size_t redirect_range_s
 
 zz_ptr_t ZzMemoryAllocate(zz_size_t size) { return zz_vm_allocate_via_task(mach_task_self(), size); }
 
+// no rwx mapping (codesign), the trampolines stay on the single pages.
+zz_ptr_t ZzMemoryAllocateHugePageArena(zz_addr_t address, zz_size_t size) { return NULL; }
+
+zz_ptr_t ZzMemoryAllocateNearHugePageArena(zz_addr_t address, zz_size_t redirect_range_size, zz_size_t size) {
+    return NULL;
+}
+
 bool ZzMemoryPatchCode(const zz_addr_t address, const zz_ptr_t codedata, zz_size_t codedata_size) {
     return zz_vm_patch_code_via_task(mach_task_self(), address, codedata, codedata_size);
 }
 
+// code pages can't be mapped rwx (codesign), always use the page remap patch.
+bool ZzMemoryIsAtomicPatchable(const zz_addr_t address, zz_size_t codedata_size) { return FALSE; }
+
+bool ZzMemoryPatchCodeAtomic(const zz_addr_t address, const zz_ptr_t codedata, zz_size_t codedata_size) {
+    return FALSE;
+}
+
 bool ZzMemoryProtectAsExecutable(const zz_addr_t address, zz_size_t size) {
 
     return zz_vm_protect_as_executable_via_task(mach_task_self(), address, size);
@@ -0,0 +1,149 @@
+/**
+ *    Copyright 2017 jmpews
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#include "thread-darwin.h"
+
+#include <mach/mach.h>
+
+#if defined(__arm64__) || defined(__aarch64__)
+#define ZZ_DARWIN_THREAD_STATE ARM_THREAD_STATE64
+#define ZZ_DARWIN_THREAD_STATE_COUNT ARM_THREAD_STATE64_COUNT
+typedef arm_thread_state64_t zz_darwin_thread_state_t;
+#define ZZ_DARWIN_THREAD_STATE_PC(state) ((state)->__pc)
+#define ZZ_DARWIN_THREAD_STATE_LR(state) ((state)->__lr)
+#elif defined(__arm__)
+#define ZZ_DARWIN_THREAD_STATE ARM_THREAD_STATE
+#define ZZ_DARWIN_THREAD_STATE_COUNT ARM_THREAD_STATE_COUNT
+typedef arm_thread_state_t zz_darwin_thread_state_t;
+#define ZZ_DARWIN_THREAD_STATE_PC(state) ((state)->__pc)
+#define ZZ_DARWIN_THREAD_STATE_LR(state) ((state)->__lr)
+#else
+#define ZZ_DARWIN_THREAD_STATE x86_THREAD_STATE64
+#define ZZ_DARWIN_THREAD_STATE_COUNT x86_THREAD_STATE64_COUNT
+typedef x86_thread_state64_t zz_darwin_thread_state_t;
+#define ZZ_DARWIN_THREAD_STATE_PC(state) ((state)->__rip)
+#endif
+
+// the threads of task_threads, the current thread is kept as MACH_PORT_NULL.
+static thread_act_array_t g_suspended_threads;
+static mach_msg_type_number_t g_suspended_thread_count;
+
+static void ZzThreadDeallocateSuspendedThreads() {
+    mach_msg_type_number_t i;
+
+    for (i = 0; i < g_suspended_thread_count; i++) {
+        if (g_suspended_threads[i] != MACH_PORT_NULL)
+            mach_port_deallocate(mach_task_self(), g_suspended_threads[i]);
+    }
+    vm_deallocate(mach_task_self(), (vm_address_t)g_suspended_threads,
+                  sizeof(thread_act_t) * g_suspended_thread_count);
+    g_suspended_threads      = NULL;
+    g_suspended_thread_count = 0;
+}
+
+bool ZzThreadSuspendOtherThreads() {
+    thread_act_t self = mach_thread_self();
+    mach_msg_type_number_t i;
+
+    if (g_suspended_threads)
+        return FALSE;
+    if (task_threads(mach_task_self(), &g_suspended_threads, &g_suspended_thread_count) != KERN_SUCCESS) {
+        g_suspended_threads      = NULL;
+        g_suspended_thread_count = 0;
+        mach_port_deallocate(mach_task_self(), self);
+        return FALSE;
+    }
+    for (i = 0; i < g_suspended_thread_count; i++) {
+        if (g_suspended_threads[i] == self) {
+            mach_port_deallocate(mach_task_self(), g_suspended_threads[i]);
+            g_suspended_threads[i] = MACH_PORT_NULL;
+            continue;
+        }
+        // a thread that already exited is skipped, the others must stop or nothing is patched.
+        if (thread_suspend(g_suspended_threads[i]) != KERN_SUCCESS) {
+            mach_port_deallocate(mach_task_self(), g_suspended_threads[i]);
+            g_suspended_threads[i] = MACH_PORT_NULL;
+        }
+    }
+    mach_port_deallocate(mach_task_self(), self);
+    return TRUE;
+}
+
+zz_size_t ZzThreadGetSuspendedThreadCount() { return g_suspended_thread_count; }
+
+zz_addr_t ZzThreadGetSuspendedThreadPC(zz_size_t index) {
+    zz_darwin_thread_state_t state;
+    mach_msg_type_number_t state_count = ZZ_DARWIN_THREAD_STATE_COUNT;
+
+    if (g_suspended_threads[index] == MACH_PORT_NULL ||
+        thread_get_state(g_suspended_threads[index], ZZ_DARWIN_THREAD_STATE, (thread_state_t)&state, &state_count) !=
+            KERN_SUCCESS)
+        return 0;
+    return (zz_addr_t)ZZ_DARWIN_THREAD_STATE_PC(&state);
+}
+
+void ZzThreadSetSuspendedThreadPC(zz_size_t index, zz_addr_t pc) {
+    zz_darwin_thread_state_t state;
+    mach_msg_type_number_t state_count = ZZ_DARWIN_THREAD_STATE_COUNT;
+
+    if (g_suspended_threads[index] == MACH_PORT_NULL ||
+        thread_get_state(g_suspended_threads[index], ZZ_DARWIN_THREAD_STATE, (thread_state_t)&state, &state_count) !=
+            KERN_SUCCESS)
+        return;
+    ZZ_DARWIN_THREAD_STATE_PC(&state) = pc;
+    thread_set_state(g_suspended_threads[index], ZZ_DARWIN_THREAD_STATE, (thread_state_t)&state, state_count);
+}
+
+zz_addr_t ZzThreadGetSuspendedThreadLR(zz_size_t index) {
+#if defined(ZZ_DARWIN_THREAD_STATE_LR)
+    zz_darwin_thread_state_t state;
+    mach_msg_type_number_t state_count = ZZ_DARWIN_THREAD_STATE_COUNT;
+
+    if (g_suspended_threads[index] == MACH_PORT_NULL ||
+        thread_get_state(g_suspended_threads[index], ZZ_DARWIN_THREAD_STATE, (thread_state_t)&state, &state_count) !=
+            KERN_SUCCESS)
+        return 0;
+    return (zz_addr_t)ZZ_DARWIN_THREAD_STATE_LR(&state);
+#else
+    return 0;
+#endif
+}
+
+void ZzThreadSetSuspendedThreadLR(zz_size_t index, zz_addr_t lr) {
+#if defined(ZZ_DARWIN_THREAD_STATE_LR)
+    zz_darwin_thread_state_t state;
+    mach_msg_type_number_t state_count = ZZ_DARWIN_THREAD_STATE_COUNT;
+
+    if (g_suspended_threads[index] == MACH_PORT_NULL ||
+        thread_get_state(g_suspended_threads[index], ZZ_DARWIN_THREAD_STATE, (thread_state_t)&state, &state_count) !=
+            KERN_SUCCESS)
+        return;
+    ZZ_DARWIN_THREAD_STATE_LR(&state) = lr;
+    thread_set_state(g_suspended_threads[index], ZZ_DARWIN_THREAD_STATE, (thread_state_t)&state, state_count);
+#endif
+}
+
+void ZzThreadResumeOtherThreads() {
+    mach_msg_type_number_t i;
+
+    if (!g_suspended_threads)
+        return;
+    for (i = 0; i < g_suspended_thread_count; i++) {
+        if (g_suspended_threads[i] != MACH_PORT_NULL)
+            thread_resume(g_suspended_threads[i]);
+    }
+    ZzThreadDeallocateSuspendedThreads();
+}
@@ -1,12 +1,12 @@
 /**
  *    Copyright 2017 jmpews
- * 
+ *
  *    Licensed under the Apache License, Version 2.0 (the "License");
  *    you may not use this file except in compliance with the License.
  *    You may obtain a copy of the License at
- * 
+ *
  *        http://www.apache.org/licenses/LICENSE-2.0
- * 
+ *
  *    Unless required by applicable law or agreed to in writing, software
  *    distributed under the License is distributed on an "AS IS" BASIS,
  *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
@@ -14,18 +14,12 @@
  *    limitations under the License.
  */
 
-#include "writer.h"
-#include <string.h>
+#ifndef platforms_backend_darwin_thread_h
+#define platforms_backend_darwin_thread_h
 
-ZzInstruction *writer_put_jmp(zz_ptr_t address) {
+#include "hookzz.h"
+#include "kitzz.h"
 
-    JMP_ABS jmp = {
-        0xFF, 0x25, 0x00000000, // FF25 00000000: JMP [RIP+6]
-        0x0000000000000000ULL   // Absolute destination address
-    };
-    ZzInstruction *ins = (ZzInstruction *)zz_malloc_with_zero(sizeof(ZzInstruction));
-    jmp.address        = address;
-    ins->size          = sizeof(jmp);
-    memcpy(ins->bytes, &jmp, sizeof(jmp));
-    return ins;
-}
\ No newline at end of file
+#include "thread.h"
+
+#endif
@@ -5,13 +5,449 @@
 #include "interceptor.h"
 #include "trampoline.h"
 
+#include <dlfcn.h>
+#include <pthread.h>
+#include <sys/mman.h>
+
+#define ZZ_MAX_GOT_SLOT_COUNT 8
+
+// the entry is keyed by the copy of the name, callers may pass the name from another buffer each time
+typedef struct _ZzGOTHookRecord {
+    char *name;
+    char *module_name; // NULL, all modules
+    ZzHookFunctionEntry *entry;
+    zz_addr_t origin_value;
+    zz_addr_t hook_value;
+} ZzGOTHookRecord;
+
+typedef struct _ZzGOTHookRecordSet {
+    ZzGOTHookRecord *records;
+    zz_size_t size;
+    zz_size_t capacity;
+} ZzGOTHookRecordSet;
+
+static ZzGOTHookRecordSet g_got_hook_record_set;
+// the loader calls back on whichever thread runs dlopen/dlclose, one notification at a time.
+static pthread_mutex_t g_module_change_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static ZzGOTHookRecord *ZzFindGOTHookRecord(const char *name) {
+    zz_size_t i;
+    for (i = 0; i < g_got_hook_record_set.size; i++) {
+        if (!strcmp(g_got_hook_record_set.records[i].name, name))
+            return &g_got_hook_record_set.records[i];
+    }
+    return NULL;
+}
+
+// takes the name, a copy of the caller's
+static ZzGOTHookRecord *ZzNewGOTHookRecord(char *name, const char *module_name, ZzHookFunctionEntry *entry) {
+    ZzGOTHookRecordSet *set = &g_got_hook_record_set;
+    ZzGOTHookRecord *record;
+
+    pthread_mutex_lock(&g_module_change_lock);
+    if (set->size >= set->capacity) {
+        zz_size_t capacity       = set->capacity ? set->capacity * 2 : 4;
+        ZzGOTHookRecord *records = (ZzGOTHookRecord *)realloc(set->records, sizeof(ZzGOTHookRecord) * capacity);
+        if (!records) {
+            pthread_mutex_unlock(&g_module_change_lock);
+            return NULL;
+        }
+        set->records  = records;
+        set->capacity = capacity;
+    }
+    record = &set->records[set->size++];
+    memset(record, 0, sizeof(ZzGOTHookRecord));
+    record->name        = name;
+    record->module_name = module_name ? strdup(module_name) : NULL;
+    record->entry       = entry;
+    pthread_mutex_unlock(&g_module_change_lock);
+    return record;
+}
+
+static bool ZzPatchGOTSlot(ElfModule *module, zz_addr_t *slot, zz_addr_t value) {
+    zz_size_t page_size = zz_posix_vm_get_page_size();
+    zz_addr_t page_addr = (zz_addr_t)slot & ~(page_size - 1);
+
+    if (*slot == value)
+        return TRUE;
+    if (!zz_posix_vm_protect(page_addr, page_size, PROT_READ | PROT_WRITE))
+        return FALSE;
+    __atomic_store_n(slot, value, __ATOMIC_RELEASE);
+    // GOT of a BIND_NOW module is read-only after relocation
+    if (zz_elf_module_is_in_relro(module, (zz_addr_t)slot))
+        zz_posix_vm_protect(page_addr, page_size, PROT_READ);
+    return TRUE;
+}
+
+// rewrite the slots of `name` in every matching module, except the module of HookZz itself.
+static zz_size_t ZzRebindGOTSlots(ZzGOTHookRecord *record, zz_addr_t from_value, zz_addr_t to_value) {
+    zz_addr_t *slots[ZZ_MAX_GOT_SLOT_COUNT];
+    zz_size_t i, j, slot_count, patched = 0;
+    ElfModuleList *list;
+
+    zz_elf_lock_loaded_modules();
+    list = zz_elf_get_loaded_modules();
+    for (i = 0; i < list->size; i++) {
+        ElfModule *module = list->modules[i];
+        if (zz_elf_module_contains_address(module, (zz_addr_t)ZzRebindGOTSlots))
+            continue;
+        if (!zz_elf_module_match_name(module, record->module_name))
+            continue;
+        slot_count = zz_elf_module_find_relocation_slots(module, record->name, slots, ZZ_MAX_GOT_SLOT_COUNT);
+        for (j = 0; j < slot_count; j++) {
+            // leave the slots bound to another hook alone when restoring
+            if (from_value && *slots[j] != from_value)
+                continue;
+            if (ZzPatchGOTSlot(module, slots[j], to_value))
+                patched++;
+        }
+    }
+    zz_elf_unlock_loaded_modules();
+    return patched;
+}
+
+zz_ptr_t ZzFindSymbolAddress(const char *module_name, const char *symbol_name) {
+    zz_ptr_t address = (zz_ptr_t)zz_elf_find_symbol(module_name, symbol_name);
+    void *handle;
+
+    if (address)
+        return address;
+    // i.e. ifunc, leave it to the loader
+    if (!module_name)
+        return dlsym(RTLD_DEFAULT, symbol_name);
+    handle = dlopen(module_name, RTLD_NOLOAD | RTLD_LAZY);
+    if (!handle)
+        return NULL;
+    address = dlsym(handle, symbol_name);
+    dlclose(handle);
+    return address;
+}
+
+ZZSTATUS ZzHookGOTInModule(const char *module_name, const char *name, zz_ptr_t replace_ptr, zz_ptr_t *origin_ptr,
+                           PRECALL pre_call_ptr, POSTCALL post_call_ptr) {
+    zz_ptr_t target_ptr = ZzFindSymbolAddress(NULL, name);
+    ZzHookFunctionEntry *entry;
+    ZzGOTHookRecord *record;
+    ZZSTATUS status;
+    char *key;
+
+    if (!target_ptr) {
+        ZZ_ERROR_LOG("can't find the symbol %s!", name);
+        return ZZ_FAILED;
+    }
+    if (ZzFindGOTHookRecord(name))
+        return ZZ_ALREADY_HOOK;
+    key = strdup(name);
+    if (!key)
+        return ZZ_FAILED;
+
+    if (replace_ptr) {
+        status = ZzBuildHookGOT((zz_ptr_t)key, replace_ptr, NULL, pre_call_ptr, post_call_ptr);
+    } else {
+        status = ZzBuildHookGOT((zz_ptr_t)key, target_ptr, NULL, pre_call_ptr, post_call_ptr);
+    }
+    if (status == ZZ_FAILED || status == ZZ_ALREADY_HOOK) {
+        free(key);
+        return status;
+    }
+
+    entry  = ZzFindHookFunctionEntry((zz_ptr_t)key);
+    record = ZzNewGOTHookRecord(key, module_name, entry);
+    if (!entry || !record)
+        return ZZ_FAILED;
+
+    record->origin_value = (zz_addr_t)target_ptr;
+    if (entry->on_enter_trampoline)
+        record->hook_value = (zz_addr_t)entry->on_enter_trampoline;
+    else
+        record->hook_value = (zz_addr_t)replace_ptr;
+
+    if (origin_ptr)
+        *origin_ptr = target_ptr;
+
+    return ZzEnableHookGOT(name);
+}
+
 ZZSTATUS ZzHookGOT(const char *name, zz_ptr_t replace_ptr, zz_ptr_t *origin_ptr, PRECALL pre_call_ptr,
                    POSTCALL post_call_ptr) {
+    return ZzHookGOTInModule(NULL, name, replace_ptr, origin_ptr, pre_call_ptr, post_call_ptr);
+}
 
-    return ZZ_SUCCESS;
+ZZSTATUS ZzEnableHookGOT(const char *name) {
+    ZzGOTHookRecord *record = ZzFindGOTHookRecord(name);
+    ZzHookFunctionEntry *entry;
+
+    if (!record || !record->entry)
+        return ZZ_NO_BUILD_HOOK;
+    entry = record->entry;
+    if (!ZzRebindGOTSlots(record, 0, record->hook_value)) {
+        ZZ_ERROR_LOG("no GOT slot of %s is patched!", name);
+        return ZZ_FAILED;
+    }
+    entry->isEnabled = TRUE;
+    return ZZ_DONE_HOOK;
 }
 
 ZZSTATUS ZzDisableHookGOT(const char *name) {
+    ZzGOTHookRecord *record = ZzFindGOTHookRecord(name);
+    ZzHookFunctionEntry *entry;
+
+    if (!record || !record->entry)
+        return ZZ_NO_BUILD_HOOK;
+    entry = record->entry;
+    ZzRebindGOTSlots(record, record->hook_value, record->origin_value);
+    entry->isEnabled = FALSE;
+    return ZZ_SUCCESS;
+}
+
+zz_size_t ZzFindLoadedModules(const char **module_patterns, zz_size_t count, const char **module_paths,
+                              zz_addr_t *load_biases) {
+    zz_size_t i, j, matched = 0;
+    ElfModuleList *list;
+
+    zz_elf_lock_loaded_modules();
+    list = zz_elf_get_loaded_modules();
+    for (j = 0; j < count; j++) {
+        module_paths[j] = NULL;
+        load_biases[j]  = 0;
+        for (i = 0; i < list->size; i++) {
+            if (!zz_elf_module_match_pattern(list->modules[i], module_patterns[j]))
+                continue;
+            module_paths[j] = list->modules[i]->path;
+            load_biases[j]  = list->modules[i]->load_bias;
+            matched++;
+            break;
+        }
+    }
+    zz_elf_unlock_loaded_modules();
+    return matched;
+}
+
+static zz_size_t ZzGetModuleFunctionsLocked(const char *module_pattern, ZzModuleFunction **functions) {
+    ElfModuleList *list = zz_elf_get_loaded_modules();
+    ElfSymbol *symbols;
+    zz_size_t i, count;
+
+    *functions = NULL;
+    for (i = 0; i < list->size; i++) {
+        if (zz_elf_module_match_pattern(list->modules[i], module_pattern))
+            break;
+    }
+    if (i == list->size)
+        return 0;
 
+    count = zz_elf_module_get_functions(list->modules[i], &symbols);
+    if (!count) {
+        free(symbols);
+        return 0;
+    }
+    *functions = (ZzModuleFunction *)malloc(count * sizeof(ZzModuleFunction));
+    if (!*functions) {
+        free(symbols);
+        return 0;
+    }
+    for (i = 0; i < count; i++) {
+        (*functions)[i].name    = symbols[i].name;
+        (*functions)[i].address = symbols[i].address;
+        (*functions)[i].size    = symbols[i].size;
+    }
+    free(symbols);
+    return count;
+}
+
+zz_size_t ZzGetModuleFunctions(const char *module_pattern, ZzModuleFunction **functions) {
+    zz_size_t count;
+
+    zz_elf_lock_loaded_modules();
+    count = ZzGetModuleFunctionsLocked(module_pattern, functions);
+    zz_elf_unlock_loaded_modules();
+    return count;
+}
+
+static zz_size_t ZzGetModuleBuildIdLocked(zz_addr_t address, zz_addr_t *load_bias, zz_addr_t *module_start,
+                                          zz_addr_t *module_end, uint8_t *build_id, zz_size_t max_size) {
+    ElfModuleList *list = zz_elf_get_loaded_modules();
+    ElfModule *module;
+    zz_size_t i;
+
+    for (i = 0; i < list->size; i++) {
+        module = list->modules[i];
+        if (!zz_elf_module_contains_address(module, address))
+            continue;
+        if (!module->build_id_size || module->build_id_size > max_size)
+            return 0;
+        memcpy(build_id, module->build_id, module->build_id_size);
+        *load_bias    = module->load_bias;
+        *module_start = module->start;
+        *module_end   = module->end;
+        return module->build_id_size;
+    }
+    return 0;
+}
+
+zz_size_t ZzGetModuleBuildId(zz_addr_t address, zz_addr_t *load_bias, zz_addr_t *module_start, zz_addr_t *module_end,
+                             uint8_t *build_id, zz_size_t max_size) {
+    zz_size_t build_id_size;
+
+    zz_elf_lock_loaded_modules();
+    build_id_size = ZzGetModuleBuildIdLocked(address, load_bias, module_start, module_end, build_id, max_size);
+    zz_elf_unlock_loaded_modules();
+    return build_id_size;
+}
+
+static bool ZzFindModuleByBuildIdLocked(const uint8_t *build_id, zz_size_t build_id_size, zz_addr_t *load_bias) {
+    ElfModuleList *list = zz_elf_get_loaded_modules();
+    ElfModule *module;
+    zz_size_t i;
+
+    for (i = 0; i < list->size; i++) {
+        module = list->modules[i];
+        if (module->build_id_size != build_id_size || memcmp(module->build_id, build_id, build_id_size))
+            continue;
+        *load_bias = module->load_bias;
+        return TRUE;
+    }
+    return FALSE;
+}
+
+bool ZzFindModuleByBuildId(const uint8_t *build_id, zz_size_t build_id_size, zz_addr_t *load_bias) {
+    bool found;
+
+    zz_elf_lock_loaded_modules();
+    found = ZzFindModuleByBuildIdLocked(build_id, build_id_size, load_bias);
+    zz_elf_unlock_loaded_modules();
+    return found;
+}
+
+static zz_addr_t ZzFindModuleProgramHeaderLocked(zz_addr_t address, uint32_t type, zz_addr_t *load_bias,
+                                                 zz_size_t *size) {
+    ElfModuleList *list = zz_elf_get_loaded_modules();
+    ElfModule *module;
+    zz_size_t i;
+    int j;
+
+    for (i = 0; i < list->size; i++) {
+        module = list->modules[i];
+        if (!zz_elf_module_contains_address(module, address))
+            continue;
+        for (j = 0; j < module->phnum; j++) {
+            if (module->phdr[j].p_type != type)
+                continue;
+            *load_bias = module->load_bias;
+            *size      = module->phdr[j].p_memsz;
+            return module->load_bias + module->phdr[j].p_vaddr;
+        }
+        return 0;
+    }
+    return 0;
+}
+
+zz_addr_t ZzFindModuleProgramHeader(zz_addr_t address, uint32_t type, zz_addr_t *load_bias, zz_size_t *size) {
+    zz_addr_t header;
+
+    zz_elf_lock_loaded_modules();
+    header = ZzFindModuleProgramHeaderLocked(address, type, load_bias, size);
+    zz_elf_unlock_loaded_modules();
+    return header;
+}
+
+static void (*g_module_load_callbacks[ZZ_MAX_MODULE_LOAD_CALLBACK_COUNT])(void);
+static zz_size_t g_module_load_callback_count;
+static zz_ptr_t g_origin_dlopen;
+static zz_ptr_t g_origin_dlclose;
+#if defined(__ANDROID__)
+static zz_ptr_t g_origin_android_dlopen_ext;
+// the linker picks the namespace by the caller address, pass the real caller instead of HookZz
+static void *(*g_loader_dlopen)(const char *filename, int flags, const void *caller_addr);
+static void *(*g_loader_android_dlopen_ext)(const char *filename, int flags, const void *extinfo,
+                                            const void *caller_addr);
+#endif
+
+static void ZzNotifyModuleChange(void) {
+    bool changed;
+    zz_size_t i;
+
+    pthread_mutex_lock(&g_module_change_lock);
+    zz_elf_lock_loaded_modules();
+    changed = zz_elf_is_loaded_modules_changed();
+    zz_elf_unlock_loaded_modules();
+    if (!changed) {
+        pthread_mutex_unlock(&g_module_change_lock);
+        return;
+    }
+    // a new module has its own GOT
+    for (i = 0; i < g_got_hook_record_set.size; i++) {
+        ZzGOTHookRecord *record = &g_got_hook_record_set.records[i];
+        if (record->entry && record->entry->isEnabled)
+            ZzRebindGOTSlots(record, 0, record->hook_value);
+    }
+    for (i = 0; i < g_module_load_callback_count; i++)
+        g_module_load_callbacks[i]();
+    pthread_mutex_unlock(&g_module_change_lock);
+}
+
+static void *ZzDlopenReplace(const char *filename, int flags) {
+    void *handle;
+
+#if defined(__ANDROID__)
+    if (g_loader_dlopen)
+        handle = g_loader_dlopen(filename, flags, __builtin_return_address(0));
+    else
+#endif
+        handle = ((void *(*)(const char *, int))g_origin_dlopen)(filename, flags);
+    ZzNotifyModuleChange();
+    return handle;
+}
+
+static int ZzDlcloseReplace(void *handle) {
+    int ret = ((int (*)(void *))g_origin_dlclose)(handle);
+    ZzNotifyModuleChange();
+    return ret;
+}
+
+#if defined(__ANDROID__)
+static void *ZzAndroidDlopenExtReplace(const char *filename, int flags, const void *extinfo) {
+    void *handle;
+
+    if (g_loader_android_dlopen_ext)
+        handle = g_loader_android_dlopen_ext(filename, flags, extinfo, __builtin_return_address(0));
+    else
+        handle = ((void *(*)(const char *, int, const void *))g_origin_android_dlopen_ext)(filename, flags, extinfo);
+    ZzNotifyModuleChange();
+    return handle;
+}
+#endif
+
+ZZSTATUS ZzObserveModuleLoad(void (*callback)(void)) {
+    ZZSTATUS status;
+    zz_size_t i;
+
+    pthread_mutex_lock(&g_module_change_lock);
+    for (i = 0; i < g_module_load_callback_count; i++) {
+        if (g_module_load_callbacks[i] == callback)
+            break;
+    }
+    if (i == g_module_load_callback_count) {
+        if (g_module_load_callback_count >= ZZ_MAX_MODULE_LOAD_CALLBACK_COUNT) {
+            pthread_mutex_unlock(&g_module_change_lock);
+            return ZZ_FAILED;
+        }
+        g_module_load_callbacks[g_module_load_callback_count++] = callback;
+    }
+    pthread_mutex_unlock(&g_module_change_lock);
+    if (g_origin_dlopen)
+        return ZZ_SUCCESS;
+
+#if defined(__ANDROID__)
+    g_loader_dlopen             = ZzFindSymbolAddress(NULL, "__loader_dlopen");
+    g_loader_android_dlopen_ext = ZzFindSymbolAddress(NULL, "__loader_android_dlopen_ext");
+    ZzHookGOT("android_dlopen_ext", (zz_ptr_t)ZzAndroidDlopenExtReplace, &g_origin_android_dlopen_ext, NULL, NULL);
+#endif
+    ZzHookGOT("dlclose", (zz_ptr_t)ZzDlcloseReplace, &g_origin_dlclose, NULL, NULL);
+    status = ZzHookGOT("dlopen", (zz_ptr_t)ZzDlopenReplace, &g_origin_dlopen, NULL, NULL);
+    if (status == ZZ_FAILED || !g_origin_dlopen) {
+        ZZ_ERROR_LOG_STR("can't observe dlopen!");
+        return ZZ_FAILED;
+    }
     return ZZ_SUCCESS;
-}
\ No newline at end of file
+}
@@ -0,0 +1,2 @@
+#include "ELFKit/elf_kit.h"
+#include "PosixKit/memory/posix_memory_kit.h"
@@ -26,10 +26,26 @@ zz_ptr_t ZzMemoryAllocateNearPages(zz_addr_t address, zz_size_t redirect_range_s
 
 zz_ptr_t ZzMemoryAllocate(zz_size_t size) { return zz_posix_vm_allocate(size); }
 
+zz_ptr_t ZzMemoryAllocateHugePageArena(zz_addr_t address, zz_size_t size) {
+    return zz_linux_vm_allocate_huge_page_arena(address, size);
+}
+
+zz_ptr_t ZzMemoryAllocateNearHugePageArena(zz_addr_t address, zz_size_t redirect_range_size, zz_size_t size) {
+    return zz_linux_vm_allocate_near_huge_page_arena(address, redirect_range_size, size);
+}
+
 bool ZzMemoryPatchCode(const zz_addr_t address, const zz_ptr_t codedata, zz_size_t codedata_size) {
     return zz_posix_vm_patch_code(address, codedata, codedata_size);
 }
 
+bool ZzMemoryIsAtomicPatchable(const zz_addr_t address, zz_size_t codedata_size) {
+    return zz_posix_vm_is_atomic_patchable(address, codedata_size);
+}
+
+bool ZzMemoryPatchCodeAtomic(const zz_addr_t address, const zz_ptr_t codedata, zz_size_t codedata_size) {
+    return zz_posix_vm_patch_code_atomic(address, codedata, codedata_size);
+}
+
 bool ZzMemoryProtectAsExecutable(const zz_addr_t address, zz_size_t size) {
 
     return zz_posix_vm_protect_as_executable(address, size);
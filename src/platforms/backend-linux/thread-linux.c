@@ -0,0 +1,41 @@
+/**
+ *    Copyright 2017 jmpews
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#include "thread-linux.h"
+
+static LinuxSuspendedThreadList g_suspended_thread_list;
+
+bool ZzThreadSuspendOtherThreads() { return zz_linux_thread_suspend_other_threads(&g_suspended_thread_list); }
+
+zz_size_t ZzThreadGetSuspendedThreadCount() { return g_suspended_thread_list.size; }
+
+zz_addr_t ZzThreadGetSuspendedThreadPC(zz_size_t index) {
+    return zz_linux_thread_get_pc(&g_suspended_thread_list.threads[index]);
+}
+
+void ZzThreadSetSuspendedThreadPC(zz_size_t index, zz_addr_t pc) {
+    zz_linux_thread_set_pc(&g_suspended_thread_list.threads[index], pc);
+}
+
+zz_addr_t ZzThreadGetSuspendedThreadLR(zz_size_t index) {
+    return zz_linux_thread_get_lr(&g_suspended_thread_list.threads[index]);
+}
+
+void ZzThreadSetSuspendedThreadLR(zz_size_t index, zz_addr_t lr) {
+    zz_linux_thread_set_lr(&g_suspended_thread_list.threads[index], lr);
+}
+
+void ZzThreadResumeOtherThreads() { zz_linux_thread_resume_threads(&g_suspended_thread_list); }
@@ -68,3 +68,28 @@ ZZSTATUS ZzBuildInsnLeaveTrampoline(ZzInterceptorBackend *self, ZzHookFunctionEn
 ZZSTATUS ZzBuildLeaveTrampoline(ZzInterceptorBackend *self, ZzHookFunctionEntry *entry) { return ZZ_FAILED; }
 
 ZZSTATUS ZzActivateTrampoline(ZzInterceptorBackend *self, ZzHookFunctionEntry *entry) { return ZZ_FAILED; }
+
+ZZSTATUS ZzBuildLazyTrampoline(ZzInterceptorBackend *self, ZzHookFunctionEntry *entry) { return ZZ_FAILED; }
+
+ZZSTATUS ZzBuildSharedDispatchTrampoline(ZzInterceptorBackend *self, ZzHookFunctionEntry *entry) { return ZZ_FAILED; }
+
+ZZSTATUS ZzRelocateHotTrampoline(ZzInterceptorBackend *self, ZzHookFunctionEntry *entry) { return ZZ_FAILED; }
+
+ZZSTATUS ZzBuildBlockTranslationTrampoline(ZzInterceptorBackend *self, ZzHookFunctionEntry *entry) { return ZZ_FAILED; }
+
+ZZSTATUS ZzBuildCounterTrampoline(ZzInterceptorBackend *self, ZzHookFunctionEntry *entry) { return ZZ_FAILED; }
+
+ZZSTATUS ZzBypassEnterTrampoline(ZzInterceptorBackend *self, ZzHookFunctionEntry *entry) { return ZZ_FAILED; }
+
+zz_size_t ZzBuildCallSiteRedirects(ZzInterceptorBackend *self, struct _ZzCallSiteHook *hook,
+                                   ZzModuleFunction *functions, zz_size_t count) {
+    return 0;
+}
+
+ZZSTATUS ZzBuildSolidifyTrampoline(ZzInterceptorBackend *self, ZzHookFunctionEntry *entry, uint64_t *enter_thunk_slot) {
+    return ZZ_FAILED;
+}
+
+ZZSTATUS ZzBuildRedirectCode(ZzInterceptorBackend *self, ZzHookFunctionEntry *entry, FunctionBackup *redirect_code) {
+    return ZZ_FAILED;
+}
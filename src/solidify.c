@@ -0,0 +1,285 @@
+/**
+ *    Copyright 2017 jmpews
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "solidify.h"
+#include "interceptor.h"
+#include "memory.h"
+#include "tools.h"
+#include "trampoline.h"
+
+#include "CommonKit/log/log_kit.h"
+
+// the bound entries sorted by target, a disabled one is bound again as is. they are never freed, a call may still
+// hold one, a replaced one is only dropped from the set.
+typedef struct {
+    ZzHookFunctionEntry **entries;
+    zz_size_t size;
+    zz_size_t capacity;
+} ZzSolidifiedEntrySet;
+
+// the solidify header of a module, looked up once. dropped on a module change, the module may be gone.
+typedef struct {
+    ZzSolidifyHeader *header;
+    zz_addr_t load_bias;
+} ZzSolidifiedModule;
+
+typedef struct {
+    ZzSolidifiedModule *modules;
+    zz_size_t size;
+    zz_size_t capacity;
+} ZzSolidifiedModuleSet;
+
+static ZzSolidifiedEntrySet g_solidified_entry_set;
+
+static ZzSolidifiedModuleSet g_solidified_module_set;
+
+static pthread_mutex_t g_solidify_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// headers are only cached while a module change drops them
+static bool g_solidified_module_observed;
+
+// the index of the first entry whose target is not below target_ptr
+static zz_size_t ZzLowerBoundSolidifiedEntry(zz_ptr_t target_ptr) {
+    zz_size_t low = 0, high = g_solidified_entry_set.size, mid;
+
+    while (low < high) {
+        mid = low + (high - low) / 2;
+        if ((zz_addr_t)g_solidified_entry_set.entries[mid]->target_ptr < (zz_addr_t)target_ptr)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    return low;
+}
+
+static ZzHookFunctionEntry *ZzFindSolidifiedEntry(zz_ptr_t target_ptr) {
+    zz_size_t i = ZzLowerBoundSolidifiedEntry(target_ptr);
+
+    if (i < g_solidified_entry_set.size && g_solidified_entry_set.entries[i]->target_ptr == target_ptr)
+        return g_solidified_entry_set.entries[i];
+    return NULL;
+}
+
+static ZZSTATUS ZzAddSolidifiedEntry(ZzHookFunctionEntry *entry) {
+    ZzSolidifiedEntrySet *set = &g_solidified_entry_set;
+    zz_size_t i;
+
+    if (set->size >= set->capacity) {
+        zz_size_t capacity            = set->capacity ? set->capacity * 2 : 16;
+        ZzHookFunctionEntry **entries = (ZzHookFunctionEntry **)realloc(set->entries, sizeof(ZzHookFunctionEntry *) * capacity);
+        if (!entries)
+            return ZZ_FAILED;
+        set->entries  = entries;
+        set->capacity = capacity;
+    }
+    i = ZzLowerBoundSolidifiedEntry(entry->target_ptr);
+    memmove(&set->entries[i + 1], &set->entries[i], sizeof(ZzHookFunctionEntry *) * (set->size - i));
+    set->entries[i] = entry;
+    set->size++;
+    return ZZ_SUCCESS;
+}
+
+// dropped from the set only, a call may still hold it
+static void ZzRemoveSolidifiedEntry(ZzHookFunctionEntry *entry) {
+    ZzSolidifiedEntrySet *set = &g_solidified_entry_set;
+    zz_size_t i               = ZzLowerBoundSolidifiedEntry(entry->target_ptr);
+
+    if (i < set->size && set->entries[i] == entry) {
+        memmove(&set->entries[i], &set->entries[i + 1], sizeof(ZzHookFunctionEntry *) * (set->size - i - 1));
+        set->size--;
+    }
+}
+
+// an entry bound at the same address may be of a module loaded there before
+static bool ZzIsSolidifiedEntryOfRecord(ZzHookFunctionEntry *entry, ZzSolidifyRecord *record, zz_addr_t load_bias) {
+    return entry->on_invoke_trampoline == (zz_ptr_t)(load_bias + record->on_invoke_trampoline) &&
+           entry->origin_prologue.size == record->redirect_size &&
+           !memcmp(entry->origin_prologue.data, record->origin_prologue, record->redirect_size);
+}
+
+static void ZzSolidifyModuleChanged(void) {
+    pthread_mutex_lock(&g_solidify_lock);
+    g_solidified_module_set.size = 0;
+    pthread_mutex_unlock(&g_solidify_lock);
+}
+
+static void ZzAddSolidifiedModule(ZzSolidifyHeader *header, zz_addr_t load_bias) {
+    ZzSolidifiedModuleSet *set = &g_solidified_module_set;
+    zz_size_t i;
+
+    if (!g_solidified_module_observed)
+        return;
+    for (i = 0; i < set->size; i++) {
+        if (set->modules[i].header == header)
+            return;
+    }
+    if (set->size >= set->capacity) {
+        zz_size_t capacity          = set->capacity ? set->capacity * 2 : 4;
+        ZzSolidifiedModule *modules = (ZzSolidifiedModule *)realloc(set->modules, sizeof(ZzSolidifiedModule) * capacity);
+        if (!modules)
+            return;
+        set->modules  = modules;
+        set->capacity = capacity;
+    }
+    set->modules[set->size].header    = header;
+    set->modules[set->size].load_bias = load_bias;
+    set->size++;
+}
+
+static int ZzSolidifyRecordCompare(const void *key, const void *item) {
+    uint64_t target = *(const uint64_t *)key;
+    if (target < ((const ZzSolidifyRecord *)item)->target)
+        return -1;
+    return target > ((const ZzSolidifyRecord *)item)->target;
+}
+
+// the record in the module of a cached header first, the module of the target is only walked on a miss
+static ZzSolidifyRecord *ZzFindSolidifyRecord(zz_ptr_t target_ptr, ZzSolidifyHeader **header, zz_addr_t *load_bias) {
+    ZzSolidifyRecord *records, *record;
+    zz_size_t size, i;
+    uint64_t key;
+
+    for (i = 0; i < g_solidified_module_set.size; i++) {
+        *header    = g_solidified_module_set.modules[i].header;
+        *load_bias = g_solidified_module_set.modules[i].load_bias;
+        records    = (ZzSolidifyRecord *)(*header + 1);
+        key        = (zz_addr_t)target_ptr - *load_bias;
+        if (!(*header)->record_count || key < records[0].target ||
+            key > records[(*header)->record_count - 1].target)
+            continue;
+        record = (ZzSolidifyRecord *)bsearch(&key, records, (*header)->record_count, sizeof(ZzSolidifyRecord),
+                                             ZzSolidifyRecordCompare);
+        if (record)
+            return record;
+    }
+
+    *header = (ZzSolidifyHeader *)ZzFindModuleProgramHeader((zz_addr_t)target_ptr, ZZ_PT_HOOKZZ_SOLIDIFY, load_bias,
+                                                            &size);
+    if (!*header || size < sizeof(ZzSolidifyHeader) || (*header)->magic != ZZ_SOLIDIFY_MAGIC ||
+        (*header)->version != ZZ_SOLIDIFY_VERSION ||
+        (size - sizeof(ZzSolidifyHeader)) / sizeof(ZzSolidifyRecord) < (*header)->record_count)
+        return NULL;
+    ZzAddSolidifiedModule(*header, *load_bias);
+
+    key = (zz_addr_t)target_ptr - *load_bias;
+    return (ZzSolidifyRecord *)bsearch(&key, *header + 1, (*header)->record_count, sizeof(ZzSolidifyRecord),
+                                       ZzSolidifyRecordCompare);
+}
+
+// the callbacks run under the module change lock, register before taking the solidify lock
+static void ZzObserveSolidifiedModules(void) {
+    bool observed = ZzObserveModuleLoad(ZzSolidifyModuleChanged) != ZZ_FAILED;
+
+    pthread_mutex_lock(&g_solidify_lock);
+    g_solidified_module_observed = observed;
+}
+
+static ZZSTATUS ZzHookSolidifiedLocked(zz_ptr_t target_ptr, zz_ptr_t replace_ptr, zz_ptr_t *origin_ptr,
+                                       PRECALL pre_call_ptr, POSTCALL post_call_ptr) {
+    ZzHookFunctionEntry *entry;
+    ZzSolidifyHeader *header;
+    ZzSolidifyRecord *record;
+    zz_addr_t load_bias;
+    ZZSTATUS status;
+
+    record = ZzFindSolidifyRecord(target_ptr, &header, &load_bias);
+    if (!record) {
+        ZZ_ERROR_LOG("%p is not solidified!", target_ptr);
+        return ZZ_FAILED;
+    }
+    if (__atomic_load_n(&record->entry, __ATOMIC_ACQUIRE))
+        return ZZ_ALREADY_HOOK;
+
+    // the entry is bound again as is, unless it is of another module or the callbacks changed
+    entry = ZzFindSolidifiedEntry(target_ptr);
+    if (entry && (!ZzIsSolidifiedEntryOfRecord(entry, record, load_bias) ||
+                  ((replace_ptr || pre_call_ptr || post_call_ptr) &&
+                   (entry->replace_call != replace_ptr || entry->pre_call != (zz_ptr_t)pre_call_ptr ||
+                    entry->post_call != (zz_ptr_t)post_call_ptr)))) {
+        ZzRemoveSolidifiedEntry(entry);
+        entry = NULL;
+    }
+    if (!entry) {
+        if (!replace_ptr && !pre_call_ptr && !post_call_ptr)
+            return ZZ_FAILED;
+        entry = (ZzHookFunctionEntry *)zz_malloc_with_zero(sizeof(ZzHookFunctionEntry));
+        if (!entry)
+            return ZZ_FAILED;
+        ZzInitializeHookFunctionEntry(entry,
+                                      pre_call_ptr || post_call_ptr ? HOOK_TYPE_FUNCTION_via_PRE_POST
+                                                                    : HOOK_TYPE_FUNCTION_via_REPLACE,
+                                      target_ptr, replace_ptr, pre_call_ptr, post_call_ptr, FALSE);
+        if (!entry->interceptor || record->redirect_size > ZZ_SOLIDIFY_MAX_PROLOGUE_SIZE) {
+            free(entry);
+            return ZZ_FAILED;
+        }
+
+        // the trampolines are in the file already
+        entry->on_enter_trampoline  = (zz_ptr_t)(load_bias + record->on_enter_trampoline);
+        entry->on_invoke_trampoline = (zz_ptr_t)(load_bias + record->on_invoke_trampoline);
+        memcpy(entry->origin_prologue.data, record->origin_prologue, record->redirect_size);
+        entry->origin_prologue.size = record->redirect_size;
+
+        ZzMaterializeLock();
+        status = ZzBuildSolidifyTrampoline(entry->interceptor->backend, entry, &header->enter_thunk);
+        ZzMaterializeUnlock();
+        if (status == ZZ_FAILED || ZzAddSolidifiedEntry(entry) == ZZ_FAILED) {
+            ZzFreeHookFunctionEntry(entry);
+            free(entry);
+            return ZZ_FAILED;
+        }
+    }
+
+    __atomic_store_n(&record->entry, (uint64_t)(zz_addr_t)entry, __ATOMIC_RELEASE);
+    entry->isEnabled = TRUE;
+    if (origin_ptr)
+        *origin_ptr = entry->on_invoke_trampoline;
+    return ZZ_DONE_HOOK;
+}
+
+ZZSTATUS ZzHookSolidified(zz_ptr_t target_ptr, zz_ptr_t replace_ptr, zz_ptr_t *origin_ptr, PRECALL pre_call_ptr,
+                          POSTCALL post_call_ptr) {
+    ZZSTATUS status;
+
+    ZzObserveSolidifiedModules();
+    status = ZzHookSolidifiedLocked(target_ptr, replace_ptr, origin_ptr, pre_call_ptr, post_call_ptr);
+    pthread_mutex_unlock(&g_solidify_lock);
+    return status;
+}
+
+ZZSTATUS ZzDisableSolidified(zz_ptr_t target_ptr) {
+    ZzHookFunctionEntry *entry;
+    ZzSolidifyHeader *header;
+    ZzSolidifyRecord *record;
+    zz_addr_t load_bias;
+    ZZSTATUS status = ZZ_NO_BUILD_HOOK;
+
+    ZzObserveSolidifiedModules();
+    entry  = ZzFindSolidifiedEntry(target_ptr);
+    record = ZzFindSolidifyRecord(target_ptr, &header, &load_bias);
+    if (entry && record && ZzIsSolidifiedEntryOfRecord(entry, record, load_bias)) {
+        // the next call runs the invoke trampoline, the prologue stays patched
+        __atomic_store_n(&record->entry, 0, __ATOMIC_RELEASE);
+        entry->isEnabled = FALSE;
+        status           = ZZ_DONE;
+    }
+    pthread_mutex_unlock(&g_solidify_lock);
+    return status;
+}
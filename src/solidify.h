@@ -0,0 +1,62 @@
+/**
+ *    Copyright 2017 jmpews
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#ifndef solidify_h
+#define solidify_h
+
+#include "hookzz.h"
+#include "kitzz.h"
+
+#include "hookplan.h"
+
+// an elf instrumented ahead of time by tools/StaticBinaryInstrumentation. the tool appends a r-x segment (HookZzCode)
+// holding the enter and invoke trampolines of every function, a rw- segment (HookZzData) holding this header and the
+// records sorted by target, and patches the prologues in the file. the trampolines are position independent and reach
+// HookZzData through adrp, the runtime only binds the slots.
+//
+// enter trampoline: the entry slot is 0 until the hook is bound, the call runs the invoke trampoline then.
+//     adrp x17, entry; add x17, x17, :lo12:entry; ldr x17, [x17]; cbz x17, invoke
+//     sub sp, sp, #0x10; str x17, [sp]
+//     adrp x17, enter_thunk; add x17, x17, :lo12:enter_thunk; ldr x17, [x17]; br x17
+// invoke: the relocated prologue; adrp x17, rest; add x17, x17, :lo12:rest; br x17
+
+#define ZZ_SOLIDIFY_MAGIC 0x44535a5a // "ZZSD"
+#define ZZ_SOLIDIFY_VERSION 1
+// p_type of the program header covering HookZzData (PT_LOOS..PT_HIOS)
+#define ZZ_PT_HOOKZZ_SOLIDIFY 0x6f5a5a00
+#define ZZ_SOLIDIFY_MAX_PROLOGUE_SIZE 16
+
+typedef struct _ZzSolidifyHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t arch; // ZzHookPlanArch
+    uint32_t record_count;
+    uint32_t reserved;
+    uint64_t enter_thunk; // bound at runtime
+} ZzSolidifyHeader;
+
+typedef struct _ZzSolidifyRecord {
+    uint64_t entry; // the ZzHookFunctionEntry, bound at runtime
+    // link time addresses
+    uint64_t target;
+    uint64_t on_enter_trampoline;
+    uint64_t on_invoke_trampoline;
+    uint32_t redirect_size;
+    uint32_t reserved;
+    uint8_t origin_prologue[ZZ_SOLIDIFY_MAX_PROLOGUE_SIZE];
+} ZzSolidifyRecord;
+
+#endif
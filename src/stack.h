@@ -36,6 +36,9 @@ typedef struct _ZzCallStack {
     zz_size_t capacity;
     zz_ptr_t sp;
     zz_ptr_t caller_ret_addr;
+    zz_ptr_t listeners; // listeners snapshot of the begin invocation
+    bool is_reading_listeners;
+    zz_ptr_t entry;
     ZzCallStackItem *items;
 } ZzCallStack;
 
@@ -30,4 +30,20 @@ bool ZzThreadSetCurrentThreadData(zz_ptr_t key_ptr, zz_ptr_t data);
 
 long ZzThreadGetCurrentThreadID();
 
+// stop-the-world for the safe patch, only one suspension at a time.
+bool ZzThreadSuspendOtherThreads();
+
+zz_size_t ZzThreadGetSuspendedThreadCount();
+
+zz_addr_t ZzThreadGetSuspendedThreadPC(zz_size_t index);
+
+void ZzThreadSetSuspendedThreadPC(zz_size_t index, zz_addr_t pc);
+
+// the link register, 0 on x86 where the return address is on the stack.
+zz_addr_t ZzThreadGetSuspendedThreadLR(zz_size_t index);
+
+void ZzThreadSetSuspendedThreadLR(zz_size_t index, zz_addr_t lr);
+
+void ZzThreadResumeOtherThreads();
+
 #endif
\ No newline at end of file
@@ -2,27 +2,58 @@
 #include <stdlib.h>
 
 ZZSTATUS ZzBuildTrampoline(struct _ZzInterceptorBackend *self, ZzHookFunctionEntry *entry) {
+    ZZSTATUS status = ZZ_DONE;
     if (entry->hook_type == HOOK_TYPE_ONE_INSTRUCTION) {
         ZzPrepareTrampoline(self, entry);
-        ZzBuildEnterTrampoline(self, entry);
+        status = ZzBuildEnterTrampoline(self, entry);
         ZzBuildInsnLeaveTrampoline(self, entry);
         ZzBuildInvokeTrampoline(self, entry);
-    } else if (entry->hook_type == HOOK_TYPE_FUNCTION_via_PRE_POST) {
-        ZzPrepareTrampoline(self, entry);
-        ZzBuildEnterTrampoline(self, entry);
-        ZzBuildInvokeTrampoline(self, entry);
-        ZzBuildLeaveTrampoline(self, entry);
-    } else if (entry->hook_type == HOOK_TYPE_FUNCTION_via_REPLACE) {
-        ZzPrepareTrampoline(self, entry);
-        ZzBuildEnterTransferTrampoline(self, entry);
-        ZzBuildInvokeTrampoline(self, entry);
-    } else if (entry->hook_type == HOOK_TYPE_FUNCTION_via_GOT) {
-        ZzBuildEnterTrampoline(self, entry);
+    } else if (entry->hook_type == HOOK_TYPE_FUNCTION_via_PRE_POST ||
+               entry->hook_type == HOOK_TYPE_FUNCTION_via_REPLACE) {
+        if (ZzPrepareTrampoline(self, entry) == ZZ_FAILED)
+            return ZZ_FAILED;
+        status = ZzMaterializeTrampoline(self, entry);
+    } else if (entry->hook_type == HOOK_TYPE_FUNCTION_via_GOT ||
+               entry->hook_type == HOOK_TYPE_FUNCTION_via_CALL_SITE) {
+        status = ZzBuildEnterTrampoline(self, entry);
         ZzBuildLeaveTrampoline(self, entry);
     } else if (entry->hook_type == HOOK_TYPE_DBI) {
         ZzPrepareTrampoline(self, entry);
         ZzBuildDynamicBinaryInstrumentationTrampoline(self, entry);
         ZzBuildInvokeTrampoline(self, entry);
+    } else if (entry->hook_type == HOOK_TYPE_DBI_BLOCK) {
+        if (ZzPrepareTrampoline(self, entry) == ZZ_FAILED)
+            return ZZ_FAILED;
+        status = ZzBuildBlockTranslationTrampoline(self, entry);
+    } else if (entry->hook_type == HOOK_TYPE_DBI_COUNTER) {
+        if (ZzPrepareTrampoline(self, entry) == ZZ_FAILED)
+            return ZZ_FAILED;
+        // the counter trampoline jumps to the relocated instructions directly
+        if (ZzBuildInvokeTrampoline(self, entry) == ZZ_FAILED)
+            return ZZ_FAILED;
+        status = ZzBuildCounterTrampoline(self, entry);
+    } else if (entry->hook_type == HOOK_TYPE_ONE_SHOT) {
+        if (ZzPrepareTrampoline(self, entry) == ZZ_FAILED)
+            return ZZ_FAILED;
+        if (ZzBuildInvokeTrampoline(self, entry) == ZZ_FAILED)
+            return ZZ_FAILED;
+        status = ZzBuildDynamicBinaryInstrumentationTrampoline(self, entry);
     }
+    if (status == ZZ_FAILED)
+        return ZZ_FAILED;
     return ZZ_DONE;
 }
+
+ZZSTATUS ZzMaterializeTrampoline(struct _ZzInterceptorBackend *self, ZzHookFunctionEntry *entry) {
+    ZZSTATUS status = ZZ_DONE;
+    if (entry->hook_type == HOOK_TYPE_FUNCTION_via_PRE_POST) {
+        status = ZzBuildEnterTrampoline(self, entry);
+        if (ZzBuildInvokeTrampoline(self, entry) == ZZ_FAILED)
+            status = ZZ_FAILED;
+        ZzBuildLeaveTrampoline(self, entry);
+    } else if (entry->hook_type == HOOK_TYPE_FUNCTION_via_REPLACE) {
+        ZzBuildEnterTransferTrampoline(self, entry);
+        status = ZzBuildInvokeTrampoline(self, entry);
+    }
+    return status;
+}
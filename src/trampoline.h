@@ -22,6 +22,8 @@
 
 #include "interceptor.h"
 
+struct _ZzCallSiteHook;
+
 typedef struct _ZzTrampoline {
     ZzCodeSlice *code_slice;
 } ZzTrampoline;
@@ -38,6 +40,24 @@ ZZSTATUS ZzBuildTrampoline(struct _ZzInterceptorBackend *self, ZzHookFunctionEnt
 
 ZZSTATUS ZzActivateTrampoline(struct _ZzInterceptorBackend *self, ZzHookFunctionEntry *entry);
 
+// back up the prologue and pick the shared lazy stub only, ZZ_FAILED if the entry must be built eagerly.
+ZZSTATUS ZzBuildLazyTrampoline(struct _ZzInterceptorBackend *self, ZzHookFunctionEntry *entry);
+
+// the prologue jumps to the shared dispatcher, only the invoke trampoline is built. ZZ_FAILED if the entry needs its own
+// trampolines.
+ZZSTATUS ZzBuildSharedDispatchTrampoline(struct _ZzInterceptorBackend *self, ZzHookFunctionEntry *entry);
+
+// rebuild the enter/invoke trampolines of an active pre/post entry in the hot region and repoint the prologue (or the
+// transfer trampoline) at them. the old ones are kept, a thread may still run on them.
+ZZSTATUS ZzRelocateHotTrampoline(struct _ZzInterceptorBackend *self, ZzHookFunctionEntry *entry);
+
+// the trampolines of a prepared function entry, the rest of ZzBuildTrampoline.
+ZZSTATUS ZzMaterializeTrampoline(struct _ZzInterceptorBackend *self, ZzHookFunctionEntry *entry);
+
+// build the prologue redirect code without patching, for the batched patch.
+ZZSTATUS ZzBuildRedirectCode(struct _ZzInterceptorBackend *self, ZzHookFunctionEntry *entry,
+                             FunctionBackup *redirect_code);
+
 ZZSTATUS ZzBuildEnterTrampoline(struct _ZzInterceptorBackend *self, ZzHookFunctionEntry *entry);
 
 ZZSTATUS ZzBuildEnterTransferTrampoline(struct _ZzInterceptorBackend *self, ZzHookFunctionEntry *entry);
@@ -46,10 +66,29 @@ ZZSTATUS ZzBuildInsnLeaveTrampoline(struct _ZzInterceptorBackend *self, ZzHookFu
 
 ZZSTATUS ZzBuildInvokeTrampoline(struct _ZzInterceptorBackend *self, ZzHookFunctionEntry *entry);
 
+// one leave trampoline per backend, every pre/post call returns through it.
 ZZSTATUS ZzBuildLeaveTrampoline(struct _ZzInterceptorBackend *self, ZzHookFunctionEntry *entry);
 
 ZZSTATUS ZzBuildDynamicBinaryInstrumentationTrampoline(struct  _ZzInterceptorBackend *self, ZzHookFunctionEntry *entry);
 
+// translate the block at the target into the block cache of the entry, the prologue jumps to it.
+ZZSTATUS ZzBuildBlockTranslationTrampoline(struct _ZzInterceptorBackend *self, ZzHookFunctionEntry *entry);
+
+// bump the counter slot of the entry inline and jump to on_invoke_trampoline, no thunk.
+ZZSTATUS ZzBuildCounterTrampoline(struct _ZzInterceptorBackend *self, ZzHookFunctionEntry *entry);
+
+// the enter trampoline of a retired one-shot entry jumps to on_invoke_trampoline, the prologue stays patched.
+ZZSTATUS ZzBypassEnterTrampoline(struct _ZzInterceptorBackend *self, ZzHookFunctionEntry *entry);
+
+// point the `bl` of the module functions that call the target (or its plt/stub) at hook->destination, through a veneer
+// if it is out of range. the sites are added to the hook, not patched. returns the site count.
+zz_size_t ZzBuildCallSiteRedirects(struct _ZzInterceptorBackend *self, struct _ZzCallSiteHook *hook,
+                                   ZzModuleFunction *functions, zz_size_t count);
+
+// the shared pieces a solidified entry jumps to, the enter thunk into its slot of HookZzData and the leave trampoline.
+ZZSTATUS ZzBuildSolidifyTrampoline(struct _ZzInterceptorBackend *self, ZzHookFunctionEntry *entry,
+                                   uint64_t *enter_thunk_slot);
+
 #ifdef TARGET_IS_IOS
 // ZZSTATUS ZzActivateSolidifyTrampoline(ZzHookFunctionEntry *entry, zz_addr_t target_fileoff);
 #endif
@@ -0,0 +1,475 @@
+/**
+ *    Copyright 2017 jmpews
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "hookplan.h"
+#include "memory.h"
+#include "tools.h"
+#include "trampolinecache.h"
+
+#include "CommonKit/log/log_kit.h"
+
+// a trampoline built in this process, with the build id of its module
+typedef struct _ZzTrampolineCacheNewRecord {
+    ZzTrampolineCacheModule module;
+    ZzTrampolineCacheRecord record;
+    uint8_t *data;
+    zz_size_t data_size;
+} ZzTrampolineCacheNewRecord;
+
+// a loaded module resolved once, until a module change drops it
+typedef struct _ZzTrampolineCacheLoadedModule {
+    ZzTrampolineCacheModule module;
+    zz_addr_t load_bias;
+    zz_addr_t start;
+    zz_addr_t end;
+    uint32_t module_index; // in the mapped cache, its module_count if it is not there
+} ZzTrampolineCacheLoadedModule;
+
+typedef struct _ZzTrampolineCache {
+    char *path;
+    zz_ptr_t map;
+    zz_size_t map_size;
+    const ZzTrampolineCacheHeader *header;
+    const ZzTrampolineCacheModule *modules;
+    const ZzTrampolineCacheRecord *records;
+
+    ZzTrampolineCacheNewRecord *new_records;
+    zz_size_t size;
+    zz_size_t capacity;
+
+    bool module_observed;
+    ZzTrampolineCacheLoadedModule *loaded_modules;
+    zz_size_t loaded_module_count;
+    zz_size_t loaded_module_capacity;
+} ZzTrampolineCache;
+
+static ZzTrampolineCache g_trampoline_cache;
+static pthread_mutex_t g_trampoline_cache_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static bool ZzIsTrampolineCacheValid(const ZzTrampolineCacheHeader *header, zz_size_t map_size) {
+    zz_size_t size;
+
+    if (map_size < sizeof(ZzTrampolineCacheHeader) || header->magic != ZZ_TRAMPOLINE_CACHE_MAGIC ||
+        header->version != ZZ_TRAMPOLINE_CACHE_VERSION)
+        return FALSE;
+#if defined(__arm64__) || defined(__aarch64__)
+    if (header->arch != ZZ_HOOK_PLAN_ARCH_ARM64)
+        return FALSE;
+#else
+    return FALSE;
+#endif
+    size = sizeof(ZzTrampolineCacheHeader) + (zz_size_t)header->module_count * sizeof(ZzTrampolineCacheModule) +
+           (zz_size_t)header->record_count * sizeof(ZzTrampolineCacheRecord);
+    return size <= map_size;
+}
+
+bool ZzIsTrampolineCacheEnabled() { return g_trampoline_cache.path != NULL; }
+
+static void ZzTrampolineCacheModuleChanged(void) {
+    pthread_mutex_lock(&g_trampoline_cache_lock);
+    g_trampoline_cache.loaded_module_count = 0;
+    pthread_mutex_unlock(&g_trampoline_cache_lock);
+}
+
+// the loaded module containing the address, its build id is read once. FALSE if it is in no module with a build id.
+static bool ZzResolveTrampolineCacheModule(zz_addr_t address, ZzTrampolineCacheLoadedModule *loaded_module) {
+    ZzTrampolineCache *cache = &g_trampoline_cache;
+    ZzTrampolineCacheLoadedModule *loaded_modules;
+    uint32_t module_count = cache->header ? cache->header->module_count : 0;
+    zz_size_t i;
+
+    pthread_mutex_lock(&g_trampoline_cache_lock);
+    for (i = 0; i < cache->loaded_module_count; i++) {
+        if (address >= cache->loaded_modules[i].start && address < cache->loaded_modules[i].end) {
+            *loaded_module = cache->loaded_modules[i];
+            pthread_mutex_unlock(&g_trampoline_cache_lock);
+            return TRUE;
+        }
+    }
+
+    memset(loaded_module, 0, sizeof(ZzTrampolineCacheLoadedModule));
+    loaded_module->module.build_id_size =
+        ZzGetModuleBuildId(address, &loaded_module->load_bias, &loaded_module->start, &loaded_module->end,
+                           loaded_module->module.build_id, sizeof(loaded_module->module.build_id));
+    if (!loaded_module->module.build_id_size) {
+        pthread_mutex_unlock(&g_trampoline_cache_lock);
+        return FALSE;
+    }
+    for (i = 0; i < module_count; i++) {
+        if (cache->modules[i].build_id_size == loaded_module->module.build_id_size &&
+            !memcmp(cache->modules[i].build_id, loaded_module->module.build_id, loaded_module->module.build_id_size))
+            break;
+    }
+    loaded_module->module_index = i;
+
+    // without a module change callback a range could outlive its module
+    if (cache->module_observed) {
+        if (cache->loaded_module_count >= cache->loaded_module_capacity) {
+            zz_size_t capacity = cache->loaded_module_capacity ? cache->loaded_module_capacity * 2 : 8;
+            loaded_modules     = (ZzTrampolineCacheLoadedModule *)realloc(
+                cache->loaded_modules, sizeof(ZzTrampolineCacheLoadedModule) * capacity);
+            if (loaded_modules) {
+                cache->loaded_modules         = loaded_modules;
+                cache->loaded_module_capacity = capacity;
+            }
+        }
+        if (cache->loaded_module_count < cache->loaded_module_capacity)
+            cache->loaded_modules[cache->loaded_module_count++] = *loaded_module;
+    }
+    pthread_mutex_unlock(&g_trampoline_cache_lock);
+    return TRUE;
+}
+
+ZZSTATUS ZzEnableTrampolineCache(const char *path) {
+    ZzTrampolineCache *cache = &g_trampoline_cache;
+    struct stat st;
+    zz_ptr_t map;
+    int fd;
+
+    if (cache->path)
+        return ZZ_ALREADY_ENABLED;
+    cache->path = strdup(path);
+    if (!cache->path)
+        return ZZ_FAILED;
+    // the callbacks run under the module change lock, registered before any lookup takes the cache lock
+    cache->module_observed = ZzObserveModuleLoad(ZzTrampolineCacheModuleChanged) != ZZ_FAILED;
+
+    // no cache yet, ZzSaveTrampolineCache writes the first one
+    fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return ZZ_SUCCESS;
+    if (fstat(fd, &st) < 0 || !st.st_size) {
+        close(fd);
+        return ZZ_SUCCESS;
+    }
+    map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+        return ZZ_SUCCESS;
+
+    // another arch or another cache format, it is rewritten on save
+    if (!ZzIsTrampolineCacheValid((const ZzTrampolineCacheHeader *)map, st.st_size)) {
+        HookZzDebugInfoLog("trampoline cache %s is stale", path);
+        munmap(map, st.st_size);
+        return ZZ_SUCCESS;
+    }
+
+    cache->map      = map;
+    cache->map_size = st.st_size;
+    cache->header   = (const ZzTrampolineCacheHeader *)map;
+    cache->modules  = (const ZzTrampolineCacheModule *)(cache->header + 1);
+    cache->records  = (const ZzTrampolineCacheRecord *)(cache->modules + cache->header->module_count);
+    HookZzDebugInfoLog("trampoline cache %s: %u trampolines", path, cache->header->record_count);
+    return ZZ_SUCCESS;
+}
+
+static int ZzTrampolineCacheRecordCompare(const void *a, const void *b) {
+    const ZzTrampolineCacheRecord *x = (const ZzTrampolineCacheRecord *)a, *y = (const ZzTrampolineCacheRecord *)b;
+    if (x->module_index != y->module_index)
+        return x->module_index < y->module_index ? -1 : 1;
+    if (x->offset != y->offset)
+        return x->offset < y->offset ? -1 : 1;
+    return 0;
+}
+
+static bool ZzIsTrampolineCacheRecordValid(const ZzTrampolineCacheRecord *record, zz_size_t map_size) {
+    const ZzTrampolineCacheFixup *fixups;
+    zz_size_t i;
+
+    if (record->redirect_size > ZZ_TRAMPOLINE_CACHE_WINDOW_SIZE || record->code_size > ZZ_TRAMPOLINE_CACHE_MAX_CODE_SIZE ||
+        record->relocated_offset_count > ZZ_TRAMPOLINE_CACHE_MAX_RELOCATED_INSN_COUNT ||
+        (zz_size_t)record->data_offset + record->code_size + record->fixup_count * sizeof(ZzTrampolineCacheFixup) >
+            map_size)
+        return FALSE;
+    fixups = (const ZzTrampolineCacheFixup *)((zz_addr_t)g_trampoline_cache.map + record->data_offset + record->code_size);
+    for (i = 0; i < record->fixup_count; i++) {
+        if (fixups[i].offset + sizeof(uint64_t) > record->code_size)
+            return FALSE;
+    }
+    return TRUE;
+}
+
+const ZzTrampolineCacheRecord *ZzFindTrampolineCacheRecord(zz_addr_t address, const uint8_t *prologue,
+                                                           zz_addr_t *load_bias) {
+    ZzTrampolineCache *cache = &g_trampoline_cache;
+    ZzTrampolineCacheLoadedModule loaded_module;
+    const ZzTrampolineCacheRecord *record;
+    ZzTrampolineCacheRecord key;
+
+    if (!cache->header || !cache->header->record_count)
+        return NULL;
+    if (!ZzResolveTrampolineCacheModule(address, &loaded_module) ||
+        loaded_module.module_index == cache->header->module_count)
+        return NULL;
+
+    *load_bias       = loaded_module.load_bias;
+    key.module_index = loaded_module.module_index;
+    key.offset       = address - *load_bias;
+    record = (const ZzTrampolineCacheRecord *)bsearch(&key, cache->records, cache->header->record_count,
+                                                      sizeof(ZzTrampolineCacheRecord), ZzTrampolineCacheRecordCompare);
+    if (!record || !ZzIsTrampolineCacheRecordValid(record, cache->map_size) ||
+        memcmp(record->prologue, prologue, record->redirect_size))
+        return NULL;
+    return record;
+}
+
+static void ZzFixupTrampolineCacheCode(zz_ptr_t code, const ZzTrampolineCacheFixup *fixups, zz_size_t fixup_count,
+                                       zz_addr_t load_bias, zz_addr_t trampoline) {
+    uint64_t literal;
+    zz_size_t i;
+
+    // the literals are 4 byte aligned only
+    for (i = 0; i < fixup_count; i++) {
+        memcpy(&literal, (char *)code + fixups[i].offset, sizeof(literal));
+        literal += fixups[i].type == ZZ_TRAMPOLINE_CACHE_FIXUP_MODULE ? load_bias : trampoline;
+        memcpy((char *)code + fixups[i].offset, &literal, sizeof(literal));
+    }
+}
+
+zz_size_t ZzInstantiateTrampolineCacheRecord(const ZzTrampolineCacheRecord *record, zz_addr_t load_bias,
+                                             zz_addr_t trampoline, zz_ptr_t out) {
+    const uint8_t *data = (const uint8_t *)g_trampoline_cache.map + record->data_offset;
+
+    memcpy(out, data, record->code_size);
+    ZzFixupTrampolineCacheCode(out, (const ZzTrampolineCacheFixup *)(data + record->code_size), record->fixup_count,
+                               load_bias, trampoline);
+    return record->code_size;
+}
+
+static ZzTrampolineCacheNewRecord *ZzAddTrampolineCacheNewRecord() {
+    ZzTrampolineCache *cache = &g_trampoline_cache;
+
+    if (cache->size >= cache->capacity) {
+        zz_size_t capacity                      = cache->capacity ? cache->capacity * 2 : 64;
+        ZzTrampolineCacheNewRecord *new_records = (ZzTrampolineCacheNewRecord *)realloc(
+            cache->new_records, sizeof(ZzTrampolineCacheNewRecord) * capacity);
+        if (!new_records)
+            return NULL;
+        cache->new_records = new_records;
+        cache->capacity    = capacity;
+    }
+    memset(&cache->new_records[cache->size], 0, sizeof(ZzTrampolineCacheNewRecord));
+    return &cache->new_records[cache->size++];
+}
+
+void ZzAddTrampolineCacheRecord(zz_addr_t address, const uint8_t *prologue, zz_size_t redirect_size, zz_ptr_t code,
+                                zz_size_t code_size, zz_addr_t trampoline, const zz_size_t *literal_offsets,
+                                zz_size_t literal_count, const ZzRelocatedOffset *relocated_offsets,
+                                zz_size_t relocated_offset_count) {
+    ZzTrampolineCacheFixup fixups[ZZ_TRAMPOLINE_CACHE_MAX_FIXUP_COUNT];
+    ZzTrampolineCacheLoadedModule loaded_module;
+    ZzTrampolineCacheNewRecord *new_record;
+    uint64_t literal;
+    uint8_t *data;
+    zz_size_t i;
+
+    if (!g_trampoline_cache.path || code_size > ZZ_TRAMPOLINE_CACHE_MAX_CODE_SIZE ||
+        literal_count > ZZ_TRAMPOLINE_CACHE_MAX_FIXUP_COUNT || redirect_size > ZZ_TRAMPOLINE_CACHE_WINDOW_SIZE ||
+        relocated_offset_count > ZZ_TRAMPOLINE_CACHE_MAX_RELOCATED_INSN_COUNT)
+        return;
+    if (!ZzResolveTrampolineCacheModule(address, &loaded_module))
+        return;
+
+    data = (uint8_t *)malloc(code_size + literal_count * sizeof(ZzTrampolineCacheFixup));
+    if (!data)
+        return;
+    memcpy(data, code, code_size);
+
+    // the trampoline is made relative, the fixups of an instantiation undo it
+    for (i = 0; i < literal_count; i++) {
+        memcpy(&literal, data + literal_offsets[i], sizeof(literal));
+        fixups[i].offset = literal_offsets[i];
+        if (literal >= trampoline && literal < trampoline + code_size) {
+            fixups[i].type = ZZ_TRAMPOLINE_CACHE_FIXUP_TRAMPOLINE;
+            literal -= trampoline;
+        } else if (literal >= loaded_module.start && literal < loaded_module.end) {
+            fixups[i].type = ZZ_TRAMPOLINE_CACHE_FIXUP_MODULE;
+            literal -= loaded_module.load_bias;
+        } else {
+            free(data);
+            return;
+        }
+        memcpy(data + literal_offsets[i], &literal, sizeof(literal));
+    }
+    memcpy(data + code_size, fixups, literal_count * sizeof(ZzTrampolineCacheFixup));
+
+    pthread_mutex_lock(&g_trampoline_cache_lock);
+    new_record = ZzAddTrampolineCacheNewRecord();
+    if (!new_record) {
+        pthread_mutex_unlock(&g_trampoline_cache_lock);
+        free(data);
+        return;
+    }
+    new_record->module               = loaded_module.module;
+    new_record->record.redirect_size = redirect_size;
+    new_record->record.offset        = address - loaded_module.load_bias;
+    memcpy(new_record->record.prologue, prologue, redirect_size);
+    new_record->record.code_size              = code_size;
+    new_record->record.fixup_count            = literal_count;
+    new_record->record.relocated_offset_count = relocated_offset_count;
+    for (i = 0; i < relocated_offset_count; i++) {
+        new_record->record.relocated_offsets[i][0] = relocated_offsets[i].origin_offset;
+        new_record->record.relocated_offsets[i][1] = relocated_offsets[i].relocated_offset;
+    }
+    new_record->data      = data;
+    new_record->data_size = code_size + literal_count * sizeof(ZzTrampolineCacheFixup);
+    pthread_mutex_unlock(&g_trampoline_cache_lock);
+}
+
+// a record to write, the mapped one or a new one
+typedef struct _ZzTrampolineCacheSaveRecord {
+    ZzTrampolineCacheRecord record;
+    const uint8_t *data;
+    zz_size_t data_size;
+} ZzTrampolineCacheSaveRecord;
+
+static int ZzTrampolineCacheSaveRecordCompare(const void *a, const void *b) {
+    return ZzTrampolineCacheRecordCompare(&((const ZzTrampolineCacheSaveRecord *)a)->record,
+                                          &((const ZzTrampolineCacheSaveRecord *)b)->record);
+}
+
+static uint32_t ZzGetTrampolineCacheModuleIndex(ZzTrampolineCacheModule *modules, uint32_t *module_count,
+                                                const ZzTrampolineCacheModule *module) {
+    uint32_t i;
+
+    for (i = 0; i < *module_count; i++) {
+        if (modules[i].build_id_size == module->build_id_size &&
+            !memcmp(modules[i].build_id, module->build_id, module->build_id_size))
+            return i;
+    }
+    modules[(*module_count)++] = *module;
+    return i;
+}
+
+static bool ZzWriteTrampolineCache(FILE *fp, ZzTrampolineCacheModule *modules, uint32_t module_count,
+                                   ZzTrampolineCacheSaveRecord *save_records, zz_size_t record_count) {
+    ZzTrampolineCacheHeader header = {0};
+    zz_size_t data_offset, i;
+
+    header.magic   = ZZ_TRAMPOLINE_CACHE_MAGIC;
+    header.version = ZZ_TRAMPOLINE_CACHE_VERSION;
+    header.arch    = ZZ_HOOK_PLAN_ARCH_ARM64;
+    header.module_count = module_count;
+    header.record_count = record_count;
+    if (fwrite(&header, sizeof(header), 1, fp) != 1 ||
+        fwrite(modules, sizeof(ZzTrampolineCacheModule), module_count, fp) != module_count)
+        return FALSE;
+
+    data_offset = sizeof(header) + module_count * sizeof(ZzTrampolineCacheModule) +
+                  record_count * sizeof(ZzTrampolineCacheRecord);
+    for (i = 0; i < record_count; i++) {
+        save_records[i].record.data_offset = data_offset;
+        data_offset += save_records[i].data_size;
+        if (fwrite(&save_records[i].record, sizeof(ZzTrampolineCacheRecord), 1, fp) != 1)
+            return FALSE;
+    }
+    for (i = 0; i < record_count; i++) {
+        if (fwrite(save_records[i].data, 1, save_records[i].data_size, fp) != save_records[i].data_size)
+            return FALSE;
+    }
+    return TRUE;
+}
+
+ZZSTATUS ZzSaveTrampolineCache() {
+    ZzTrampolineCache *cache = &g_trampoline_cache;
+    zz_size_t mapped_count   = cache->header ? cache->header->record_count : 0;
+    ZzTrampolineCacheSaveRecord *save_records;
+    ZzTrampolineCacheModule *modules;
+    zz_size_t record_count = 0, i;
+    uint32_t module_count  = 0;
+    char *temp_path;
+    bool ok;
+    FILE *fp;
+
+    if (!cache->path)
+        return ZZ_FAILED;
+
+    pthread_mutex_lock(&g_trampoline_cache_lock);
+    if (!cache->size) {
+        pthread_mutex_unlock(&g_trampoline_cache_lock);
+        return ZZ_DONE;
+    }
+    modules      = (ZzTrampolineCacheModule *)malloc(sizeof(ZzTrampolineCacheModule) *
+                                                (cache->size + (cache->header ? cache->header->module_count : 0)));
+    save_records = (ZzTrampolineCacheSaveRecord *)malloc(sizeof(ZzTrampolineCacheSaveRecord) * (mapped_count + cache->size));
+    temp_path    = (char *)malloc(strlen(cache->path) + 16);
+    if (!modules || !save_records || !temp_path) {
+        pthread_mutex_unlock(&g_trampoline_cache_lock);
+        free(modules);
+        free(save_records);
+        free(temp_path);
+        return ZZ_FAILED;
+    }
+
+    // the mapped modules keep their index, a new trampoline of the same function replaces the mapped one
+    if (cache->header) {
+        memcpy(modules, cache->modules, sizeof(ZzTrampolineCacheModule) * cache->header->module_count);
+        module_count = cache->header->module_count;
+    }
+    for (i = 0; i < cache->size; i++) {
+        save_records[record_count].record              = cache->new_records[i].record;
+        save_records[record_count].record.module_index =
+            ZzGetTrampolineCacheModuleIndex(modules, &module_count, &cache->new_records[i].module);
+        save_records[record_count].data      = cache->new_records[i].data;
+        save_records[record_count].data_size = cache->new_records[i].data_size;
+        record_count++;
+    }
+    qsort(save_records, record_count, sizeof(ZzTrampolineCacheSaveRecord), ZzTrampolineCacheSaveRecordCompare);
+    for (i = 0; i < mapped_count; i++) {
+        const ZzTrampolineCacheRecord *record = &cache->records[i];
+        ZzTrampolineCacheSaveRecord key;
+
+        key.record = *record;
+        if (!ZzIsTrampolineCacheRecordValid(record, cache->map_size) ||
+            bsearch(&key, save_records, cache->size, sizeof(ZzTrampolineCacheSaveRecord),
+                    ZzTrampolineCacheSaveRecordCompare))
+            continue;
+        save_records[record_count].record    = *record;
+        save_records[record_count].data      = (const uint8_t *)cache->map + record->data_offset;
+        save_records[record_count].data_size = record->code_size + record->fixup_count * sizeof(ZzTrampolineCacheFixup);
+        record_count++;
+    }
+    qsort(save_records, record_count, sizeof(ZzTrampolineCacheSaveRecord), ZzTrampolineCacheSaveRecordCompare);
+
+    // another process may map the old file, it is replaced, not rewritten
+    sprintf(temp_path, "%s.%d", cache->path, (int)getpid());
+    fp = fopen(temp_path, "wb");
+    ok = fp && ZzWriteTrampolineCache(fp, modules, module_count, save_records, record_count);
+    if (fp && fclose(fp))
+        ok = FALSE;
+    if (ok && rename(temp_path, cache->path))
+        ok = FALSE;
+    if (!ok) {
+        ZZ_ERROR_LOG("write trampoline cache %s failed", cache->path);
+        unlink(temp_path);
+    }
+    pthread_mutex_unlock(&g_trampoline_cache_lock);
+
+    free(modules);
+    free(save_records);
+    free(temp_path);
+    return ok ? ZZ_SUCCESS : ZZ_FAILED;
+}
@@ -0,0 +1,96 @@
+/**
+ *    Copyright 2017 jmpews
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+
+#ifndef trampolinecache_h
+#define trampolinecache_h
+
+#include "hookzz.h"
+#include "kitzz.h"
+
+#include "interceptor.h"
+
+// a trampoline cache keeps the invoke trampolines of the hooked functions across process starts, keyed by the build id
+// of the module and the offset of the function. a trampoline is stored as a template, its 64 bit literals are fixed
+// up for the load bias of the module and the address of the new trampoline. the file is a header, the modules, the
+// records sorted by module and offset, then the code and the fixups of every record, little endian.
+
+#define ZZ_TRAMPOLINE_CACHE_MAGIC 0x43545a5a // "ZZTC"
+// bump on a change of the layout or of the relocated code, a cache of another version is dropped
+#define ZZ_TRAMPOLINE_CACHE_VERSION 2
+#define ZZ_TRAMPOLINE_CACHE_MAX_BUILD_ID_SIZE 32
+#define ZZ_TRAMPOLINE_CACHE_WINDOW_SIZE 16
+#define ZZ_TRAMPOLINE_CACHE_MAX_RELOCATED_INSN_COUNT 4
+#define ZZ_TRAMPOLINE_CACHE_MAX_CODE_SIZE 256
+#define ZZ_TRAMPOLINE_CACHE_MAX_FIXUP_COUNT 16
+
+typedef enum _ZzTrampolineCacheFixupType {
+    ZZ_TRAMPOLINE_CACHE_FIXUP_MODULE = 1, // the literal is an offset in the module, plus the load bias
+    ZZ_TRAMPOLINE_CACHE_FIXUP_TRAMPOLINE  // the literal is an offset in the trampoline, plus its address
+} ZzTrampolineCacheFixupType;
+
+typedef struct _ZzTrampolineCacheHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t arch; // ZzHookPlanArch
+    uint32_t module_count;
+    uint32_t record_count;
+} ZzTrampolineCacheHeader;
+
+typedef struct _ZzTrampolineCacheModule {
+    uint32_t build_id_size; // elf: NT_GNU_BUILD_ID, macho: LC_UUID
+    uint8_t build_id[ZZ_TRAMPOLINE_CACHE_MAX_BUILD_ID_SIZE];
+    uint32_t reserved;
+} ZzTrampolineCacheModule;
+
+typedef struct _ZzTrampolineCacheFixup {
+    uint16_t offset; // of the literal in the code
+    uint16_t type;
+} ZzTrampolineCacheFixup;
+
+typedef struct _ZzTrampolineCacheRecord {
+    uint32_t module_index;
+    uint32_t redirect_size;
+    uint64_t offset; // the function, less the load bias of its module
+    // the relocated prologue, the record is ignored if the code differs at runtime
+    uint8_t prologue[ZZ_TRAMPOLINE_CACHE_WINDOW_SIZE];
+    uint32_t data_offset; // the code and then the fixups, from the start of the file
+    uint16_t code_size;
+    uint16_t fixup_count;
+    // the origin and the relocated offset of every prologue instruction, for the pc fixup of the safe patch
+    uint16_t relocated_offsets[ZZ_TRAMPOLINE_CACHE_MAX_RELOCATED_INSN_COUNT][2];
+    uint16_t relocated_offset_count;
+    uint16_t reserved[3];
+} ZzTrampolineCacheRecord;
+
+bool ZzIsTrampolineCacheEnabled();
+
+// the cached trampoline of the function at address with this prologue, NULL if there is none
+const ZzTrampolineCacheRecord *ZzFindTrampolineCacheRecord(zz_addr_t address, const uint8_t *prologue,
+                                                           zz_addr_t *load_bias);
+
+// copy the code of the record to out and fix it up for a trampoline at the address, return the code size
+zz_size_t ZzInstantiateTrampolineCacheRecord(const ZzTrampolineCacheRecord *record, zz_addr_t load_bias,
+                                             zz_addr_t trampoline, zz_ptr_t out);
+
+// a trampoline built at the address for the function, saved by the next ZzSaveTrampolineCache. the literals are
+// classified by their value, a literal out of the module of the function leaves the trampoline uncached.
+void ZzAddTrampolineCacheRecord(zz_addr_t address, const uint8_t *prologue, zz_size_t redirect_size, zz_ptr_t code,
+                                zz_size_t code_size, zz_addr_t trampoline, const zz_size_t *literal_offsets,
+                                zz_size_t literal_count, const ZzRelocatedOffset *relocated_offsets,
+                                zz_size_t relocated_offset_count);
+
+#endif
@@ -0,0 +1,205 @@
+#include "platforms/arch-x86/reader-x86.h"
+#include "platforms/arch-x86/relocator-x86.h"
+
+#include <elf.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// differential test of the x86_64 decoder, every instruction objdump decodes in .text must have the same length.
+// objdump prints `fwait` with the following x87 instruction as one, it is one byte on its own. the relocator is
+// checked first, on branches and rip relative operands moved to another address.
+
+static uint8_t g_source[32 + ZZ_X86_MAX_INSN_SIZE];
+
+// relocate the one instruction to out_pc, the size written, 0 if it can't be relocated
+static zz_size_t relocate_one(const uint8_t *code, zz_size_t size, zz_addr_t out_pc, uint8_t *output) {
+    ZzX86Reader reader = {0};
+    ZzX86Relocator relocator;
+    ZzX86Writer writer;
+    zz_size_t written = 0;
+
+    memset(g_source, 0, sizeof(g_source));
+    memcpy(g_source, code, size);
+    zz_x86_reader_init(&reader, g_source);
+    zz_x86_writer_init(&writer, output, out_pc);
+    zz_x86_relocator_init(&relocator, &reader, &writer);
+    if (zz_x86_relocator_read_one(&relocator, NULL) == size && zz_x86_relocator_write_one(&relocator))
+        written = writer.size;
+    ZzArenaFree(&reader.arena);
+    return written;
+}
+
+// the instruction is kept, only the rel32 displacement is rewritten for out_pc
+static bool check_rip_relative(const char *name, const uint8_t *code, zz_size_t size, zz_size_t disp_offset,
+                               int32_t disp) {
+    zz_addr_t out_pc = (zz_addr_t)g_source + 0x40000000;
+    uint8_t output[64];
+    int32_t relocated_disp;
+    zz_size_t written;
+
+    written = relocate_one(code, size, out_pc, output);
+    memcpy(&relocated_disp, output + disp_offset, sizeof(relocated_disp));
+    if (written != size || memcmp(output, code, disp_offset) ||
+        (zz_addr_t)((int64_t)out_pc + size + relocated_disp) != (zz_addr_t)g_source + size + disp) {
+        printf("[!] relocate %s: %lu bytes, displacement 0x%x\n", name, (unsigned long)written, relocated_disp);
+        return FALSE;
+    }
+    // out of rel32 range of the output, nothing is written
+    if (relocate_one(code, size, (zz_addr_t)g_source + ((zz_addr_t)1 << 32), output)) {
+        printf("[!] relocate %s: relocated out of rel32 range\n", name);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+// the branch is rewritten as the expected code followed by the absolute target
+static bool check_branch(const char *name, const uint8_t *code, zz_size_t size, int32_t rel, const uint8_t *expected,
+                         zz_size_t expected_size) {
+    zz_addr_t out_pc = (zz_addr_t)g_source + 0x40000000, target;
+    uint8_t output[64];
+    zz_size_t written;
+
+    written = relocate_one(code, size, out_pc, output);
+    memcpy(&target, output + expected_size, sizeof(target));
+    if (written != expected_size + sizeof(target) || memcmp(output, expected, expected_size) ||
+        target != (zz_addr_t)g_source + size + rel) {
+        printf("[!] relocate %s: %lu bytes, target 0x%lx\n", name, (unsigned long)written, (unsigned long)target);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+static bool test_relocation() {
+    // jmp [rip]
+    const uint8_t jmp_absolute[] = {0xff, 0x25, 0x00, 0x00, 0x00, 0x00};
+    bool ok                      = TRUE;
+
+    // mov rax, [rip + 0x100]; lea rcx, [rip - 0x20]
+    ok &= check_rip_relative("mov rip", (const uint8_t[]){0x48, 0x8b, 0x05, 0x00, 0x01, 0x00, 0x00}, 7, 3, 0x100);
+    ok &= check_rip_relative("lea rip", (const uint8_t[]){0x48, 0x8d, 0x0d, 0xe0, 0xff, 0xff, 0xff}, 7, 3, -0x20);
+    // cmp dword [rip + 0x1000], 1, the immediate follows the displacement
+    ok &= check_rip_relative("cmp rip imm",
+                             (const uint8_t[]){0x83, 0x3d, 0x00, 0x10, 0x00, 0x00, 0x01}, 7, 2, 0x1000);
+
+    ok &= check_branch("jmp rel8", (const uint8_t[]){0xeb, 0x10}, 2, 0x10, jmp_absolute, sizeof(jmp_absolute));
+    ok &= check_branch("jmp rel32", (const uint8_t[]){0xe9, 0x00, 0x10, 0x00, 0x00}, 5, 0x1000, jmp_absolute,
+                       sizeof(jmp_absolute));
+    // je +0x10, jne -0x1000: the inverted condition skips the absolute jump
+    ok &= check_branch("jcc rel8", (const uint8_t[]){0x74, 0x10}, 2, 0x10,
+                       (const uint8_t[]){0x75, ZZ_X86_JMP_ABSOLUTE_SIZE, 0xff, 0x25, 0x00, 0x00, 0x00, 0x00}, 8);
+    ok &= check_branch("jcc rel32", (const uint8_t[]){0x0f, 0x85, 0x00, 0xf0, 0xff, 0xff}, 6, -0x1000,
+                       (const uint8_t[]){0x74, ZZ_X86_JMP_ABSOLUTE_SIZE, 0xff, 0x25, 0x00, 0x00, 0x00, 0x00}, 8);
+    // call [rip + 2]; jmp +8
+    ok &= check_branch("call rel32", (const uint8_t[]){0xe8, 0x00, 0x01, 0x00, 0x00}, 5, 0x100,
+                       (const uint8_t[]){0xff, 0x15, 0x02, 0x00, 0x00, 0x00, 0xeb, 0x08}, 8);
+    return ok;
+}
+
+static uint8_t *read_text_section(const char *path, zz_addr_t *text_address, zz_size_t *text_size) {
+    Elf64_Ehdr ehdr;
+    Elf64_Shdr *shdrs;
+    char *shstrtab;
+    uint8_t *text = NULL;
+    FILE *fp;
+    int i;
+
+    fp = fopen(path, "rb");
+    if (!fp)
+        return NULL;
+    if (fread(&ehdr, sizeof(ehdr), 1, fp) != 1 || memcmp(ehdr.e_ident, ELFMAG, SELFMAG) ||
+        ehdr.e_machine != EM_X86_64) {
+        fclose(fp);
+        return NULL;
+    }
+
+    shdrs = (Elf64_Shdr *)calloc(ehdr.e_shnum, sizeof(Elf64_Shdr));
+    fseek(fp, ehdr.e_shoff, SEEK_SET);
+    fread(shdrs, sizeof(Elf64_Shdr), ehdr.e_shnum, fp);
+    shstrtab = (char *)calloc(1, shdrs[ehdr.e_shstrndx].sh_size + 1);
+    fseek(fp, shdrs[ehdr.e_shstrndx].sh_offset, SEEK_SET);
+    fread(shstrtab, 1, shdrs[ehdr.e_shstrndx].sh_size, fp);
+
+    for (i = 0; i < ehdr.e_shnum; i++) {
+        if (strcmp(shstrtab + shdrs[i].sh_name, ".text"))
+            continue;
+        // room for a decoder reading past the last instruction
+        text = (uint8_t *)calloc(1, shdrs[i].sh_size + ZZ_X86_MAX_INSN_SIZE);
+        fseek(fp, shdrs[i].sh_offset, SEEK_SET);
+        fread(text, 1, shdrs[i].sh_size, fp);
+        *text_address = shdrs[i].sh_addr;
+        *text_size    = shdrs[i].sh_size;
+        break;
+    }
+
+    free(shstrtab);
+    free(shdrs);
+    fclose(fp);
+    return text;
+}
+
+int main(int argc, char *argv[]) {
+    unsigned long address, total = 0, mismatch = 0;
+    zz_addr_t text_address;
+    zz_size_t text_size, size, length;
+    ZzX86Instruction insn_ctx;
+    char command[1024], line[1024];
+    uint8_t *text;
+    FILE *objdump;
+
+    if (argc < 2) {
+        printf("usage: %s <x86_64 elf>\n", argv[0]);
+        return 1;
+    }
+    if (!test_relocation())
+        return 1;
+
+    text = read_text_section(argv[1], &text_address, &text_size);
+    if (!text) {
+        printf("[!] no x86_64 .text in %s\n", argv[1]);
+        return 1;
+    }
+
+    snprintf(command, sizeof(command), "objdump -d --insn-width=16 -j .text '%s'", argv[1]);
+    objdump = popen(command, "r");
+    if (!objdump) {
+        printf("[!] run objdump failed\n");
+        return 1;
+    }
+
+    // `  address:\tbytes\tmnemonic operands`
+    while (fgets(line, sizeof(line), objdump)) {
+        char *bytes, *mnemonic, *token;
+
+        if (sscanf(line, " %lx:\t", &address) != 1 || !(bytes = strchr(line, '\t')))
+            continue;
+        bytes++;
+        mnemonic = strchr(bytes, '\t');
+        if (!mnemonic || strstr(mnemonic, "(bad)") || address < text_address || address >= text_address + text_size)
+            continue;
+        *mnemonic = '\0';
+        length    = 0;
+        for (token = strtok(bytes, " "); token; token = strtok(NULL, " "))
+            length++;
+
+        total++;
+        size = zz_x86_decode_instruction(text + (address - text_address), address, &insn_ctx);
+        if (size == 1 && text[address - text_address] == 0x9b && length > 1)
+            size += zz_x86_decode_instruction(text + (address - text_address) + 1, address + 1, &insn_ctx);
+        if (size == length)
+            continue;
+
+        if (mismatch++ < 32) {
+            zz_size_t i;
+            printf("[!] %lx: objdump %lu, decoder %lu:", address, (unsigned long)length, (unsigned long)size);
+            for (i = 0; i < length; i++)
+                printf(" %02x", text[address - text_address + i]);
+            printf("\n");
+        }
+    }
+    pclose(objdump);
+    free(text);
+
+    printf("[*] %s: %lu instructions, %lu mismatches\n", argv[1], total, mismatch);
+    return (mismatch || !total) ? 1 : 0;
+}
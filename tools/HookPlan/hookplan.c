@@ -0,0 +1,376 @@
+#include "hookplan.h"
+#include "platforms/arch-arm64/reader-arm64.h"
+#include "platforms/backend-arm64/prologue-arm64.h"
+
+#include <elf.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// write the hook plan of an arm64 elf or thin macho, the prologue analysis of every function of it, for
+// ZzLoadHookPlan. `hookplan -d <plan>` dumps a plan.
+
+#ifndef NT_GNU_BUILD_ID
+#define NT_GNU_BUILD_ID 3
+#endif
+
+// <mach-o/loader.h> is not there off darwin
+#define ZZ_MH_MAGIC_64 0xfeedfacf
+#define ZZ_FAT_CIGAM 0xbebafeca
+#define ZZ_CPU_TYPE_ARM64 0x0100000c
+#define ZZ_LC_SEGMENT_64 0x19
+#define ZZ_LC_UUID 0x1b
+#define ZZ_LC_FUNCTION_STARTS 0x26
+#define ZZ_VM_PROT_EXECUTE 0x4
+
+typedef struct {
+    uint32_t magic, cputype, cpusubtype, filetype, ncmds, sizeofcmds, flags, reserved;
+} zz_mach_header_64;
+
+typedef struct {
+    uint32_t cmd, cmdsize;
+} zz_load_command;
+
+typedef struct {
+    uint32_t cmd, cmdsize;
+    char segname[16];
+    uint64_t vmaddr, vmsize, fileoff, filesize;
+    uint32_t maxprot, initprot, nsects, flags;
+} zz_segment_command_64;
+
+typedef struct {
+    uint32_t cmd, cmdsize, dataoff, datasize;
+} zz_linkedit_data_command;
+
+typedef struct {
+    uint32_t cmd, cmdsize;
+    uint8_t uuid[16];
+} zz_uuid_command;
+
+// an executable segment, copied out with ZZ_ARM64_PROLOGUE_SCAN_SIZE zero bytes behind it for the sweep
+typedef struct {
+    uint64_t address;
+    uint64_t size;
+    uint8_t *code;
+} CodeSegment;
+
+typedef struct {
+    uint8_t *map;
+    zz_size_t map_size;
+    ZzHookPlanHeader header;
+    CodeSegment segments[16];
+    int segment_count;
+    uint64_t *functions;
+    zz_size_t function_count;
+    zz_size_t function_capacity;
+} Binary;
+
+static void add_function(Binary *binary, uint64_t address) {
+    if (binary->function_count >= binary->function_capacity) {
+        binary->function_capacity = binary->function_capacity ? binary->function_capacity * 2 : 1024;
+        binary->functions = (uint64_t *)realloc(binary->functions, sizeof(uint64_t) * binary->function_capacity);
+    }
+    binary->functions[binary->function_count++] = address;
+}
+
+static void add_code_segment(Binary *binary, uint64_t address, uint64_t offset, uint64_t size) {
+    CodeSegment *segment;
+
+    if (binary->segment_count >= (int)(sizeof(binary->segments) / sizeof(binary->segments[0])) ||
+        offset + size > binary->map_size)
+        return;
+    segment          = &binary->segments[binary->segment_count++];
+    segment->address = address;
+    segment->size    = size;
+    segment->code    = (uint8_t *)calloc(1, size + ZZ_ARM64_PROLOGUE_SCAN_SIZE);
+    memcpy(segment->code, binary->map + offset, size);
+}
+
+static void update_image_span(Binary *binary, uint64_t address, uint64_t size) {
+    if (!binary->header.image_end || address < binary->header.image_start)
+        binary->header.image_start = address;
+    if (address + size > binary->header.image_end)
+        binary->header.image_end = address + size;
+}
+
+static void read_elf_build_id(Binary *binary, const Elf64_Phdr *note) {
+    const uint8_t *cursor = binary->map + note->p_offset, *end = cursor + note->p_filesz;
+    const Elf64_Nhdr *nhdr;
+
+    while (cursor + sizeof(Elf64_Nhdr) <= end) {
+        nhdr = (const Elf64_Nhdr *)cursor;
+        cursor += sizeof(Elf64_Nhdr) + ((nhdr->n_namesz + 3) & ~3);
+        if (nhdr->n_type == NT_GNU_BUILD_ID && nhdr->n_namesz == 4 && !memcmp(nhdr + 1, "GNU", 4) &&
+            nhdr->n_descsz <= ZZ_HOOK_PLAN_MAX_BUILD_ID_SIZE && cursor + nhdr->n_descsz <= end) {
+            memcpy(binary->header.build_id, cursor, nhdr->n_descsz);
+            binary->header.build_id_size = nhdr->n_descsz;
+            return;
+        }
+        cursor += (nhdr->n_descsz + 3) & ~3;
+    }
+}
+
+static bool parse_elf(Binary *binary) {
+    const Elf64_Ehdr *ehdr = (const Elf64_Ehdr *)binary->map;
+    const Elf64_Phdr *phdr;
+    const Elf64_Shdr *shdr, *symtab = NULL;
+    const Elf64_Sym *sym;
+    zz_size_t i;
+
+    if (ehdr->e_ident[EI_CLASS] != ELFCLASS64 || ehdr->e_machine != EM_AARCH64) {
+        printf("[!] only arm64 elf is supported\n");
+        return FALSE;
+    }
+
+    phdr = (const Elf64_Phdr *)(binary->map + ehdr->e_phoff);
+    for (i = 0; i < ehdr->e_phnum; i++) {
+        if (phdr[i].p_type == PT_LOAD) {
+            update_image_span(binary, phdr[i].p_vaddr, phdr[i].p_memsz);
+            if (phdr[i].p_flags & PF_X)
+                add_code_segment(binary, phdr[i].p_vaddr, phdr[i].p_offset, phdr[i].p_filesz);
+        } else if (phdr[i].p_type == PT_NOTE && !binary->header.build_id_size) {
+            read_elf_build_id(binary, &phdr[i]);
+        }
+    }
+
+    // .symtab if not stripped, else .dynsym
+    shdr = (const Elf64_Shdr *)(binary->map + ehdr->e_shoff);
+    for (i = 0; ehdr->e_shoff && i < ehdr->e_shnum; i++) {
+        if (shdr[i].sh_type == SHT_SYMTAB || (shdr[i].sh_type == SHT_DYNSYM && !symtab))
+            symtab = &shdr[i];
+    }
+    if (!symtab)
+        return TRUE;
+    sym = (const Elf64_Sym *)(binary->map + symtab->sh_offset);
+    for (i = 0; i < symtab->sh_size / sizeof(Elf64_Sym); i++) {
+        if (ELF64_ST_TYPE(sym[i].st_info) == STT_FUNC && sym[i].st_shndx != SHN_UNDEF && sym[i].st_value &&
+            sym[i].st_size)
+            add_function(binary, sym[i].st_value);
+    }
+    return TRUE;
+}
+
+static bool parse_macho(Binary *binary) {
+    const zz_mach_header_64 *header = (const zz_mach_header_64 *)binary->map;
+    const zz_linkedit_data_command *function_starts = NULL;
+    const zz_segment_command_64 *segment;
+    const zz_load_command *cmd;
+    uint64_t text_address = 0, address;
+    const uint8_t *cursor, *end;
+    uint32_t i;
+
+    if (header->cputype != ZZ_CPU_TYPE_ARM64) {
+        printf("[!] only arm64 macho is supported\n");
+        return FALSE;
+    }
+
+    cmd = (const zz_load_command *)(header + 1);
+    for (i = 0; i < header->ncmds; i++, cmd = (const zz_load_command *)((const uint8_t *)cmd + cmd->cmdsize)) {
+        if (cmd->cmd == ZZ_LC_SEGMENT_64) {
+            segment = (const zz_segment_command_64 *)cmd;
+            // __PAGEZERO
+            if (!segment->filesize && !segment->initprot)
+                continue;
+            update_image_span(binary, segment->vmaddr, segment->vmsize);
+            if (!strncmp(segment->segname, "__TEXT", 16))
+                text_address = segment->vmaddr;
+            if (segment->initprot & ZZ_VM_PROT_EXECUTE)
+                add_code_segment(binary, segment->vmaddr, segment->fileoff, segment->filesize);
+        } else if (cmd->cmd == ZZ_LC_UUID) {
+            memcpy(binary->header.build_id, ((const zz_uuid_command *)cmd)->uuid, 16);
+            binary->header.build_id_size = 16;
+        } else if (cmd->cmd == ZZ_LC_FUNCTION_STARTS) {
+            function_starts = (const zz_linkedit_data_command *)cmd;
+        }
+    }
+    if (!function_starts)
+        return TRUE;
+
+    // uleb128 deltas from the start of __TEXT, a zero ends the list
+    cursor  = binary->map + function_starts->dataoff;
+    end     = cursor + function_starts->datasize;
+    address = text_address;
+    while (cursor < end) {
+        uint64_t delta = 0;
+        int shift      = 0;
+        do {
+            delta |= (uint64_t)(*cursor & 0x7f) << shift;
+            shift += 7;
+        } while (*cursor++ & 0x80 && cursor < end);
+        if (!delta)
+            break;
+        address += delta;
+        add_function(binary, address);
+    }
+    return TRUE;
+}
+
+static int compare_address(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+static bool analyse_function(Binary *binary, uint64_t address, ZzHookPlanRecord *record) {
+    ZzARM64PrologueAnalysis analysis;
+    uint8_t *code = NULL;
+    uint64_t code_size = 0;
+    uint32_t insn;
+    int i;
+
+    for (i = 0; i < binary->segment_count; i++) {
+        if (address >= binary->segments[i].address &&
+            address + ZZ_HOOK_PLAN_WINDOW_SIZE <= binary->segments[i].address + binary->segments[i].size) {
+            code      = binary->segments[i].code + (address - binary->segments[i].address);
+            code_size = binary->segments[i].address + binary->segments[i].size - address;
+        }
+    }
+    if (!code || address & 3)
+        return FALSE;
+
+    // the sweep stops at the end of the segment
+    ZzARM64AnalyzePrologue((zz_addr_t)code, ZZ_ARM64_FULL_REDIRECT_SIZE, (zz_size_t)code_size, &analysis);
+    memset(record, 0, sizeof(ZzHookPlanRecord));
+    record->address = address;
+    memcpy(record->prologue, code, ZZ_HOOK_PLAN_WINDOW_SIZE);
+    record->limit        = analysis.limit;
+    record->limit_offset = analysis.limit == ZZ_ARM64_PROLOGUE_LIMIT_NONE ? 0 : analysis.limit_address - (zz_addr_t)code;
+    record->scan_size    = analysis.scan_size;
+    record->safe_size    = analysis.safe_size;
+    if (analysis.safe_size >= ZZ_ARM64_FULL_REDIRECT_SIZE)
+        record->redirect_size = ZZ_ARM64_FULL_REDIRECT_SIZE;
+    else if (analysis.safe_size >= ZZ_ARM64_TINY_REDIRECT_SIZE)
+        record->redirect_size = ZZ_ARM64_TINY_REDIRECT_SIZE;
+
+    for (i = 0; i < record->redirect_size / 4; i++) {
+        memcpy(&insn, code + i * 4, 4);
+        switch (GetARM64InsnType(insn)) {
+        case ARM64_INS_LDR_literal:
+        case ARM64_INS_ADR:
+        case ARM64_INS_ADRP:
+        case ARM64_INS_B:
+        case ARM64_INS_BL:
+        case ARM64_INS_B_cond:
+        case ARM64_INS_CBZ_CBNZ:
+        case ARM64_INS_TBZ_TBNZ:
+            record->relocation_mask |= 1 << i;
+            break;
+        default:;
+        }
+    }
+    return TRUE;
+}
+
+static int write_plan(const char *binary_path, const char *plan_path) {
+    ZzHookPlanRecord record;
+    Binary binary = {0};
+    zz_size_t i, full = 0, tiny = 0;
+    struct stat st;
+    FILE *fp;
+    int fd;
+    bool ok;
+
+    fd = open(binary_path, O_RDONLY);
+    if (fd < 0 || fstat(fd, &st) < 0 || st.st_size < (off_t)sizeof(Elf64_Ehdr)) {
+        printf("[!] open %s failed\n", binary_path);
+        return 1;
+    }
+    binary.map      = (uint8_t *)mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    binary.map_size = st.st_size;
+    close(fd);
+    if (binary.map == MAP_FAILED)
+        return 1;
+
+    if (!memcmp(binary.map, ELFMAG, SELFMAG)) {
+        ok = parse_elf(&binary);
+    } else if (*(uint32_t *)binary.map == ZZ_MH_MAGIC_64) {
+        ok = parse_macho(&binary);
+    } else if (*(uint32_t *)binary.map == ZZ_FAT_CIGAM) {
+        printf("[!] use lipo to thin it\n");
+        ok = FALSE;
+    } else {
+        printf("[!] %s is no elf or macho\n", binary_path);
+        ok = FALSE;
+    }
+    if (!ok)
+        return 1;
+    if (!binary.header.build_id_size)
+        printf("[!] %s has no build id, the plan binds to no module\n", binary_path);
+
+    fp = fopen(plan_path, "wb");
+    if (!fp) {
+        printf("[!] open %s failed\n", plan_path);
+        return 1;
+    }
+    binary.header.magic   = ZZ_HOOK_PLAN_MAGIC;
+    binary.header.version = ZZ_HOOK_PLAN_VERSION;
+    binary.header.arch    = ZZ_HOOK_PLAN_ARCH_ARM64;
+    fwrite(&binary.header, sizeof(ZzHookPlanHeader), 1, fp);
+
+    // sorted for the bsearch at runtime, aliases once
+    qsort(binary.functions, binary.function_count, sizeof(uint64_t), compare_address);
+    for (i = 0; i < binary.function_count; i++) {
+        if (i && binary.functions[i] == binary.functions[i - 1])
+            continue;
+        if (!analyse_function(&binary, binary.functions[i], &record))
+            continue;
+        fwrite(&record, sizeof(ZzHookPlanRecord), 1, fp);
+        binary.header.record_count++;
+        full += record.redirect_size == ZZ_ARM64_FULL_REDIRECT_SIZE;
+        tiny += record.redirect_size == ZZ_ARM64_TINY_REDIRECT_SIZE;
+    }
+    fseek(fp, 0, SEEK_SET);
+    fwrite(&binary.header, sizeof(ZzHookPlanHeader), 1, fp);
+    if (fclose(fp)) {
+        printf("[!] write %s failed\n", plan_path);
+        return 1;
+    }
+
+    printf("[*] %s: %u functions, %lu full redirect, %lu near jump only, %lu none\n", plan_path,
+           binary.header.record_count, (unsigned long)full, (unsigned long)tiny,
+           (unsigned long)(binary.header.record_count - full - tiny));
+    return 0;
+}
+
+static int dump_plan(const char *plan_path) {
+    ZzHookPlanHeader header;
+    ZzHookPlanRecord record;
+    uint32_t i;
+    FILE *fp;
+
+    fp = fopen(plan_path, "rb");
+    if (!fp || fread(&header, sizeof(header), 1, fp) != 1 || header.magic != ZZ_HOOK_PLAN_MAGIC) {
+        printf("[!] %s is no hook plan\n", plan_path);
+        return 1;
+    }
+    printf("version %u, arch %u, image [0x%llx, 0x%llx), build id ", header.version, header.arch,
+           (unsigned long long)header.image_start, (unsigned long long)header.image_end);
+    for (i = 0; i < header.build_id_size; i++)
+        printf("%02x", header.build_id[i]);
+    printf("\n");
+
+    for (i = 0; i < header.record_count && fread(&record, sizeof(record), 1, fp) == 1; i++) {
+        printf("0x%llx redirect %u, relocate 0x%x, safe %u", (unsigned long long)record.address,
+               record.redirect_size, record.relocation_mask, record.safe_size);
+        if (record.limit != ZZ_ARM64_PROLOGUE_LIMIT_NONE)
+            printf(", %s (+0x%x)", ZzARM64PrologueLimitDescription((ZzARM64PrologueLimit)record.limit),
+                   record.limit_offset);
+        printf("\n");
+    }
+    fclose(fp);
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc == 3 && !strcmp(argv[1], "-d"))
+        return dump_plan(argv[2]);
+    if (argc == 3)
+        return write_plan(argv[1], argv[2]);
+    printf("usage: %s <arm64 elf/macho> <plan>\n"
+           "       %s -d <plan>\n",
+           argv[0], argv[0]);
+    return 1;
+}
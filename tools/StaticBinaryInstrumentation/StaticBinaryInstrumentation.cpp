@@ -1,4 +1,5 @@
 #include <iostream>
+#include <fcntl.h>
 #include <stdio.h>
 #include <sys/stat.h>
 #include <unistd.h>
@@ -35,36 +36,53 @@ bool zz_file_remove(const char *target_path) {
     return FALSE;
 }
 
+static bool zz_fd_copy_offset(int src_fd, int dst_fd, off_t src_offset, off_t dst_offset, zz_size_t length) {
+#if defined(__linux__)
+    // copied in the kernel, the data never reaches user space
+    while (length) {
+        ssize_t n = copy_file_range(src_fd, &src_offset, dst_fd, &dst_offset, length, 0);
+        if (n <= 0)
+            break;
+        length -= n;
+    }
+#endif
+    unsigned char tmp_block[0x10000];
+
+    while (length) {
+        ssize_t n = pread(src_fd, tmp_block, length < sizeof(tmp_block) ? length : sizeof(tmp_block), src_offset);
+        if (n <= 0 || pwrite(dst_fd, tmp_block, n, dst_offset) != n)
+            return FALSE;
+        src_offset += n;
+        dst_offset += n;
+        length -= n;
+    }
+    return TRUE;
+}
+
 bool zz_file_copy_offset(const char *src_path, const char *dst_path, zz_size_t src_offset, zz_size_t dst_offset, zz_size_t length) {
-    FILE *src_fd;
-    FILE *dst_fd;
+    int src_fd;
+    int dst_fd;
+    bool done;
 
     if (!zz_file_is_exist(src_path) || !zz_file_is_exist(dst_path)) {
         return FALSE;
     }
 
-    src_fd = fopen(src_path, "rb");
-    dst_fd = fopen(dst_path, "rb+");
-
-    fseek(src_fd, src_offset, SEEK_SET);
-    fseek(dst_fd, dst_offset, SEEK_SET);
-
-    zz_size_t WRITE_BLOCK_SIZE = 1024;
-    unsigned char tmp_block[1024];
-
-    for (int i = 0; i < length / WRITE_BLOCK_SIZE; i++) {
-        fread(tmp_block, WRITE_BLOCK_SIZE, 1, src_fd);
-        fwrite(tmp_block, WRITE_BLOCK_SIZE, 1, dst_fd);
+    src_fd = open(src_path, O_RDONLY);
+    dst_fd = open(dst_path, O_WRONLY);
+    if (src_fd < 0 || dst_fd < 0) {
+        if (src_fd >= 0)
+            close(src_fd);
+        if (dst_fd >= 0)
+            close(dst_fd);
+        return FALSE;
     }
 
-    if (length % WRITE_BLOCK_SIZE) {
-        fread(tmp_block, length % WRITE_BLOCK_SIZE, 1, src_fd);
-        fwrite(tmp_block, length % WRITE_BLOCK_SIZE, 1, dst_fd);
-    }
+    done = zz_fd_copy_offset(src_fd, dst_fd, src_offset, dst_offset, length);
 
-    fclose(src_fd);
-    fclose(dst_fd);
-    return TRUE;
+    close(src_fd);
+    close(dst_fd);
+    return done;
 }
 
 void zz_copy_file_to_file(const char *src_path, const char *dst_path) {
@@ -124,6 +142,8 @@ void fix_macho_load_command(const char *target_path) {
         printf("use lipo to thin it.");
     }
 
+    // only the load commands are rewritten
+    machofd->parse_type = PARSE_SIMPLE;
     machofd->parse_macho();
 
     for (const auto &loadcmd : machofd->loadcommands.load_command_infos) {
@@ -192,6 +212,7 @@ void macho_insert_segment(string target_path, string new_target_path) {
     if (machofd->isFat) {
         printf("use lipo to thin it.");
     }
+    machofd->parse_type = PARSE_SIMPLE;
     machofd->parse_macho();
     Xinfo("[*] parse origin file %s", target_path.c_str());
 
@@ -493,6 +514,7 @@ int main(int args, const char **argv) {
     if (machofd->isFat) {
         printf("use lipo to thin it.");
     }
+    machofd->parse_type = PARSE_SIMPLE;
     machofd->parse_macho();
 
     ZzSolidifyHook((zpointer)0x7f0c, machofd);
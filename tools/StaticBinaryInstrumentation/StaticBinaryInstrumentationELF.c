@@ -0,0 +1,369 @@
+#include "solidify.h"
+#include "platforms/arch-arm64/instructions.h"
+#include "platforms/arch-arm64/reader-arm64.h"
+#include "platforms/arch-arm64/writer-arm64.h"
+#include "platforms/backend-arm64/prologue-arm64.h"
+
+#include <elf.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+// elf mode of the static binary instrumentation (arm64). HookZzCode (r-x) gets the moved program headers and the
+// enter/invoke trampolines of every function, HookZzData (rw-) the records, and the prologues are patched in the file.
+// ZzHookSolidified binds a function at runtime. see solidify.h for the layout.
+//
+//     StaticBinaryInstrumentationELF <in elf> <out elf> <symbol | 0xaddress>...
+
+// a hook slot of HookZzCode, the enter trampoline and then the invoke trampoline
+#define ZZ_SOLIDIFY_ENTER_SIZE (10 * 4)
+#define ZZ_SOLIDIFY_HOOK_STRIDE 128
+
+// `adrp x17, enter; add x17, x17, :lo12:enter; br x17` if the `b` does not reach
+#define ZZ_SOLIDIFY_FAR_REDIRECT_SIZE 12
+
+typedef struct {
+    uint64_t target;
+    uint64_t fileoff;
+    ZzARM64PrologueAnalysis analysis;
+} SolidifyTarget;
+
+typedef struct {
+    uint8_t *data; // ZZ_ARM64_PROLOGUE_SCAN_SIZE zero bytes behind it for the sweep
+    zz_size_t size;
+    Elf64_Ehdr *ehdr;
+    Elf64_Phdr *phdr;
+    Elf64_Shdr *shdr;
+} ElfFile;
+
+static bool read_elf(const char *path, ElfFile *elf) {
+    struct stat st;
+    FILE *fp;
+
+    fp = fopen(path, "rb");
+    if (!fp || fstat(fileno(fp), &st) < 0 || st.st_size < (off_t)sizeof(Elf64_Ehdr)) {
+        printf("[!] open %s failed\n", path);
+        return FALSE;
+    }
+    elf->size = st.st_size;
+    elf->data = (uint8_t *)calloc(1, elf->size + ZZ_ARM64_PROLOGUE_SCAN_SIZE);
+    if (fread(elf->data, 1, elf->size, fp) != elf->size) {
+        fclose(fp);
+        return FALSE;
+    }
+    fclose(fp);
+
+    elf->ehdr = (Elf64_Ehdr *)elf->data;
+    if (memcmp(elf->ehdr->e_ident, ELFMAG, SELFMAG) || elf->ehdr->e_ident[EI_CLASS] != ELFCLASS64 ||
+        elf->ehdr->e_machine != EM_AARCH64 || (elf->ehdr->e_type != ET_DYN && elf->ehdr->e_type != ET_EXEC)) {
+        printf("[!] only arm64 elf executable or shared object is supported\n");
+        return FALSE;
+    }
+    elf->phdr = (Elf64_Phdr *)(elf->data + elf->ehdr->e_phoff);
+    elf->shdr = elf->ehdr->e_shoff ? (Elf64_Shdr *)(elf->data + elf->ehdr->e_shoff) : NULL;
+    return TRUE;
+}
+
+// .symtab first, a stripped file has .dynsym only
+static uint64_t find_function(ElfFile *elf, const char *name) {
+    const Elf64_Sym *sym;
+    const char *strtab;
+    int pass, i;
+    zz_size_t j;
+
+    if (!strncmp(name, "0x", 2))
+        return strtoull(name, NULL, 16);
+    for (pass = 0; elf->shdr && pass < 2; pass++) {
+        for (i = 0; i < elf->ehdr->e_shnum; i++) {
+            if (elf->shdr[i].sh_type != (pass ? SHT_DYNSYM : SHT_SYMTAB))
+                continue;
+            sym    = (const Elf64_Sym *)(elf->data + elf->shdr[i].sh_offset);
+            strtab = (const char *)(elf->data + elf->shdr[elf->shdr[i].sh_link].sh_offset);
+            for (j = 0; j < elf->shdr[i].sh_size / sizeof(Elf64_Sym); j++) {
+                if (ELF64_ST_TYPE(sym[j].st_info) == STT_FUNC && sym[j].st_shndx != SHN_UNDEF &&
+                    !strcmp(strtab + sym[j].st_name, name))
+                    return sym[j].st_value;
+            }
+        }
+    }
+    return 0;
+}
+
+static uint64_t find_code_fileoff(ElfFile *elf, uint64_t address) {
+    const Elf64_Phdr *phdr;
+    int i;
+
+    for (i = 0; i < elf->ehdr->e_phnum; i++) {
+        phdr = &elf->phdr[i];
+        if (phdr->p_type == PT_LOAD && phdr->p_flags & PF_X && address >= phdr->p_vaddr &&
+            address + ZZ_SOLIDIFY_MAX_PROLOGUE_SIZE <= phdr->p_vaddr + phdr->p_filesz)
+            return phdr->p_offset + (address - phdr->p_vaddr);
+    }
+    return 0;
+}
+
+static int compare_target(const void *a, const void *b) {
+    uint64_t x = ((const SolidifyTarget *)a)->target, y = ((const SolidifyTarget *)b)->target;
+    return x < y ? -1 : x > y;
+}
+
+static uint64_t align_up(uint64_t value, uint64_t align) { return (value + align - 1) & ~(align - 1); }
+
+// the prologue instruction at pc, position independent. x17 is used as scratch, like the runtime relocator.
+static void relocate_insn(ZzARM64AssemblerWriter *writer, uint64_t pc, uint32_t insn) {
+    static const uint32_t literal_loads[2][4] = {
+        {0xb9400000, 0xf9400000, 0xb9800000, 0xf9800000}, // ldr w, ldr x, ldrsw, prfm
+        {0xbd400000, 0xfd400000, 0x3dc00000, 0}};         // ldr s, ldr d, ldr q
+    uint64_t target;
+
+    // literal load, `adrp x17, literal; add x17, x17, :lo12:literal; ldr rt, [x17]`
+    if ((insn & 0x3b000000) == 0x18000000) {
+        target = pc + sign_extend((uint64_t)get_insn_sub(insn, 5, 19) << 2, 21);
+        zz_arm64_writer_put_adrp_add_reg_address(writer, ZZ_ARM64_REG_X17, target);
+        zz_arm64_writer_put_instruction(writer, literal_loads[get_insn_sub(insn, 26, 1)][get_insn_sub(insn, 30, 2)] |
+                                                    17 << 5 | get_insn_sub(insn, 0, 5));
+        return;
+    }
+
+    switch (GetARM64InsnType(insn)) {
+    case ARM64_INS_ADR:
+        target = pc + sign_extend((uint64_t)get_insn_sub(insn, 5, 19) << 2 | get_insn_sub(insn, 29, 2), 21);
+        zz_arm64_writer_put_adrp_add_reg_address(writer, (ZzARM64Reg)(ZZ_ARM64_REG_X0 + get_insn_sub(insn, 0, 5)),
+                                                 target);
+        return;
+    case ARM64_INS_ADRP:
+        target = (pc & ~(uint64_t)0xfff) +
+                 sign_extend(((uint64_t)get_insn_sub(insn, 5, 19) << 2 | get_insn_sub(insn, 29, 2)) << 12, 33);
+        zz_arm64_writer_put_adrp_reg_imm(writer, (ZzARM64Reg)(ZZ_ARM64_REG_X0 + get_insn_sub(insn, 0, 5)),
+                                         (int64_t)(target >> 12) - (int64_t)(writer->current_pc >> 12));
+        return;
+    case ARM64_INS_B:
+    case ARM64_INS_BL:
+        target = pc + sign_extend((uint64_t)get_insn_sub(insn, 0, 26) << 2, 28);
+        zz_arm64_writer_put_adrp_add_reg_address(writer, ZZ_ARM64_REG_X17, target);
+        if (GetARM64InsnType(insn) == ARM64_INS_BL)
+            zz_arm64_writer_put_blr_reg(writer, ZZ_ARM64_REG_X17);
+        else
+            zz_arm64_writer_put_br_reg(writer, ZZ_ARM64_REG_X17);
+        return;
+    case ARM64_INS_B_cond:
+    case ARM64_INS_CBZ_CBNZ:
+    case ARM64_INS_TBZ_TBNZ:
+        // the branch taken skips to the far jump, `b.cond +8; b +16; adrp; add; br`
+        if (GetARM64InsnType(insn) == ARM64_INS_TBZ_TBNZ) {
+            target = pc + sign_extend((uint64_t)get_insn_sub(insn, 5, 14) << 2, 16);
+            insn   = (insn & ~((uint32_t)0x3fff << 5)) | 2 << 5;
+        } else {
+            target = pc + sign_extend((uint64_t)get_insn_sub(insn, 5, 19) << 2, 21);
+            insn   = (insn & ~((uint32_t)0x7ffff << 5)) | 2 << 5;
+        }
+        zz_arm64_writer_put_instruction(writer, insn);
+        zz_arm64_writer_put_b_imm(writer, 16);
+        zz_arm64_writer_put_adrp_add_reg_address(writer, ZZ_ARM64_REG_X17, target);
+        zz_arm64_writer_put_br_reg(writer, ZZ_ARM64_REG_X17);
+        return;
+    default:
+        zz_arm64_writer_put_instruction(writer, insn);
+    }
+}
+
+// the enter and invoke trampolines at code, the prologue redirect at prologue. FALSE if no redirect fits.
+static bool solidify_function(ZzARM64AssemblerWriter *writer, SolidifyTarget *target, uint8_t *code,
+                              uint64_t code_vaddr, uint8_t *prologue, uint64_t entry_slot, uint64_t enter_thunk_slot,
+                              ZzSolidifyRecord *record) {
+    uint64_t enter = code_vaddr, invoke = code_vaddr + ZZ_SOLIDIFY_ENTER_SIZE;
+    uint64_t distance = enter > target->target ? enter - target->target : target->target - enter;
+    zz_size_t redirect_size, i;
+    uint32_t insn;
+
+    if (distance < zz_arm64_writer_near_jump_range_size() && target->analysis.safe_size >= 4)
+        redirect_size = 4;
+    else if (target->analysis.safe_size >= ZZ_SOLIDIFY_FAR_REDIRECT_SIZE)
+        redirect_size = ZZ_SOLIDIFY_FAR_REDIRECT_SIZE;
+    else
+        return FALSE;
+
+    // enter trampoline, the same stack layout as the runtime one
+    zz_arm64_writer_reset(writer, code, enter);
+    zz_arm64_writer_put_adrp_add_reg_address(writer, ZZ_ARM64_REG_X17, entry_slot);
+    zz_arm64_writer_put_ldr_reg_reg_offset(writer, ZZ_ARM64_REG_X17, ZZ_ARM64_REG_X17, 0);
+    // cbz x17, invoke
+    zz_arm64_writer_put_instruction(writer, 0xb4000000 | ((invoke - writer->current_pc) >> 2 & 0x7ffff) << 5 | 17);
+    zz_arm64_writer_put_sub_reg_reg_imm(writer, ZZ_ARM64_REG_SP, ZZ_ARM64_REG_SP, 2 * 0x8);
+    zz_arm64_writer_put_str_reg_reg_offset(writer, ZZ_ARM64_REG_X17, ZZ_ARM64_REG_SP, 0x0);
+    zz_arm64_writer_put_adrp_add_reg_address(writer, ZZ_ARM64_REG_X17, enter_thunk_slot);
+    zz_arm64_writer_put_ldr_reg_reg_offset(writer, ZZ_ARM64_REG_X17, ZZ_ARM64_REG_X17, 0);
+    zz_arm64_writer_put_br_reg(writer, ZZ_ARM64_REG_X17);
+
+    // invoke trampoline, the relocated prologue and back to the rest
+    zz_arm64_writer_reset(writer, code + ZZ_SOLIDIFY_ENTER_SIZE, invoke);
+    for (i = 0; i < redirect_size; i += 4) {
+        memcpy(&insn, prologue + i, 4);
+        relocate_insn(writer, target->target + i, insn);
+    }
+    zz_arm64_writer_put_adrp_add_reg_address(writer, ZZ_ARM64_REG_X17, target->target + redirect_size);
+    zz_arm64_writer_put_br_reg(writer, ZZ_ARM64_REG_X17);
+
+    memset(record, 0, sizeof(ZzSolidifyRecord));
+    record->target               = target->target;
+    record->on_enter_trampoline  = enter;
+    record->on_invoke_trampoline = invoke;
+    record->redirect_size        = redirect_size;
+    memcpy(record->origin_prologue, prologue, redirect_size);
+
+    // the prologue redirect, last, the relocation read it
+    zz_arm64_writer_reset(writer, prologue, target->target);
+    if (redirect_size == 4) {
+        zz_arm64_writer_put_b_imm(writer, enter - target->target);
+    } else {
+        zz_arm64_writer_put_adrp_add_reg_address(writer, ZZ_ARM64_REG_X17, enter);
+        zz_arm64_writer_put_br_reg(writer, ZZ_ARM64_REG_X17);
+    }
+    return TRUE;
+}
+
+int main(int argc, char *argv[]) {
+    uint64_t load_end = 0, load_delta = 0, align = 0x1000, code_off, code_vaddr, data_off, data_vaddr, phdr_size;
+    uint64_t code_size, data_size, lowest_vaddr = (uint64_t)-1;
+    ZzARM64AssemblerWriter writer;
+    SolidifyTarget *targets;
+    ZzSolidifyHeader *header;
+    ZzSolidifyRecord *records;
+    Elf64_Phdr *phdr;
+    Elf64_Ehdr *ehdr;
+    zz_size_t count = 0, i;
+    ElfFile elf;
+    uint8_t *out;
+    struct stat st;
+    FILE *fp;
+    int j, k, phnum, has_phdr = 0;
+
+    if (argc < 4) {
+        printf("usage: %s <in elf> <out elf> <symbol | 0xaddress>...\n", argv[0]);
+        return 1;
+    }
+    if (!read_elf(argv[1], &elf))
+        return 1;
+
+    // analysed on the original bytes, a patched neighbour would look like a tail call
+    targets = (SolidifyTarget *)calloc(argc - 3, sizeof(SolidifyTarget));
+    for (j = 3; j < argc; j++) {
+        SolidifyTarget *target = &targets[count];
+        target->target         = find_function(&elf, argv[j]);
+        target->fileoff        = target->target ? find_code_fileoff(&elf, target->target) : 0;
+        if (!target->fileoff || target->target & 3) {
+            printf("[!] %s is no function in an executable segment\n", argv[j]);
+            continue;
+        }
+        ZzARM64AnalyzePrologue((zz_addr_t)(elf.data + target->fileoff), ZZ_ARM64_FULL_REDIRECT_SIZE, 0,
+                               &target->analysis);
+        count++;
+    }
+    qsort(targets, count, sizeof(SolidifyTarget), compare_target);
+
+    // a target named twice, e.g. by symbol and by address, is solidified once. a second pass would relocate the
+    // already patched prologue.
+    for (i = 0, k = 0; i < count; i++) {
+        if (k && targets[k - 1].target == targets[i].target) {
+            printf("[*] 0x%llx is named twice, solidified once\n", (unsigned long long)targets[i].target);
+            continue;
+        }
+        targets[k++] = targets[i];
+    }
+    count = k;
+
+    for (j = 0; j < elf.ehdr->e_phnum; j++) {
+        phdr = &elf.phdr[j];
+        if (phdr->p_type != PT_LOAD)
+            continue;
+        if (phdr->p_align > align)
+            align = phdr->p_align;
+        if (phdr->p_vaddr + phdr->p_memsz > load_end)
+            load_end = phdr->p_vaddr + phdr->p_memsz;
+        if (phdr->p_vaddr < lowest_vaddr) {
+            lowest_vaddr = phdr->p_vaddr;
+            load_delta   = phdr->p_vaddr - phdr->p_offset;
+        }
+    }
+    if (load_delta & (align - 1)) {
+        printf("[!] the first PT_LOAD is not aligned\n");
+        return 1;
+    }
+
+    // the program headers move to HookZzCode, a PT_PHDR tells every loader where. with vaddr - offset of the first
+    // PT_LOAD kept, the load address plus e_phoff still finds them too. the new segments go behind every other one.
+    for (j = 0; j < elf.ehdr->e_phnum; j++)
+        has_phdr |= elf.phdr[j].p_type == PT_PHDR;
+    phnum      = elf.ehdr->e_phnum + 3 + !has_phdr;
+    phdr_size  = phnum * sizeof(Elf64_Phdr);
+    code_size  = align_up(phdr_size, 16) + count * ZZ_SOLIDIFY_HOOK_STRIDE;
+    // code_off is always code_vaddr - load_delta, padding the file when the segments end beyond it, so the loader's
+    // load address plus e_phoff lands on the program headers. kernels before 5.18 compute AT_PHDR that way.
+    code_vaddr = align_up(load_end, align);
+    if (code_vaddr < align_up(elf.size, align) + load_delta)
+        code_vaddr = align_up(elf.size, align) + load_delta;
+    code_off   = code_vaddr - load_delta;
+    data_off   = align_up(code_off + code_size, align);
+    data_vaddr = code_vaddr + (data_off - code_off);
+    data_size  = sizeof(ZzSolidifyHeader) + count * sizeof(ZzSolidifyRecord);
+
+    out = (uint8_t *)calloc(1, data_off + data_size);
+    memcpy(out, elf.data, elf.size);
+    header  = (ZzSolidifyHeader *)(out + data_off);
+    records = (ZzSolidifyRecord *)(header + 1);
+
+    zz_arm64_writer_init(&writer, NULL, 0);
+    for (i = 0; i < count; i++) {
+        ZzSolidifyRecord *record = &records[header->record_count];
+        uint64_t slot            = align_up(phdr_size, 16) + i * ZZ_SOLIDIFY_HOOK_STRIDE;
+
+        if (!solidify_function(&writer, &targets[i], out + code_off + slot, code_vaddr + slot,
+                               out + targets[i].fileoff,
+                               data_vaddr + sizeof(ZzSolidifyHeader) + header->record_count * sizeof(ZzSolidifyRecord),
+                               data_vaddr + offsetof(ZzSolidifyHeader, enter_thunk), record)) {
+            printf("[!] 0x%llx: no redirect fits, %s\n", (unsigned long long)targets[i].target,
+                   ZzARM64PrologueLimitDescription(targets[i].analysis.limit));
+            continue;
+        }
+        printf("[*] 0x%llx: %u bytes redirect, trampolines at 0x%llx\n", (unsigned long long)record->target,
+               record->redirect_size, (unsigned long long)record->on_enter_trampoline);
+        header->record_count++;
+    }
+    header->magic   = ZZ_SOLIDIFY_MAGIC;
+    header->version = ZZ_SOLIDIFY_VERSION;
+    header->arch    = ZZ_HOOK_PLAN_ARCH_ARM64;
+
+    // PT_PHDR, if any, comes before every PT_LOAD
+    ehdr = (Elf64_Ehdr *)out;
+    phdr = (Elf64_Phdr *)(out + code_off);
+    k    = 0;
+    if (!has_phdr)
+        phdr[k++] = (Elf64_Phdr){PT_PHDR, PF_R, code_off, code_vaddr, code_vaddr, phdr_size, phdr_size, 8};
+    memcpy(&phdr[k], elf.phdr, elf.ehdr->e_phnum * sizeof(Elf64_Phdr));
+    for (j = 0; j < elf.ehdr->e_phnum; j++, k++) {
+        if (phdr[k].p_type != PT_PHDR)
+            continue;
+        phdr[k].p_offset = code_off;
+        phdr[k].p_vaddr = phdr[k].p_paddr = code_vaddr;
+        phdr[k].p_filesz = phdr[k].p_memsz = phdr_size;
+    }
+    phdr[k++] = (Elf64_Phdr){PT_LOAD, PF_R | PF_X, code_off, code_vaddr, code_vaddr, code_size, code_size, align};
+    phdr[k++] = (Elf64_Phdr){PT_LOAD, PF_R | PF_W, data_off, data_vaddr, data_vaddr, data_size, data_size, align};
+    phdr[k++] = (Elf64_Phdr){ZZ_PT_HOOKZZ_SOLIDIFY, PF_R | PF_W, data_off, data_vaddr, data_vaddr,
+                             data_size,             data_size,   8};
+    ehdr->e_phoff = code_off;
+    ehdr->e_phnum = phnum;
+
+    fp = fopen(argv[2], "wb");
+    if (!fp || fwrite(out, 1, data_off + data_size, fp) != data_off + data_size || fclose(fp)) {
+        printf("[!] write %s failed\n", argv[2]);
+        return 1;
+    }
+    if (!stat(argv[1], &st))
+        chmod(argv[2], st.st_mode);
+    printf("[*] %s: %u functions solidified, HookZzCode at 0x%llx, HookZzData at 0x%llx\n", argv[2],
+           header->record_count, (unsigned long long)code_vaddr, (unsigned long long)data_vaddr);
+    return 0;
+}
@@ -35,6 +35,8 @@ public:
   /* common */
   bool macho_read(zaddr addr, zpointer data, zsize len);
   char *macho_read_string(zaddr addr);
+  zpointer macho_view(zaddr addr, zsize len);
+  const char *macho_view_string(zaddr addr);
   zaddr macho_search_data(const zaddr start_addr, const zaddr end_addr,
                           const zbyte *data, const zsize len);
   bool check_initialization();
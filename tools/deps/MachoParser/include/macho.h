@@ -136,11 +136,16 @@ class Macho
     virtual bool macho_read(zaddr addr, zpointer data, zsize len) = 0;
 
     virtual char *macho_read_string(zaddr addr) = 0;
+
+    /* a pointer into the input instead of a copy, NULL when the input can't be viewed */
+    virtual zpointer macho_view(zaddr addr, zsize len);
+    virtual const char *macho_view_string(zaddr addr);
     zaddr macho_search_data(const zaddr start_addr, const zaddr end_addr,
                             const zbyte *data, const zsize len);
     bool macho_runtime_read(zaddr vmaddr, zpointer data, zsize len);
 
     char *macho_runtime_read_string(zaddr vmaddr);
+    zpointer macho_runtime_view(zaddr vmaddr, zsize len);
     zaddr macho_runtime_address(zaddr vmaddr);
     zaddr macho_link_address(zaddr vmaddr);
 
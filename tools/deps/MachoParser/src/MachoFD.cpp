@@ -21,6 +21,7 @@
 // common
 #include <fcntl.h> //open
 #include <stdio.h>
+#include <string.h>
 #include <sys/mman.h> //mmap
 #include <sys/stat.h> //stat
 #include <unistd.h> //read
@@ -97,18 +98,50 @@ bool MachoFD::setPath(const char *path)
     return TRUE;
 }
 
+zpointer MachoFD::macho_view(zaddr address, zsize len)
+{
+    zaddr start = (zaddr)this->input.fd.data;
+    zaddr end = start + this->input.fd.length;
+
+    if (address < start || address > end || len > end - address)
+    {
+        return NULL;
+    }
+    return (zpointer)address;
+}
+const char *MachoFD::macho_view_string(zaddr address)
+{
+    zaddr end = (zaddr)this->input.fd.data + this->input.fd.length;
+
+    if (!macho_view(address, 1))
+    {
+        return NULL;
+    }
+    // the string must end inside the mapping
+    if (!memchr((zpointer)address, 0, end - address))
+    {
+        return NULL;
+    }
+    return (const char *)address;
+}
 bool MachoFD::macho_read(zaddr address, zpointer data, zsize len)
 {
-    if (address - (zaddr)this->input.fd.data > this->input.fd.length)
+    zpointer view = macho_view(address, len);
+    if (!view)
     {
         return FALSE;
     }
-    memcpy(data, (zpointer)address, len);
+    memcpy(data, view, len);
     return TRUE;
 }
 char *MachoFD::macho_read_string(zaddr address)
 {
-    return zz_vm_read_string((zpointer)address);
+    const char *view = macho_view_string(address);
+    if (!view)
+    {
+        return NULL;
+    }
+    return strdup(view);
 }
 bool MachoFD::check_initialization()
 {
@@ -149,7 +182,9 @@ bool MachoFD::parse_macho()
         {
             parse_load_command_headers();
             parse_load_command_details();
-            parse_SECT();
+            // PARSE_SIMPLE stops at the load commands, parse_SECT() can still be called later
+            if (this->parse_type == PARSE_ALL)
+                parse_SECT();
         }
 
         return TRUE;
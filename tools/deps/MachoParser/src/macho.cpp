@@ -273,6 +273,18 @@ bool Macho::macho_runtime_read(zaddr vmaddr, zpointer data, zsize len)
         return macho_read(tmp_vmaddr, data, len);
     return TRUE;
 }
+zpointer Macho::macho_view(zaddr addr, zsize len)
+{
+    return NULL;
+}
+const char *Macho::macho_view_string(zaddr addr)
+{
+    return NULL;
+}
+zpointer Macho::macho_runtime_view(zaddr vmaddr, zsize len)
+{
+    return macho_view(macho_runtime_address(vmaddr), len);
+}
 char *Macho::macho_runtime_read_string(zaddr vmaddr)
 {
     zaddr tmp_vmaddr = macho_runtime_address(vmaddr);
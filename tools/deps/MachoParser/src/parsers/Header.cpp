@@ -37,18 +37,26 @@ bool Macho::parse_header()
     {
     case MH_MAGIC_64:
         this->is64bit = TRUE;
-        header.header64 = (struct mach_header_64 *)malloc(sizeof(struct mach_header_64));
-        if (!macho_read(this->load_addr, header.header64, sizeof(struct mach_header_64)))
-            return FALSE;
+        header.header64 = (struct mach_header_64 *)macho_view(this->load_addr, sizeof(struct mach_header_64));
+        if (!header.header64)
+        {
+            header.header64 = (struct mach_header_64 *)malloc(sizeof(struct mach_header_64));
+            if (!macho_read(this->load_addr, header.header64, sizeof(struct mach_header_64)))
+                return FALSE;
+        }
         Sdebug("dump arch-64");
         break;
 
     case FAT_CIGAM:
     case FAT_MAGIC:
         this->isFat = TRUE;
-        header.fat_header = (struct fat_header *)malloc(sizeof(struct fat_header));
-        if (!macho_read(this->load_addr, header.fat_header, sizeof(struct fat_header)))
-            return FALSE;
+        header.fat_header = (struct fat_header *)macho_view(this->load_addr, sizeof(struct fat_header));
+        if (!header.fat_header)
+        {
+            header.fat_header = (struct fat_header *)malloc(sizeof(struct fat_header));
+            if (!macho_read(this->load_addr, header.fat_header, sizeof(struct fat_header)))
+                return FALSE;
+        }
         Sdebug("dump arch-fat");
         break;
     default:
@@ -70,20 +78,23 @@ bool MachoFD::parse_universal()
 
     for (uint32_t i = 0; i < nfat; i++)
     {
-        struct fat_arch *arch = (struct fat_arch *)malloc(sizeof(struct fat_arch));
-        macho_read(addr + i * sizeof(struct fat_arch), arch, sizeof(struct fat_arch));
+        struct fat_arch *arch = (struct fat_arch *)macho_view(addr + i * sizeof(struct fat_arch), sizeof(struct fat_arch));
+        if (!arch)
+            return FALSE;
 
-        size_t length = OSSwapBigToHostInt32(arch->size);
+        // the slice must lie inside the file
+        if ((uint64_t)OSSwapBigToHostInt32(arch->offset) + OSSwapBigToHostInt32(arch->size) > this->input.fd.length)
+            return FALSE;
 
         input_t t;
         memcpy(&t, &this->input, sizeof(input_t));
         t.type = FD_INPUT;
         t.fd.data = (zpointer)((zaddr)this->input.fd.data + OSSwapBigToHostInt32(arch->offset));
         t.fd.baseAddr = (zaddr)t.fd.data;
+        t.fd.length = OSSwapBigToHostInt32(arch->size);
 
         MachoFD *macho = new MachoFD(t);
         macho->load_addr = (zaddr)macho->input.fd.data;
-        macho->input.fd = this->input.fd;
 
         fat_arch_info_t fat_arch_info;
         fat_arch_info.arch = arch;
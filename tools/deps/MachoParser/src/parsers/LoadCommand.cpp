@@ -68,41 +68,57 @@ bool Macho::parse_load_command_headers()
     for (int i = 0; i < ncmds; i++)
     {
         load_command_info_t load_cmd_info;
-        load_cmd = (struct load_command *)malloc(sizeof(struct load_command));
-        macho_runtime_read(tmp_addr, load_cmd, sizeof(struct load_command));
-
-        switch (load_cmd->cmd)
+        load_cmd = (struct load_command *)macho_runtime_view(tmp_addr, sizeof(struct load_command));
+        if (load_cmd)
         {
-        case LC_SEGMENT_64:
-            /* struct segment_command_64 *seg_cmd_64; */
-            cmd_info = (struct segment_command_64 *)malloc(
-                sizeof(struct segment_command_64));
-            macho_runtime_read(tmp_addr, cmd_info, sizeof(struct segment_command_64));
-            break;
-        case LC_ID_DYLINKER:
-            this->isDyldLinker = TRUE;
-            break;
-        case LC_SYMTAB:
-            /* struct symtab_command *sym_cmd; */
-            cmd_info = (struct symtab_command *)malloc(sizeof(struct symtab_command));
-            macho_runtime_read(tmp_addr, cmd_info, sizeof(struct symtab_command));
-            break;
-        case LC_FUNCTION_STARTS:
-            /* struct linkedit_data_command *funcstart_cmd; */
-            cmd_info = (struct linkedit_data_command *)malloc(
-                sizeof(struct linkedit_data_command));
-            macho_runtime_read(tmp_addr, cmd_info, sizeof(struct linkedit_data_command));
-            break;
-        case LC_LOAD_DYLINKER:
-            /* struct dylinker_command *dy_cmd; */
-            cmd_info =
-                (struct dylinker_command *)malloc(sizeof(struct dylinker_command));
-            macho_runtime_read(tmp_addr, cmd_info, sizeof(struct dylinker_command));
-            break;
-        default:
-            cmd_info = (struct load_command *)malloc(load_cmd->cmdsize);
-            macho_runtime_read(tmp_addr, cmd_info, load_cmd->cmdsize);
-            break;
+            /* the command is used in place, nothing is copied */
+            cmd_info = macho_runtime_view(tmp_addr, load_cmd->cmdsize);
+            if (!cmd_info || load_cmd->cmdsize < sizeof(struct load_command))
+            {
+                Serror("load command out of file.");
+                return FALSE;
+            }
+            if (load_cmd->cmd == LC_ID_DYLINKER)
+                this->isDyldLinker = TRUE;
+        }
+        else
+        {
+            load_cmd = (struct load_command *)malloc(sizeof(struct load_command));
+            macho_runtime_read(tmp_addr, load_cmd, sizeof(struct load_command));
+
+            switch (load_cmd->cmd)
+            {
+            case LC_SEGMENT_64:
+                /* struct segment_command_64 *seg_cmd_64; */
+                cmd_info = (struct segment_command_64 *)malloc(
+                    sizeof(struct segment_command_64));
+                macho_runtime_read(tmp_addr, cmd_info, sizeof(struct segment_command_64));
+                break;
+            case LC_ID_DYLINKER:
+                this->isDyldLinker = TRUE;
+                break;
+            case LC_SYMTAB:
+                /* struct symtab_command *sym_cmd; */
+                cmd_info = (struct symtab_command *)malloc(sizeof(struct symtab_command));
+                macho_runtime_read(tmp_addr, cmd_info, sizeof(struct symtab_command));
+                break;
+            case LC_FUNCTION_STARTS:
+                /* struct linkedit_data_command *funcstart_cmd; */
+                cmd_info = (struct linkedit_data_command *)malloc(
+                    sizeof(struct linkedit_data_command));
+                macho_runtime_read(tmp_addr, cmd_info, sizeof(struct linkedit_data_command));
+                break;
+            case LC_LOAD_DYLINKER:
+                /* struct dylinker_command *dy_cmd; */
+                cmd_info =
+                    (struct dylinker_command *)malloc(sizeof(struct dylinker_command));
+                macho_runtime_read(tmp_addr, cmd_info, sizeof(struct dylinker_command));
+                break;
+            default:
+                cmd_info = (struct load_command *)malloc(load_cmd->cmdsize);
+                macho_runtime_read(tmp_addr, cmd_info, load_cmd->cmdsize);
+                break;
+            }
         }
 
         load_cmd_info.cmd_info = cmd_info;
@@ -243,8 +259,12 @@ bool Macho::parse_LC_SEGMENT_64(const load_command_info_t *load_cmd_info)
 
     for (uint32_t nsect = 0; nsect < seg_cmd->nsects; nsect++)
     {
-        sect_64 = (struct section_64 *)malloc(sizeof(struct section_64));
-        macho_runtime_read(tmp_addr, sect_64, sizeof(section_64));
+        sect_64 = (struct section_64 *)macho_runtime_view(tmp_addr, sizeof(struct section_64));
+        if (!sect_64)
+        {
+            sect_64 = (struct section_64 *)malloc(sizeof(struct section_64));
+            macho_runtime_read(tmp_addr, sect_64, sizeof(section_64));
+        }
 
         Xdebug("\t section: %s's runtime addr: 0x%lx", sect_64->sectname, tmp_addr);
 
@@ -277,19 +297,34 @@ bool Macho::parse_LC_SYMTAB(const load_command_info_t *load_cmd_info)
     this->linkinfo.symtab_offset = sym_cmd->symoff;
     this->linkinfo.strtab_offset = sym_cmd->stroff;
 
-    struct nlist_64 *nlist;
-    nlist = (struct nlist_64 *)malloc(sizeof(struct nlist_64));
+    // the symbols are only walked on a full parse
+    if (this->parse_type == PARSE_SIMPLE)
+        return TRUE;
 
     zaddr tmp_addr = macho_link_address(this->linkinfo.symtab_offset);
+    struct nlist_64 *symtab = (struct nlist_64 *)macho_view(tmp_addr, (zsize)sym_cmd->nsyms * sizeof(struct nlist_64));
+    struct nlist_64 tmp_nlist;
+    struct nlist_64 *nlist;
     for (int i = 0; i < sym_cmd->nsyms; i++)
     {
-        macho_read(tmp_addr, nlist, sizeof(struct nlist_64));
+        if (symtab)
+        {
+            nlist = &symtab[i];
+        }
+        else
+        {
+            nlist = &tmp_nlist;
+            if (!macho_read(tmp_addr, nlist, sizeof(struct nlist_64)))
+                break;
+        }
         if (nlist->n_un.n_strx > 1)
         {
-            char *sym_name = macho_read_string(macho_link_address(this->linkinfo.strtab_offset + nlist->n_un.n_strx));
-            if (sym_name)
+            zaddr sym_name_addr = macho_link_address(this->linkinfo.strtab_offset + nlist->n_un.n_strx);
+            const char *sym_name_view = macho_view_string(sym_name_addr);
+            char *sym_name = sym_name_view ? NULL : macho_read_string(sym_name_addr);
+            if (sym_name_view || sym_name)
             {
-                if (!strcmp(sym_name, "_dlopen"))
+                if (!strcmp(sym_name_view ? sym_name_view : sym_name, "_dlopen"))
                 {
                     Xinfo("found function _dlopen: 0x%llx", this->load_addr + nlist->n_value);
                 }
@@ -333,6 +368,9 @@ bool Macho::parse_LC_FUNCTION_STARTS(const load_command_info_t *load_cmd_info)
     const uint8_t *infoStart = NULL;
     const uint8_t *infoEnd;
 
+    if (this->parse_type == PARSE_SIMPLE)
+        return TRUE;
+
     func_start_cmd = (struct linkedit_data_command *)load_cmd_info->cmd_info;
 
     infoStart = (uint8_t *)(macho_link_address(func_start_cmd->dataoff));
@@ -341,7 +379,7 @@ bool Macho::parse_LC_FUNCTION_STARTS(const load_command_info_t *load_cmd_info)
     zaddr tmp = 0;
     unsigned n = 0;
     zaddr func_vmaddr = this->load_vmaddr;
-    for (const uint8_t *p = infoStart; (*p != 0) && (p < infoEnd);)
+    for (const uint8_t *p = infoStart; (p < infoEnd) && (*p != 0);)
     {
         uint8_t tmp_uleb128[8];
 